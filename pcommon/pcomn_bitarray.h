@@ -33,11 +33,15 @@
 #include <pcomn_integer.h>
 #include <pcomn_function.h>
 #include <pcomn_iterator.h>
+#include <pcomn_bitrank.h>
+#include <pcomn_bitkernels.h>
 
 #include <algorithm>
 #include <iterator>
 #include <vector>
 #include <iostream>
+#include <atomic>
+#include <memory>
 
 #include <limits.h>
 #include <stdint.h>
@@ -61,7 +65,7 @@ struct bitarray_base {
             return 0 ;
          auto &ones = cb(cdata())->cached_popcount() ;
          if (ones == ~0UL)
-            ones = bitop::popcount(cbits(), nelements()) ;
+            ones = bulk_popcount(cbits(), nelements()) ;
          return bitval ? ones : _size - ones ;
       }
 
@@ -103,6 +107,20 @@ struct bitarray_base {
       /// If there is no such bit, returns 'finish'
       size_t find_first_bit(size_t start = 0, size_t finish = -1) const ;
 
+      /// @name Rank/select
+      /// The first call builds the rank/select index (see bitrank_index), which is kept
+      /// until the array is changed; the index takes 25% of the array memory.
+      /**@{*/
+      /// Get the count of 1s at positions [0, pos), pos <= size().
+      size_t rank1(size_t pos) const { return rank_index().rank1(pos) ; }
+      /// Get the count of 0s at positions [0, pos), pos <= size().
+      size_t rank0(size_t pos) const { return rank_index().rank0(pos) ; }
+      /// Get the position of the k-th (0-based) 1, or size() if there is no such bit.
+      size_t select1(size_t k) const { return rank_index().select1(k) ; }
+      /// Get the position of the k-th (0-based) 0, or size() if there is no such bit.
+      size_t select0(size_t k) const { return rank_index().select0(k) ; }
+      /**@}*/
+
    protected:
       // The type of element of an array in which we store bits.
       typedef Element element_type ;
@@ -133,38 +151,57 @@ struct bitarray_base {
          bitarray_base(start, finish, is_iterator<InputIterator, std::random_access_iterator_tag>())
       {}
 
-      bitarray_base(const bitarray_base &) = default ;
+      // The rank index is not copied: the copy builds its own if needed.
+      bitarray_base(const bitarray_base &other) :
+         _size(other._size), _elements(other._elements)
+      {}
 
       bitarray_base(bitarray_base &&other) :
-         _size(other._size), _elements(std::move(other._elements))
+         _size(other._size), _elements(std::move(other._elements)),
+         _rank_index(other._rank_index.exchange(nullptr, std::memory_order_relaxed))
       {
          other._size = 0 ;
       }
 
-      ~bitarray_base() = default ;
+      ~bitarray_base() { reset_rank_index() ; }
 
-      bitarray_base &operator=(const bitarray_base &other) = default ;
+      bitarray_base &operator=(const bitarray_base &other)
+      {
+         if (&other != this)
+         {
+            reset_rank_index() ;
+            _size = other._size ;
+            _elements = other._elements ;
+         }
+         return *this ;
+      }
 
       bitarray_base &operator=(bitarray_base &&other)
       {
          if (&other != this)
          {
+            reset_rank_index() ;
             _size = other._size ;
             other._size = 0 ;
             _elements = std::move(other._elements) ;
+            _rank_index.store(other._rank_index.exchange(nullptr, std::memory_order_relaxed),
+                              std::memory_order_relaxed) ;
          }
          return *this ;
       }
 
 
+      // The bulk kernel for an operation (see pcomn_bitkernels.h)
+      typedef bitop::bulk_kernels::assign_kernel bitop::bulk_kernels::*bulk_assign ;
+
       template<typename Operator>
-      void op_assign(const bitarray_base &source, Operator op) ;
+      void op_assign(const bitarray_base &source, Operator op, bulk_assign kernel) ;
 
       template<typename Operator>
-      void op_assign_skip_self(const bitarray_base &source, Operator op)
+      void op_assign_skip_self(const bitarray_base &source, Operator op, bulk_assign kernel)
       {
          if (cbits() != source.cbits())
-            op_assign(source, op) ;
+            op_assign(source, op, kernel) ;
       }
 
       void reset() { size() && memset(mdata(), 0, _elements.size()) ; }
@@ -200,13 +237,16 @@ struct bitarray_base {
          const item_type * const data2 = other.cdata() ;
          return
             data1 == data2 ||
-            _size == other._size && !memcmp(data1 + 1, data2 + 1, _elements.size() - sizeof *data1) ;
+            _size == other._size && bulk_equal(data1 + 1, data2 + 1, _elements.size()/sizeof *data1 - 1) ;
       }
 
       void swap(bitarray_base &other) noexcept
       {
          std::swap(other._size, _size) ;
          _elements.swap(other._elements) ;
+         _rank_index.store(other._rank_index.exchange(_rank_index.load(std::memory_order_relaxed),
+                                                      std::memory_order_relaxed),
+                           std::memory_order_relaxed) ;
       }
 
       /// Given a bit position, get the position of an element containing specified bit
@@ -254,6 +294,9 @@ struct bitarray_base {
    private:
       size_t      _size  = 0UL ;
       cow_buffer  _elements ;
+      // Built lazily by a const method, so may be concurrently created by several
+      // readers: only one wins, see rank_index().
+      mutable std::atomic<const bitrank_index *> _rank_index {nullptr} ;
 
       // Fake control block data for zero-sized bitarrays
       static const item_type _empty_data[control_block::size(1)] ;
@@ -313,9 +356,32 @@ struct bitarray_base {
          NOXCHECK(_size) ;
          item_type * const data = static_cast<item_type *>(_elements.get()) ;
          cb(data)->cached_popcount() = ~0UL ;
+         reset_rank_index() ;
          return data ;
       }
 
+      const bitrank_index &rank_index() const
+      {
+         PCOMN_STATIC_CHECK(sizeof(element_type) == sizeof(uint64_t)) ;
+
+         const bitrank_index *index = _rank_index.load(std::memory_order_acquire) ;
+         if (unlikely(!index))
+         {
+            std::unique_ptr<bitrank_index> created
+               (new bitrank_index(reinterpret_cast<const uint64_t *>(cbits()), size())) ;
+
+            if (_rank_index.compare_exchange_strong(index, created.get(), std::memory_order_acq_rel))
+               index = created.release() ;
+         }
+         return *index ;
+      }
+
+      void reset_rank_index()
+      {
+         if (_rank_index.load(std::memory_order_relaxed))
+            delete _rank_index.exchange(nullptr, std::memory_order_relaxed) ;
+      }
+
       const element_type &const_elem(size_t bitpos) const { return cbits()[cellndx(bitpos)] ; }
 
    private:
@@ -362,6 +428,38 @@ struct bitarray_base {
       {
          update_element(data, nelements() - 1, tailmask(size()), std::bit_and<element_type>()) ;
       }
+
+      /*************************************************************************
+       Bulk operations: use runtime-dispatched SIMD kernels if elements are 64-bit
+      *************************************************************************/
+      static constexpr bool has_bulk_kernels = sizeof(element_type) == sizeof(uint64_t) ;
+
+      template<typename T>
+      static auto words(T *data) -> std::conditional_t<std::is_const<T>::value, const uint64_t *, uint64_t *>
+      {
+         return reinterpret_cast<std::conditional_t<std::is_const<T>::value, const uint64_t *, uint64_t *>>(data) ;
+      }
+
+      static size_t bulk_popcount(const element_type *data, size_t n)
+      {
+         return has_bulk_kernels
+            ? bitop::bulk().popcount(words(data), n)
+            : bitop::popcount(data, n) ;
+      }
+
+      static bool bulk_equal(const item_type *x, const item_type *y, size_t n)
+      {
+         return has_bulk_kernels
+            ? bitop::bulk().equal(words(x), words(y), n)
+            : !memcmp(x, y, n*sizeof *x) ;
+      }
+
+      static size_t bulk_find_nonzero(const element_type *data, size_t n)
+      {
+         return has_bulk_kernels
+            ? bitop::bulk().find_nonzero(words(data), n)
+            : std::find_if(data, data + n, identity()) - data ;
+      }
 } ;
 
 /******************************************************************************/
@@ -519,6 +617,10 @@ class bitarray : private bitarray_base<uintptr_t> {
       using ancestor::any ;
       using ancestor::all ;
       using ancestor::find_first_bit ;
+      using ancestor::rank1 ;
+      using ancestor::rank0 ;
+      using ancestor::select1 ;
+      using ancestor::select0 ;
 
       constexpr bitarray() {}
 
@@ -546,27 +648,29 @@ class bitarray : private bitarray_base<uintptr_t> {
 
       bitarray &operator&=(const bitarray &source)
       {
-         op_assign_skip_self(source, std::bit_and<element_type>()) ;
+         op_assign_skip_self(source, std::bit_and<element_type>(), &bitop::bulk_kernels::and_assign) ;
          return *this ;
       }
 
       bitarray &operator|=(const bitarray &source)
       {
-         op_assign_skip_self(source, std::bit_or<element_type>()) ;
+         op_assign_skip_self(source, std::bit_or<element_type>(), &bitop::bulk_kernels::or_assign) ;
          return *this ;
       }
 
       bitarray &operator^=(const bitarray &source)
       {
-         op_assign(source, std::bit_xor<element_type>()) ;
+         op_assign(source, std::bit_xor<element_type>(), &bitop::bulk_kernels::xor_assign) ;
          return *this ;
       }
 
       bitarray &operator-=(const bitarray &source)
       {
          size() >= source.size()
-            ? op_assign(source, [](element_type x, element_type y) { return x &~ y ; })
-            : op_assign(source, [](element_type x, element_type y) { return y &~ x ; }) ;
+            ? op_assign(source, [](element_type x, element_type y) { return x &~ y ; },
+                        &bitop::bulk_kernels::andnot_assign)
+            : op_assign(source, [](element_type x, element_type y) { return y &~ x ; },
+                        &bitop::bulk_kernels::notand_assign) ;
          return *this ;
       }
 
@@ -722,7 +826,7 @@ void bitarray_base<Element>::flip()
 
 template<typename Element>
 template<typename Operator>
-void bitarray_base<Element>::op_assign(const bitarray_base &source, Operator op)
+void bitarray_base<Element>::op_assign(const bitarray_base &source, Operator op, bulk_assign kernel)
 {
    const element_type *source_bits = source.cbits() ;
    bitarray_base input (source) ;
@@ -737,6 +841,21 @@ void bitarray_base<Element>::op_assign(const bitarray_base &source, Operator op)
 
    item_type * const outdata = mdata() ;
 
+   if (has_bulk_kernels)
+   {
+      // Apply the operation to the whole arrays, then rebuild the nonzero map
+      element_type * const outbits = bits(outdata) ;
+      (bitop::bulk().*kernel)(words(outbits), words(source_bits), ninput) ;
+
+      // For all the bitwise operations, op(x, 0) is either x or 0
+      if (!op(~element_type(), 0))
+         std::fill(outbits + ninput, outbits + noutput, element_type()) ;
+      fix_tail(outdata) ;
+
+      bitop::bulk().nonzero_map(words(outbits), noutput, words(nzmap(outdata))) ;
+      return ;
+   }
+
    size_t ndx ;
    for (ndx = 0 ; ndx < ninput ; ++ndx)
       update_element(outdata, ndx, source_bits[ndx], op) ;
@@ -772,12 +891,16 @@ size_t bitarray_base<Element>::find_first_bit(size_t start, size_t finish) const
 
       size_t current_nzcellndx = cellndx(current_elemndx) ;
       element_type nzcell = nzmap_cells[current_nzcellndx] & (~element_type() << bitndx(current_elemndx)) ;
-      for ( ; !nzcell ; nzcell = nzmap_cells[current_nzcellndx])
+      if (!nzcell)
       {
+         // Nonzero map cells covering bits before finish
+         const size_t nzcell_count = nzmapcellndx(finish - 1) + 1 ;
          ++current_nzcellndx ;
-         start = current_nzcellndx * (BITS_PER_ELEMENT * BITS_PER_ELEMENT) ;
-         if (start >= finish)
+         current_nzcellndx += bulk_find_nonzero(nzmap_cells + current_nzcellndx,
+                                                nzcell_count - std::min(current_nzcellndx, nzcell_count)) ;
+         if (current_nzcellndx >= nzcell_count)
             return finish ;
+         nzcell = nzmap_cells[current_nzcellndx] ;
       }
       current_elemndx = current_nzcellndx * BITS_PER_ELEMENT + bitop::rzcnt(nzcell) ;
       NOXCHECK(current_elemndx < nelements()) ;
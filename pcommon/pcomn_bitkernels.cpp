@@ -0,0 +1,178 @@
+/*-*- tab-width: 3; indent-tabs-mode: nil; c-file-style: "ellemtel"; c-file-offsets:((innamespace . 0)) -*-*/
+/*******************************************************************************
+ FILE         :   pcomn_bitkernels.cpp
+ COPYRIGHT    :   Yakov Markovitch, 2026. All rights reserved.
+                  See LICENSE for information on usage/redistribution.
+
+ DESCRIPTION  :   Generic bulk bit kernels and the runtime selection of ISA-specific
+                  kernels.
+
+ PROGRAMMED BY:   Yakov Markovitch
+ CREATION DATE:   16 Oct 2026
+*******************************************************************************/
+#include <pcomn_bitkernels.h>
+#include <pcomn_isakernels.h>
+#include <pcomn_bitops.h>
+
+#include <algorithm>
+
+#include <string.h>
+
+#if defined(PCOMN_PL_X86) && defined(PCOMN_COMPILER_GNU)
+#  define PCOMN_BITKERNELS_X86 1
+#endif
+
+namespace pcomn {
+namespace bitop {
+
+/*******************************************************************************
+ Generic kernels: the ISA the library is compiled for
+*******************************************************************************/
+namespace {
+size_t generic_popcount(const uint64_t *data, size_t n)
+{
+   size_t cnt = 0 ;
+   for (size_t i = 0 ; i < n ; ++i)
+      cnt += popcount(data[i]) ;
+   return cnt ;
+}
+
+void generic_and_assign(uint64_t *dest, const uint64_t *src, size_t n)
+{
+   for (size_t i = 0 ; i < n ; ++i)
+      dest[i] &= src[i] ;
+}
+
+void generic_or_assign(uint64_t *dest, const uint64_t *src, size_t n)
+{
+   for (size_t i = 0 ; i < n ; ++i)
+      dest[i] |= src[i] ;
+}
+
+void generic_xor_assign(uint64_t *dest, const uint64_t *src, size_t n)
+{
+   for (size_t i = 0 ; i < n ; ++i)
+      dest[i] ^= src[i] ;
+}
+
+void generic_andnot_assign(uint64_t *dest, const uint64_t *src, size_t n)
+{
+   for (size_t i = 0 ; i < n ; ++i)
+      dest[i] &= ~src[i] ;
+}
+
+void generic_notand_assign(uint64_t *dest, const uint64_t *src, size_t n)
+{
+   for (size_t i = 0 ; i < n ; ++i)
+      dest[i] = ~dest[i] & src[i] ;
+}
+
+size_t generic_find_nonzero(const uint64_t *data, size_t n)
+{
+   size_t i = 0 ;
+   while (i < n && !data[i])
+      ++i ;
+   return i ;
+}
+
+bool generic_equal(const uint64_t *x, const uint64_t *y, size_t n)
+{
+   return x == y || !memcmp(x, y, n*sizeof *x) ;
+}
+
+void generic_nonzero_map(const uint64_t *data, size_t n, uint64_t *map)
+{
+   for (size_t i = 0 ; i < n ; i += 64)
+   {
+      uint64_t m = 0 ;
+      for (size_t j = 0, jend = std::min<size_t>(n - i, 64) ; j < jend ; ++j)
+         m |= uint64_t(!!data[i + j]) << j ;
+      *map++ = m ;
+   }
+}
+} // end of anonymous namespace
+
+/*******************************************************************************
+ Kernel tables
+*******************************************************************************/
+namespace detail {
+
+std::atomic<const bulk_kernels *> selected_bulk_kernels {nullptr} ;
+
+static const bulk_kernels generic_bulk_kernels = {
+   kernel_isa::generic, "generic",
+   generic_popcount,
+   generic_and_assign,
+   generic_or_assign,
+   generic_xor_assign,
+   generic_andnot_assign,
+   generic_notand_assign,
+   generic_find_nonzero,
+   generic_equal,
+   generic_nonzero_map
+} ;
+
+#ifdef PCOMN_BITKERNELS_X86
+// Defined in pcomn_bitkernels_avx2.cpp and pcomn_bitkernels_avx512.cpp, which are
+// compiled with the appropriate -m options
+extern const bulk_kernels avx2_bulk_kernels ;
+extern const bulk_kernels avx512_bulk_kernels ;
+#endif
+
+static const bulk_kernels * const kernel_tables[kernel_isa_count] = {
+   &generic_bulk_kernels,
+#ifdef PCOMN_BITKERNELS_X86
+   &avx2_bulk_kernels,
+   &avx512_bulk_kernels
+#endif
+} ;
+
+const bulk_kernels &select_bulk_kernels()
+{
+   return pcomn::detail::select_isa_kernels(selected_bulk_kernels, kernel_tables, is_kernel_isa_supported,
+                                            "PCOMN_BITOPS_ISA") ;
+}
+
+} // end of namespace pcomn::bitop::detail
+
+/*******************************************************************************
+ Kernel selection
+*******************************************************************************/
+bool is_kernel_isa_supported(kernel_isa isa)
+{
+   switch (isa)
+   {
+      case kernel_isa::generic:
+         return true ;
+
+#ifdef PCOMN_BITKERNELS_X86
+      case kernel_isa::avx2:
+         __builtin_cpu_init() ;
+         return
+            __builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt") &&
+            __builtin_cpu_supports("bmi") && __builtin_cpu_supports("bmi2") ;
+
+      case kernel_isa::avx512:
+         return
+            is_kernel_isa_supported(kernel_isa::avx2) &&
+            __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512vpopcntdq") ;
+#endif
+
+      default: break ;
+   }
+   return false ;
+}
+
+const bulk_kernels &get_bulk_kernels(kernel_isa isa)
+{
+   return pcomn::detail::get_isa_kernels(detail::kernel_tables, is_kernel_isa_supported, isa, "Bulk bit kernels") ;
+}
+
+kernel_isa set_bulk_kernels(kernel_isa isa)
+{
+   return pcomn::detail::replace_isa_kernels(detail::selected_bulk_kernels, get_bulk_kernels(isa),
+                                             detail::select_bulk_kernels) ;
+}
+
+} // end of namespace pcomn::bitop
+} // end of namespace pcomn
@@ -0,0 +1,112 @@
+/*-*- mode:c++;tab-width:3;indent-tabs-mode:nil;c-file-style:"ellemtel";c-file-offsets:((innamespace . 0)(inclass . ++)) -*-*/
+#ifndef __PCOMN_BITKERNELS_H
+#define __PCOMN_BITKERNELS_H
+/*******************************************************************************
+ FILE         :   pcomn_bitkernels.h
+ COPYRIGHT    :   Yakov Markovitch, 2026. All rights reserved.
+                  See LICENSE for information on usage/redistribution.
+
+ DESCRIPTION  :   Bulk operations over arrays of 64-bit words with the implementation
+                  selected at runtime by the CPU the code is executing on.
+
+ CREATION DATE:   16 Oct 2026
+*******************************************************************************/
+/** @file
+ Bulk bit kernels (popcount, and/or/xor/andnot, nonzero word search, equality) with
+ runtime CPU dispatch.
+
+ The library object code is generated for the baseline ISA (see -march in
+ CMakeLists.txt), while the kernels are compiled in separate translation units for
+ every supported ISA variant. The most advanced variant the executing CPU supports is
+ selected on the first call to bitop::bulk().
+
+ The selection can be overriden with PCOMN_BITOPS_ISA environment variable (generic,
+ avx2, avx512), or by bitop::set_bulk_kernels() (e.g. in tests).
+*******************************************************************************/
+#include <pcomn_platform.h>
+
+#include <atomic>
+
+#include <stdint.h>
+#include <stddef.h>
+
+namespace pcomn {
+namespace bitop {
+
+/// Instruction set variants of the bulk kernels, from the least to the most advanced.
+enum class kernel_isa : unsigned {
+   generic, /**< The ISA the library is compiled for */
+   avx2,    /**< AVX2, BMI1, BMI2, POPCNT */
+   avx512   /**< AVX2 plus AVX-512F and AVX-512 VPOPCNTDQ */
+} ;
+
+/// The count of kernel_isa values.
+constexpr unsigned kernel_isa_count = (unsigned)kernel_isa::avx512 + 1 ;
+
+/******************************************************************************/
+/** The table of bulk kernels for a single ISA variant.
+
+ All the kernels work on arrays of @a n 64-bit words; @a dest and @a src may be equal
+ but must not overlap otherwise.
+*******************************************************************************/
+struct bulk_kernels {
+      typedef void (*assign_kernel)(uint64_t *dest, const uint64_t *src, size_t n) ;
+
+      kernel_isa isa ;
+      const char *name ;
+
+      /// Count 1s in data[0..n)
+      size_t (*popcount)(const uint64_t *data, size_t n) ;
+
+      /// dest[i] &= src[i]
+      assign_kernel and_assign ;
+      /// dest[i] |= src[i]
+      assign_kernel or_assign ;
+      /// dest[i] ^= src[i]
+      assign_kernel xor_assign ;
+      /// dest[i] &= ~src[i]
+      assign_kernel andnot_assign ;
+      /// dest[i] = ~dest[i] & src[i]
+      assign_kernel notand_assign ;
+
+      /// Get the index of the first nonzero word in data[0..n), or n if all are zero.
+      size_t (*find_nonzero)(const uint64_t *data, size_t n) ;
+
+      /// Check x[0..n) and y[0..n) for equality.
+      bool (*equal)(const uint64_t *x, const uint64_t *y, size_t n) ;
+
+      /// Make the map of nonzero words: bit i of the map is set iff data[i] != 0.
+      /// The map is (n + 63)/64 words.
+      void (*nonzero_map)(const uint64_t *data, size_t n, uint64_t *map) ;
+} ;
+
+/// Check if the executing CPU supports the specified kernel variant.
+/// kernel_isa::generic is always supported.
+bool is_kernel_isa_supported(kernel_isa isa) ;
+
+/// Get the table of kernels for the specified ISA.
+/// @throw std::invalid_argument The ISA is not supported by the executing CPU.
+const bulk_kernels &get_bulk_kernels(kernel_isa isa) ;
+
+/// Select the kernels used by bulk().
+/// @return The previously selected ISA.
+/// @throw std::invalid_argument The ISA is not supported by the executing CPU.
+kernel_isa set_bulk_kernels(kernel_isa isa) ;
+
+namespace detail {
+extern std::atomic<const bulk_kernels *> selected_bulk_kernels ;
+
+const bulk_kernels &select_bulk_kernels() ;
+} // end of namespace pcomn::bitop::detail
+
+/// Get the currently selected bulk kernels.
+inline const bulk_kernels &bulk()
+{
+   const bulk_kernels * const selected = detail::selected_bulk_kernels.load(std::memory_order_acquire) ;
+   return likely(selected) ? *selected : detail::select_bulk_kernels() ;
+}
+
+} // end of namespace pcomn::bitop
+} // end of namespace pcomn
+
+#endif /* __PCOMN_BITKERNELS_H */
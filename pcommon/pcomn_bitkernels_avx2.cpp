@@ -0,0 +1,207 @@
+/*-*- tab-width: 3; indent-tabs-mode: nil; c-file-style: "ellemtel"; c-file-offsets:((innamespace . 0)) -*-*/
+/*******************************************************************************
+ FILE         :   pcomn_bitkernels_avx2.cpp
+ COPYRIGHT    :   Yakov Markovitch, 2026. All rights reserved.
+                  See LICENSE for information on usage/redistribution.
+
+ DESCRIPTION  :   AVX2 bulk bit kernels.
+                  Must be compiled with -mavx2 -mbmi -mbmi2 -mpopcnt regardless of the
+                  ISA the rest of the library is compiled for; called only if the CPU
+                  supports AVX2 (see pcomn_bitkernels.cpp).
+
+ PROGRAMMED BY:   Yakov Markovitch
+ CREATION DATE:   16 Oct 2026
+*******************************************************************************/
+#include <pcomn_bitkernels.h>
+
+#if defined(PCOMN_PL_X86) && defined(PCOMN_COMPILER_GNU)
+
+#ifndef PCOMN_PL_SIMD_AVX2
+#error pcomn_bitkernels_avx2.cpp must be compiled for AVX2 instruction set.
+#endif
+
+#include <immintrin.h>
+
+namespace pcomn {
+namespace bitop {
+
+namespace {
+// Not std::min(), see pcomn_isakernels.h
+inline size_t min_size(size_t x, size_t y) { return x < y ? x : y ; }
+
+inline __m256i load(const uint64_t *p) { return _mm256_loadu_si256((const __m256i *)p) ; }
+inline void store(uint64_t *p, __m256i v) { _mm256_storeu_si256((__m256i *)p, v) ; }
+
+// Get 4 bits, one for every nonzero 64-bit lane of v
+inline unsigned nonzero_lanes(__m256i v)
+{
+   return ~_mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(v, _mm256_setzero_si256()))) & 0xf ;
+}
+
+/*******************************************************************************
+ Popcount: in-register nibble lookup table (Mula's algorithm), byte counts are
+ summed by PSADBW.
+*******************************************************************************/
+inline __m256i popcount_bytes(__m256i v)
+{
+   const __m256i lookup = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                           0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4) ;
+   const __m256i low_nibbles = _mm256_set1_epi8(0x0f) ;
+
+   return _mm256_add_epi8(_mm256_shuffle_epi8(lookup, _mm256_and_si256(v, low_nibbles)),
+                          _mm256_shuffle_epi8(lookup, _mm256_and_si256(_mm256_srli_epi16(v, 4), low_nibbles))) ;
+}
+
+size_t avx2_popcount(const uint64_t *data, size_t n)
+{
+   // Every byte counter gets at most 8 per vector, so it may accumulate up to 31 vectors
+   // without overflow
+   constexpr size_t max_accumulated = 4*31 ;
+
+   const size_t vend = n & ~size_t(3) ;
+   __m256i total = _mm256_setzero_si256() ;
+   size_t i = 0 ;
+
+   while (i < vend)
+   {
+      __m256i bytes = _mm256_setzero_si256() ;
+      for (const size_t end = min_size(i + max_accumulated, vend) ; i < end ; i += 4)
+         bytes = _mm256_add_epi8(bytes, popcount_bytes(load(data + i))) ;
+      total = _mm256_add_epi64(total, _mm256_sad_epu8(bytes, _mm256_setzero_si256())) ;
+   }
+
+   size_t cnt =
+      _mm256_extract_epi64(total, 0) + _mm256_extract_epi64(total, 1) +
+      _mm256_extract_epi64(total, 2) + _mm256_extract_epi64(total, 3) ;
+
+   for (; i < n ; ++i)
+      cnt += _mm_popcnt_u64(data[i]) ;
+   return cnt ;
+}
+
+/*******************************************************************************
+ Bitwise operations
+*******************************************************************************/
+template<typename VectorOp, typename ScalarOp>
+inline void assign_op(uint64_t *dest, const uint64_t *src, size_t n, VectorOp vop, ScalarOp sop)
+{
+   size_t i = 0 ;
+   for (; i + 8 <= n ; i += 8)
+   {
+      const __m256i r0 = vop(load(dest + i), load(src + i)) ;
+      const __m256i r1 = vop(load(dest + i + 4), load(src + i + 4)) ;
+      store(dest + i, r0) ;
+      store(dest + i + 4, r1) ;
+   }
+   for (; i < n ; ++i)
+      dest[i] = sop(dest[i], src[i]) ;
+}
+
+void avx2_and_assign(uint64_t *dest, const uint64_t *src, size_t n)
+{
+   assign_op(dest, src, n,
+             [](__m256i x, __m256i y) { return _mm256_and_si256(x, y) ; },
+             [](uint64_t x, uint64_t y) { return x & y ; }) ;
+}
+
+void avx2_or_assign(uint64_t *dest, const uint64_t *src, size_t n)
+{
+   assign_op(dest, src, n,
+             [](__m256i x, __m256i y) { return _mm256_or_si256(x, y) ; },
+             [](uint64_t x, uint64_t y) { return x | y ; }) ;
+}
+
+void avx2_xor_assign(uint64_t *dest, const uint64_t *src, size_t n)
+{
+   assign_op(dest, src, n,
+             [](__m256i x, __m256i y) { return _mm256_xor_si256(x, y) ; },
+             [](uint64_t x, uint64_t y) { return x ^ y ; }) ;
+}
+
+void avx2_andnot_assign(uint64_t *dest, const uint64_t *src, size_t n)
+{
+   assign_op(dest, src, n,
+             [](__m256i x, __m256i y) { return _mm256_andnot_si256(y, x) ; },
+             [](uint64_t x, uint64_t y) { return x &~ y ; }) ;
+}
+
+void avx2_notand_assign(uint64_t *dest, const uint64_t *src, size_t n)
+{
+   assign_op(dest, src, n,
+             [](__m256i x, __m256i y) { return _mm256_andnot_si256(x, y) ; },
+             [](uint64_t x, uint64_t y) { return ~x & y ; }) ;
+}
+
+/*******************************************************************************
+ Search and comparison
+*******************************************************************************/
+size_t avx2_find_nonzero(const uint64_t *data, size_t n)
+{
+   size_t i = 0 ;
+   for (; i + 8 <= n ; i += 8)
+   {
+      const __m256i v0 = load(data + i) ;
+      const __m256i v1 = load(data + i + 4) ;
+      const __m256i any = _mm256_or_si256(v0, v1) ;
+      if (!_mm256_testz_si256(any, any))
+         return i + _tzcnt_u32(nonzero_lanes(v0) | nonzero_lanes(v1) << 4) ;
+   }
+   while (i < n && !data[i])
+      ++i ;
+   return i ;
+}
+
+bool avx2_equal(const uint64_t *x, const uint64_t *y, size_t n)
+{
+   if (x == y)
+      return true ;
+
+   size_t i = 0 ;
+   for (; i + 8 <= n ; i += 8)
+   {
+      const __m256i diff = _mm256_or_si256(_mm256_xor_si256(load(x + i), load(y + i)),
+                                           _mm256_xor_si256(load(x + i + 4), load(y + i + 4))) ;
+      if (!_mm256_testz_si256(diff, diff))
+         return false ;
+   }
+   for (; i < n ; ++i)
+      if (x[i] != y[i])
+         return false ;
+   return true ;
+}
+
+void avx2_nonzero_map(const uint64_t *data, size_t n, uint64_t *map)
+{
+   for (size_t i = 0 ; i < n ; i += 64)
+   {
+      const size_t jend = min_size(n - i, 64) ;
+      uint64_t m = 0 ;
+      size_t j = 0 ;
+      for (; j + 4 <= jend ; j += 4)
+         m |= uint64_t(nonzero_lanes(load(data + i + j))) << j ;
+      for (; j < jend ; ++j)
+         m |= uint64_t(!!data[i + j]) << j ;
+      *map++ = m ;
+   }
+}
+} // end of anonymous namespace
+
+namespace detail {
+extern const bulk_kernels avx2_bulk_kernels = {
+   kernel_isa::avx2, "avx2",
+   avx2_popcount,
+   avx2_and_assign,
+   avx2_or_assign,
+   avx2_xor_assign,
+   avx2_andnot_assign,
+   avx2_notand_assign,
+   avx2_find_nonzero,
+   avx2_equal,
+   avx2_nonzero_map
+} ;
+} // end of namespace pcomn::bitop::detail
+
+} // end of namespace pcomn::bitop
+} // end of namespace pcomn
+
+#endif /* PCOMN_PL_X86 && PCOMN_COMPILER_GNU */
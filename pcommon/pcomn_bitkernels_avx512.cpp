@@ -0,0 +1,160 @@
+/*-*- tab-width: 3; indent-tabs-mode: nil; c-file-style: "ellemtel"; c-file-offsets:((innamespace . 0)) -*-*/
+/*******************************************************************************
+ FILE         :   pcomn_bitkernels_avx512.cpp
+ COPYRIGHT    :   Yakov Markovitch, 2026. All rights reserved.
+                  See LICENSE for information on usage/redistribution.
+
+ DESCRIPTION  :   AVX-512 bulk bit kernels (AVX-512F and VPOPCNTDQ).
+                  Must be compiled with -mavx512f -mavx512vpopcntdq (plus AVX2 options)
+                  regardless of the ISA the rest of the library is compiled for;
+                  called only if the CPU supports AVX-512 VPOPCNTDQ (see
+                  pcomn_bitkernels.cpp).
+
+ PROGRAMMED BY:   Yakov Markovitch
+ CREATION DATE:   16 Oct 2026
+*******************************************************************************/
+#include <pcomn_bitkernels.h>
+
+#if defined(PCOMN_PL_X86) && defined(PCOMN_COMPILER_GNU)
+
+#ifndef PCOMN_PL_SIMD_AVX512
+#error pcomn_bitkernels_avx512.cpp must be compiled for AVX-512F and AVX-512 VPOPCNTDQ instruction sets.
+#endif
+
+#include <immintrin.h>
+
+namespace pcomn {
+namespace bitop {
+
+/*******************************************************************************
+ Every kernel processes the tail shorter than a vector with masked loads/stores, so
+ there are no scalar loops.
+*******************************************************************************/
+namespace {
+// Not std::min(), see pcomn_isakernels.h
+inline size_t min_size(size_t x, size_t y) { return x < y ? x : y ; }
+
+inline __m512i load(const uint64_t *p) { return _mm512_loadu_si512(p) ; }
+inline void store(uint64_t *p, __m512i v) { _mm512_storeu_si512(p, v) ; }
+
+// Get the mask of the first n < 8 lanes
+inline __mmask8 tail_mask(size_t n) { return (__mmask8)((1U << n) - 1) ; }
+
+inline __m512i load_tail(const uint64_t *p, size_t n) { return _mm512_maskz_loadu_epi64(tail_mask(n), p) ; }
+
+size_t avx512_popcount(const uint64_t *data, size_t n)
+{
+   __m512i total = _mm512_setzero_si512() ;
+   size_t i = 0 ;
+   for (; i + 16 <= n ; i += 16)
+      total = _mm512_add_epi64(total,
+                               _mm512_add_epi64(_mm512_popcnt_epi64(load(data + i)),
+                                                _mm512_popcnt_epi64(load(data + i + 8)))) ;
+   for (; i < n ; i += 8)
+      total = _mm512_add_epi64(total, _mm512_popcnt_epi64(load_tail(data + i, min_size(n - i, 8)))) ;
+
+   // Sum the lanes through memory: _mm512_reduce_add_epi64() triggers spurious
+   // -Wuninitialized in GCC 12
+   alignas(64) uint64_t lanes[8] ;
+   _mm512_store_si512(lanes, total) ;
+   return lanes[0] + lanes[1] + lanes[2] + lanes[3] + lanes[4] + lanes[5] + lanes[6] + lanes[7] ;
+}
+
+template<typename VectorOp>
+inline void assign_op(uint64_t *dest, const uint64_t *src, size_t n, VectorOp op)
+{
+   size_t i = 0 ;
+   for (; i + 8 <= n ; i += 8)
+      store(dest + i, op(load(dest + i), load(src + i))) ;
+   if (const size_t tail = n - i)
+      _mm512_mask_storeu_epi64(dest + i, tail_mask(tail),
+                               op(load_tail(dest + i, tail), load_tail(src + i, tail))) ;
+}
+
+void avx512_and_assign(uint64_t *dest, const uint64_t *src, size_t n)
+{
+   assign_op(dest, src, n, [](__m512i x, __m512i y) { return _mm512_and_si512(x, y) ; }) ;
+}
+
+void avx512_or_assign(uint64_t *dest, const uint64_t *src, size_t n)
+{
+   assign_op(dest, src, n, [](__m512i x, __m512i y) { return _mm512_or_si512(x, y) ; }) ;
+}
+
+void avx512_xor_assign(uint64_t *dest, const uint64_t *src, size_t n)
+{
+   assign_op(dest, src, n, [](__m512i x, __m512i y) { return _mm512_xor_si512(x, y) ; }) ;
+}
+
+void avx512_andnot_assign(uint64_t *dest, const uint64_t *src, size_t n)
+{
+   // x & ~y; _mm512_andnot_si512() triggers spurious -Wuninitialized in GCC 12
+   assign_op(dest, src, n, [](__m512i x, __m512i y) { return _mm512_ternarylogic_epi64(x, y, y, 0x30) ; }) ;
+}
+
+void avx512_notand_assign(uint64_t *dest, const uint64_t *src, size_t n)
+{
+   // ~x & y
+   assign_op(dest, src, n, [](__m512i x, __m512i y) { return _mm512_ternarylogic_epi64(x, y, y, 0x0c) ; }) ;
+}
+
+size_t avx512_find_nonzero(const uint64_t *data, size_t n)
+{
+   for (size_t i = 0 ; i < n ; i += 8)
+   {
+      const __m512i v = i + 8 <= n ? load(data + i) : load_tail(data + i, n - i) ;
+      if (const unsigned nonzero = _mm512_test_epi64_mask(v, v))
+         return i + _tzcnt_u32(nonzero) ;
+   }
+   return n ;
+}
+
+bool avx512_equal(const uint64_t *x, const uint64_t *y, size_t n)
+{
+   if (x == y)
+      return true ;
+
+   size_t i = 0 ;
+   for (; i + 8 <= n ; i += 8)
+      if (_mm512_cmpneq_epi64_mask(load(x + i), load(y + i)))
+         return false ;
+
+   const size_t tail = n - i ;
+   return !tail || !_mm512_cmpneq_epi64_mask(load_tail(x + i, tail), load_tail(y + i, tail)) ;
+}
+
+void avx512_nonzero_map(const uint64_t *data, size_t n, uint64_t *map)
+{
+   for (size_t i = 0 ; i < n ; i += 64)
+   {
+      const size_t jend = min_size(n - i, 64) ;
+      uint64_t m = 0 ;
+      for (size_t j = 0 ; j < jend ; j += 8)
+      {
+         const __m512i v = j + 8 <= jend ? load(data + i + j) : load_tail(data + i + j, jend - j) ;
+         m |= uint64_t(_mm512_test_epi64_mask(v, v)) << j ;
+      }
+      *map++ = m ;
+   }
+}
+} // end of anonymous namespace
+
+namespace detail {
+extern const bulk_kernels avx512_bulk_kernels = {
+   kernel_isa::avx512, "avx512",
+   avx512_popcount,
+   avx512_and_assign,
+   avx512_or_assign,
+   avx512_xor_assign,
+   avx512_andnot_assign,
+   avx512_notand_assign,
+   avx512_find_nonzero,
+   avx512_equal,
+   avx512_nonzero_map
+} ;
+} // end of namespace pcomn::bitop::detail
+
+} // end of namespace pcomn::bitop
+} // end of namespace pcomn
+
+#endif /* PCOMN_PL_X86 && PCOMN_COMPILER_GNU */
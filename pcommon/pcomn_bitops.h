@@ -1107,6 +1107,50 @@ inline if_unsigned_int_t<I> bits_extract(I source, I mask)
 #endif
 /**@}*/
 
+/******************************************************************************/
+/** Get the position of the n-th (0-based) nonzero bit of unsigned integer, counting
+ from the least significant bit; if there are no more than n nonzero bits, returns
+ bitsizeof(I).
+
+ On platforms supporting BMI2 is implemented with PDEP: depositing (1 << n) to the
+ nonzero bits of the value leaves exactly the required bit set.
+
+ select1<uint8_t>(0b10110100, 0) -> 2
+ select1<uint8_t>(0b10110100, 2) -> 5
+ select1<uint8_t>(0b10110100, 4) -> 8
+*******************************************************************************/
+template<typename I>
+inline if_unsigned_int_t<I, unsigned> select1(I v, unsigned n)
+{
+   PCOMN_STATIC_CHECK(bitsizeof(I) <= 64) ;
+
+   if (n >= bitsizeof(I))
+      return bitsizeof(I) ;
+
+   #ifdef PCOMN_PL_BMI2
+   return std::min<unsigned>(rzcnt(_pdep_u64(1ULL << n, v)), bitsizeof(I)) ;
+   #else
+   // Broadword: get the cumulative popcounts of bytes, find the byte containing the
+   // required bit, then drop the lower nonzero bits of this byte.
+   const uint64_t x = v ;
+   uint64_t bytecounts = x - ((x >> 1) & 0x5555555555555555ULL) ;
+   bytecounts = (bytecounts & 0x3333333333333333ULL) + ((bytecounts >> 2) & 0x3333333333333333ULL) ;
+   bytecounts = (bytecounts + (bytecounts >> 4)) & 0x0F0F0F0F0F0F0F0FULL ;
+   const uint64_t prefix_counts = bytecounts * 0x0101010101010101ULL ;
+
+   unsigned byte = 0 ;
+   while (((prefix_counts >> 8*byte) & 0xff) <= n)
+      if (++byte == sizeof(I))
+         return bitsizeof(I) ;
+
+   uint8_t bits = x >> 8*byte ;
+   for (unsigned skip = n - (byte ? (prefix_counts >> (8*byte - 8)) & 0xff : 0) ; skip ; --skip)
+      bits &= bits - 1 ;
+
+   return 8*byte + rzcnt(bits) ;
+   #endif
+}
+
 /*******************************************************************************
  Compile-time calculations
 *******************************************************************************/
@@ -21,6 +21,8 @@
 #include "pcomn_safeptr.h"
 
 #include <list>
+#include <vector>
+#include <thread>
 #include <new>
 
 namespace pcomn {
@@ -28,6 +30,7 @@ namespace pcomn {
 namespace detail {
 template<typename> class list_cbqueue ;
 template<typename> class ring_cbqueue ;
+template<typename> class lockfree_ring_cbqueue ;
 } // end of namespace pcomn::detail
 
 /*******************************************************************************
@@ -46,6 +49,10 @@ class blocking_queue ;
 
  blocking_ring_queue<T>: the underlying container is a ring queue with locking
                          (still extremely fast) push and lock-free pop.
+
+ blocking_lockfree_ring_queue<T>: the underlying container is a ring queue with
+                                  per-slot sequence numbers and both lock-free
+                                  push and pop; scales with many producers.
 *******************************************************************************/
 /**@{*/
 
@@ -55,6 +62,9 @@ using blocking_list_queue = blocking_queue<T> ;
 template<typename T>
 using blocking_ring_queue = blocking_queue<T, detail::ring_cbqueue<T>> ;
 
+template<typename T>
+using blocking_lockfree_ring_queue = blocking_queue<T, detail::lockfree_ring_cbqueue<T>> ;
+
 /**@}*/
 
 /***************************************************************************//**
@@ -704,6 +714,138 @@ private:
     }
 
 } ;
+
+/***************************************************************************//**
+ Nonblocking bounded-capacity MPMC ring-buffer queue with lock-free both push and pop,
+ for use with blocking_queue template.
+
+ Every slot carries a sequence number (D.Vyukov's bounded MPMC queue scheme): the
+ producer that claimed the position `pos` waits until the slot sequence becomes `pos`
+ (i.e. the consumer of the previous lap has left the slot), the consumer waits until
+ it becomes `pos+1` (i.e. the producer has finished construction). Since blocking_queue
+ already ensures no overflow/underflow takes place, positions are claimed with plain
+ fetch_add and such waits are always short: the waiting thread only ever waits for
+ another thread that is already in the middle of its own (nonblocking) push or pop.
+
+ @note The value type must be nothrow move constructible: the slot is claimed before
+ the value is placed into it and there is no way to give the position back.
+*******************************************************************************/
+template<typename T>
+class lockfree_ring_cbqueue final {
+    PCOMN_STATIC_CHECK(std::is_nothrow_move_constructible<T>::value) ;
+
+    struct cell {
+        std::atomic<uint64_t> _seq ;
+        std::aligned_storage_t<sizeof(T), alignof(T)> _data ;
+
+        T *value() noexcept { return reinterpret_cast<T *>(&_data) ; }
+    } ;
+
+    typedef std::allocator<cell> allocator_type ;
+public:
+    typedef T value_type ;
+
+    explicit lockfree_ring_cbqueue(unsigned init_capacity) :
+        _capacity_mask((PCOMN_VERIFY(init_capacity), (1U << bitop::log2ceil(init_capacity)) - 1))
+    {
+        for (uint64_t i = 0 ; i <= _capacity_mask ; ++i)
+            new (&_cells[i]._seq) std::atomic<uint64_t>(i) ;
+    }
+
+    explicit lockfree_ring_cbqueue(const unipair<unsigned> &capacities) :
+        lockfree_ring_cbqueue((PCOMN_VERIFY(capacities.second >= capacities.first), capacities.second))
+    {}
+
+    ~lockfree_ring_cbqueue()
+    {
+        uint64_t i = _deq_pos.load(std::memory_order_acquire) ;
+        const uint64_t e = _enq_pos.load(std::memory_order_acquire) ;
+
+        NOXCHECK(i <= e) ;
+        NOXCHECK(e - i <= max_size()) ;
+
+        while (i < e)
+            destroy(cell_at(i++).value()) ;
+
+        allocator_type().deallocate(_cells, max_size()) ;
+    }
+
+    void push(const value_type &v) { push_item(value_type(v)) ; }
+
+    void push(value_type &&v) noexcept { push_item(std::move(v)) ; }
+
+    template<typename... Args>
+    void emplace(Args &&...a) { push_item(value_type(std::forward<Args>(a)...)) ; }
+
+    value_type pop() noexcept
+    {
+        return pop_item(_deq_pos.fetch_add(1, std::memory_order_relaxed)) ;
+    }
+
+    std::vector<value_type> pop_many(unsigned count) ;
+
+    size_t max_size() const noexcept { return _capacity_mask + 1 ; }
+
+    void change_capacity(uint64_t new_capacity)
+    {
+        ensure_le<std::out_of_range>(new_capacity, max_size(),
+                                     "The requested lockfree_ring_cbqueue capacity is too big.") ;
+    }
+
+private:
+    const uint64_t _capacity_mask ;
+    cell * const   _cells = allocator_type().allocate(max_size()) ;
+
+    // Keep producers and consumers off each other's cache lines
+    alignas(cacheline_t) std::atomic<uint64_t> _enq_pos {0} ;
+    alignas(cacheline_t) std::atomic<uint64_t> _deq_pos {0} ;
+
+private:
+    cell &cell_at(uint64_t pos) const noexcept { return _cells[pos & _capacity_mask] ; }
+
+    // Wait until the slot at `pos` gets the sequence number `seq`.
+    cell &wait_cell(uint64_t pos, uint64_t seq) const noexcept
+    {
+        cell &c = cell_at(pos) ;
+        for (unsigned spincount = 0 ; c._seq.load(std::memory_order_acquire) != seq ; ++spincount)
+            backoff(spincount) ;
+        return c ;
+    }
+
+    static void backoff(unsigned spincount) noexcept
+    {
+        #if defined(PCOMN_PL_X86) && defined(PCOMN_COMPILER_GNU)
+        if (spincount < 64)
+        {
+            __builtin_ia32_pause() ;
+            return ;
+        }
+        #endif
+        (void)spincount ;
+        std::this_thread::yield() ;
+    }
+
+    void push_item(value_type &&v) noexcept
+    {
+        const uint64_t pos = _enq_pos.fetch_add(1, std::memory_order_relaxed) ;
+        cell &c = wait_cell(pos, pos) ;
+
+        new (c.value()) value_type(std::move(v)) ;
+        c._seq.store(pos + 1, std::memory_order_release) ;
+    }
+
+    value_type pop_item(uint64_t pos) noexcept
+    {
+        cell &c = wait_cell(pos, pos + 1) ;
+        value_type * const v = c.value() ;
+        value_type result (std::move(*v)) ;
+
+        destroy(v) ;
+        // Hand the slot over to the producer of the next lap
+        c._seq.store(pos + max_size(), std::memory_order_release) ;
+        return result ;
+    }
+} ;
 } // end of namespace pcomn::detail
 
 
@@ -850,6 +992,26 @@ auto detail::ring_cbqueue<T>::pop_many(unsigned count) -> std::vector<value_type
     return result ;
 }
 
+/*******************************************************************************
+ detail::lockfree_ring_cbqueue
+*******************************************************************************/
+template<typename T>
+auto detail::lockfree_ring_cbqueue<T>::pop_many(unsigned count) -> std::vector<value_type>
+{
+    NOXCHECK(count) ;
+
+    std::vector<value_type> result ;
+    result.reserve(count) ;
+
+    const uint64_t start_index = _deq_pos.fetch_add(count, std::memory_order_relaxed) ;
+    const uint64_t end_index = start_index + count ;
+
+    for (uint64_t i = start_index ; i < end_index ; ++i)
+        result.emplace_back(pop_item(i)) ;
+
+    return result ;
+}
+
 } // end of namespace pcomn
 
 #endif /* __PCOMN_BLOCQUEUE_H */
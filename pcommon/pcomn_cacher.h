@@ -12,11 +12,14 @@
  CREATION DATE:   8 Oct 2009
 *******************************************************************************/
 /** @file
-    Generic LRU cacher.
+    Generic LRU cacher and its sharded variant for concurrent read-heavy use.
 *******************************************************************************/
 #include <pcomn_syncobj.h>
+#include <pcomn_sys.h>
+#include <pcomn_bitops.h>
 #include <pcomn_hashclosed.h>
 #include <pcomn_incdlist.h>
+#include <pcomn_eviction.h>
 #include <pcomn_function.h>
 #include <pcomn_alloca.h>
 
@@ -24,18 +27,21 @@
 #include <functional>
 #include <memory>
 #include <vector>
+#include <atomic>
 
 namespace pcomn {
 
 /******************************************************************************/
 /** Generic cacher template.
 
- Implements LRU eviction
+ The eviction policy is specified by the Eviction parameter, LRU by default; see
+ pcomn_eviction.h for the list of available policies.
 *******************************************************************************/
 template<typename Value,
          typename ExtractKey = pcomn::identity,
          typename Hash = pcomn::hash_fn<noref_result_of_t<ExtractKey(Value)> >,
-         typename Pred = std::equal_to<noref_result_of_t<ExtractKey(Value)> > >
+         typename Pred = std::equal_to<noref_result_of_t<ExtractKey(Value)> >,
+         typename Eviction = lru_eviction>
 class cacher {
    public:
       typedef noref_result_of_t<ExtractKey(Value)> key_type ;
@@ -43,28 +49,35 @@ class cacher {
       typedef Hash        hasher ;
       typedef Pred        key_equal ;
       typedef ExtractKey  key_extract ;
+      typedef Eviction    eviction_policy ;
 
       explicit cacher(size_t szlimit = (size_t)-1) :
          _szlimit(szlimit)
-      {}
+      {
+         _eviction.set_capacity(szlimit) ;
+      }
 
       explicit cacher(const hasher &hf, size_t szlimit = (size_t)-1) :
          _szlimit(szlimit),
-         _cache(-1, hf)
-      {}
+         _cache({0, 0}, hf)
+      {
+         _eviction.set_capacity(szlimit) ;
+      }
 
       cacher(const hasher &hf, const key_equal &eq, size_t szlimit = (size_t)-1) :
          _szlimit(szlimit),
-         _cache(-1, hf, eq)
-      {}
+         _cache({0, 0}, hf, eq)
+      {
+         _eviction.set_capacity(szlimit) ;
+      }
 
       ~cacher() ;
 
       /// Get an item from cache.
       /// @param key          Cached entry key.
       /// @param found_item   Buffer to place the found cache entry to.
-      /// @param touch        Whether to move the accessed element to the head of the LRU
-      /// list.
+      /// @param touch        Whether to register the access with the eviction policy
+      /// (for LRU, move the accessed element to the head of the LRU list).
       /// @note If there is no cache entry with name @a key found, @a found_item is left
       /// unchanged.
       /// @return true, if the item is present in the cache; false otherwise.
@@ -124,18 +137,18 @@ class cacher {
       /// Erase all elements from the cache
       size_t clear()
       {
-         size_t count ;
-         lru_list removed_entries ;
+         // An empty hashtable doesn't allocate memory, so nothing is allocated under
+         // the lock
+         cache_data removed_entries ({0, 0}, _cache.hash_function(), _cache.key_eq()) ;
          {
             PCOMN_SCOPE_LOCK(guard, _lock) ;
 
-            count = _cache.size() ;
-            _lru.swap(removed_entries) ;
-            _cache.clear() ;
+            _eviction.clear() ;
+            _cache.swap(removed_entries) ;
          }
          // Destroy entries outside of a critical section
-         destroy_entries(removed_entries) ;
-         return count ;
+         std::for_each(removed_entries.begin(), removed_entries.end(), std::default_delete<entry_type>()) ;
+         return removed_entries.size() ;
       }
 
       /// Get the current cache size
@@ -151,8 +164,8 @@ class cacher {
       /// @return Current cache size, i.e. the count of remaining cache entries.
       size_t set_size_limit(size_t count) ;
 
-      /// Get all cacher keys in LRU order (more precise, in "reverse LRU" - recently used
-      /// first).
+      /// Get all cacher keys in eviction order, most valuable first (for LRU, recently
+      /// used first).
       /// @note Avoid excessive use of this function: the cache stay locked while it is
       /// being traversed.
       template<typename OutputIterator>
@@ -167,7 +180,7 @@ class cacher {
       typedef std::vector<typename std::remove_cv<typename std::remove_reference<key_type>::type>::type> key_vector ;
 
       /*************************************************************************
-       Cache entry: a node of an LRU list containing data_type item
+       Cache entry: a node of an eviction queue containing data_type item
       *************************************************************************/
       struct entry_type {
             entry_type() : _value() {}
@@ -177,7 +190,7 @@ class cacher {
             const value_type &value() const { return _value ; }
             value_type &value() { return _value ; }
 
-            mutable incdlist_node   _node ;
+            mutable eviction_hook   _evict ;
          private:
             value_type              _value ;
 
@@ -185,10 +198,9 @@ class cacher {
             PCOMN_NONASSIGNABLE(entry_type) ;
       } ;
 
-      // Declare the inclusive list of entry_type nodes
-      typedef incdlist<entry_type, &entry_type::_node> lru_list ;
+      typedef typename eviction_policy::template queue<entry_type, &entry_type::_evict> eviction_queue ;
 
-      typedef std::result_of_t<key_extract(value_type)> key_result ;
+      typedef decltype(std::declval<const key_extract &>()(std::declval<const value_type &>())) key_result ;
 
       struct entry_key_extract : std::unary_function<const entry_type *, key_result> {
             entry_key_extract() {}
@@ -214,7 +226,7 @@ class cacher {
       mutable lock_type _lock ;
       size_t            _szlimit ; /* Cache size (item count) limit; by reaching this
                                     * limit, the cache starts evicting entries */
-      mutable lru_list  _lru ;
+      mutable eviction_queue _eviction ;
       cache_data        _cache ;
 
       bool put_locked(const value_type &item, value_type *found_item, bool touch) ;
@@ -222,9 +234,10 @@ class cacher {
       bool get_unlocked(const key_type &key, value_type *found_item, bool touch) const ;
       void insert_unlocked(const value_type &item, value_type *found_item)
       {
-         _lru.push_front(**_cache.insert(new entry_type(item)).first) ;
+         entry_type * const entry = *_cache.insert(new entry_type(item)).first ;
+         _eviction.insert(*entry, key_hash(_cache.key_get().extract_key(item))) ;
          if (found_item)
-            *found_item = _lru.front().value() ;
+            *found_item = entry->value() ;
       }
       entry_type *remove_unlocked(const key_type &key)
       {
@@ -232,22 +245,31 @@ class cacher {
          if (_cache.erase(key, erased))
          {
             NOXCHECK(erased) ;
-            _lru.erase(*erased) ;
+            _eviction.erase(*erased) ;
          }
          return erased ;
       }
 
-      void handle_existing_entry(const entry_type *entry, value_type *found_item, bool touch) const
+      void handle_existing_entry(const key_type &key, const entry_type *entry,
+                                 value_type *found_item, bool touch) const
       {
          NOXCHECK(entry) ;
          if (touch)
-            // The entry is _the_ most recent used one, move it to the head of the LRU list
-            _lru.push_front(*const_cast<entry_type *>(entry)) ;
+            _eviction.touch(*const_cast<entry_type *>(entry), key_hash(key)) ;
 
          if (found_item)
             *found_item = entry->value() ;
       }
 
+      // The hash for the eviction policy; computed only if the policy needs it
+      uint32_t key_hash(const key_type &key) const
+      {
+         if constexpr (eviction_policy::uses_frequency)
+            return wang_hash64to32(_cache.hash_function()(key)) ;
+         else
+            return 0 ;
+      }
+
       entry_type **cleanup_cache(entry_type **discarded) noexcept ;
 
       // Get count of items to remove
@@ -255,49 +277,332 @@ class cacher {
       {
          const size_t cachesz = _cache.size() ;
          return cachesz > size_limit()
-            ? std::max<size_t>(cachesz/3, cachesz - std::max<size_t>(size_limit(), 1) + 1)
+            ? std::max<size_t>(eviction_policy::batch_eviction ? cachesz/3 : 0,
+                               cachesz - std::max<size_t>(size_limit(), 1) + 1)
             : 0 ;
       }
 
       key_vector &retrieve_keys(key_vector &result) const ;
+} ;
+
+/******************************************************************************/
+/** Concurrent cacher partitioned into independently locked shards.
+
+ Provides the same get/put/replace/exists/erase/clear interface as pcomn::cacher.
+
+ The key space is hash-partitioned into shard_count() shards (a power of 2), every shard
+ has its own hashtable, LRU list, and read-write lock, so the operations on keys from
+ different shards never contend.
+
+ Lookups (get(), exists()) take only the shared lock of the shard. Instead of moving
+ the found entry to the head of the LRU list, get() with touch=true just marks the entry
+ as referenced (lazy promotion); referenced entries are moved to the head of the LRU
+ list only when they reach the tail on eviction, which is done under the exclusive lock
+ anyway ("second chance"). Thus the LRU order is approximate, but cache hits never
+ serialize.
+
+ The size limit is distributed evenly between the shards (rounded up), so the total
+ item count may exceed size_limit() by less than shard_count().
+*******************************************************************************/
+template<typename Value,
+         typename ExtractKey = pcomn::identity,
+         typename Hash = pcomn::hash_fn<noref_result_of_t<ExtractKey(Value)> >,
+         typename Pred = std::equal_to<noref_result_of_t<ExtractKey(Value)> > >
+class sharded_cacher {
+      PCOMN_NONCOPYABLE(sharded_cacher) ;
+      PCOMN_NONASSIGNABLE(sharded_cacher) ;
+   public:
+      typedef noref_result_of_t<ExtractKey(Value)> key_type ;
+      typedef Value       value_type ;
+      typedef Hash        hasher ;
+      typedef Pred        key_equal ;
+      typedef ExtractKey  key_extract ;
+
+      /// Create a cacher.
+      /// @param szlimit   Total size limit.
+      /// @param shards    Shard count, rounded up to a power of 2; 0 means twice the
+      /// count of hardware threads.
+      explicit sharded_cacher(size_t szlimit = (size_t)-1, unsigned shards = 0) :
+         sharded_cacher(hasher(), key_equal(), szlimit, shards)
+      {}
+
+      sharded_cacher(const hasher &hf, const key_equal &eq,
+                     size_t szlimit = (size_t)-1, unsigned shards = 0) ;
+
+      ~sharded_cacher() = default ;
+
+      /// Get an item from the cache.
+      /// @param key          Cached entry key.
+      /// @param found_item   Buffer to place the found cache entry to.
+      /// @param touch        Whether to mark the accessed element as recently used.
+      /// @note If there is no cache entry with name @a key found, @a found_item is left
+      /// unchanged.
+      /// @return true, if the item is present in the cache; false otherwise.
+      bool get(const key_type &key, value_type &found_item, bool touch = true) const
+      {
+         return shard_of(key).get(key, &found_item, touch) ;
+      }
+
+      value_type get(const key_type &key, bool touch = true) const
+      {
+         value_type result ;
+         get(key, result, touch) ;
+         return result ;
+      }
+
+      /// Put a value into the cache, if there is no value with the same key in the cache
+      /// yet
+      bool put(const value_type &new_item, bool touch = true)
+      {
+         return shard_of(key_of(new_item)).put(new_item, NULL, touch) ;
+      }
+
+      bool put(const value_type &new_item, value_type &found_item, bool touch = true)
+      {
+         return shard_of(key_of(new_item)).put(new_item, &found_item, touch) ;
+      }
+
+      /// Replace a value in the cache; if there is no value with such key, insert the value
+      bool replace(const value_type &new_item)
+      {
+         return shard_of(key_of(new_item)).replace(new_item) ;
+      }
+
+      bool exists(const key_type &key) const
+      {
+         return shard_of(key).get(key, NULL, false) ;
+      }
+
+      /// Discard an item from the cache
+      /// @return true, if the item was present in the cache and has been deleted; false
+      /// otherwise.
+      bool erase(const key_type &key)
+      {
+         return shard_of(key).erase(key) ;
+      }
+
+      /// Discard a set of items from the cache
+      /// @return the count of discarded items
+      template<typename InputIterator>
+      size_t erase(InputIterator begin, InputIterator end)
+      {
+         size_t count = 0 ;
+         for (; begin != end ; ++begin)
+            count += erase(*begin) ;
+         return count ;
+      }
+
+      /// Erase all elements from the cache
+      size_t clear()
+      {
+         size_t count = 0 ;
+         for (const auto &s: _shards)
+            count += s->clear() ;
+         return count ;
+      }
+
+      /// Get the current cache size.
+      /// @note Shards are not locked all at once, so under concurrent modification the
+      /// result is approximate.
+      size_t size() const
+      {
+         size_t count = 0 ;
+         for (const auto &s: _shards)
+            count += s->size() ;
+         return count ;
+      }
+
+      size_t size_limit() const { return _szlimit ; }
+
+      /// Set the cache size limit.
+      /// @return Current cache size.
+      size_t set_size_limit(size_t limit)
+      {
+         _szlimit = limit ;
+         size_t newsz = 0 ;
+         for (const auto &s: _shards)
+            newsz += s->set_size_limit(shard_limit(limit, _shards.size())) ;
+         return newsz ;
+      }
+
+      unsigned shard_count() const { return _shards.size() ; }
+
+      /// Get all cacher keys, shard by shard; inside a shard, recently used first
+      /// (approximately, see lazy promotion above).
+      template<typename OutputIterator>
+      OutputIterator keys(OutputIterator out) const
+      {
+         key_vector result ;
+         for (const auto &s: _shards)
+            s->retrieve_keys(result) ;
+         return std::copy(result.begin(), result.end(), out) ;
+      }
+
+   private:
+      typedef std::vector<typename std::remove_cv<typename std::remove_reference<key_type>::type>::type> key_vector ;
+
+      struct entry_type {
+            explicit entry_type(const value_type &v) : _value(v) {}
+
+            const value_type &value() const { return _value ; }
+
+            incdlist_node                 _node ;
+            mutable std::atomic<bool>     _referenced {false} ;
+         private:
+            value_type                    _value ;
+
+            PCOMN_NONCOPYABLE(entry_type) ;
+            PCOMN_NONASSIGNABLE(entry_type) ;
+      } ;
+
+      typedef incdlist<entry_type, &entry_type::_node> lru_list ;
+
+      typedef decltype(std::declval<const key_extract &>()(std::declval<const value_type &>())) key_result ;
+
+      struct entry_key_extract {
+            key_result operator()(const entry_type *entry) const
+            {
+               NOXCHECK(entry) ;
+               return key_extract()(entry->value()) ;
+            }
+      } ;
+
+      typedef closed_hashtable<entry_type *, entry_key_extract, hasher, key_equal> cache_data ;
+
+      /*************************************************************************
+       A shard: LRU cacher guarded by its own read-write lock
+      *************************************************************************/
+      class alignas(cacheline_t) shard {
+            PCOMN_NONCOPYABLE(shard) ;
+            PCOMN_NONASSIGNABLE(shard) ;
+         public:
+            shard(const hasher &hf, const key_equal &eq, size_t szlimit) :
+               _szlimit(szlimit),
+               _cache({0, 0}, hf, eq)
+            {}
+
+            ~shard() { destroy_entries(_lru) ; }
+
+            bool get(const key_type &key, value_type *found_item, bool touch) const ;
+            bool put(const value_type &item, value_type *found_item, bool touch) ;
+            bool replace(const value_type &item) ;
+            bool erase(const key_type &key) ;
+            size_t clear() ;
+            size_t set_size_limit(size_t limit) ;
+
+            size_t size() const
+            {
+               PCOMN_SCOPE_R_LOCK (guard, _lock) ;
+               return _cache.size() ;
+            }
+
+            void retrieve_keys(key_vector &result) const ;
+
+         private:
+            mutable shared_mutex _lock ;
+            size_t               _szlimit ;
+            lru_list             _lru ;
+            cache_data           _cache ;
+
+            void insert_unlocked(const value_type &item, value_type *found_item)
+            {
+               _lru.push_front(**_cache.insert(new entry_type(item)).first) ;
+               if (found_item)
+                  *found_item = _lru.front().value() ;
+            }
+
+            entry_type *remove_unlocked(const key_type &key)
+            {
+               entry_type *erased = NULL ;
+               if (_cache.erase(key, erased))
+               {
+                  NOXCHECK(erased) ;
+                  _lru.erase(*erased) ;
+               }
+               return erased ;
+            }
+
+            size_t cleanup_required() const
+            {
+               const size_t cachesz = _cache.size() ;
+               return cachesz > _szlimit
+                  ? std::max<size_t>(cachesz/3, cachesz - std::max<size_t>(_szlimit, 1) + 1)
+                  : 0 ;
+            }
+
+            entry_type **cleanup_cache(entry_type **discarded) noexcept ;
+
+            static void destroy_entries(lru_list &lru)
+            {
+               while(!lru.empty())
+                  delete &lru.back() ;
+            }
+      } ;
+
+   private:
+      size_t                              _szlimit ;
+      hasher                              _hasher ;
+      std::vector<std::unique_ptr<shard>> _shards ;
+
+      static key_result key_of(const value_type &value)
+      {
+         return key_extract()(value) ;
+      }
+
+      shard &shard_of(const key_type &key) const
+      {
+         // The hashtable takes the lowest bits of the hash, remix the hash so that
+         // the shard index is independent of the bucket index.
+         return *_shards[wang_hash64to32(_hasher(key)) & (_shards.size() - 1)] ;
+      }
 
-      static void destroy_entries(lru_list &lru)
+      static size_t shard_limit(size_t limit, size_t shard_count)
       {
-         while(!lru.empty())
-            delete &lru.back() ;
+         return limit == (size_t)-1
+            ? limit
+            : (limit + shard_count - 1)/shard_count ;
       }
 } ;
 
 /*******************************************************************************
  cacher
 *******************************************************************************/
-template<typename V, typename X, typename H, typename P>
-cacher<V, X, H, P>::~cacher() { destroy_entries(_lru) ; }
+template<typename V, typename X, typename H, typename P, typename E>
+cacher<V, X, H, P, E>::~cacher()
+{
+   _eviction.clear() ;
+   std::for_each(_cache.begin(), _cache.end(), std::default_delete<entry_type>()) ;
+}
 
-template<typename V, typename X, typename H, typename P>
-bool cacher<V, X, H, P>::get_unlocked(const key_type &key, value_type *found_item, bool touch) const
+template<typename V, typename X, typename H, typename P, typename E>
+bool cacher<V, X, H, P, E>::get_unlocked(const key_type &key, value_type *found_item, bool touch) const
 {
    typename cache_data::const_iterator entry (_cache.find(key)) ;
 
    if (entry == _cache.end())
+   {
+      if (touch)
+         _eviction.record(key_hash(key)) ;
       return false ;
+   }
 
-   handle_existing_entry(*entry, found_item, touch) ;
+   handle_existing_entry(key, *entry, found_item, touch) ;
    return true ;
 }
 
-template<typename V, typename X, typename H, typename P>
-bool cacher<V, X, H, P>::put_locked(const value_type &item, value_type *found_item, bool touch)
+template<typename V, typename X, typename H, typename P, typename E>
+bool cacher<V, X, H, P, E>::put_locked(const value_type &item, value_type *found_item, bool touch)
 {
    entry_type **begin_discarded, **end_discarded ;
    {
       PCOMN_SCOPE_LOCK (guard, _lock) ;
 
-      auto item_iter = _cache.find(_cache.key_get().extract_key(item)) ;
+      const key_type &key = _cache.key_get().extract_key(item) ;
+      auto item_iter = _cache.find(key) ;
       if (item_iter != _cache.end())
       {
          // Already in the cache
-         handle_existing_entry(*item_iter, found_item, touch) ;
+         handle_existing_entry(key, *item_iter, found_item, touch) ;
          return false ;
       }
 
@@ -315,8 +620,8 @@ bool cacher<V, X, H, P>::put_locked(const value_type &item, value_type *found_it
    return true ;
 }
 
-template<typename V, typename X, typename H, typename P>
-bool cacher<V, X, H, P>::replace(const value_type &item)
+template<typename V, typename X, typename H, typename P, typename E>
+bool cacher<V, X, H, P, E>::replace(const value_type &item)
 {
    entry_type **begin_discarded, **end_discarded ;
    bool erased ;
@@ -337,8 +642,8 @@ bool cacher<V, X, H, P>::replace(const value_type &item)
    return erased ;
 }
 
-template<typename V, typename X, typename H, typename P>
-bool cacher<V, X, H, P>::erase(const key_type &key)
+template<typename V, typename X, typename H, typename P, typename E>
+bool cacher<V, X, H, P, E>::erase(const key_type &key)
 {
    entry_type *erased ;
    {
@@ -349,9 +654,9 @@ bool cacher<V, X, H, P>::erase(const key_type &key)
    return !!erased ;
 }
 
-template<typename V, typename X, typename H, typename P>
+template<typename V, typename X, typename H, typename P, typename E>
 template<typename InputIterator>
-__noinline size_t cacher<V, X, H, P>::erase(InputIterator begin, InputIterator end)
+__noinline size_t cacher<V, X, H, P, E>::erase(InputIterator begin, InputIterator end)
 {
    _lock.lock() ;
    if (_cache.empty() || begin == end)
@@ -378,15 +683,15 @@ __noinline size_t cacher<V, X, H, P>::erase(InputIterator begin, InputIterator e
    return discarded_count ;
 }
 
-template<typename V, typename X, typename H, typename P>
-size_t cacher<V, X, H, P>::size() const
+template<typename V, typename X, typename H, typename P, typename E>
+size_t cacher<V, X, H, P, E>::size() const
 {
    PCOMN_SCOPE_LOCK (guard, _lock) ;
    return _cache.size() ;
 }
 
-template<typename V, typename X, typename H, typename P>
-__noinline size_t cacher<V, X, H, P>::set_size_limit(size_t limit)
+template<typename V, typename X, typename H, typename P, typename E>
+__noinline size_t cacher<V, X, H, P, E>::set_size_limit(size_t limit)
 {
    size_t newsz ;
    entry_type **begin_discarded, **end_discarded ;
@@ -394,6 +699,7 @@ __noinline size_t cacher<V, X, H, P>::set_size_limit(size_t limit)
       PCOMN_SCOPE_LOCK(guard, _lock) ;
 
       _szlimit = limit ;
+      _eviction.set_capacity(limit) ;
 
       const size_t cleanup_count = cleanup_required() ;
       NOXCHECK(cleanup_count <= _cache.size()) ;
@@ -413,33 +719,219 @@ __noinline size_t cacher<V, X, H, P>::set_size_limit(size_t limit)
    return newsz ;
 }
 
-template<typename V, typename X, typename H, typename P>
-auto cacher<V, X, H, P>::cleanup_cache(entry_type **discarded) noexcept -> entry_type **
+template<typename V, typename X, typename H, typename P, typename E>
+auto cacher<V, X, H, P, E>::cleanup_cache(entry_type **discarded) noexcept -> entry_type **
 {
    for (size_t remove_count = cleanup_required() ; remove_count ; --remove_count)
    {
-      NOXCHECK(!_lru.empty()) ;
-      entry_type * const entry = &_lru.back() ;
+      entry_type * const entry = _eviction.victim() ;
+      NOXCHECK(entry) ;
       NOXVERIFY(_cache.erase_value(entry)) ;
-      _lru.erase(*entry) ;
+      _eviction.erase(*entry) ;
       *discarded++ = entry ;
    }
 
    return discarded ;
 }
 
-template<typename V, typename X, typename H, typename P>
-auto cacher<V, X, H, P>::retrieve_keys(key_vector &result) const -> key_vector &
+template<typename V, typename X, typename H, typename P, typename E>
+auto cacher<V, X, H, P, E>::retrieve_keys(key_vector &result) const -> key_vector &
 {
    result.clear() ;
 
    PCOMN_SCOPE_LOCK (guard, _lock) ;
    result.reserve(size()) ;
-   for (typename lru_list::const_iterator i (_lru.begin()), e (_lru.end()) ; i != e ; ++i)
-      result.push_back(_cache.key_get().extract_key(i->value())) ;
+   _eviction.for_each([&](const entry_type &entry)
+   {
+      result.push_back(_cache.key_get().extract_key(entry.value())) ;
+   }) ;
    return result ;
 }
 
+/*******************************************************************************
+ sharded_cacher
+*******************************************************************************/
+template<typename V, typename X, typename H, typename P>
+sharded_cacher<V, X, H, P>::sharded_cacher(const hasher &hf, const key_equal &eq,
+                                           size_t szlimit, unsigned shards) :
+   _szlimit(szlimit),
+   _hasher(hf)
+{
+   const size_t count =
+      bitop::round2z<size_t>(midval<size_t>(1, 1024, shards ? shards : 2*sys::hw_threads_count())) ;
+
+   _shards.reserve(count) ;
+   while (_shards.size() < count)
+      _shards.emplace_back(new shard(hf, eq, shard_limit(szlimit, count))) ;
+}
+
+template<typename V, typename X, typename H, typename P>
+bool sharded_cacher<V, X, H, P>::shard::get(const key_type &key, value_type *found_item, bool touch) const
+{
+   PCOMN_SCOPE_R_LOCK (guard, _lock) ;
+
+   const auto entry (_cache.find(key)) ;
+   if (entry == _cache.end())
+      return false ;
+
+   // Lazy promotion: don't touch the LRU list, only mark the entry; avoid writing
+   // into the shared cache line if it is already marked.
+   if (touch && !(*entry)->_referenced.load(std::memory_order_relaxed))
+      (*entry)->_referenced.store(true, std::memory_order_relaxed) ;
+
+   if (found_item)
+      *found_item = (*entry)->value() ;
+   return true ;
+}
+
+template<typename V, typename X, typename H, typename P>
+bool sharded_cacher<V, X, H, P>::shard::put(const value_type &item, value_type *found_item, bool touch)
+{
+   entry_type **begin_discarded, **end_discarded ;
+   {
+      PCOMN_SCOPE_W_LOCK (guard, _lock) ;
+
+      const auto item_iter = _cache.find(key_of(item)) ;
+      if (item_iter != _cache.end())
+      {
+         // Already in the cache; we hold the exclusive lock, so promote immediately
+         entry_type * const entry = *item_iter ;
+         if (touch)
+         {
+            entry->_referenced.store(false, std::memory_order_relaxed) ;
+            _lru.push_front(*entry) ;
+         }
+         if (found_item)
+            *found_item = entry->value() ;
+         return false ;
+      }
+
+      P_FAST_BUFFER(discarded, entry_type *, cleanup_required(), 64*KiB) ;
+      begin_discarded = discarded ;
+      end_discarded = cleanup_cache(discarded) ;
+
+      if (_szlimit)
+         insert_unlocked(item, found_item) ;
+      else if (found_item)
+         *found_item = item ;
+   }
+   std::for_each(begin_discarded, end_discarded, std::default_delete<entry_type>()) ;
+
+   return true ;
+}
+
+template<typename V, typename X, typename H, typename P>
+bool sharded_cacher<V, X, H, P>::shard::replace(const value_type &item)
+{
+   entry_type **begin_discarded, **end_discarded ;
+   bool erased ;
+   {
+      PCOMN_SCOPE_W_LOCK (guard, _lock) ;
+      P_FAST_BUFFER(discarded, entry_type *, cleanup_required() + 1, 64*KiB) ;
+
+      begin_discarded = discarded ;
+      *begin_discarded = remove_unlocked(key_of(item)) ;
+      erased = !!*begin_discarded ;
+      end_discarded = cleanup_cache(begin_discarded + erased) ;
+
+      insert_unlocked(item, NULL) ;
+   }
+   std::for_each(begin_discarded, end_discarded, std::default_delete<entry_type>()) ;
+
+   return erased ;
+}
+
+template<typename V, typename X, typename H, typename P>
+bool sharded_cacher<V, X, H, P>::shard::erase(const key_type &key)
+{
+   entry_type *erased ;
+   {
+      PCOMN_SCOPE_W_LOCK (guard, _lock) ;
+      erased = remove_unlocked(key) ;
+   }
+   delete erased ;
+   return !!erased ;
+}
+
+template<typename V, typename X, typename H, typename P>
+size_t sharded_cacher<V, X, H, P>::shard::clear()
+{
+   size_t count ;
+   lru_list removed_entries ;
+   {
+      PCOMN_SCOPE_W_LOCK (guard, _lock) ;
+
+      count = _cache.size() ;
+      _lru.swap(removed_entries) ;
+      _cache.clear() ;
+   }
+   // Destroy entries outside of a critical section
+   destroy_entries(removed_entries) ;
+   return count ;
+}
+
+template<typename V, typename X, typename H, typename P>
+__noinline size_t sharded_cacher<V, X, H, P>::shard::set_size_limit(size_t limit)
+{
+   size_t newsz ;
+   entry_type **begin_discarded, **end_discarded ;
+   {
+      PCOMN_SCOPE_W_LOCK (guard, _lock) ;
+
+      _szlimit = limit ;
+
+      P_FAST_BUFFER(discarded, entry_type *, cleanup_required(), 64*KiB) ;
+
+      begin_discarded = discarded ;
+      end_discarded = cleanup_cache(begin_discarded) ;
+
+      newsz = _cache.size() ;
+      NOXCHECK(newsz <= _szlimit) ;
+   }
+   std::for_each(begin_discarded, end_discarded, std::default_delete<entry_type>()) ;
+
+   return newsz ;
+}
+
+template<typename V, typename X, typename H, typename P>
+auto sharded_cacher<V, X, H, P>::shard::cleanup_cache(entry_type **discarded) noexcept -> entry_type **
+{
+   // Every entry can get its second chance at most once per cleanup, so the loop
+   // is finite even if all the entries are referenced.
+   size_t promotions = _cache.size() ;
+
+   for (size_t remove_count = cleanup_required() ; remove_count ;)
+   {
+      NOXCHECK(!_lru.empty()) ;
+      entry_type * const entry = &_lru.back() ;
+
+      if (promotions && entry->_referenced.load(std::memory_order_relaxed))
+      {
+         --promotions ;
+         entry->_referenced.store(false, std::memory_order_relaxed) ;
+         _lru.push_front(*entry) ;
+         continue ;
+      }
+
+      NOXVERIFY(_cache.erase_value(entry)) ;
+      _lru.erase(*entry) ;
+      *discarded++ = entry ;
+      --remove_count ;
+   }
+
+   return discarded ;
+}
+
+template<typename V, typename X, typename H, typename P>
+void sharded_cacher<V, X, H, P>::shard::retrieve_keys(key_vector &result) const
+{
+   PCOMN_SCOPE_R_LOCK (guard, _lock) ;
+
+   result.reserve(result.size() + _cache.size()) ;
+   for (const entry_type &entry: _lru)
+      result.push_back(key_of(entry.value())) ;
+}
+
 } // end of namespace pcomn
 
 #endif /* __PCOMN_CACHER_H */
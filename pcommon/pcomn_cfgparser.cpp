@@ -21,10 +21,13 @@
 #include <pcomn_assert.h>
 #include <pcomn_sys.h>
 #include <pcomn_except.h>
+#include <pcomn_syncobj.h>
 
 #include <pcstring.h>
 
-#include <set>
+#include <mutex>
+#include <memory>
+#include <unordered_set>
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -33,10 +36,6 @@
 
 using namespace pcomn ;
 
-#define ENSURE_FILEOP(call, err) { if ((call) < 0) { return (err) ; } }
-
-typedef char linebuf_t[PCOMN_CFGPARSER_MAXLINEBUF] ;
-
 static const char PATTERN_SCAN[] =
    "^[\t\f\v ]*("                                  // Skip whitespaces at the beginning
    "([;#][^\n\r]*)"                                // Comment (2)
@@ -115,69 +114,409 @@ static LineKind lineKind(const char *begin_line, const char *end_line,
    return LineEmpty ;
 }
 
-static inline char *atName(LineKind kind, const char *line, char *name)
+static inline std::string lowercase(const strslice &s)
 {
-   reg_match namegrp, dummmygrp ;
-   NOXPRECONDITION(line && name) ;
-   return
-      // The line _shall_ end with '\n' or '\r'
-      (!*line || lineKind(line, line + strlen(line) - 1, namegrp, dummmygrp) != kind)
-      ? NULL
-      : regstrcpy(name, line, &namegrp) ;
+   std::string result (s) ;
+   str::to_lower_inplace(result) ;
+   return result ;
 }
 
-static inline char *atValue(const char *line, char *keyname)
+/*******************************************************************************
+ cfgfile
+*******************************************************************************/
+namespace pcomn {
+
+cfgfile::cfgfile(const strslice &filename) :
+   _filename(filename),
+   _stat()
 {
-   return atName(LineValue, line, keyname) ;
+   initPatterns() ;
+   load() ;
+}
+
+void cfgfile::load()
+{
+   _lines.clear() ;
+   _stat = {} ;
+   _exists = _modified = false ;
+   _final_newline = true ;
+
+   fd_safehandle fd (::open(_filename.c_str(), O_RDONLY|O_TEXT)) ;
+   if (fd.bad() && errno == ENOENT)
+   {
+      reindex() ;
+      return ;
+   }
+   PCOMN_ENSURE_POSIX(fd.handle(), "open") ;
+   PCOMN_ENSURE_POSIX(fstat(fd.handle(), &_stat), "fstat") ;
+
+   std::string data ;
+   data.resize(_stat.st_size) ;
+   for (size_t size = 0 ;;)
+   {
+      if (size == data.size())
+         data.resize(size + 4096) ;
+      const ssize_t lastread = PCOMN_ENSURE_POSIX(::read(fd.handle(), &data[size], data.size() - size), "read") ;
+      if (!lastread)
+      {
+         data.resize(size) ;
+         break ;
+      }
+      size += lastread ;
+   }
+   _exists = true ;
+
+   for (const char *begin = data.c_str(), *end = begin + data.size() ; begin != end ;)
+   {
+      const char *eol = static_cast<const char *>(memchr(begin, '\n', end - begin)) ;
+      _final_newline = !!eol ;
+      if (!eol)
+         eol = end ;
+
+      _lines.push_back({std::string(begin, eol), line_other}) ;
+      parse_line(_lines.back()) ;
+
+      begin = eol + _final_newline ;
+   }
+   reindex() ;
+}
+
+void cfgfile::parse_line(line &ln) const
+{
+   // lineKind() needs a newline-terminated string
+   std::string text ;
+   text.reserve(ln.text.size() + 1) ;
+   text.append(ln.text).append(1, '\n') ;
+
+   reg_match namegrp, valgrp ;
+   switch (lineKind(text.c_str(), text.c_str() + text.size() - 1, namegrp, valgrp))
+   {
+      case LineSection:
+         ln.kind = line_section ;
+         ln.name = std::string(strslice(text.c_str(), namegrp)) ;
+         break ;
+
+      case LineValue:
+         ln.kind = line_value ;
+         ln.name = std::string(strslice(text.c_str(), namegrp)) ;
+         ln.value = std::string(strslice(text.c_str(), valgrp)) ;
+         break ;
+
+      default:
+         ln.kind = line_other ;
+   }
 }
 
-static inline char *atSectionHeader(const char *line, char *sectionname)
+void cfgfile::reindex()
 {
-   return atName(LineSection, line, sectionname) ;
+   _sectnames.clear() ;
+   _sections.clear() ;
+
+   std::unordered_set<std::string> sectnames ;
+   // Keys before the first section belong to the empty section
+   section_index *current = &_sections[""] ;
+   for (size_t n = 0 ; n < _lines.size() ; ++n)
+   {
+      const line &ln = _lines[n] ;
+      switch (ln.kind)
+      {
+         case line_section:
+            if (sectnames.insert(ln.name).second)
+               _sectnames.push_back(ln.name) ;
+            current = &_sections[lowercase(ln.name)] ;
+            break ;
+
+         case line_value:
+            current->keys.push_back(n) ;
+            current->first.emplace(lowercase(ln.name), n) ;
+            break ;
+
+         default: break ;
+      }
+   }
 }
 
-static inline bool isSection(const char *found_section, const char *sectname)
+bool cfgfile::is_unchanged(const struct stat &st) const
 {
-   return !stricmp(found_section, sectname) ;
+   return st.st_dev == _stat.st_dev && st.st_ino == _stat.st_ino && st.st_size == _stat.st_size
+   #ifdef PCOMN_PL_LINUX
+      && st.st_mtim.tv_sec == _stat.st_mtim.tv_sec && st.st_mtim.tv_nsec == _stat.st_mtim.tv_nsec
+   #else
+      && st.st_mtime == _stat.st_mtime
+   #endif
+      ;
 }
 
-static inline char *atValue(const char *line, const char *key, char *value)
+bool cfgfile::revalidate()
 {
-   NOXPRECONDITION(line && key && value) ;
+   struct stat st ;
+   if (stat(_filename.c_str(), &st) < 0 ? !_exists : _exists && is_unchanged(st))
+      return false ;
 
-   reg_match keygrp, valgrp ;
-   // The line _shall_ end with '\n' or '\r'
-   if (!*line || lineKind(line, line + strlen(line) - 1, keygrp, valgrp) != LineValue
-       || (ssize_t)strlen(key) != PSUBEXP_LENGTH(keygrp)
-       // Note memicmp(), the keys are case-insensitive (modulo ASCII)
-       || memicmp(PSUBEXP_BEGIN(line, keygrp), key, PSUBEXP_LENGTH(keygrp)))
-      return NULL ;
+   load() ;
+   return true ;
+}
 
-   return regstrcpy(value, line, &valgrp) ;
+const cfgfile::section_index *cfgfile::find_section(const strslice &section) const
+{
+   const auto found = _sections.find(lowercase(section)) ;
+   return found == _sections.end() ? nullptr : &found->second ;
 }
 
-static inline char *line_normalize(char *line)
+const std::string *cfgfile::find_value(const strslice &section, const strslice &key) const
 {
-   const size_t len = strlen(line) ;
-   if (!one_of<'\n', '\r'>::is(line[len - 1]))
+   const section_index * const sect = find_section(section) ;
+   if (!sect)
+      return nullptr ;
+   const auto found = sect->first.find(lowercase(key)) ;
+   return found == sect->first.end() ? nullptr : &_lines[found->second].value ;
+}
+
+std::vector<std::pair<std::string, std::string> > cfgfile::section(const strslice &section) const
+{
+   std::vector<std::pair<std::string, std::string> > result ;
+   if (const section_index * const sect = find_section(section))
    {
-      line[len] = '\n' ;
-      line[len + 1] = 0 ;
+      std::unordered_set<std::string> found ;
+      for (size_t n: sect->keys)
+         if (found.insert(_lines[n].name).second)
+            result.emplace_back(_lines[n].name, _lines[n].value) ;
    }
-   return line ;
+   return result ;
 }
 
-template<size_t bufsize>
-static inline char *getline_normalize(FILE *f, char (&buf)[bufsize])
+void cfgfile::insert_line(size_t pos, std::string text)
 {
-   return !fgets(buf, bufsize-1, f) ? (char *)NULL : line_normalize(buf) ;
+   NOXCHECK(pos <= _lines.size()) ;
+   _lines.insert(_lines.begin() + pos, line{std::move(text), line_other}) ;
+   parse_line(_lines[pos]) ;
 }
 
-static size_t addResultToBuf(char **bufp, size_t *remains, const strslice &result, std::set<std::string> *found)
+void cfgfile::erase_lines(size_t from, size_t to)
+{
+   NOXCHECK(from <= to && to <= _lines.size()) ;
+   // The line before the erased last one is newline-terminated
+   if (to == _lines.size())
+      _final_newline = true ;
+   _lines.erase(_lines.begin() + from, _lines.begin() + to) ;
+}
+
+void cfgfile::set_value(const strslice &section, const strslice &key, const strslice &value)
+{
+   std::string newline (key) ;
+   newline.append(" = ").append(value.begin(), value.end()) ;
+
+   // The same placement as cfgfile_write_value() has always done: replace the first
+   // appearance of the key; if there is no such key, insert after the last key of the
+   // section (or after the first section header); if there is no such section, append
+   // the section at the end of the file.
+   const std::string sectname (section) ;
+   const bool empty_section = sectname.empty() ;
+   bool in_section = empty_section ;
+   bool section_found = in_section ;
+   bool nonempty_line = false ;
+   size_t inspos = 0 ;
+
+   for (size_t n = 0 ; n < _lines.size() ; ++n)
+   {
+      line &ln = _lines[n] ;
+      if ((nonempty_line = ln.kind == line_section))
+      {
+         if (empty_section)
+            break ;
+         in_section = !stricmp(ln.name.c_str(), sectname.c_str()) ;
+         if (in_section && !section_found)
+         {
+            inspos = n + 1 ;
+            section_found = true ;
+         }
+      }
+      else if ((nonempty_line = ln.kind == line_value) && in_section)
+      {
+         if (ln.name.size() != key.size() || memicmp(ln.name.data(), key.begin(), key.size()))
+            inspos = n + 1 ;
+         else
+         {
+            ln.text = std::move(newline) ;
+            parse_line(ln) ;
+            _modified = true ;
+            reindex() ;
+            return ;
+         }
+      }
+   }
+
+   if (!section_found)
+   {
+      if (!_final_newline)
+         _final_newline = true ;
+      else if (nonempty_line)
+         _lines.push_back({}) ;
+
+      insert_line(_lines.size(), "[" + sectname + "]") ;
+      insert_line(_lines.size(), std::move(newline)) ;
+      _lines.push_back({}) ;
+   }
+   else
+   {
+      if (inspos == _lines.size())
+         _final_newline = true ;
+      insert_line(inspos, std::move(newline)) ;
+      // A key inserted at the very beginning of the file is separated by an empty line
+      if (!inspos)
+         _lines.insert(_lines.begin() + 1, line()) ;
+   }
+   _modified = true ;
+   reindex() ;
+}
+
+bool cfgfile::del_value(const strslice &section, const strslice &key)
+{
+   const std::string sectname (section) ;
+   const bool empty_section = sectname.empty() ;
+   bool in_section = empty_section ;
+   bool deleted = false ;
+
+   for (size_t n = 0 ; n < _lines.size() ;)
+   {
+      const line &ln = _lines[n] ;
+      if (ln.kind == line_section)
+      {
+         if (empty_section)
+            break ;
+         in_section = !stricmp(ln.name.c_str(), sectname.c_str()) ;
+      }
+      else if (in_section && ln.kind == line_value &&
+               ln.name.size() == key.size() && !memicmp(ln.name.data(), key.begin(), key.size()))
+      {
+         erase_lines(n, n + 1) ;
+         deleted = true ;
+         continue ;
+      }
+      ++n ;
+   }
+
+   if (deleted)
+   {
+      _modified = true ;
+      reindex() ;
+   }
+   return deleted ;
+}
+
+bool cfgfile::del_section(const strslice &section)
+{
+   const std::string sectname (section) ;
+   const bool empty_section = sectname.empty() ;
+   bool in_section = empty_section ;
+   bool deleted = false ;
+   // Delete a section from its header up to its last key, leaving comments and empty
+   // lines after the last key intact.
+   size_t startpos = 0 ;
+   size_t endpos = 0 ;
+
+   for (size_t n = 0 ; n < _lines.size() ; ++n)
+   {
+      const line &ln = _lines[n] ;
+      if (ln.kind == line_section)
+      {
+         if (stricmp(ln.name.c_str(), sectname.c_str()))
+         {
+            if (!in_section)
+               continue ;
+            in_section = false ;
+            // The empty section is everything before the first section header
+            if (empty_section)
+            {
+               endpos = n ;
+               break ;
+            }
+            deleted |= startpos != endpos ;
+            erase_lines(startpos, endpos) ;
+            n -= endpos - startpos ;
+         }
+         else
+         {
+            if (!in_section)
+            {
+               in_section = true ;
+               startpos = n ;
+            }
+            endpos = n + 1 ;
+         }
+      }
+      else if (in_section && ln.kind == line_value)
+         endpos = n + 1 ;
+   }
+
+   if (in_section || empty_section)
+   {
+      deleted |= startpos != endpos ;
+      erase_lines(startpos, endpos) ;
+   }
+
+   if (deleted)
+   {
+      _modified = true ;
+      reindex() ;
+   }
+   return deleted ;
+}
+
+void cfgfile::flush()
+{
+   if (!_modified)
+      return ;
+
+   std::string data ;
+   for (const line &ln: _lines)
+      data.append(ln.text).append(1, '\n') ;
+   if (!_final_newline && !data.empty())
+      data.pop_back() ;
+
+   fd_safehandle fd (PCOMN_ENSURE_POSIX(::open(_filename.c_str(), O_WRONLY|O_CREAT|O_TRUNC|O_TEXT,
+                                              S_IRUSR|S_IWUSR|S_IRGRP|S_IROTH), "open")) ;
+   for (const char *p = data.c_str(), *end = p + data.size() ; p != end ;)
+      p += PCOMN_ENSURE_POSIX(::write(fd.handle(), p, end - p), "write") ;
+
+   PCOMN_ENSURE_POSIX(fstat(fd.handle(), &_stat), "fstat") ;
+   _exists = true ;
+   _modified = false ;
+}
+
+} // end of namespace pcomn
+
+/*******************************************************************************
+ The process-wide cache of cfgfile objects
+*******************************************************************************/
+namespace {
+struct cfgfile_cache {
+      std::mutex lock ;
+      std::unordered_map<std::string, std::unique_ptr<cfgfile> > files ;
+} ;
+
+// Intentionally never destroyed: cfgfile functions can be called from static
+// destructors (e.g. by diagnostics trace)
+cfgfile_cache &cache()
+{
+   static cfgfile_cache * const instance = new cfgfile_cache ;
+   return *instance ;
+}
+
+// Call only when the cache is locked
+cfgfile &cached_cfgfile(const char *filename)
+{
+   std::unique_ptr<cfgfile> &cached = cache().files[filename] ;
+   if (!cached)
+      cached.reset(new cfgfile(filename)) ;
+   else
+      cached->revalidate() ;
+   return *cached ;
+}
+} // end of anonymous namespace
+
+static size_t addResultToBuf(char **bufp, size_t *remains, const strslice &result)
 {
-   // Check for the first appearance
-   if (found && !found->insert(str::stdstr(result)).second)
-      return 0 ;
    const size_t sz = std::min(result.size() + 1, *remains) ;
    char * const buf = *bufp ;
 
@@ -188,18 +527,14 @@ static size_t addResultToBuf(char **bufp, size_t *remains, const strslice &resul
    return sz ;
 }
 
-static size_t readAllSectionNames(FILE *f, char *buf, size_t bufsize)
+static size_t readAllSectionNames(const cfgfile &file, char *buf, size_t bufsize)
 {
-   NOXPRECONDITION(f && bufsize && buf) ;
+   NOXPRECONDITION(bufsize && buf) ;
 
    char *bufp = buf ;
-
-   linebuf_t linebuf ;
-   std::set<std::string> found ;
    size_t remains = bufsize ;
-   while (remains && getline_normalize(f, linebuf))
-      if (atSectionHeader(linebuf, linebuf))
-         addResultToBuf(&bufp, &remains, linebuf, &found) ;
+   for (auto name = file.sectnames().begin(), end = file.sectnames().end() ; remains && name != end ; ++name)
+      addResultToBuf(&bufp, &remains, *name) ;
 
    // If there was enough space, return the buffer size - 1 (don't count the final null);
    // if the buffer is too small, return the _full_ buffer size
@@ -208,32 +543,24 @@ static size_t readAllSectionNames(FILE *f, char *buf, size_t bufsize)
    return bufp - buf ;
 }
 
-static size_t readAllSectionValues(FILE *f, const char *section, char *buf, size_t bufsize)
+static size_t readAllSectionValues(const cfgfile &file, const char *section, char *buf, size_t bufsize)
 {
-   NOXPRECONDITION(f && bufsize && buf && !*buf) ;
+   NOXPRECONDITION(bufsize && buf && !*buf) ;
    NOXPRECONDITION(section) ;
 
    char *bufp = buf ;
-   bool in_section = !*section ;
-
-   linebuf_t linebuf ;
-   std::set<std::string> found ;
    size_t remains = bufsize ;
-   while (remains && getline_normalize(f, linebuf))
-      if (atSectionHeader(linebuf, linebuf))
-         in_section = isSection(linebuf, section) ;
-      else if (in_section)
+   for (const auto &keyval: file.section(section))
+   {
+      if (!remains)
+         break ;
+      if (addResultToBuf(&bufp, &remains, keyval.first) && remains)
       {
-         reg_match keygrp, valgrp ;
-         if (lineKind(linebuf, linebuf + strlen(linebuf) - 1, keygrp, valgrp) == LineValue &&
-             addResultToBuf(&bufp, &remains, strslice(linebuf, keygrp), &found) &&
-             remains)
-         {
-            bufp[-1] = '=' ;
-            *bufp = 0 ;
-            addResultToBuf(&bufp, &remains, strslice(linebuf, valgrp), NULL) ;
-         }
+         bufp[-1] = '=' ;
+         *bufp = 0 ;
+         addResultToBuf(&bufp, &remains, keyval.second) ;
       }
+   }
 
    bufp[remains ? 0 : -2] = 0 ;
    return bufp - buf ;
@@ -252,30 +579,27 @@ size_t cfgfile_get_value(const char *filename,
    const char *result = defval ? defval : "" ;
    if (!filename)
       return strlen(strncpy(buf, result, bufsize - 1)) ;
-
-   initPatterns() ;
-
-   safe_handle<FILE_handle_tag> f (fopen(filename, "r")) ;
-
-   if (!f)
+   if (!*filename)
       return 0 ;
-   else if (!section)
-      return readAllSectionNames(f, buf, bufsize) ;
-   else if (!key)
-      return readAllSectionValues(f, section, buf, bufsize) ;
-
-   linebuf_t linebuf ;
-
-   /* key=value pairs that follow before the first section belong to the "empty" section */
-   for (bool in_section = !*section ; getline_normalize(f, linebuf) ;)
-      if (atSectionHeader(linebuf, linebuf))
-         in_section = isSection(linebuf, section) ;
-      else if (in_section && atValue(linebuf, key, linebuf))
-      {
-         result = linebuf ;
-         break ;
-      }
 
+   try {
+      PCOMN_SCOPE_LOCK (guard, cache().lock) ;
+
+      const cfgfile &file = cached_cfgfile(filename) ;
+      if (!file.exists())
+         return 0 ;
+      else if (!section)
+         return readAllSectionNames(file, buf, bufsize) ;
+      else if (!key)
+         return readAllSectionValues(file, section, buf, bufsize) ;
+
+      if (const std::string * const value = file.find_value(section, key))
+         return strlen(strncpy(buf, value->c_str(), bufsize - 1)) ;
+   }
+   catch (const std::exception &)
+   {
+      return 0 ;
+   }
    return strlen(strncpy(buf, result, bufsize - 1)) ;
 } ;
 
@@ -287,206 +611,45 @@ int cfgfile_get_intval(const char *filename, const char *section, const char *ke
       : defval ;
 }
 
-static bool substPart(FILE *file, const char *newstr, fileoff_t range_begin, fileoff_t range_end)
-{
-   NOXCHECK(range_begin >= 0 && range_end >= 0) ;
-   NOXCHECK(range_begin <= range_end) ;
-
-   setbuf(file, NULL) ;
-   const fileoff_t fsz = sys::filesize(fileno(file)) ;
-   ENSURE_FILEOP(fsz, false) ;
-   const ssize_t slen = newstr ? strlen(newstr) : 0 ;
-   const fileoff_t newfsz = fsz + (slen - (range_end - range_begin)) ;
-   if (newfsz > fsz || !newfsz)
-   {
-      ENSURE_FILEOP(ftruncate(fileno(file), newfsz), false) ;
-      if (!newfsz)
-         return true ;
-   }
-   try {
-      PMemMapping mem (fileno(file), O_RDWR) ;
-      memmove(mem.cdata() + (range_end + (newfsz - fsz)),
-              mem.cdata() + range_end,
-              fsz - range_end) ;
-      memmove(mem.cdata() + range_begin, newstr, slen) ;
-   }
-   catch (const std::exception &)
-   {
-      return false ;
-   }
-   if (newfsz < fsz)
-      ENSURE_FILEOP(ftruncate(fileno(file), newfsz), false) ;
-   return true ;
-}
-
-static bool delPart(FILE *file, fpos_t range_begin, fpos_t range_end)
-{
-   fileoff_t begin, end ;
-   ENSURE_FILEOP(fsetpos(file, &range_end), false) ;
-   ENSURE_FILEOP(end = ftell(file), false) ;
-   ENSURE_FILEOP(fsetpos(file, &range_begin), false) ;
-   ENSURE_FILEOP(begin = ftell(file), false) ;
-   return
-      substPart(file, NULL, begin, end) ;
-}
-
-static bool deleteSection(FILE *file, const char *section)
-{
-   if (!section)
-      section = "" ;
-
-   linebuf_t linebuf ;
-   bool in_section = !*section ;
-
-   fpos_t pos ;
-   ENSURE_FILEOP(fgetpos(file, &pos), false) ;
-   fpos_t startpos = pos ;
-   fpos_t endpos   = pos ;
-   while (getline_normalize(file, linebuf))
-   {
-      if (atSectionHeader(linebuf, linebuf))
-      {
-         if (!isSection(linebuf, section))
-         {
-            if (in_section)
-            {
-               if (!*section)
-                  return delPart(file, startpos, pos) ;
-               if (!delPart(file, startpos, endpos))
-                  return false ;
-               in_section = false ;
-            }
-         }
-         else
-         {
-            ENSURE_FILEOP(fgetpos(file, &endpos), false) ;
-            if (!in_section)
-            {
-               in_section = true ;
-               startpos = pos ;
-            }
-         }
-      }
-      else if (in_section && atValue(linebuf, linebuf))
-         ENSURE_FILEOP(fgetpos(file, &endpos), false) ;
-
-      ENSURE_FILEOP(fgetpos(file, &pos), false) ;
-   }
-
-   return
-      !in_section || delPart(file, startpos, endpos) ;
-}
-
-static bool deleteValue(FILE *file, const char *section, const char *key)
-{
-   NOXCHECK(key) ;
-   linebuf_t linebuf ;
-   fpos_t pos ;
-   int status ;
-   bool in_section = !*section ;
-   while ((status = fgetpos(file, &pos)) == 0 && getline_normalize(file, linebuf))
-      if (atSectionHeader(linebuf, linebuf))
-         if (*section)
-            in_section = isSection(linebuf, section) ;
-         else
-            break ;
-      else if (in_section && atValue(linebuf, key, linebuf))
-      {
-         fpos_t endpos ;
-         ENSURE_FILEOP(fgetpos(file, &endpos), false) ;
-         if (!delPart(file, pos, endpos))
-            return false ;
-      }
-   return status == 0 ;
-}
-
-static inline bool isPrevLf(FILE *file)
-{
-   return fseek(file, -1, SEEK_CUR) < 0 || fgetc(file) == '\n' ;
-}
-
 int cfgfile_write_value(const char *filename, const char *section, const char *key, const char *value)
 {
-   initPatterns() ;
-
-   if (!key || !value)
-   {
-      safe_handle<FILE_handle_tag> file (fopen (filename, "r+")) ;
-      return file &&
-         (!key && deleteSection(file, section) ||
-          !value && deleteValue(file, section, key)) ;
-   }
-
-   safe_handle<FILE_handle_tag> file (fdopen(open(filename,
-                                                  O_RDWR|O_CREAT|O_TEXT,
-                                                  S_IRUSR|S_IWUSR|S_IRGRP|S_IROTH), "w+t")) ;
-   if (!file)
+   if (!filename || !*filename)
       return 0 ;
-
    if (!section)
       section = "" ;
 
-   linebuf_t linebuf ;
-   fpos_t prevpos, sectpos ;
-   int status = fgetpos(file, &prevpos) ;
-   sectpos = prevpos ;
-   bool in_section    = !*section ;
-   bool section_found = in_section ;
-   bool nonempty_line = false ;
+   try {
+      PCOMN_SCOPE_LOCK (guard, cache().lock) ;
 
-   for (sectpos = prevpos ; !status && getline_normalize(file, linebuf) ; status = fgetpos(file, &prevpos))
-      if ((nonempty_line = atSectionHeader(linebuf, linebuf)) != false)
-      {
-         if (!*section)
-            break ;
-         in_section = isSection(linebuf, section) ;
-         if (in_section && !section_found)
+      try {
+         cfgfile &file = cached_cfgfile(filename) ;
+         if (!key || !value)
          {
-            ENSURE_FILEOP(fgetpos(file, &sectpos), 0) ;
-            section_found = true ;
+            if (!file.exists())
+               return 0 ;
+            if (!key)
+               file.del_section(section) ;
+            else
+               file.del_value(section, key) ;
          }
+         else
+            file.set_value(section, key, value) ;
+
+         file.flush() ;
       }
-      else
+      catch (...)
       {
-         const size_t oldlen = strlen(linebuf) - 1 ; // Take '\n' into account
-         nonempty_line = atValue(linebuf, linebuf) ;
-         if (in_section && nonempty_line)
-         {
-            if (stricmp(linebuf, key))
-            {
-               ENSURE_FILEOP(fgetpos(file, &sectpos), 0) ;
-            }
-            else
-            {
-               // Requested key found, replace the old value with the new.
-               ENSURE_FILEOP(fsetpos(file, &prevpos), 0) ;
-               const fileoff_t start = ftell(file) ;
-               ENSURE_FILEOP(start, 0) ;
-               snprintf(linebuf, sizeof linebuf, "%s = %s", key, value) ;
-               return
-                  substPart(file, linebuf, start, start + oldlen) ;
-            }
-         }
+         // Don't keep unsaved modifications: they would be returned by subsequent
+         // reads and written by the next successful write
+         cache().files.erase(filename) ;
+         throw ;
       }
-   if (!section_found)
+   }
+   catch (const std::exception &)
    {
-      ENSURE_FILEOP(fgetpos(file, &sectpos), false) ;
-      nonempty_line = nonempty_line || !isPrevLf(file) ;
-      ENSURE_FILEOP(fsetpos(file, &sectpos), false) ;
-      return fprintf
-         (file, "%s[%s]\n%s = %s\n\n", nonempty_line ? "\n" : "", section, key, value) > 0 ;
+      return 0 ;
    }
-
-   // There is a section but there is no such key in it.
-   // Insert the key = value pair after the last value.
-   ENSURE_FILEOP(fsetpos(file, &sectpos), 0) ;
-   const fileoff_t start = ftell(file) ;
-   ENSURE_FILEOP(start, 0) ;
-   snprintf(linebuf, sizeof linebuf,
-            "%s%s = %s%s", start && !isPrevLf(file) ? PCOMN_EOL_NATIVE : "", key, value,
-            !start ? (PCOMN_EOL_NATIVE PCOMN_EOL_NATIVE) : PCOMN_EOL_NATIVE) ;
-   return
-      substPart(file, linebuf, start, start) ;
+   return 1 ;
 } ;
 
 static char *cfgfile_get_sequence(const char *filename, const char *section, size_t buf_initsz)
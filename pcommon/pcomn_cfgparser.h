@@ -59,6 +59,16 @@
 #include <pcomn_platform.h>
 #include <stddef.h>
 
+#ifdef __cplusplus
+#include <pcomn_strslice.h>
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+#include <sys/stat.h>
+#endif
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -240,6 +250,126 @@ inline bool cfgfile_del_section(const char *filename, const char *section)
    return _cfgfile_del_section(filename, section) ;
 }
 
+namespace pcomn {
+
+/******************************************************************************/
+/** A configuration file parsed into memory, with section/key index.
+
+ Parses the file once and serves lookups from memory with the same semantics as
+ cfgfile_get_value(): section names and keys are compared case-insensitively (modulo
+ ASCII), a section may appear in the file several times (its keys are looked up in all
+ its appearances, the first key wins), keys before the first section belong to the
+ "empty" section @c "".
+
+ Modifications are applied to the in-memory file and written by flush() at once, so
+ several modifications cost a single write; comments, empty and invalid lines are
+ preserved as cfgfile_write_value() does.
+
+ cfgfile_get_value(), cfgfile_write_value() and the functions based on them use the
+ process-wide cache of cfgfile objects, which are revalidated on every call by file
+ modification time, size, and inode.
+
+ @note cfgfile is not synchronized: concurrent access to the same object from several
+ threads must be synchronized by the caller.
+*******************************************************************************/
+class _PCOMNEXP cfgfile {
+   public:
+      /// Load a configuration file.
+      /// A nonexistent file is not an error: the result is empty and exists() is false;
+      /// a nonexistent file is created by flush() if there are modifications.
+      /// @throw std::system_error Error reading an existent file.
+      explicit cfgfile(const strslice &filename) ;
+
+      const std::string &filename() const { return _filename ; }
+
+      /// Indicate whether the file existed when loaded (or is created by flush()).
+      bool exists() const { return _exists ; }
+
+      /// Indicate whether there are modifications not yet written by flush().
+      bool modified() const { return _modified ; }
+
+      /// Reload the file if it has been changed since loaded or written by flush().
+      /// Unflushed modifications are discarded on reload.
+      /// @return true if the file has been reloaded.
+      bool revalidate() ;
+
+      /// Get the value of a key in a section.
+      /// @return Pointer to the value or nullptr if there is no such key.
+      const std::string *find_value(const strslice &section, const strslice &key) const ;
+
+      std::string get_value(const strslice &section, const strslice &key,
+                            const strslice &defval = {}) const
+      {
+         const std::string * const value = find_value(section, key) ;
+         return value ? *value : std::string(defval) ;
+      }
+
+      /// Get the names of all sections, in the order of the first appearance.
+      /// Like cfgfile_get_sectnames(), names that differ only in case are all
+      /// included.
+      const std::vector<std::string> &sectnames() const { return _sectnames ; }
+
+      /// Get all key/value pairs of a section, in the file order.
+      /// Like cfgfile_get_section(), only the first appearance of a key is included.
+      std::vector<std::pair<std::string, std::string> > section(const strslice &section) const ;
+
+      /// Set the value of a key, creating the key and/or the section if necessary.
+      void set_value(const strslice &section, const strslice &key, const strslice &value) ;
+
+      /// Delete all appearances of a key in a section.
+      /// @return true if anything is deleted.
+      bool del_value(const strslice &section, const strslice &key) ;
+
+      /// Delete all appearances of a section.
+      /// For the empty section @c "", deletes everything before the first section.
+      /// @return true if anything is deleted.
+      bool del_section(const strslice &section) ;
+
+      /// Write modifications, if any, to the file.
+      /// @throw std::system_error
+      void flush() ;
+
+   private:
+      enum line_kind : uint8_t {
+         line_other,
+         line_section,
+         line_value
+      } ;
+
+      struct line {
+            std::string text ;   /* Without newline */
+            line_kind   kind ;
+            std::string name ;   /* Section name or key */
+            std::string value ;
+      } ;
+
+      struct section_index {
+            std::vector<size_t>                       keys ;   /* Value lines, in the file order */
+            std::unordered_map<std::string, size_t>   first ;  /* Lowercase key -> the first value line */
+      } ;
+
+      std::string          _filename ;
+      struct stat          _stat ;
+      bool                 _exists = false ;
+      bool                 _modified = false ;
+      bool                 _final_newline = true ;
+      std::vector<line>    _lines ;
+
+      std::vector<std::string>                        _sectnames ;
+      std::unordered_map<std::string, section_index>  _sections ; /* Lowercase name -> index */
+
+      void load() ;
+      void reindex() ;
+      void parse_line(line &ln) const ;
+      void erase_lines(size_t from, size_t to) ;
+      void insert_line(size_t pos, std::string text) ;
+
+      bool is_unchanged(const struct stat &st) const ;
+      const section_index *find_section(const strslice &section) const ;
+} ;
+
+} // end of namespace pcomn
+
 #undef _PCOMN_CFGPARSER_MAXLINEBUF
 #undef _cfgfile_get_section
 #undef _cfgfile_get_sectnames
@@ -26,6 +26,10 @@
    -  there is pcommon typedefs used instead of the original zlib typedefs;
    -  the crc32 function has been renamed into calc_crc32 to avoid name clashing;
    -  the crc32 function has been ANSIfied
+   -  there are slicing-by-8/16 and PCLMULQDQ-folded implementations added, the best
+      one is selected at runtime;
+   -  there is CRC32C (Castagnoli) calculation added, with SSE4.2 crc32 instruction
+      used where available
 
 */
 
@@ -143,18 +147,51 @@ static const uint32_t crc_table[256] = {
 };
 #endif
 
+/* ========================================================================
+ * Slicing tables: slices[k][n] is the CRC of the byte n followed by k zero bytes;
+ * slices[0] is the bytewise table.
+ */
+#define CRC32C_POLY 0x82f63b78UL
+
+static uint32_t crc32_slices[16][256] ;
+static uint32_t crc32c_slices[16][256] ;
+
+static void make_slices(uint32_t (*slices)[256], const uint32_t *bytewise)
+{
+   unsigned n, k ;
+   for (n = 0 ; n < 256 ; ++n)
+      slices[0][n] = bytewise[n] ;
+
+   for (k = 1 ; k < 16 ; ++k)
+      for (n = 0 ; n < 256 ; ++n)
+      {
+         const uint32_t prev = slices[k - 1][n] ;
+         slices[k][n] = (prev >> 8) ^ slices[0][prev & 0xff] ;
+      }
+}
+
+static void make_crc32c_table(uint32_t *table)
+{
+   unsigned n, k ;
+   for (n = 0 ; n < 256 ; ++n)
+   {
+      uint32_t c = n ;
+      for (k = 0 ; k < 8 ; k++)
+         c = c & 1 ? CRC32C_POLY ^ (c >> 1) : c >> 1 ;
+      table[n] = c ;
+   }
+}
+
 /* ========================================================================= */
-#define DO1(buf) crc = crc_table[((int)crc ^ (*buf++)) & 0xff] ^ (crc >> 8);
+#define DO1(buf) crc = table[((int)crc ^ (*buf++)) & 0xff] ^ (crc >> 8);
 #define DO2(buf)  DO1(buf); DO1(buf);
 #define DO4(buf)  DO2(buf); DO2(buf);
 #define DO8(buf)  DO4(buf); DO4(buf);
 
-/* ========================================================================= */
-uint32_t calc_crc32(uint32_t crc, const void *srcbuf, size_t len)
+/* All the functions below get and return the "internal" (i.e. inverted) CRC value */
+static uint32_t crc_bytewise(const uint32_t (*slices)[256], uint32_t crc, const byte_t *buf, size_t len)
 {
-    const byte_t *buf = (const byte_t *)srcbuf ;
-    if (buf == NULL) return 0L;
-    crc = crc ^ 0xffffffffL;
+    const uint32_t * const table = slices[0] ;
     while (len >= 8)
     {
       DO8(buf);
@@ -163,5 +200,310 @@ uint32_t calc_crc32(uint32_t crc, const void *srcbuf, size_t len)
     if (len) do {
       DO1(buf);
     } while (--len);
-    return crc ^ 0xffffffffL;
+    return crc ;
+}
+
+static __forceinline uint32_t load_le32(const byte_t *buf)
+{
+   uint32_t v ;
+   memcpy(&v, buf, sizeof v) ;
+#ifdef PCOMN_CPU_BIG_ENDIAN
+   v = __builtin_bswap32(v) ;
+#endif
+   return v ;
+}
+
+#define SLICE4(t, k, v)                         \
+   ((t)[(k) + 3][(v) & 0xff] ^                  \
+    (t)[(k) + 2][((v) >> 8) & 0xff] ^           \
+    (t)[(k) + 1][((v) >> 16) & 0xff] ^          \
+    (t)[(k)][(v) >> 24])
+
+static uint32_t crc_slice8(const uint32_t (*t)[256], uint32_t crc, const byte_t *buf, size_t len)
+{
+   for (; len >= 8 ; buf += 8, len -= 8)
+   {
+      const uint32_t w0 = load_le32(buf) ^ crc ;
+      const uint32_t w1 = load_le32(buf + 4) ;
+      crc = SLICE4(t, 4, w0) ^ SLICE4(t, 0, w1) ;
+   }
+   return crc_bytewise(t, crc, buf, len) ;
+}
+
+static uint32_t crc_slice16(const uint32_t (*t)[256], uint32_t crc, const byte_t *buf, size_t len)
+{
+   for (; len >= 16 ; buf += 16, len -= 16)
+   {
+      const uint32_t w0 = load_le32(buf) ^ crc ;
+      const uint32_t w1 = load_le32(buf + 4) ;
+      const uint32_t w2 = load_le32(buf + 8) ;
+      const uint32_t w3 = load_le32(buf + 12) ;
+      crc = SLICE4(t, 12, w0) ^ SLICE4(t, 8, w1) ^ SLICE4(t, 4, w2) ^ SLICE4(t, 0, w3) ;
+   }
+   return crc_slice8(t, crc, buf, len) ;
+}
+
+/* ========================================================================
+ * Hardware-accelerated implementations
+ */
+#if defined(PCOMN_PL_X86) && defined(PCOMN_COMPILER_GNU)
+#define CRC32_HW_AVAILABLE 1
+
+#include <immintrin.h>
+
+/*
+ * CRC32 folding with carry-less multiplication, see Intel's "Fast CRC Computation for
+ * Generic Polynomials Using PCLMULQDQ Instruction" by V.Gopal et al. The constants are
+ * for the bit-reflected zlib polynomial.
+ * Requires len >= 64, processes len & ~15 bytes.
+ */
+__attribute__((target("pclmul,sse4.1")))
+static uint32_t crc32_clmul_fold(uint32_t crc, const byte_t *buf, size_t len)
+{
+   static const uint64_t k1k2[2] __attribute__((aligned(16))) = { 0x0154442bd4, 0x01c6e41596 } ;
+   static const uint64_t k3k4[2] __attribute__((aligned(16))) = { 0x01751997d0, 0x00ccaa009e } ;
+   static const uint64_t k5k0[2] __attribute__((aligned(16))) = { 0x0163cd6124, 0x0000000000 } ;
+   static const uint64_t poly[2] __attribute__((aligned(16))) = { 0x01db710641, 0x01f7011641 } ;
+
+   __m128i x0, x1, x2, x3, x4, x5, x6, x7, x8 ;
+
+   x1 = _mm_loadu_si128((const __m128i *)(buf + 0x00)) ;
+   x2 = _mm_loadu_si128((const __m128i *)(buf + 0x10)) ;
+   x3 = _mm_loadu_si128((const __m128i *)(buf + 0x20)) ;
+   x4 = _mm_loadu_si128((const __m128i *)(buf + 0x30)) ;
+
+   x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128(crc)) ;
+   x0 = _mm_load_si128((const __m128i *)k1k2) ;
+
+   buf += 64 ;
+   len -= 64 ;
+
+   /* Fold 4 128-bit lanes in parallel */
+   for (; len >= 64 ; buf += 64, len -= 64)
+   {
+      x5 = _mm_clmulepi64_si128(x1, x0, 0x00) ;
+      x6 = _mm_clmulepi64_si128(x2, x0, 0x00) ;
+      x7 = _mm_clmulepi64_si128(x3, x0, 0x00) ;
+      x8 = _mm_clmulepi64_si128(x4, x0, 0x00) ;
+
+      x1 = _mm_clmulepi64_si128(x1, x0, 0x11) ;
+      x2 = _mm_clmulepi64_si128(x2, x0, 0x11) ;
+      x3 = _mm_clmulepi64_si128(x3, x0, 0x11) ;
+      x4 = _mm_clmulepi64_si128(x4, x0, 0x11) ;
+
+      x1 = _mm_xor_si128(_mm_xor_si128(x1, x5), _mm_loadu_si128((const __m128i *)(buf + 0x00))) ;
+      x2 = _mm_xor_si128(_mm_xor_si128(x2, x6), _mm_loadu_si128((const __m128i *)(buf + 0x10))) ;
+      x3 = _mm_xor_si128(_mm_xor_si128(x3, x7), _mm_loadu_si128((const __m128i *)(buf + 0x20))) ;
+      x4 = _mm_xor_si128(_mm_xor_si128(x4, x8), _mm_loadu_si128((const __m128i *)(buf + 0x30))) ;
+   }
+
+   /* Fold the lanes into 128 bits */
+   x0 = _mm_load_si128((const __m128i *)k3k4) ;
+
+   x5 = _mm_clmulepi64_si128(x1, x0, 0x00) ;
+   x1 = _mm_clmulepi64_si128(x1, x0, 0x11) ;
+   x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5) ;
+
+   x5 = _mm_clmulepi64_si128(x1, x0, 0x00) ;
+   x1 = _mm_clmulepi64_si128(x1, x0, 0x11) ;
+   x1 = _mm_xor_si128(_mm_xor_si128(x1, x3), x5) ;
+
+   x5 = _mm_clmulepi64_si128(x1, x0, 0x00) ;
+   x1 = _mm_clmulepi64_si128(x1, x0, 0x11) ;
+   x1 = _mm_xor_si128(_mm_xor_si128(x1, x4), x5) ;
+
+   /* Fold the remaining 16-byte blocks */
+   for (; len >= 16 ; buf += 16, len -= 16)
+   {
+      x5 = _mm_clmulepi64_si128(x1, x0, 0x00) ;
+      x1 = _mm_clmulepi64_si128(x1, x0, 0x11) ;
+      x1 = _mm_xor_si128(_mm_xor_si128(x1, _mm_loadu_si128((const __m128i *)buf)), x5) ;
+   }
+
+   /* Fold 128 bits into 64 bits */
+   x2 = _mm_clmulepi64_si128(x1, x0, 0x10) ;
+   x3 = _mm_setr_epi32(~0, 0, ~0, 0) ;
+   x1 = _mm_xor_si128(_mm_srli_si128(x1, 8), x2) ;
+
+   x0 = _mm_loadl_epi64((const __m128i *)k5k0) ;
+
+   x2 = _mm_srli_si128(x1, 4) ;
+   x1 = _mm_and_si128(x1, x3) ;
+   x1 = _mm_clmulepi64_si128(x1, x0, 0x00) ;
+   x1 = _mm_xor_si128(x1, x2) ;
+
+   /* Barrett reduction to 32 bits */
+   x0 = _mm_load_si128((const __m128i *)poly) ;
+
+   x2 = _mm_and_si128(x1, x3) ;
+   x2 = _mm_clmulepi64_si128(x2, x0, 0x10) ;
+   x2 = _mm_and_si128(x2, x3) ;
+   x2 = _mm_clmulepi64_si128(x2, x0, 0x00) ;
+   x1 = _mm_xor_si128(x1, x2) ;
+
+   return _mm_extract_epi32(x1, 1) ;
+}
+
+static uint32_t crc32_hw(uint32_t crc, const byte_t *buf, size_t len)
+{
+   if (len >= 64)
+   {
+      const size_t folded = len & ~(size_t)15 ;
+      crc = crc32_clmul_fold(crc, buf, len) ;
+      buf += folded ;
+      len -= folded ;
+   }
+   return crc_slice8(crc32_slices, crc, buf, len) ;
+}
+
+__attribute__((target("sse4.2")))
+static uint32_t crc32c_hw(uint32_t crc, const byte_t *buf, size_t len)
+{
+#ifdef PCOMN_PL_64BIT
+   uint64_t crc64 = crc ;
+   for (; len >= 8 ; buf += 8, len -= 8)
+   {
+      uint64_t v ;
+      memcpy(&v, buf, sizeof v) ;
+      crc64 = _mm_crc32_u64(crc64, v) ;
+   }
+   crc = (uint32_t)crc64 ;
+#endif
+   for (; len >= 4 ; buf += 4, len -= 4)
+      crc = _mm_crc32_u32(crc, load_le32(buf)) ;
+   for (; len ; --len)
+      crc = _mm_crc32_u8(crc, *buf++) ;
+   return crc ;
+}
+
+static int cpu_has_clmul(void)
+{
+   __builtin_cpu_init() ;
+   return __builtin_cpu_supports("pclmul") && __builtin_cpu_supports("sse4.1") ;
+}
+
+static int cpu_has_sse42(void)
+{
+   __builtin_cpu_init() ;
+   return !!__builtin_cpu_supports("sse4.2") ;
+}
+
+#else
+#define CRC32_HW_AVAILABLE 0
+#endif /* PCOMN_PL_X86 && PCOMN_COMPILER_GNU */
+
+/* ========================================================================
+ * Runtime selection
+ */
+typedef uint32_t (*crc_function)(uint32_t, const byte_t *, size_t) ;
+
+static uint32_t crc32_sliced(uint32_t crc, const byte_t *buf, size_t len)
+{
+   return crc_slice16(crc32_slices, crc, buf, len) ;
+}
+
+static uint32_t crc32c_sliced(uint32_t crc, const byte_t *buf, size_t len)
+{
+   return crc_slice16(crc32c_slices, crc, buf, len) ;
+}
+
+static uint32_t crc32_init_proxy(uint32_t crc, const byte_t *buf, size_t len) ;
+static uint32_t crc32c_init_proxy(uint32_t crc, const byte_t *buf, size_t len) ;
+
+static crc_function crc32_selected = crc32_init_proxy ;
+static crc_function crc32c_selected = crc32c_init_proxy ;
+
+#ifdef PCOMN_COMPILER_GNU
+__attribute__((constructor))
+#endif
+static void crc32_init(void)
+{
+   uint32_t crc32c_table[256] ;
+
+   /* Initialization is idempotent: if called concurrently, all the threads write
+    * the same values */
+   make_crc32c_table(crc32c_table) ;
+   make_slices(crc32_slices, crc_table) ;
+   make_slices(crc32c_slices, crc32c_table) ;
+
+#if CRC32_HW_AVAILABLE
+   crc32_selected = cpu_has_clmul() ? crc32_hw : crc32_sliced ;
+   crc32c_selected = cpu_has_sse42() ? crc32c_hw : crc32c_sliced ;
+#else
+   crc32_selected = crc32_sliced ;
+   crc32c_selected = crc32c_sliced ;
+#endif
+}
+
+static uint32_t crc32_init_proxy(uint32_t crc, const byte_t *buf, size_t len)
+{
+   crc32_init() ;
+   return crc32_selected(crc, buf, len) ;
+}
+
+static uint32_t crc32c_init_proxy(uint32_t crc, const byte_t *buf, size_t len)
+{
+   crc32_init() ;
+   return crc32c_selected(crc, buf, len) ;
+}
+
+/* ========================================================================= */
+uint32_t calc_crc32(uint32_t crc, const void *srcbuf, size_t len)
+{
+   if (srcbuf == NULL) return 0L;
+   return crc32_selected(crc ^ 0xffffffffL, (const byte_t *)srcbuf, len) ^ 0xffffffffL ;
+}
+
+uint32_t calc_crc32c(uint32_t crc, const void *srcbuf, size_t len)
+{
+   if (srcbuf == NULL) return 0L;
+   return crc32c_selected(crc ^ 0xffffffffL, (const byte_t *)srcbuf, len) ^ 0xffffffffL ;
+}
+
+int crc32_hw_supported(void)
+{
+#if CRC32_HW_AVAILABLE
+   return cpu_has_clmul() ;
+#else
+   return 0 ;
+#endif
+}
+
+int crc32c_hw_supported(void)
+{
+#if CRC32_HW_AVAILABLE
+   return cpu_has_sse42() ;
+#else
+   return 0 ;
+#endif
+}
+
+static uint32_t calc_crc_using(crc32_impl_t impl, const uint32_t (*slices)[256], crc_function selected,
+                               uint32_t crc, const void *srcbuf, size_t len)
+{
+   const byte_t * const buf = (const byte_t *)srcbuf ;
+   if (buf == NULL) return 0L;
+
+   crc ^= 0xffffffffL ;
+   switch (impl)
+   {
+      case CRC32_BYTEWISE: crc = crc_bytewise(slices, crc, buf, len) ; break ;
+      case CRC32_SLICE8:   crc = crc_slice8(slices, crc, buf, len) ; break ;
+      case CRC32_SLICE16:  crc = crc_slice16(slices, crc, buf, len) ; break ;
+      default:             crc = selected(crc, buf, len) ; break ;
+   }
+   return crc ^ 0xffffffffL ;
+}
+
+uint32_t calc_crc32_using(crc32_impl_t impl, uint32_t crc, const void *buf, size_t len)
+{
+   /* Ensure the slicing tables are initialized */
+   calc_crc32(0, "", 0) ;
+   return calc_crc_using(impl, crc32_slices, crc32_selected, crc, buf, len) ;
+}
+
+uint32_t calc_crc32c_using(crc32_impl_t impl, uint32_t crc, const void *buf, size_t len)
+{
+   calc_crc32c(0, "", 0) ;
+   return calc_crc_using(impl, crc32c_slices, crc32c_selected, crc, buf, len) ;
 }
@@ -0,0 +1,410 @@
+/*-*- mode:c++;tab-width:3;indent-tabs-mode:nil;c-file-style:"ellemtel";c-file-offsets:((innamespace . 0)(inclass . ++)) -*-*/
+#ifndef __PCOMN_EVICTION_H
+#define __PCOMN_EVICTION_H
+/*******************************************************************************
+ FILE         :   pcomn_eviction.h
+ COPYRIGHT    :   Yakov Markovitch, 2026. All rights reserved.
+                  See LICENSE for information on usage/redistribution.
+
+ DESCRIPTION  :   Eviction policies for cacher and keyed_pool: LRU, CLOCK, W-TinyLFU.
+
+ PROGRAMMED BY:   Yakov Markovitch
+ CREATION DATE:   16 Oct 2026
+*******************************************************************************/
+/** @file
+ Eviction policies for pcomn::cacher and pcomn::keyed_pool.
+
+  - lru_eviction:      strict LRU (the default);
+  - clock_eviction:    CLOCK (second chance), a hit only sets a reference bit and
+                       never splices the list;
+  - wtinylfu_eviction: W-TinyLFU, a small LRU admission window in front of segmented
+                       LRU main space; window victims are admitted into the main space
+                       only if their (count-min sketch) frequency estimate is higher than
+                       that of the main space victim, which makes the cache scan-resistant.
+
+ Every policy is a class with a nested class template `queue<T, H>`, where T is the
+ type of a cache entry and H is the pointer to the eviction_hook member of T. The queue
+ is not synchronized, its owner calls it under its own lock.
+
+ The queue interface:
+ @code
+   void set_capacity(size_t capacity) ;      // (size_t)-1 means "unlimited"
+   void record(uint32_t hash) ;              // Record an access to a missing key
+   void insert(T &entry, uint32_t hash) ;    // Add a new entry
+   void touch(T &entry, uint32_t hash) ;     // Record a hit
+   void erase(T &entry) ;                    // Remove an entry
+   T *victim() ;                             // Select the entry to evict; NULL if empty
+   void clear() ;                            // Forget all the entries
+   void for_each(F fn) const ;               // Call fn(const T &), most valuable first
+ @endcode
+
+ If the policy has `uses_frequency` true, the hashes passed to the queue must be
+ the hashes of keys, otherwise they are ignored and may be 0.
+
+ If the policy has `batch_eviction` true, the owner may evict a number of entries at
+ once when it reaches its size limit (this amortizes eviction for LRU); otherwise it
+ should evict only as many entries as needed to stay within the limit, since for
+ scan-resistant policies evicting in batches means evicting valuable entries.
+*******************************************************************************/
+#include <pcomn_incdlist.h>
+#include <pcomn_hash.h>
+#include <pcomn_bitops.h>
+#include <pcomn_math.h>
+
+#include <memory>
+#include <algorithm>
+
+#include <stdint.h>
+#include <string.h>
+
+namespace pcomn {
+
+/***************************************************************************//**
+ A member of a cache entry used by eviction policies: a node of a policy's list
+ plus some policy-specific data.
+*******************************************************************************/
+struct eviction_hook {
+      incdlist_node  _node ;
+      uint32_t       _hash = 0 ; /* Key hash, used by frequency-based policies */
+      uint8_t        _mark = 0 ; /* CLOCK reference bit, W-TinyLFU segment */
+} ;
+
+/***************************************************************************//**
+ Count-min sketch of 4-bit counters, the frequency estimator of TinyLFU.
+
+ Has 4 rows, every counter of an item is in the same 64-bit word (16 counters, 4 per
+ row). When the count of increments reaches 10*capacity, all the counters are halved
+ ("aging"), so the sketch reflects the recent access history.
+*******************************************************************************/
+class frequency_sketch {
+      PCOMN_NONCOPYABLE(frequency_sketch) ;
+      PCOMN_NONASSIGNABLE(frequency_sketch) ;
+   public:
+      frequency_sketch() = default ;
+
+      /// Resize the sketch for the specified count of items and reset all counters.
+      /// 0 makes the sketch empty: increment() does nothing, frequency() returns 0.
+      void set_capacity(size_t capacity)
+      {
+         const size_t wordcount = capacity
+            ? bitop::round2z(midval<size_t>(8, 1 << 24, capacity))
+            : 0 ;
+         _table.reset(wordcount ? new uint64_t[wordcount]() : nullptr) ;
+         _mask = wordcount - 1 ;
+         _sample_size = 10*std::max<size_t>(capacity, 1) ;
+         _additions = 0 ;
+      }
+
+      bool empty() const { return !_table ; }
+
+      void increment(uint32_t hash)
+      {
+         if (empty())
+            return ;
+
+         uint64_t &word = _table[word_index(hash)] ;
+         bool added = false ;
+         for (unsigned row = 0 ; row < 4 ; ++row)
+         {
+            const unsigned shift = counter_shift(hash, row) ;
+            if (((word >> shift) & 0xf) != 0xf)
+            {
+               word += uint64_t(1) << shift ;
+               added = true ;
+            }
+         }
+         if (added && ++_additions >= _sample_size)
+            halve() ;
+      }
+
+      unsigned frequency(uint32_t hash) const
+      {
+         if (empty())
+            return 0 ;
+
+         const uint64_t word = _table[word_index(hash)] ;
+         unsigned result = 0xf ;
+         for (unsigned row = 0 ; row < 4 ; ++row)
+            result = std::min<unsigned>(result, (word >> counter_shift(hash, row)) & 0xf) ;
+         return result ;
+      }
+
+   private:
+      std::unique_ptr<uint64_t[]> _table ;
+      size_t _mask = 0 ;
+      size_t _sample_size = 0 ;
+      size_t _additions = 0 ;
+
+      size_t word_index(uint32_t hash) const { return wang_hash64to32(hash) & _mask ; }
+
+      // Row `row` owns counters [4*row, 4*row+3] of the word, select one of them by
+      // the two bits of the hash.
+      static unsigned counter_shift(uint32_t hash, unsigned row)
+      {
+         return (4*row + ((hash >> (8*row)) & 3)) * 4 ;
+      }
+
+      void halve()
+      {
+         for (uint64_t *w = _table.get(), *e = w + _mask + 1 ; w != e ; ++w)
+            *w = (*w >> 1) & 0x7777777777777777ULL ;
+         _additions /= 2 ;
+      }
+} ;
+
+namespace detail {
+/******************************************************************************/
+/** Common part of eviction queues: conversion between entries and hooks.
+*******************************************************************************/
+template<typename T, eviction_hook T::*H>
+struct eviction_queue_base {
+   protected:
+      typedef incdlist<eviction_hook, &eviction_hook::_node> hook_list ;
+
+      static eviction_hook &hook(T &entry) { return entry.*H ; }
+
+      // The same "back offset" trick as in incdlist::object()
+      static T &entry(const eviction_hook &h)
+      {
+         return *reinterpret_cast<T *>
+            (reinterpret_cast<char *>(const_cast<eviction_hook *>(&h)) -
+             (reinterpret_cast<char *>(&(reinterpret_cast<T *>(256)->*H)) - 256)) ;
+      }
+
+      template<typename F>
+      static void for_each_in(const hook_list &lst, F &fn)
+      {
+         for (const eviction_hook &h: lst)
+            fn(const_cast<const T &>(entry(h))) ;
+      }
+} ;
+} // end of namespace pcomn::detail
+
+/******************************************************************************/
+/** Strict LRU eviction: every hit moves the entry to the head of the list.
+*******************************************************************************/
+struct lru_eviction {
+      static constexpr bool uses_frequency = false ;
+      static constexpr bool batch_eviction = true ;
+
+      template<typename T, eviction_hook T::*H>
+      class queue : detail::eviction_queue_base<T, H> {
+            typedef detail::eviction_queue_base<T, H> ancestor ;
+            using typename ancestor::hook_list ;
+            using ancestor::hook ;
+            using ancestor::entry ;
+         public:
+            void set_capacity(size_t) {}
+            void record(uint32_t) {}
+
+            void insert(T &e, uint32_t) { _lru.push_front(hook(e)) ; }
+            void touch(T &e, uint32_t) { _lru.push_front(hook(e)) ; }
+            void erase(T &e) { hook_list::remove(hook(e)) ; }
+
+            T *victim() { return _lru.empty() ? nullptr : &entry(_lru.back()) ; }
+
+            void clear() { _lru.flush() ; }
+
+            template<typename F>
+            void for_each(F fn) const { ancestor::for_each_in(_lru, fn) ; }
+
+         private:
+            hook_list _lru ;
+      } ;
+} ;
+
+/******************************************************************************/
+/** CLOCK (second chance) eviction.
+
+ A hit only sets the reference bit of the entry. The entries with the reference bit
+ set that reach the tail of the list are moved to its head with the bit cleared
+ instead of being evicted.
+*******************************************************************************/
+struct clock_eviction {
+      static constexpr bool uses_frequency = false ;
+      static constexpr bool batch_eviction = false ;
+
+      template<typename T, eviction_hook T::*H>
+      class queue : detail::eviction_queue_base<T, H> {
+            typedef detail::eviction_queue_base<T, H> ancestor ;
+            using typename ancestor::hook_list ;
+            using ancestor::hook ;
+            using ancestor::entry ;
+         public:
+            void set_capacity(size_t) {}
+            void record(uint32_t) {}
+
+            void insert(T &e, uint32_t)
+            {
+               hook(e)._mark = 0 ;
+               _ring.push_front(hook(e)) ;
+            }
+            void touch(T &e, uint32_t) { hook(e)._mark = 1 ; }
+            void erase(T &e) { hook_list::remove(hook(e)) ; }
+
+            T *victim()
+            {
+               if (_ring.empty())
+                  return nullptr ;
+               // Terminates: every pass clears the reference bit
+               while (_ring.back()._mark)
+               {
+                  eviction_hook &h = _ring.back() ;
+                  h._mark = 0 ;
+                  _ring.push_front(h) ;
+               }
+               return &entry(_ring.back()) ;
+            }
+
+            void clear() { _ring.flush() ; }
+
+            template<typename F>
+            void for_each(F fn) const { ancestor::for_each_in(_ring, fn) ; }
+
+         private:
+            hook_list _ring ;
+      } ;
+} ;
+
+/******************************************************************************/
+/** W-TinyLFU eviction.
+
+ New entries go to the LRU window (1% of capacity). Entries falling out of the window
+ are candidates for the main space, which is segmented LRU: probation (20%) and
+ protected (80%) segments; a hit in probation promotes the entry to protected.
+ When the main space is full, the window candidate is admitted only if its frequency
+ estimate is greater than that of the probation LRU victim; otherwise the candidate
+ itself is evicted. Thus one-off keys of a scan never push out frequently used ones.
+*******************************************************************************/
+struct wtinylfu_eviction {
+      static constexpr bool uses_frequency = true ;
+      static constexpr bool batch_eviction = false ;
+
+      template<typename T, eviction_hook T::*H>
+      class queue : detail::eviction_queue_base<T, H> {
+            typedef detail::eviction_queue_base<T, H> ancestor ;
+            using typename ancestor::hook_list ;
+            using ancestor::hook ;
+            using ancestor::entry ;
+
+            enum Segment : uint8_t { WINDOW, PROBATION, PROTECTED } ;
+
+         public:
+            void set_capacity(size_t capacity)
+            {
+               if (capacity == (size_t)-1)
+               {
+                  // Nothing will ever be evicted, don't waste memory for the sketch
+                  _sketch.set_capacity(0) ;
+                  _window_max = _main_max = _protected_max = capacity ;
+                  return ;
+               }
+               _window_max = std::max<size_t>(capacity/100, 1) ;
+               _main_max = capacity > _window_max ? capacity - _window_max : 0 ;
+               _protected_max = _main_max*4/5 ;
+               _sketch.set_capacity(capacity) ;
+            }
+
+            void record(uint32_t hash) { _sketch.increment(hash) ; }
+
+            void insert(T &e, uint32_t hash)
+            {
+               eviction_hook &h = hook(e) ;
+               h._hash = hash ;
+               h._mark = WINDOW ;
+               _window.push_front(h) ;
+               ++_count[WINDOW] ;
+               _sketch.increment(hash) ;
+            }
+
+            void touch(T &e, uint32_t hash)
+            {
+               eviction_hook &h = hook(e) ;
+               _sketch.increment(hash) ;
+
+               switch (h._mark)
+               {
+                  case WINDOW:    _window.push_front(h) ; break ;
+                  case PROTECTED: _protected.push_front(h) ; break ;
+                  default:
+                     move_to(h, PROBATION, PROTECTED, _protected) ;
+                     // Demote protected overflow back to probation
+                     if (_count[PROTECTED] > _protected_max)
+                        move_to(_protected.back(), PROTECTED, PROBATION, _probation) ;
+               }
+            }
+
+            void erase(T &e)
+            {
+               eviction_hook &h = hook(e) ;
+               NOXCHECK(_count[h._mark]) ;
+               --_count[h._mark] ;
+               hook_list::remove(h) ;
+            }
+
+            T *victim()
+            {
+               // While there is room in the main space, window overflow goes there freely
+               while (_count[WINDOW] > _window_max && _count[PROBATION] + _count[PROTECTED] < _main_max)
+                  move_to(_window.back(), WINDOW, PROBATION, _probation) ;
+
+               eviction_hook * const candidate = _count[WINDOW] ? &_window.back() : nullptr ;
+               eviction_hook * const main_victim =
+                  _count[PROBATION] ? &_probation.back() :
+                  _count[PROTECTED] ? &_protected.back() :
+                  nullptr ;
+
+               if (!candidate || !main_victim)
+                  return candidate ? &entry(*candidate) : main_victim ? &entry(*main_victim) : nullptr ;
+
+               // Compare the window candidate with the main space victim even if the window
+               // is within its limit: the owner may shrink the capacity.
+               if (_sketch.frequency(candidate->_hash) <= _sketch.frequency(main_victim->_hash))
+                  return &entry(*candidate) ;
+
+               if (_count[WINDOW] > _window_max)
+                  // Admit the candidate into the main space
+                  move_to(*candidate, WINDOW, PROBATION, _probation) ;
+               return &entry(*main_victim) ;
+            }
+
+            void clear()
+            {
+               _window.flush() ;
+               _probation.flush() ;
+               _protected.flush() ;
+               std::fill_n(_count, 3, 0) ;
+            }
+
+            template<typename F>
+            void for_each(F fn) const
+            {
+               ancestor::for_each_in(_window, fn) ;
+               ancestor::for_each_in(_protected, fn) ;
+               ancestor::for_each_in(_probation, fn) ;
+            }
+
+         private:
+            hook_list         _window ;
+            hook_list         _probation ;
+            hook_list         _protected ;
+            size_t            _count[3] = {} ;
+            size_t            _window_max = (size_t)-1 ;
+            size_t            _main_max = (size_t)-1 ;
+            size_t            _protected_max = (size_t)-1 ;
+            frequency_sketch  _sketch ;
+
+            void move_to(eviction_hook &h, Segment from, Segment to, hook_list &lst)
+            {
+               NOXCHECK(h._mark == from && _count[from]) ;
+               --_count[from] ;
+               ++_count[to] ;
+               h._mark = to ;
+               lst.push_front(h) ;
+            }
+      } ;
+} ;
+
+} // end of namespace pcomn
+
+#endif /* __PCOMN_EVICTION_H */
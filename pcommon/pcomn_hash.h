@@ -32,8 +32,29 @@
 extern "C" {
 #endif
 
+/// Calculate CRC32 (zlib polynomial) of a buffer.
+/// Uses PCLMULQDQ folding where supported by the CPU, slicing-by-16 otherwise.
 _PCOMNEXP uint32_t calc_crc32(uint32_t crc, const void *buf, size_t len) ;
 
+/// Calculate CRC32C (Castagnoli polynomial) of a buffer.
+/// Uses SSE4.2 crc32 instruction where supported by the CPU, slicing-by-16 otherwise.
+_PCOMNEXP uint32_t calc_crc32c(uint32_t crc, const void *buf, size_t len) ;
+
+/// Particular CRC32/CRC32C implementations, for testing and benchmarking.
+typedef enum {
+   CRC32_BYTEWISE,   /**< Byte-at-a-time table lookup */
+   CRC32_SLICE8,     /**< Slicing-by-8 */
+   CRC32_SLICE16,    /**< Slicing-by-16 */
+   CRC32_HARDWARE    /**< PCLMULQDQ folding for CRC32, crc32 instruction for CRC32C;
+                        if not supported by the CPU, the same as calc_crc32/calc_crc32c */
+} crc32_impl_t ;
+
+_PCOMNEXP int crc32_hw_supported(void) ;
+_PCOMNEXP int crc32c_hw_supported(void) ;
+
+_PCOMNEXP uint32_t calc_crc32_using(crc32_impl_t impl, uint32_t crc, const void *buf, size_t len) ;
+_PCOMNEXP uint32_t calc_crc32c_using(crc32_impl_t impl, uint32_t crc, const void *buf, size_t len) ;
+
 #ifdef __cplusplus
 }
 #endif
@@ -70,6 +91,11 @@ inline uint32_t calc_crc32(uint32_t prev_crc, const void *buf, size_t sz)
    return ::calc_crc32(prev_crc, buf, sz) ;
 }
 
+inline uint32_t calc_crc32c(uint32_t prev_crc, const void *buf, size_t sz)
+{
+   return ::calc_crc32c(prev_crc, buf, sz) ;
+}
+
 /*******************************************************************************/
 /** Fowler/Noll/Vo (FNV) hash.
 *******************************************************************************/
@@ -921,6 +947,20 @@ inline enable_if_buffer_t<B, uint32_t> calc_crc32(uint32_t crc, size_t ignore_ta
       ignore_tail >= bufsize ? crc : calc_crc32(crc, buf::cdata(buffer), bufsize - ignore_tail) ;
 }
 
+template<typename B>
+inline enable_if_buffer_t<B, uint32_t> calc_crc32c(uint32_t crc, const B &buffer)
+{
+   return calc_crc32c(crc, buf::cdata(buffer), buf::size(buffer)) ;
+}
+
+template<typename B>
+inline enable_if_buffer_t<B, uint32_t> calc_crc32c(uint32_t crc, size_t ignore_tail, const B &buffer)
+{
+   const size_t bufsize = buf::size(buffer) ;
+   return
+      ignore_tail >= bufsize ? crc : calc_crc32c(crc, buf::cdata(buffer), bufsize - ignore_tail) ;
+}
+
 template<typename B>
 inline enable_if_buffer_t<B, md5hash_t>  md5hash(const B &b) { return md5hash(buf::cdata(b), buf::size(b)) ; }
 template<typename B>
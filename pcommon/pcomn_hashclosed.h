@@ -20,6 +20,14 @@
  Uses linear probing as a collision resolution strategy: this is simple, has quite
  satisfactory performance and allows more efficient item deletion algorithme than
  other more complex strategies (e.g. double-hashing).
+
+ The bucket layout is selected by the Layout template parameter:
+  - linear_probing_layout (the default) keeps every bucket state together with the
+    value and probes buckets one by one;
+  - group_probing_layout keeps bucket states along with 7 bits of the hash in a
+    separate control byte array that is probed by groups of 16 (SSE2) or 32 (AVX2)
+    slots at once, so a probe seldom touches a value with non-matching key; this is
+    much faster on large, miss-heavy tables.
 *******************************************************************************/
 #include <pcomn_meta.h>
 #include <pcomn_math.h>
@@ -42,7 +50,13 @@
 #include <string.h>
 #include <math.h>
 
+#ifdef PCOMN_GCC86_INTRINSICS
+#  include <immintrin.h>
+#endif
+
 constexpr const float PCOMN_CLOSED_HASH_LOAD_FACTOR = 0.75 ;
+/// The count of keys hashed and prefetched at once by closed_hashtable::find_many()
+constexpr const size_t PCOMN_CLOSED_HASH_PREFETCH_BATCH = 32 ;
 
 namespace pcomn {
 
@@ -187,6 +201,173 @@ struct closed_hashtable_bucket<basic_strslice<C>, void> :
          closed_hashtable_bucket<basic_strslice<C>, strslice_state_extractor>
 {} ;
 
+/*******************************************************************************
+ Control bytes of group_probing_layout.
+ A full slot has a control byte in the range 0..127 (7 bits of the key hash), other
+ values are negative. The encoding allows to test for Empty and Deleted with simple
+ bit arithmetics (see ctrl_group_portable).
+*******************************************************************************/
+enum hash_ctrl : int8_t {
+   CTRL_EMPTY    = -128,
+   CTRL_DELETED  = -2,
+   CTRL_SENTINEL = -1
+} ;
+
+namespace detail {
+/// All-empty control bytes group for tables without allocated slots.
+inline int8_t *empty_ctrl_group()
+{
+   alignas(32) static const int8_t group[32] = {
+      CTRL_SENTINEL, CTRL_EMPTY, CTRL_EMPTY, CTRL_EMPTY, CTRL_EMPTY, CTRL_EMPTY, CTRL_EMPTY, CTRL_EMPTY,
+      CTRL_EMPTY,    CTRL_EMPTY, CTRL_EMPTY, CTRL_EMPTY, CTRL_EMPTY, CTRL_EMPTY, CTRL_EMPTY, CTRL_EMPTY,
+      CTRL_EMPTY,    CTRL_EMPTY, CTRL_EMPTY, CTRL_EMPTY, CTRL_EMPTY, CTRL_EMPTY, CTRL_EMPTY, CTRL_EMPTY,
+      CTRL_EMPTY,    CTRL_EMPTY, CTRL_EMPTY, CTRL_EMPTY, CTRL_EMPTY, CTRL_EMPTY, CTRL_EMPTY, CTRL_EMPTY
+   } ;
+   // Never written: a table with no slots always allocates them before insertion
+   return const_cast<int8_t *>(group) ;
+}
+
+/***************************************************************************//**
+ Mask operations common for all control byte groups.
+
+ A match mask has (1 << Shift) bits per slot, only the lowest/highest bit of them
+ may be set.
+*******************************************************************************/
+template<typename Mask, unsigned Width, unsigned Shift>
+struct ctrl_group_mask {
+      typedef Mask mask_type ;
+
+      enum : unsigned {
+         width = Width,
+         shift = Shift
+      } ;
+
+      /// Get the index of the first matching slot; @a mask must be nonzero.
+      static unsigned first(mask_type mask) { return bitop::rzcnt(mask) >> shift ; }
+
+      static mask_type clear_first(mask_type mask) { return bitop::clrrnzb(mask) ; }
+
+      /// Get the count of unmatched slots at the start of the group; @a mask must be nonzero.
+      static unsigned trailing(mask_type mask) { return first(mask) ; }
+
+      /// Get the count of unmatched slots at the end of the group; @a mask must be nonzero.
+      static unsigned leading(mask_type mask)
+      {
+         return ((width << shift) - 1 - bitop::log2floor(mask)) >> shift ;
+      }
+} ;
+
+/***************************************************************************//**
+ Portable control bytes group: 8 slots probed using 64-bit integer arithmetics.
+*******************************************************************************/
+struct ctrl_group_portable : ctrl_group_mask<uint64_t, 8, 3> {
+
+      explicit ctrl_group_portable(const int8_t *ctrl)
+      {
+         memcpy(&_ctrl, ctrl, sizeof _ctrl) ;
+         _ctrl = value_from_little_endian(_ctrl) ;
+      }
+
+      /// Match slots with specified 7 hash bits; may give false positives, which is OK
+      /// since keys are compared anyway.
+      mask_type match(int8_t h2) const
+      {
+         const uint64_t x = _ctrl ^ (lsbs * (uint8_t)h2) ;
+         return (x - lsbs) & ~x & msbs ;
+      }
+
+      mask_type match_empty() const { return (_ctrl & (~_ctrl << 6)) & msbs ; }
+
+      /// Match Empty and Deleted slots.
+      mask_type match_available() const { return (_ctrl & (~_ctrl << 7)) & msbs ; }
+
+   private:
+      uint64_t _ctrl ;
+
+      static constexpr uint64_t lsbs = 0x0101010101010101ULL ;
+      static constexpr uint64_t msbs = 0x8080808080808080ULL ;
+} ;
+
+#if defined(PCOMN_GCC86_INTRINSICS) && defined(__SSE2__)
+/***************************************************************************//**
+ SSE2 control bytes group: 16 slots probed at once.
+*******************************************************************************/
+struct ctrl_group_sse2 : ctrl_group_mask<uint32_t, 16, 0> {
+
+      explicit ctrl_group_sse2(const int8_t *ctrl) :
+         _ctrl(_mm_loadu_si128((const __m128i *)ctrl))
+      {}
+
+      mask_type match(int8_t h2) const
+      {
+         return _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(h2), _ctrl)) ;
+      }
+
+      mask_type match_empty() const { return match(CTRL_EMPTY) ; }
+
+      mask_type match_available() const
+      {
+         return _mm_movemask_epi8(_mm_cmpgt_epi8(_mm_set1_epi8(CTRL_SENTINEL), _ctrl)) ;
+      }
+
+   private:
+      __m128i _ctrl ;
+} ;
+#endif
+
+#ifdef PCOMN_AVX2_INTRINSICS
+/***************************************************************************//**
+ AVX2 control bytes group: 32 slots probed at once.
+*******************************************************************************/
+struct ctrl_group_avx2 : ctrl_group_mask<uint32_t, 32, 0> {
+
+      explicit ctrl_group_avx2(const int8_t *ctrl) :
+         _ctrl(_mm256_loadu_si256((const __m256i *)ctrl))
+      {}
+
+      mask_type match(int8_t h2) const
+      {
+         return _mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_set1_epi8(h2), _ctrl)) ;
+      }
+
+      mask_type match_empty() const { return match(CTRL_EMPTY) ; }
+
+      mask_type match_available() const
+      {
+         return _mm256_movemask_epi8(_mm256_cmpgt_epi8(_mm256_set1_epi8(CTRL_SENTINEL), _ctrl)) ;
+      }
+
+   private:
+      __m256i _ctrl ;
+} ;
+
+typedef ctrl_group_avx2 native_ctrl_group ;
+
+#elif defined(PCOMN_GCC86_INTRINSICS) && defined(__SSE2__)
+typedef ctrl_group_sse2 native_ctrl_group ;
+#else
+typedef ctrl_group_portable native_ctrl_group ;
+#endif
+} // end of namespace pcomn::detail
+
+/***************************************************************************//**
+ Bucket layout policies of closed_hashtable.
+*******************************************************************************/
+/**@{*/
+/// Every bucket keeps its state together with the value, buckets are probed one by one.
+struct linear_probing_layout {} ;
+
+/// Bucket states along with 7 bits of the hash are kept in a separate control byte
+/// array, which is probed by groups of CtrlGroup::width slots.
+template<typename CtrlGroup>
+struct basic_group_probing_layout {
+      typedef CtrlGroup ctrl_group ;
+} ;
+
+/// Group probing using the widest SIMD instruction set the code is compiled for.
+typedef basic_group_probing_layout<detail::native_ctrl_group> group_probing_layout ;
+/**@}*/
+
 /******************************************************************************/
 /** Closed hash table, particularly efficient for storing objects of small POD types.
 
@@ -196,17 +377,20 @@ template<typename Value,
          typename ExtractKey     = void,
          typename Hash           = void,
          typename Pred           = void,
-         typename ExtractState   = void>
+         typename ExtractState   = void,
+         typename Layout         = linear_probing_layout>
 
 class closed_hashtable {
       // Only TriviallyCopyable items are allowed!
       PCOMN_STATIC_CHECK(std::is_trivially_copyable<Value>::value ||
                          pcomn::is_literal_type<Value>::value) ;
 
+      PCOMN_STATIC_CHECK(std::is_same<Layout, linear_probing_layout>::value) ;
+
       PCOMN_NONASSIGNABLE(closed_hashtable) ;
 
       typedef closed_hashtable_bucket<Value, ExtractState> bucket_type ;
-      typedef closed_hashtable<Value, ExtractKey, Hash, Pred, ExtractState> table_type ;
+      typedef closed_hashtable<Value, ExtractKey, Hash, Pred, ExtractState, Layout> table_type ;
 
    public:
       using value_type  = Value ;
@@ -448,6 +632,36 @@ class closed_hashtable {
          return count(key_get()(value)) ;
       }
 
+      /// Find every key from a sequence, writing a const_iterator per key (end() for
+      /// absent keys) to @a results.
+      ///
+      /// Keys are hashed by batches of PCOMN_CLOSED_HASH_PREFETCH_BATCH and the home
+      /// buckets of a batch are prefetched before probing, so the cache misses of a batch
+      /// overlap instead of being taken one after another.
+      /// @return The end of the results sequence.
+      template<typename ForwardIterator, typename OutputIterator>
+      OutputIterator find_many(ForwardIterator keys_begin, ForwardIterator keys_end,
+                               OutputIterator results) const
+      {
+         probe_many(keys_begin, keys_end, [&](const_iterator found)
+         {
+            *results = found ;
+            ++results ;
+         }) ;
+         return results ;
+      }
+
+      /// Get the count of keys from a sequence present in the table.
+      /// Probes like find_many().
+      template<typename ForwardIterator>
+      size_type count_many(ForwardIterator keys_begin, ForwardIterator keys_end) const
+      {
+         const const_iterator e = end() ;
+         size_type result = 0 ;
+         probe_many(keys_begin, keys_end, [&](const_iterator found) { result += found != e ; }) ;
+         return result ;
+      }
+
       iterator begin() { return empty() ? end() : iterator(begin_buckets()) ; }
       const_iterator begin() const { return empty() ? end() : const_iterator(begin_buckets()) ; }
       const_iterator cbegin() const { return begin() ; }
@@ -799,10 +1013,14 @@ class closed_hashtable {
 
       bucket_type *find_bucket(const key_type &key) const
       {
-         if (empty())
-            return NULL ;
+         return empty() ? NULL : find_bucket(key, hash_function()(key)) ;
+      }
+
+      bucket_type *find_bucket(const key_type &key, size_t hash) const
+      {
+         NOXCHECK(!empty()) ;
          bucket_type * const begin = begin_buckets() ;
-         bucket_type *bucket = begin + bucket_ndx(key) ;
+         bucket_type *bucket = begin + (hash & (bucket_count() - 1)) ;
          bucket_type * const end = bucket ;
          do
             switch (bucket->state())
@@ -827,6 +1045,35 @@ class closed_hashtable {
          return Iterator(bucket ? bucket : end_buckets()) ;
       }
 
+      template<typename ForwardIterator, typename Found>
+      void probe_many(ForwardIterator b, ForwardIterator e, Found &&found) const
+      {
+         if (empty())
+         {
+            for (; b != e ; ++b)
+               found(end()) ;
+            return ;
+         }
+         bucket_type * const begin = begin_buckets() ;
+         const size_t mask = bucket_count() - 1 ;
+         size_t hashes[PCOMN_CLOSED_HASH_PREFETCH_BATCH] ;
+         while (b != e)
+         {
+            ForwardIterator batch = b ;
+            size_t n = 0 ;
+            for (; n < PCOMN_CLOSED_HASH_PREFETCH_BATCH && b != e ; ++n, ++b)
+            {
+               hashes[n] = hash_function()(*b) ;
+               PCOMN_PREFETCH(begin + (hashes[n] & mask)) ;
+            }
+            for (size_t i = 0 ; i < n ; ++i, ++batch)
+            {
+               bucket_type * const bucket = find_bucket(*batch, hashes[i]) ;
+               found(const_iterator(bucket ? bucket : end_buckets())) ;
+            }
+         }
+      }
+
       // Advance bucket pointer cyclically forward
       bucket_type *next(bucket_type *current) const
       {
@@ -883,19 +1130,19 @@ class closed_hashtable {
 /*******************************************************************************
  closed_hashtable
 *******************************************************************************/
-template<typename V, typename X, typename H, typename P, typename S>
-closed_hashtable<V, X, H, P, S>::closed_hashtable(size_type initsize) :
+template<typename V, typename X, typename H, typename P, typename S, typename L>
+closed_hashtable<V, X, H, P, S, L>::closed_hashtable(size_type initsize) :
    _bucket_container(initsize, _basic_state)
 {}
 
-template<typename V, typename X, typename H, typename P, typename S>
-closed_hashtable<V, X, H, P, S>::closed_hashtable(const std::pair<size_type, float> &size_n_load) :
+template<typename V, typename X, typename H, typename P, typename S, typename L>
+closed_hashtable<V, X, H, P, S, L>::closed_hashtable(const std::pair<size_type, float> &size_n_load) :
    _basic_state{{}, {}, {}, size_n_load.second},
    _bucket_container(size_n_load.first, _basic_state)
 {}
 
-template<typename V, typename X, typename H, typename P, typename S>
-auto closed_hashtable<V, X, H, P, S>::insert(const value_type &value) -> std::pair<iterator, bool>
+template<typename V, typename X, typename H, typename P, typename S, typename L>
+auto closed_hashtable<V, X, H, P, S, L>::insert(const value_type &value) -> std::pair<iterator, bool>
 {
    if (container().overloaded(_basic_state))
       expand() ;
@@ -911,9 +1158,9 @@ auto closed_hashtable<V, X, H, P, S>::insert(const value_type &value) -> std::pa
    return std::pair<iterator, bool>(iterator(place), has_place) ;
 }
 
-template<typename V, typename X, typename H, typename P, typename S>
-void closed_hashtable<V, X, H, P, S>::copy_buckets(const bucket_type *begin,
-                                                   const bucket_type *end)
+template<typename V, typename X, typename H, typename P, typename S, typename L>
+void closed_hashtable<V, X, H, P, S, L>::copy_buckets(const bucket_type *begin,
+                                                      const bucket_type *end)
 {
    for ( ; begin != end ; ++begin)
       if (begin->state() == bucket_state::Valid)
@@ -922,8 +1169,8 @@ void closed_hashtable<V, X, H, P, S>::copy_buckets(const bucket_type *begin,
          NOXCHECK(begin->is_available()) ;
 }
 
-template<typename V, typename X, typename H, typename P, typename S>
-void closed_hashtable<V, X, H, P, S>::expand(size_type reserve_count)
+template<typename V, typename X, typename H, typename P, typename S, typename L>
+void closed_hashtable<V, X, H, P, S, L>::expand(size_type reserve_count)
 {
    NOXCHECK(reserve_count <= std::numeric_limits<size_type>::max()/2) ;
    NOXCHECK(!_basic_state.is_static_buckets() || _basic_state.static_size()) ;
@@ -946,11 +1193,652 @@ void closed_hashtable<V, X, H, P, S>::expand(size_type reserve_count)
       other_container._dyn.clear() ;
 }
 
+/******************************************************************************/
+/** Closed hash table with group probing (a.k.a. "Swiss table") bucket layout.
+
+ Slot states along with 7 bits of the key hash are kept in a separate array of
+ control bytes, one byte per slot; the rest of the hash selects the first group to
+ probe. A group of CtrlGroup::width control bytes is checked for matching hash bits
+ and for an empty slot with a couple of SIMD instructions, so keys are only compared
+ for slots with matching hash bits.
+
+ Probing is triangular over groups (offset += width, 2*width, 3*width, ...), which
+ visits every group of a power-of-2-sized table.
+
+ The slot count is always 2^n-1: the control byte at slot count position is the end
+ sentinel, it is followed by width-1 clones of the first control bytes so that a group
+ load at any slot never wraps around.
+
+ ExtractState is ignored: slot states are kept in control bytes.
+*******************************************************************************/
+template<typename Value, typename ExtractKey, typename Hash, typename Pred, typename ExtractState,
+         typename CtrlGroup>
+
+class closed_hashtable<Value, ExtractKey, Hash, Pred, ExtractState, basic_group_probing_layout<CtrlGroup>> {
+      // Only TriviallyCopyable items are allowed!
+      PCOMN_STATIC_CHECK(std::is_trivially_copyable<Value>::value ||
+                         pcomn::is_literal_type<Value>::value) ;
+
+      PCOMN_STATIC_CHECK(alignof(Value) <= alignof(std::max_align_t)) ;
+
+      PCOMN_NONASSIGNABLE(closed_hashtable) ;
+
+      typedef CtrlGroup                      group_type ;
+      typedef typename group_type::mask_type mask_type ;
+      typedef closed_hashtable<Value, ExtractKey, Hash, Pred, ExtractState,
+                               basic_group_probing_layout<CtrlGroup>> table_type ;
+
+      enum : size_t { GroupWidth = group_type::width } ;
+
+   public:
+      using value_type  = Value ;
+
+      using key_extract = std::conditional_t<std::is_same<ExtractKey, void>::value,
+                                             pcomn::identity, ExtractKey> ;
+      using key_type    = noref_result_of_t<key_extract(value_type)> ;
+      using hasher      = select_functor_t<Hash, key_type, pcomn::hash_fn> ;
+      using key_equal   = select_functor_t<Pred, key_type, std::equal_to> ;
+
+      typedef size_t      size_type ;
+      typedef ptrdiff_t   difference_type ;
+
+      template<bool IsConstant>
+      class basic_iterator :
+         public std::iterator<std::forward_iterator_tag, Value, ptrdiff_t, const Value *, const Value &>
+      {
+            friend table_type ;
+
+         public:
+            typedef ptrdiff_t    difference_type ;
+            typedef Value        value_type ;
+            typedef const Value *pointer ;
+            typedef const Value &reference ;
+
+            basic_iterator() :
+               _ctrl(NULL), _slot(NULL)
+            {}
+
+            basic_iterator(const basic_iterator<false> &other) :
+               _ctrl(other._ctrl), _slot(other._slot)
+            {}
+
+            reference operator*() const { return *_slot ; }
+            pointer operator->() const { return &(operator*()) ; }
+
+            basic_iterator &operator++()
+            {
+               ++_ctrl ;
+               ++_slot ;
+               nearest() ;
+               return *this ;
+            }
+            basic_iterator operator++(int)
+            {
+               basic_iterator prev (*this) ;
+               ++*this ;
+               return prev ;
+            }
+
+            friend bool operator==(const basic_iterator<IsConstant> &lhs, const basic_iterator<IsConstant> &rhs)
+            {
+               return lhs._ctrl == rhs._ctrl ;
+            }
+            friend bool operator!=(const basic_iterator<IsConstant> &lhs, const basic_iterator<IsConstant> &rhs)
+            {
+               return !(lhs == rhs) ;
+            }
+
+            friend std::ostream &operator<<(std::ostream &os, const basic_iterator &v)
+            {
+               return os << "{_current:" << (const void *)v._ctrl << '}' ;
+            }
+         private:
+            const int8_t *     _ctrl ;
+            const value_type * _slot ;
+
+            basic_iterator(const int8_t *ctrl, const value_type *slot) :
+               _ctrl(ctrl), _slot(slot)
+            {
+               nearest() ;
+            }
+
+            // Skip Empty and Deleted slots, stop at a full slot or at the end sentinel
+            void nearest()
+            {
+               for (; *_ctrl < CTRL_SENTINEL ; ++_ctrl, ++_slot) ;
+            }
+      } ;
+
+   public:
+      typedef basic_iterator<false> iterator ;
+      typedef basic_iterator<true>  const_iterator ;
+
+      closed_hashtable() noexcept : closed_hashtable(0) {}
+
+      explicit closed_hashtable(size_type initsize) :
+         closed_hashtable(std::pair<size_type, float>(initsize, 0))
+      {}
+
+      explicit closed_hashtable(const std::pair<size_type, float> &size_n_load) :
+         closed_hashtable(size_n_load, hasher())
+      {}
+
+      closed_hashtable(const closed_hashtable &other) :
+         closed_hashtable({other.size(), other.max_load_factor()},
+                          other.hash_function(), other.key_eq(), other.key_get())
+      {
+         copy_slots(other._ctrl, other._slots, other._capacity) ;
+      }
+
+      closed_hashtable(closed_hashtable &&other) noexcept : closed_hashtable(0) { swap(other) ; }
+
+      closed_hashtable(const std::pair<size_type, float> &size_n_load,
+                       const hasher &hf, const key_equal &keq = {}, const key_extract &kex = {}) :
+         _hasher(hf), _key_eq(keq), _key_get(kex),
+         // Set max load factor bounds to float values exactly representable in binary
+         _max_load_factor(size_n_load.second <= 0
+                          ? PCOMN_CLOSED_HASH_LOAD_FACTOR
+                          : midval<float>(0.125, 0.875, (float)size_n_load.second))
+      {
+         if (size_n_load.first)
+            allocate(capacity_for(size_n_load.first)) ;
+      }
+
+      closed_hashtable(const std::pair<size_type, float> &size_n_load,
+                       const key_extract &kex, const key_equal &keq = {}) :
+         closed_hashtable(size_n_load, {}, keq, kex)
+      {}
+
+      template<typename InputIterator>
+      closed_hashtable(InputIterator b, InputIterator e) :
+         closed_hashtable(pcomn::estimated_distance(b, e))
+      {
+         insert(b, e) ;
+      }
+
+      ~closed_hashtable() { deallocate() ; }
+
+      closed_hashtable &operator=(closed_hashtable &&other)
+      {
+         if (&other != this)
+            closed_hashtable(std::move(other)).swap(*this) ;
+         return *this ;
+      }
+
+      const hasher &hash_function() const { return _hasher ; }
+
+      const key_equal &key_eq() const { return _key_eq ; }
+
+      const key_extract &key_get() const { return _key_get ; }
+
+      void swap(closed_hashtable &other) noexcept
+      {
+         if (&other == this)
+            return ;
+         pcomn_swap(_hasher, other._hasher) ;
+         pcomn_swap(_key_eq, other._key_eq) ;
+         pcomn_swap(_key_get, other._key_get) ;
+         pcomn_swap(_max_load_factor, other._max_load_factor) ;
+         pcomn_swap(_ctrl, other._ctrl) ;
+         pcomn_swap(_slots, other._slots) ;
+         pcomn_swap(_capacity, other._capacity) ;
+         pcomn_swap(_size, other._size) ;
+         pcomn_swap(_growth_left, other._growth_left) ;
+      }
+
+      void erase(iterator it) { erase_slot(it._ctrl - _ctrl) ; }
+
+      size_type erase(const key_type &key) { return erase_item(key, NULL) ; }
+
+      size_type erase(const key_type &key, value_type &erased_value)
+      {
+         return erase_item(key, &erased_value) ;
+      }
+
+      size_type erase_value(const value_type &value)
+      {
+         return erase_item(key_get()(value), NULL) ;
+      }
+
+      std::pair<iterator, bool> insert(const value_type &value) ;
+
+      std::pair<iterator, bool> replace(const value_type &value)
+      {
+         const std::pair<iterator, bool> result = insert(value) ;
+         if (!result.second)
+            *const_cast<value_type *>(result.first._slot) = value ;
+         return result ;
+      }
+
+      std::pair<iterator, bool> replace(const value_type &value, value_type &oldvalue)
+      {
+         const std::pair<iterator, bool> result = insert(value) ;
+         if (!result.second)
+         {
+            oldvalue = *result.first ;
+            *const_cast<value_type *>(result.first._slot) = value ;
+         }
+         return result ;
+      }
+
+      template<typename InputIterator>
+      void insert(InputIterator b, InputIterator e)
+      {
+         for ( ; b != e ; ++b)
+            insert(*b) ;
+      }
+
+      template<typename InputIterator>
+      void replace(InputIterator b, InputIterator e)
+      {
+         for ( ; b != e ; ++b)
+            replace(*b) ;
+      }
+
+      iterator find(const key_type &key)
+      {
+         return find_iterator<iterator>(key) ;
+      }
+
+      const_iterator find(const key_type &key) const
+      {
+         return find_iterator<const_iterator>(key) ;
+      }
+
+      iterator find_value(const value_type &value)
+      {
+         return find_iterator<iterator>(key_get()(value)) ;
+      }
+
+      const_iterator find_value(const value_type &value) const
+      {
+         return find_iterator<const_iterator>(key_get()(value)) ;
+      }
+
+      size_type bucket_count() const { return _capacity ; }
+
+      size_type size() const { return _size ; }
+
+      size_type max_size() const { return bucket_count() ; }
+
+      float max_load_factor() const { return _max_load_factor ; }
+
+      float load_factor() const
+      {
+         const size_type bc = bucket_count() ;
+         return bc ? (float)size()/bc : 1.0 ;
+      }
+
+      bool empty() const { return !size() ; }
+
+      void reserve(size_type n)
+      {
+         const size_type newcap = capacity_for(n) ;
+         if (newcap > _capacity)
+            rehash(newcap) ;
+      }
+
+      void clear()
+      {
+         deallocate() ;
+         reset_members() ;
+      }
+
+      size_type count(const key_type &key) const
+      {
+         return (size_type)!!find_slot(key, hash_function()(key)) ;
+      }
+
+      size_type value_count(const value_type &value) const
+      {
+         return count(key_get()(value)) ;
+      }
+
+      /// Find every key from a sequence, writing a const_iterator per key (end() for
+      /// absent keys) to @a results.
+      ///
+      /// Keys are hashed by batches of PCOMN_CLOSED_HASH_PREFETCH_BATCH and the home
+      /// buckets of a batch are prefetched before probing, so the cache misses of a batch
+      /// overlap instead of being taken one after another.
+      /// @return The end of the results sequence.
+      template<typename ForwardIterator, typename OutputIterator>
+      OutputIterator find_many(ForwardIterator keys_begin, ForwardIterator keys_end,
+                               OutputIterator results) const
+      {
+         probe_many(keys_begin, keys_end, [&](const_iterator found)
+         {
+            *results = found ;
+            ++results ;
+         }) ;
+         return results ;
+      }
+
+      /// Get the count of keys from a sequence present in the table.
+      /// Probes like find_many().
+      template<typename ForwardIterator>
+      size_type count_many(ForwardIterator keys_begin, ForwardIterator keys_end) const
+      {
+         const const_iterator e = end() ;
+         size_type result = 0 ;
+         probe_many(keys_begin, keys_end, [&](const_iterator found) { result += found != e ; }) ;
+         return result ;
+      }
+
+      iterator begin() { return iterator(_ctrl, _slots) ; }
+      const_iterator begin() const { return const_iterator(_ctrl, _slots) ; }
+      const_iterator cbegin() const { return begin() ; }
+
+      iterator end() { return iterator(_ctrl + _capacity, _slots + _capacity) ; }
+      const_iterator end() const { return const_iterator(_ctrl + _capacity, _slots + _capacity) ; }
+      const_iterator cend() const { return end() ; }
+
+      friend std::ostream &operator<<(std::ostream &os, const closed_hashtable &v)
+      {
+         return os << "{size:" << v.size()
+                   << " buckets:" << v.bucket_count()
+                   << " group:" << (size_t)GroupWidth
+                   << " growth_left:" << v._growth_left
+                   << " buckptr:" << (const void *)v._slots << '}' ;
+      }
+
+   private:
+      hasher         _hasher  {} ;
+      key_equal      _key_eq  {} ;
+      key_extract    _key_get {} ;
+      float          _max_load_factor = PCOMN_CLOSED_HASH_LOAD_FACTOR ;
+
+      int8_t *       _ctrl        = detail::empty_ctrl_group() ; /* _capacity + GroupWidth control bytes */
+      value_type *   _slots       = nullptr ;
+      size_type      _capacity    = 0 ; /* 0 or 2^n-1, never less than GroupWidth-1 */
+      size_type      _size        = 0 ;
+      size_type      _growth_left = 0 ; /* Count of Empty slots that may be occupied before rehash */
+
+      // Lower 7 bits of the hash go to the control byte, the rest selects the group
+      static size_t h1(size_t hash) { return hash >> 7 ; }
+      static int8_t h2(size_t hash) { return hash & 0x7f ; }
+
+      bool keys_equal(const value_type &value, const key_type &key) const
+      {
+         return !!key_eq()(key_get()(value), key) ;
+      }
+
+      /*************************************************************************
+        Triangular probe sequence over groups
+      *************************************************************************/
+      struct probe_seq {
+            probe_seq(size_t hash, size_t mask) :
+               _mask(mask), _offset(hash & mask)
+            {}
+
+            size_t offset() const { return _offset ; }
+            size_t offset(unsigned i) const { return (_offset + i) & _mask ; }
+
+            void next()
+            {
+               _index += GroupWidth ;
+               _offset = (_offset + _index) & _mask ;
+            }
+
+         private:
+            size_t _mask ;
+            size_t _offset ;
+            size_t _index = 0 ;
+      } ;
+
+      size_type max_growth(size_type capacity) const
+      {
+         return (size_type)(capacity * _max_load_factor) ;
+      }
+
+      // Get the capacity to hold count items; for nonzero count, guarantees nonzero
+      // max_growth(capacity)
+      size_type capacity_for(size_type count) const
+      {
+         if (!count)
+            return 0 ;
+         size_type capacity = std::max<size_type>
+            (((size_type)2 << bitop::log2floor((size_type)ceil(count/_max_load_factor))) - 1, GroupWidth - 1) ;
+         while (max_growth(capacity) < count)
+            capacity = capacity*2 + 1 ;
+         return capacity ;
+      }
+
+      // Allocate slots and control bytes for the table of the given capacity,
+      // with all control bytes Empty
+      static value_type *allocate_slots(size_type capacity) ;
+      void set_slots(value_type *slots, size_type capacity) ;
+
+      void allocate(size_type capacity)
+      {
+         NOXCHECK(!_capacity) ;
+         set_slots(allocate_slots(capacity), capacity) ;
+      }
+
+      void deallocate()
+      {
+         if (_capacity)
+            ::operator delete(_slots) ;
+      }
+
+      void reset_members()
+      {
+         _ctrl = detail::empty_ctrl_group() ;
+         _slots = nullptr ;
+         _capacity = _size = _growth_left = 0 ;
+      }
+
+      // Set the control byte along with its clone at the end of control array
+      void set_ctrl(size_t ndx, int8_t c)
+      {
+         NOXCHECK(ndx < _capacity) ;
+         _ctrl[ndx] = c ;
+         _ctrl[((ndx - (GroupWidth - 1)) & _capacity) + (GroupWidth - 1)] = c ;
+      }
+
+      const value_type *find_slot(const key_type &key, size_t hash) const
+      {
+         for (probe_seq seq (h1(hash), _capacity) ;; seq.next())
+         {
+            const group_type group (_ctrl + seq.offset()) ;
+            for (mask_type match = group.match(h2(hash)) ; match ; match = group_type::clear_first(match))
+            {
+               const value_type * const slot = _slots + seq.offset(group_type::first(match)) ;
+               if (keys_equal(*slot, key))
+                  return slot ;
+            }
+            if (group.match_empty())
+               return NULL ;
+         }
+      }
+
+      size_t find_available_slot(size_t hash) const
+      {
+         for (probe_seq seq (h1(hash), _capacity) ;; seq.next())
+            if (const mask_type available = group_type(_ctrl + seq.offset()).match_available())
+               return seq.offset(group_type::first(available)) ;
+      }
+
+      template<typename Iterator>
+      Iterator find_iterator(const key_type &key) const
+      {
+         return make_iterator<Iterator>(find_slot(key, hash_function()(key))) ;
+      }
+
+      template<typename Iterator>
+      Iterator make_iterator(const value_type *slot) const
+      {
+         return slot ? Iterator(_ctrl + (slot - _slots), slot) : Iterator(_ctrl + _capacity, _slots + _capacity) ;
+      }
+
+      template<typename ForwardIterator, typename Found>
+      void probe_many(ForwardIterator b, ForwardIterator e, Found &&found) const
+      {
+         size_t hashes[PCOMN_CLOSED_HASH_PREFETCH_BATCH] ;
+         while (b != e)
+         {
+            ForwardIterator batch = b ;
+            size_t n = 0 ;
+            // Stage 1: prefetch the first control bytes group of every key
+            for (; n < PCOMN_CLOSED_HASH_PREFETCH_BATCH && b != e ; ++n, ++b)
+            {
+               hashes[n] = hash_function()(*b) ;
+               PCOMN_PREFETCH(_ctrl + (h1(hashes[n]) & _capacity)) ;
+            }
+            // Stage 2: prefetch the first slot with matching hash bits, if any; misses
+            // mostly end here without touching slots at all
+            for (size_t i = 0 ; i < n ; ++i)
+            {
+               const size_t offset = h1(hashes[i]) & _capacity ;
+               if (const mask_type match = group_type(_ctrl + offset).match(h2(hashes[i])))
+                  PCOMN_PREFETCH(_slots + ((offset + group_type::first(match)) & _capacity)) ;
+            }
+            // Stage 3: probe
+            for (size_t i = 0 ; i < n ; ++i, ++batch)
+               found(make_iterator<const_iterator>(find_slot(*batch, hashes[i]))) ;
+         }
+      }
+
+      // Put a value into the available slot ndx
+      void put_value(size_t ndx, size_t hash, const value_type &value)
+      {
+         NOXCHECK(_ctrl[ndx] == CTRL_EMPTY || _ctrl[ndx] == CTRL_DELETED) ;
+         _growth_left -= _ctrl[ndx] == CTRL_EMPTY ;
+         set_ctrl(ndx, h2(hash)) ;
+         new (_slots + ndx) value_type(value) ;
+         ++_size ;
+      }
+
+      size_type erase_item(const key_type &key, value_type *erased_value)
+      {
+         const value_type * const found = find_slot(key, hash_function()(key)) ;
+         if (!found)
+            return 0 ;
+         if (erased_value)
+            *erased_value = *found ;
+         erase_slot(found - _slots) ;
+         return 1 ;
+      }
+
+      void erase_slot(size_t ndx)
+      {
+         NOXCHECK(ndx < _capacity) ;
+         NOXCHECK(_ctrl[ndx] >= 0) ;
+
+         --_size ;
+         // If there is no window of GroupWidth consecutive non-empty slots spanning the
+         // erased one, no probe has ever passed over it and it can be marked Empty.
+         const mask_type empty_before = group_type(_ctrl + ((ndx - GroupWidth) & _capacity)).match_empty() ;
+         const mask_type empty_after = group_type(_ctrl + ndx).match_empty() ;
+         const bool was_never_full =
+            empty_before && empty_after &&
+            group_type::trailing(empty_after) + group_type::leading(empty_before) < GroupWidth ;
+
+         set_ctrl(ndx, was_never_full ? CTRL_EMPTY : CTRL_DELETED) ;
+         _growth_left += was_never_full ;
+      }
+
+      void copy_slots(const int8_t *ctrl, const value_type *slots, size_type capacity) ;
+
+      void rehash(size_type new_capacity) ;
+} ;
+
+/*******************************************************************************
+ closed_hashtable with group probing layout
+*******************************************************************************/
+template<typename V, typename X, typename H, typename P, typename S, typename G>
+auto closed_hashtable<V, X, H, P, S, basic_group_probing_layout<G>>::insert(const value_type &value)
+   -> std::pair<iterator, bool>
+{
+   const auto &key = key_get()(value) ;
+   const size_t hash = hash_function()(key) ;
+
+   if (const value_type * const found = find_slot(key, hash))
+      return {iterator(_ctrl + (found - _slots), found), false} ;
+
+   size_t ndx = find_available_slot(hash) ;
+   // Reusing a Deleted slot doesn't decrease the growth reserve
+   if (!_growth_left && _ctrl[ndx] != CTRL_DELETED)
+   {
+      // If more than a half of the growth reserve is eaten by Deleted slots, collect
+      // them, otherwise grow; note that with a low load factor a small capacity may
+      // have no growth reserve at all
+      const size_type growth = max_growth(_capacity) ;
+      rehash(growth > _size && _size <= growth/2
+             ? _capacity
+             : std::max(capacity_for(_size + 1), _capacity*2 + 1)) ;
+      ndx = find_available_slot(hash) ;
+   }
+   put_value(ndx, hash, value) ;
+
+   return {iterator(_ctrl + ndx, _slots + ndx), true} ;
+}
+
+template<typename V, typename X, typename H, typename P, typename S, typename G>
+auto closed_hashtable<V, X, H, P, S, basic_group_probing_layout<G>>::allocate_slots(size_type capacity) -> value_type *
+{
+   NOXCHECK(bitop::tstpow2(capacity + 1) && capacity >= GroupWidth - 1) ;
+
+   // Slots come first to get maximum alignment, control bytes follow
+   value_type * const slots = static_cast<value_type *>
+      (::operator new(capacity * sizeof(value_type) + capacity + GroupWidth)) ;
+   int8_t * const ctrl = reinterpret_cast<int8_t *>(slots + capacity) ;
+
+   memset(ctrl, CTRL_EMPTY, capacity + GroupWidth) ;
+   ctrl[capacity] = CTRL_SENTINEL ;
+
+   return slots ;
+}
+
+template<typename V, typename X, typename H, typename P, typename S, typename G>
+void closed_hashtable<V, X, H, P, S, basic_group_probing_layout<G>>::set_slots(value_type *slots, size_type capacity)
+{
+   // There must be room for at least one more item
+   NOXCHECK(max_growth(capacity) > _size) ;
+
+   _ctrl = reinterpret_cast<int8_t *>(slots + capacity) ;
+   _slots = slots ;
+   _capacity = capacity ;
+   _growth_left = max_growth(capacity) - _size ;
+}
+
+template<typename V, typename X, typename H, typename P, typename S, typename G>
+void closed_hashtable<V, X, H, P, S, basic_group_probing_layout<G>>::copy_slots(const int8_t *ctrl,
+                                                                               const value_type *slots,
+                                                                               size_type capacity)
+{
+   for (size_type i = 0 ; i < capacity ; ++i)
+      if (ctrl[i] >= 0)
+      {
+         const size_t hash = hash_function()(key_get()(slots[i])) ;
+         put_value(find_available_slot(hash), hash, slots[i]) ;
+      }
+}
+
+template<typename V, typename X, typename H, typename P, typename S, typename G>
+void closed_hashtable<V, X, H, P, S, basic_group_probing_layout<G>>::rehash(size_type new_capacity)
+{
+   NOXCHECK(max_growth(new_capacity) > _size) ;
+
+   // Allocate before touching the table: if allocation throws, the table is intact
+   value_type * const new_slots = allocate_slots(new_capacity) ;
+
+   const int8_t * const old_ctrl = _ctrl ;
+   value_type * const old_slots = _slots ;
+   const size_type old_capacity = _capacity ;
+
+   _size = 0 ;
+   set_slots(new_slots, new_capacity) ;
+   copy_slots(old_ctrl, old_slots, old_capacity) ;
+
+   if (old_capacity)
+      ::operator delete(old_slots) ;
+}
+
 /*******************************************************************************
 
 *******************************************************************************/
-template<typename V, typename E, typename H, typename P, typename S, typename K>
-inline bool find_keyed_value(const closed_hashtable<V, E, H, P, S> &dict, K &&key, V &value)
+template<typename V, typename E, typename H, typename P, typename S, typename L, typename K>
+inline bool find_keyed_value(const closed_hashtable<V, E, H, P, S, L> &dict, K &&key, V &value)
 {
    const auto found (dict.find(std::forward<K>(key))) ;
    if (found == dict.end())
@@ -959,15 +1847,15 @@ inline bool find_keyed_value(const closed_hashtable<V, E, H, P, S> &dict, K &&ke
    return true ;
 }
 
-template<typename V, typename E, typename H, typename P, typename S, typename K>
-inline V get_keyed_value(const closed_hashtable<V, E, H, P, S> &dict, K &&key, const V &default_value)
+template<typename V, typename E, typename H, typename P, typename S, typename L, typename K>
+inline V get_keyed_value(const closed_hashtable<V, E, H, P, S, L> &dict, K &&key, const V &default_value)
 {
    const auto found (dict.find(std::forward<K>(key))) ;
    return found == dict.end() ? default_value : *found ;
 }
 
-template<typename V, typename E, typename H, typename P, typename S, typename K>
-inline V get_keyed_value(const closed_hashtable<V, E, H, P, S> &dict, K &&key)
+template<typename V, typename E, typename H, typename P, typename S, typename L, typename K>
+inline V get_keyed_value(const closed_hashtable<V, E, H, P, S, L> &dict, K &&key)
 {
    return get_keyed_value(dict, std::forward<K>(key), V()) ;
 }
@@ -975,9 +1863,9 @@ inline V get_keyed_value(const closed_hashtable<V, E, H, P, S> &dict, K &&key)
 } // end of namespace pcomn
 
 namespace std {
-template<typename V, typename X, typename H, typename P, typename S>
-inline void swap(pcomn::closed_hashtable<V, X, H, P, S> &lhs,
-                 pcomn::closed_hashtable<V, X, H, P, S> &rhs)
+template<typename V, typename X, typename H, typename P, typename S, typename L>
+inline void swap(pcomn::closed_hashtable<V, X, H, P, S, L> &lhs,
+                 pcomn::closed_hashtable<V, X, H, P, S, L> &rhs)
 {
    lhs.swap(rhs) ;
 }
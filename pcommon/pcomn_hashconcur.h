@@ -0,0 +1,473 @@
+/*-*- mode: c++; tab-width: 3; indent-tabs-mode: nil; c-file-style: "ellemtel"; c-file-offsets:((innamespace . 0)(inclass . ++)) -*-*/
+#ifndef __PCOMN_HASHCONCUR_H
+#define __PCOMN_HASHCONCUR_H
+/*******************************************************************************
+ FILE         :   pcomn_hashconcur.h
+ COPYRIGHT    :   Yakov Markovitch, 2026. All rights reserved.
+
+ DESCRIPTION  :   Concurrent read-mostly closed hashtable with lock-free readers.
+
+ PROGRAMMED BY:   Yakov Markovitch
+ CREATION DATE:   16 Oct 2026
+*******************************************************************************/
+/** @file
+ Concurrent read-mostly closed hashtable with lock-free readers.
+
+ Readers never lock and never write to memory shared with other threads: a lookup
+ copies a value out of a bucket guarded by a per-bucket sequence lock and retries if
+ a writer has modified the bucket in the meantime.
+
+ Writers are serialized by a mutex. Insertion, replacement, and erasure change
+ buckets in place; growth (and cleanup of Deleted buckets) builds a new bucket array
+ and publishes it; old arrays are freed in batches, every one as soon as there are no
+ readers using it.
+
+ To detect such readers, every reading thread announces the bucket array it is
+ reading with hazard_guard (see pcomn_hazardptr.h).
+*******************************************************************************/
+#include <pcomn_hashclosed.h>
+#include <pcomn_hazardptr.h>
+#include <pcomn_syncobj.h>
+#include <pcomn_sys.h>
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+namespace pcomn {
+
+/******************************************************************************/
+/** Closed hash table for read-mostly concurrent access: lookups are lock-free and
+ never write to shared memory, modifications are serialized by a mutex.
+
+ Key extraction, hashing, and key comparison are specified exactly as for
+ closed_hashtable. Since readers may copy a value while it is being overwritten (such
+ a copy is discarded and the read retried), only TriviallyCopyable values are
+ allowed.
+
+ Uses linear probing; erase marks a bucket as Deleted, Deleted buckets are reused by
+ insertions and dropped by rehashing.
+*******************************************************************************/
+template<typename Value,
+         typename ExtractKey  = void,
+         typename Hash        = void,
+         typename Pred        = void>
+
+class concurrent_hashtable {
+      PCOMN_STATIC_CHECK(std::is_trivially_copyable<Value>::value) ;
+      PCOMN_STATIC_CHECK(alignof(Value) <= alignof(std::max_align_t)) ;
+
+      PCOMN_NONCOPYABLE(concurrent_hashtable) ;
+      PCOMN_NONASSIGNABLE(concurrent_hashtable) ;
+
+   public:
+      using value_type  = Value ;
+
+      using key_extract = std::conditional_t<std::is_same<ExtractKey, void>::value,
+                                             pcomn::identity, ExtractKey> ;
+      using key_type    = noref_result_of_t<key_extract(value_type)> ;
+      using hasher      = select_functor_t<Hash, key_type, pcomn::hash_fn> ;
+      using key_equal   = select_functor_t<Pred, key_type, std::equal_to> ;
+
+      typedef size_t      size_type ;
+      typedef ptrdiff_t   difference_type ;
+
+      concurrent_hashtable() : concurrent_hashtable(0) {}
+
+      explicit concurrent_hashtable(size_type initsize) :
+         concurrent_hashtable(std::pair<size_type, float>(initsize, 0))
+      {}
+
+      explicit concurrent_hashtable(const std::pair<size_type, float> &size_n_load,
+                                    const hasher &hf = {}, const key_equal &keq = {},
+                                    const key_extract &kex = {}) :
+         _hasher(hf),
+         _key_eq(keq),
+         _key_get(kex),
+         _max_load_factor(size_n_load.second <= 0
+                          ? PCOMN_CLOSED_HASH_LOAD_FACTOR
+                          : midval<float>(0.125, 0.875, size_n_load.second)),
+         _data(create_buckets(bucket_count_for(size_n_load.first)))
+      {}
+
+      /// The destructor must not run concurrently with readers.
+      ~concurrent_hashtable()
+      {
+         destroy_buckets(_data.load(std::memory_order_relaxed)) ;
+         for (bucket_array *retired: _retired)
+            destroy_buckets(retired) ;
+      }
+
+      const hasher &hash_function() const { return _hasher ; }
+      const key_equal &key_eq() const { return _key_eq ; }
+      const key_extract &key_get() const { return _key_get ; }
+
+      /*************************************************************************
+       Lock-free readers
+      *************************************************************************/
+      /// Find the value with @a key and copy it to @a found_value.
+      /// @return true if found, false otherwise (@a found_value is unchanged then).
+      bool get(const key_type &key, value_type &found_value) const
+      {
+         const read_guard guard (*this) ;
+         return read_value(guard.buckets(), key, &found_value) ;
+      }
+
+      size_type count(const key_type &key) const
+      {
+         const read_guard guard (*this) ;
+         return read_value(guard.buckets(), key, nullptr) ;
+      }
+
+      /// Get the (weakly consistent) copy of all the values in the table.
+      std::vector<value_type> values() const
+      {
+         std::vector<value_type> result ;
+         result.reserve(size()) ;
+
+         const read_guard guard (*this) ;
+         const bucket_array &data = guard.buckets() ;
+         value_storage buffer ;
+         value_type &value = *reinterpret_cast<value_type *>(&buffer) ;
+         for (const bucket_type *b = data._buckets, *e = b + data.bucket_count() ; b != e ; ++b)
+            if (read_bucket(*b, value) == bucket_state::Valid)
+               result.push_back(value) ;
+         return result ;
+      }
+
+      size_type size() const { return _size.load(std::memory_order_relaxed) ; }
+
+      bool empty() const { return !size() ; }
+
+      size_type bucket_count() const
+      {
+         return _data.load(std::memory_order_acquire)->bucket_count() ;
+      }
+
+      float max_load_factor() const { return _max_load_factor ; }
+
+      float load_factor() const
+      {
+         const size_type bcount = bucket_count() ;
+         return bcount ? (float)size()/bcount : 0 ;
+      }
+
+      /*************************************************************************
+       Writers
+      *************************************************************************/
+      /// Insert @a value if there is no value with the same key.
+      /// @return true if inserted, false if there already is a value with such key.
+      bool insert(const value_type &value)
+      {
+         PCOMN_SCOPE_LOCK (guard, _writer_lock) ;
+         return put_value(value, false) ;
+      }
+
+      /// Insert or replace the value with the key of @a value.
+      /// @return true if inserted, false if replaced.
+      bool replace(const value_type &value)
+      {
+         PCOMN_SCOPE_LOCK (guard, _writer_lock) ;
+         return put_value(value, true) ;
+      }
+
+      template<typename InputIterator>
+      void insert(InputIterator b, InputIterator e)
+      {
+         PCOMN_SCOPE_LOCK (guard, _writer_lock) ;
+         for (; b != e ; ++b)
+            put_value(*b, false) ;
+      }
+
+      size_type erase(const key_type &key) { return erase_item(key, nullptr) ; }
+
+      size_type erase(const key_type &key, value_type &erased_value)
+      {
+         return erase_item(key, &erased_value) ;
+      }
+
+      void clear()
+      {
+         PCOMN_SCOPE_LOCK (guard, _writer_lock) ;
+         publish(create_buckets(bucket_count_for(0))) ;
+         _size.store(0, std::memory_order_relaxed) ;
+      }
+
+      void reserve(size_type count)
+      {
+         PCOMN_SCOPE_LOCK (guard, _writer_lock) ;
+         const size_type new_bucket_count = bucket_count_for(std::max(count, size())) ;
+         if (new_bucket_count > current_buckets().bucket_count())
+            rehash(new_bucket_count) ;
+      }
+
+      friend std::ostream &operator<<(std::ostream &os, const concurrent_hashtable &v)
+      {
+         return os << "{size:" << v.size() << " buckets:" << v.bucket_count() << '}' ;
+      }
+
+   private:
+      typedef typename std::aligned_storage<sizeof(Value), alignof(Value)>::type value_storage ;
+
+      struct bucket_type {
+            std::atomic<uint32_t>      _seq ;   /* Odd while the bucket is being written */
+            std::atomic<bucket_state>  _state ;
+            value_storage              _value ;
+      } ;
+
+      struct bucket_array {
+            size_type   _mask ;     /* bucket_count - 1 */
+            size_type   _occupied ; /* Valid and Deleted buckets, writer-only */
+            bucket_type _buckets[1] ;
+
+            size_type bucket_count() const { return _mask + 1 ; }
+      } ;
+
+      // Announces the bucket array used by the current thread until destructed
+      class read_guard {
+         public:
+            explicit read_guard(const concurrent_hashtable &table) : _guard(table._data) {}
+
+            const bucket_array &buckets() const { return *_guard ; }
+
+         private:
+            const hazard_guard<const bucket_array> _guard ;
+      } ;
+
+   private:
+      // Count of retired bucket arrays that triggers reclamation
+      enum : size_t { RECLAIM_BATCH = 4 } ;
+
+      const hasher                     _hasher ;
+      const key_equal                  _key_eq ;
+      const key_extract                _key_get ;
+      const float                      _max_load_factor ;
+
+      std::atomic<bucket_array *>      _data ;
+      std::atomic<size_type>           _size {0} ;
+
+      std::mutex                       _writer_lock ;
+      std::vector<bucket_array *>      _retired ; /* Unpublished, maybe still being read */
+      size_t                           _reclaim_at = RECLAIM_BATCH ; /* _retired size to reclaim at */
+
+      decltype(auto) key_of(const value_type &value) const { return key_get()(value) ; }
+
+      bucket_array &current_buckets() const { return *_data.load(std::memory_order_relaxed) ; }
+
+      size_type max_occupied(size_type bcount) const
+      {
+         // Keep at least one Empty bucket, or an unsuccessful search never stops
+         return std::min<size_type>(bcount*_max_load_factor, bcount - 1) ;
+      }
+
+      size_type bucket_count_for(size_type count) const
+      {
+         size_type bcount = 8 ;
+         while (max_occupied(bcount) < count)
+            bcount *= 2 ;
+         return bcount ;
+      }
+
+      static bucket_array *create_buckets(size_type bcount)
+      {
+         NOXCHECK(bitop::popcount(bcount) == 1) ;
+
+         bucket_array * const data = static_cast<bucket_array *>
+            (::operator new(sizeof(bucket_array) + (bcount - 1)*sizeof(bucket_type))) ;
+         data->_mask = bcount - 1 ;
+         data->_occupied = 0 ;
+         for (bucket_type *b = data->_buckets, *e = b + bcount ; b != e ; ++b)
+         {
+            new (&b->_seq) std::atomic<uint32_t>(0) ;
+            new (&b->_state) std::atomic<bucket_state>(bucket_state::Empty) ;
+         }
+         return data ;
+      }
+
+      static void destroy_buckets(bucket_array *data) { ::operator delete(data) ; }
+
+      // Consistent copy of the bucket, the value is copied only if the bucket is valid
+      static bucket_state read_bucket(const bucket_type &bucket, value_type &value)
+      {
+         for (;;)
+         {
+            const uint32_t seq = bucket._seq.load(std::memory_order_acquire) ;
+            if (seq & 1)
+               continue ;
+
+            const bucket_state state = bucket._state.load(std::memory_order_relaxed) ;
+            if (state != bucket_state::Valid)
+               return state ;
+
+            memcpy(&value, &bucket._value, sizeof value) ;
+
+            std::atomic_thread_fence(std::memory_order_acquire) ;
+            if (bucket._seq.load(std::memory_order_relaxed) == seq)
+               return state ;
+         }
+      }
+
+      bool read_value(const bucket_array &data, const key_type &key, value_type *found_value) const
+      {
+         value_storage buffer ;
+         value_type &value = *reinterpret_cast<value_type *>(&buffer) ;
+         for (size_type i = hash_function()(key) & data._mask ;; i = (i + 1) & data._mask)
+            switch (read_bucket(data._buckets[i], value))
+            {
+               case bucket_state::Empty:
+                  return false ;
+
+               case bucket_state::Valid:
+                  if (key_eq()(key_of(value), key))
+                  {
+                     if (found_value)
+                        *found_value = value ;
+                     return true ;
+                  }
+                  break ;
+
+               default: break ;
+            }
+      }
+
+      /*************************************************************************
+       The following members must be called under _writer_lock
+      *************************************************************************/
+      static const value_type &bucket_value(const bucket_type &bucket)
+      {
+         return *reinterpret_cast<const value_type *>(&bucket._value) ;
+      }
+
+      // Writers have exclusive access, so no read protocol is necessary.
+      // Returns the bucket with @a key or, if not found, the first available bucket
+      // of the probe sequence.
+      std::pair<bucket_type *, bool> find_bucket(bucket_array &data, const key_type &key) const
+      {
+         bucket_type *available = nullptr ;
+         for (size_type i = hash_function()(key) & data._mask ;; i = (i + 1) & data._mask)
+         {
+            bucket_type &bucket = data._buckets[i] ;
+            switch (bucket._state.load(std::memory_order_relaxed))
+            {
+               case bucket_state::Empty:
+                  return {available ? available : &bucket, false} ;
+
+               case bucket_state::Valid:
+                  if (key_eq()(key_of(bucket_value(bucket)), key))
+                     return {&bucket, true} ;
+                  break ;
+
+               default:
+                  if (!available)
+                     available = &bucket ;
+            }
+         }
+      }
+
+      static void write_bucket(bucket_type &bucket, bucket_state state, const value_type *value)
+      {
+         const uint32_t seq = bucket._seq.load(std::memory_order_relaxed) ;
+         bucket._seq.store(seq + 1, std::memory_order_relaxed) ;
+         std::atomic_thread_fence(std::memory_order_release) ;
+
+         if (value)
+            memcpy(&bucket._value, value, sizeof *value) ;
+         bucket._state.store(state, std::memory_order_relaxed) ;
+
+         bucket._seq.store(seq + 2, std::memory_order_release) ;
+      }
+
+      bool put_value(const value_type &value, bool replace)
+      {
+         std::pair<bucket_type *, bool> found = find_bucket(current_buckets(), key_of(value)) ;
+         if (found.second)
+         {
+            if (replace)
+               write_bucket(*found.first, bucket_state::Valid, &value) ;
+            return false ;
+         }
+
+         if (found.first->_state.load(std::memory_order_relaxed) == bucket_state::Empty)
+         {
+            bucket_array &data = current_buckets() ;
+            if (data._occupied >= max_occupied(data.bucket_count()))
+            {
+               // If more than a quarter of occupied buckets are Deleted, collect them,
+               // otherwise grow
+               const size_type bcount = data.bucket_count() ;
+               rehash(size() < max_occupied(bcount)/4*3 ? bcount : 2*bcount) ;
+               found = find_bucket(current_buckets(), key_of(value)) ;
+            }
+            if (found.first->_state.load(std::memory_order_relaxed) == bucket_state::Empty)
+               ++current_buckets()._occupied ;
+         }
+
+         write_bucket(*found.first, bucket_state::Valid, &value) ;
+         _size.fetch_add(1, std::memory_order_relaxed) ;
+         return true ;
+      }
+
+      size_type erase_item(const key_type &key, value_type *erased_value)
+      {
+         PCOMN_SCOPE_LOCK (guard, _writer_lock) ;
+
+         const std::pair<bucket_type *, bool> found = find_bucket(current_buckets(), key) ;
+         if (!found.second)
+            return 0 ;
+
+         if (erased_value)
+            *erased_value = bucket_value(*found.first) ;
+         write_bucket(*found.first, bucket_state::Deleted, nullptr) ;
+         _size.fetch_sub(1, std::memory_order_relaxed) ;
+         return 1 ;
+      }
+
+      void rehash(size_type new_bucket_count)
+      {
+         bucket_array &data = current_buckets() ;
+         bucket_array * const new_data = create_buckets(new_bucket_count) ;
+
+         for (const bucket_type *b = data._buckets, *e = b + data.bucket_count() ; b != e ; ++b)
+            if (b->_state.load(std::memory_order_relaxed) == bucket_state::Valid)
+            {
+               bucket_type &target = *find_bucket(*new_data, key_of(bucket_value(*b))).first ;
+               memcpy(&target._value, &b->_value, sizeof target._value) ;
+               target._state.store(bucket_state::Valid, std::memory_order_relaxed) ;
+               ++new_data->_occupied ;
+            }
+
+         publish(new_data) ;
+      }
+
+      void publish(bucket_array *new_data)
+      {
+         _retired.push_back(_data.exchange(new_data, std::memory_order_acq_rel)) ;
+         reclaim() ;
+      }
+
+      // Free retired bucket arrays no reader announces.
+      // The process-wide fence is expensive, so an attempt is made only after
+      // RECLAIM_BATCH arrays are retired since the previous one
+      void reclaim()
+      {
+         if (_retired.size() < _reclaim_at)
+            return ;
+
+         atomic_op::atomic_process_fence() ;
+
+         _retired.erase(std::remove_if(_retired.begin(), _retired.end(), [](bucket_array *data)
+         {
+            if (detail::hazard_registry::is_hazardous(data))
+               return false ;
+            destroy_buckets(data) ;
+            return true ;
+         }),
+            _retired.end()) ;
+
+         _reclaim_at = _retired.size() + RECLAIM_BATCH ;
+      }
+} ;
+
+} // end of namespace pcomn
+
+#endif /* __PCOMN_HASHCONCUR_H */
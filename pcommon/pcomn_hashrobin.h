@@ -0,0 +1,686 @@
+/*-*- mode: c++; tab-width: 3; indent-tabs-mode: nil; c-file-style: "ellemtel"; c-file-offsets:((innamespace . 0)(inclass . ++)) -*-*/
+#ifndef __PCOMN_HASHROBIN_H
+#define __PCOMN_HASHROBIN_H
+/*******************************************************************************
+ FILE         :   pcomn_hashrobin.h
+ COPYRIGHT    :   Yakov Markovitch, 2026. All rights reserved.
+
+ DESCRIPTION  :   Robin Hood bucket layout of closed_hashtable: linear probing
+                  without tombstones.
+
+ PROGRAMMED BY:   Yakov Markovitch
+ CREATION DATE:   16 Oct 2026
+*******************************************************************************/
+/** @file
+ Robin Hood layout of closed_hashtable.
+
+ Linear probing where every bucket knows its distance from the home bucket of its
+ item, and insertion keeps items of every probe sequence ordered by that distance:
+ an inserted item takes the place of any item closer to its home ("robs the rich"),
+ and the displaced item continues probing.
+
+ This bounds the variance of probe lengths, lets an unsuccessful search stop as soon
+ as it meets an item closer to its home than the probe, and allows deletion by
+ shifting the following items one bucket back, so the table never accumulates Deleted
+ buckets. As a result, max load factor up to 0.9375 is allowed.
+*******************************************************************************/
+#include <pcomn_hashclosed.h>
+
+namespace pcomn {
+
+/// Bucket layout policy of closed_hashtable: Robin Hood hashing with backward-shift
+/// deletion, the distance of an item from its home bucket is limited to MaxProbeLength.
+template<unsigned MaxProbeLength>
+struct basic_robin_hood_layout {
+      PCOMN_STATIC_CHECK(MaxProbeLength > 0 && MaxProbeLength <= 0xfffd) ;
+      static constexpr unsigned max_probe_length = MaxProbeLength ;
+} ;
+
+/// Robin Hood layout with the maximum probe distance a bucket can keep.
+typedef basic_robin_hood_layout<0xfffd> robin_hood_layout ;
+
+/******************************************************************************/
+/** Closed hash table with Robin Hood bucket layout.
+
+ Every bucket keeps the distance to the home bucket of its item plus 1 (0 for an empty
+ bucket). The probe distance is limited to MaxProbeLength (65533 for robin_hood_layout):
+ if an insertion would exceed it, the table grows regardless of the load factor; if
+ the table is sparse already, the hash function is considered broken and
+ std::length_error is thrown.
+
+ ExtractState is ignored: an empty bucket is marked by zero distance.
+*******************************************************************************/
+template<typename Value, typename ExtractKey, typename Hash, typename Pred, typename ExtractState,
+         unsigned MaxProbeLength>
+
+class closed_hashtable<Value, ExtractKey, Hash, Pred, ExtractState, basic_robin_hood_layout<MaxProbeLength>> {
+      // Only TriviallyCopyable items are allowed!
+      PCOMN_STATIC_CHECK(std::is_trivially_copyable<Value>::value ||
+                         pcomn::is_literal_type<Value>::value) ;
+
+      PCOMN_STATIC_CHECK(alignof(Value) <= alignof(std::max_align_t)) ;
+
+      PCOMN_NONASSIGNABLE(closed_hashtable) ;
+
+      typedef closed_hashtable<Value, ExtractKey, Hash, Pred, ExtractState,
+                               basic_robin_hood_layout<MaxProbeLength>> table_type ;
+
+      enum : uint16_t {
+         DIB_EMPTY = 0,       /* Empty bucket */
+         DIB_HOME  = 1,       /* An item in its home bucket */
+         DIB_MAX   = MaxProbeLength + 1, /* Maximum distance + 1 */
+         DIB_END   = 0xffff   /* End sentinel bucket */
+      } ;
+
+      struct bucket_type {
+            uint16_t _dib ; /* Distance to the Initial Bucket + 1 */
+            typename std::aligned_storage<sizeof(Value), alignof(Value)>::type _value ;
+
+            const Value &value() const { return *reinterpret_cast<const Value *>(&_value) ; }
+            Value &value() { return *reinterpret_cast<Value *>(&_value) ; }
+      } ;
+
+   public:
+      using value_type  = Value ;
+
+      using key_extract = std::conditional_t<std::is_same<ExtractKey, void>::value,
+                                             pcomn::identity, ExtractKey> ;
+      using key_type    = noref_result_of_t<key_extract(value_type)> ;
+      using hasher      = select_functor_t<Hash, key_type, pcomn::hash_fn> ;
+      using key_equal   = select_functor_t<Pred, key_type, std::equal_to> ;
+
+      typedef size_t      size_type ;
+      typedef ptrdiff_t   difference_type ;
+
+      template<bool IsConstant>
+      class basic_iterator :
+         public std::iterator<std::forward_iterator_tag, Value, ptrdiff_t, const Value *, const Value &>
+      {
+            friend table_type ;
+
+         public:
+            typedef ptrdiff_t    difference_type ;
+            typedef Value        value_type ;
+            typedef const Value *pointer ;
+            typedef const Value &reference ;
+
+            basic_iterator() :
+               _current(NULL)
+            {}
+
+            basic_iterator(const basic_iterator<false> &other) :
+               _current(other._current)
+            {}
+
+            reference operator*() const { return _current->value() ; }
+            pointer operator->() const { return &(operator*()) ; }
+
+            basic_iterator &operator++()
+            {
+               ++_current ;
+               nearest() ;
+               return *this ;
+            }
+            basic_iterator operator++(int)
+            {
+               basic_iterator prev (*this) ;
+               ++*this ;
+               return prev ;
+            }
+
+            friend bool operator==(const basic_iterator<IsConstant> &lhs, const basic_iterator<IsConstant> &rhs)
+            {
+               return lhs._current == rhs._current ;
+            }
+            friend bool operator!=(const basic_iterator<IsConstant> &lhs, const basic_iterator<IsConstant> &rhs)
+            {
+               return !(lhs == rhs) ;
+            }
+
+            friend std::ostream &operator<<(std::ostream &os, const basic_iterator &v)
+            {
+               return os << "{_current:" << (const void *)v._current << '}' ;
+            }
+         private:
+            const bucket_type *_current ;
+
+            explicit basic_iterator(const bucket_type *bucket) :
+               _current(bucket)
+            {
+               nearest() ;
+            }
+
+            // Skip empty buckets, stop at a full bucket or at the end sentinel
+            void nearest()
+            {
+               for (; _current->_dib == DIB_EMPTY ; ++_current) ;
+            }
+      } ;
+
+   public:
+      typedef basic_iterator<false> iterator ;
+      typedef basic_iterator<true>  const_iterator ;
+
+      closed_hashtable() noexcept : closed_hashtable(0) {}
+
+      explicit closed_hashtable(size_type initsize) :
+         closed_hashtable(std::pair<size_type, float>(initsize, 0))
+      {}
+
+      explicit closed_hashtable(const std::pair<size_type, float> &size_n_load) :
+         closed_hashtable(size_n_load, hasher())
+      {}
+
+      closed_hashtable(const closed_hashtable &other) :
+         closed_hashtable({other.size(), other.max_load_factor()},
+                          other.hash_function(), other.key_eq(), other.key_get())
+      {
+         copy_buckets(other._buckets, other._bucket_count, other._size) ;
+      }
+
+      closed_hashtable(closed_hashtable &&other) noexcept : closed_hashtable(0) { swap(other) ; }
+
+      closed_hashtable(const std::pair<size_type, float> &size_n_load,
+                       const hasher &hf, const key_equal &keq = {}, const key_extract &kex = {}) :
+         _hasher(hf), _key_eq(keq), _key_get(kex),
+         // Set max load factor bounds to float values exactly representable in binary
+         _max_load_factor(size_n_load.second <= 0
+                          ? PCOMN_CLOSED_HASH_LOAD_FACTOR
+                          : midval<float>(0.125, 0.9375, (float)size_n_load.second))
+      {
+         if (size_n_load.first)
+            allocate(bucket_count_for(size_n_load.first)) ;
+      }
+
+      closed_hashtable(const std::pair<size_type, float> &size_n_load,
+                       const key_extract &kex, const key_equal &keq = {}) :
+         closed_hashtable(size_n_load, {}, keq, kex)
+      {}
+
+      template<typename InputIterator>
+      closed_hashtable(InputIterator b, InputIterator e) :
+         closed_hashtable(pcomn::estimated_distance(b, e))
+      {
+         insert(b, e) ;
+      }
+
+      ~closed_hashtable() { deallocate() ; }
+
+      closed_hashtable &operator=(closed_hashtable &&other)
+      {
+         if (&other != this)
+            closed_hashtable(std::move(other)).swap(*this) ;
+         return *this ;
+      }
+
+      const hasher &hash_function() const { return _hasher ; }
+
+      const key_equal &key_eq() const { return _key_eq ; }
+
+      const key_extract &key_get() const { return _key_get ; }
+
+      void swap(closed_hashtable &other) noexcept
+      {
+         if (&other == this)
+            return ;
+         pcomn_swap(_hasher, other._hasher) ;
+         pcomn_swap(_key_eq, other._key_eq) ;
+         pcomn_swap(_key_get, other._key_get) ;
+         pcomn_swap(_max_load_factor, other._max_load_factor) ;
+         pcomn_swap(_buckets, other._buckets) ;
+         pcomn_swap(_bucket_count, other._bucket_count) ;
+         pcomn_swap(_size, other._size) ;
+      }
+
+      /// Erase the item pointed to by @a it.
+      /// @note Following items may be shifted back into the erased bucket, so @a it may
+      /// point to another valid item or to an empty bucket after erasure and must not be
+      /// used.
+      void erase(iterator it) { erase_bucket(it._current - _buckets) ; }
+
+      size_type erase(const key_type &key) { return erase_item(key, NULL) ; }
+
+      size_type erase(const key_type &key, value_type &erased_value)
+      {
+         return erase_item(key, &erased_value) ;
+      }
+
+      size_type erase_value(const value_type &value)
+      {
+         return erase_item(key_get()(value), NULL) ;
+      }
+
+      std::pair<iterator, bool> insert(const value_type &value) ;
+
+      std::pair<iterator, bool> replace(const value_type &value)
+      {
+         const std::pair<iterator, bool> result = insert(value) ;
+         if (!result.second)
+            const_cast<bucket_type *>(result.first._current)->value() = value ;
+         return result ;
+      }
+
+      std::pair<iterator, bool> replace(const value_type &value, value_type &oldvalue)
+      {
+         const std::pair<iterator, bool> result = insert(value) ;
+         if (!result.second)
+         {
+            oldvalue = *result.first ;
+            const_cast<bucket_type *>(result.first._current)->value() = value ;
+         }
+         return result ;
+      }
+
+      template<typename InputIterator>
+      void insert(InputIterator b, InputIterator e)
+      {
+         for ( ; b != e ; ++b)
+            insert(*b) ;
+      }
+
+      template<typename InputIterator>
+      void replace(InputIterator b, InputIterator e)
+      {
+         for ( ; b != e ; ++b)
+            replace(*b) ;
+      }
+
+      iterator find(const key_type &key)
+      {
+         return find_iterator<iterator>(key) ;
+      }
+
+      const_iterator find(const key_type &key) const
+      {
+         return find_iterator<const_iterator>(key) ;
+      }
+
+      iterator find_value(const value_type &value)
+      {
+         return find_iterator<iterator>(key_get()(value)) ;
+      }
+
+      const_iterator find_value(const value_type &value) const
+      {
+         return find_iterator<const_iterator>(key_get()(value)) ;
+      }
+
+      size_type bucket_count() const { return _bucket_count ; }
+
+      size_type size() const { return _size ; }
+
+      size_type max_size() const { return bucket_count() ; }
+
+      float max_load_factor() const { return _max_load_factor ; }
+
+      float load_factor() const
+      {
+         const size_type bc = bucket_count() ;
+         return bc ? (float)size()/bc : 1.0 ;
+      }
+
+      bool empty() const { return !size() ; }
+
+      void reserve(size_type n)
+      {
+         const size_type newcount = bucket_count_for(n) ;
+         if (newcount > _bucket_count)
+            rehash(newcount) ;
+      }
+
+      void clear()
+      {
+         deallocate() ;
+         reset_members() ;
+      }
+
+      size_type count(const key_type &key) const
+      {
+         return (size_type)!!find_bucket(key, hash_function()(key)) ;
+      }
+
+      size_type value_count(const value_type &value) const
+      {
+         return count(key_get()(value)) ;
+      }
+
+      /// Find every key from a sequence, writing a const_iterator per key (end() for
+      /// absent keys) to @a results.
+      ///
+      /// Keys are hashed by batches of PCOMN_CLOSED_HASH_PREFETCH_BATCH and the home
+      /// buckets of a batch are prefetched before probing.
+      /// @return The end of the results sequence.
+      template<typename ForwardIterator, typename OutputIterator>
+      OutputIterator find_many(ForwardIterator keys_begin, ForwardIterator keys_end,
+                               OutputIterator results) const
+      {
+         probe_many(keys_begin, keys_end, [&](const_iterator found)
+         {
+            *results = found ;
+            ++results ;
+         }) ;
+         return results ;
+      }
+
+      /// Get the count of keys from a sequence present in the table.
+      /// Probes like find_many().
+      template<typename ForwardIterator>
+      size_type count_many(ForwardIterator keys_begin, ForwardIterator keys_end) const
+      {
+         const const_iterator e = end() ;
+         size_type result = 0 ;
+         probe_many(keys_begin, keys_end, [&](const_iterator found) { result += found != e ; }) ;
+         return result ;
+      }
+
+      iterator begin() { return iterator(_buckets) ; }
+      const_iterator begin() const { return const_iterator(_buckets) ; }
+      const_iterator cbegin() const { return begin() ; }
+
+      iterator end() { return iterator(_buckets + _bucket_count) ; }
+      const_iterator end() const { return const_iterator(_buckets + _bucket_count) ; }
+      const_iterator cend() const { return end() ; }
+
+      /// Get the maximum distance of an item from its home bucket.
+      /// O(bucket_count()), intended for diagnostics and tests.
+      size_type max_probe_length() const
+      {
+         unsigned result = 0 ;
+         for (const bucket_type *b = _buckets, *e = b + _bucket_count ; b != e ; ++b)
+            result = std::max<unsigned>(result, b->_dib) ;
+         return result ? result - DIB_HOME : 0 ;
+      }
+
+      friend std::ostream &operator<<(std::ostream &os, const closed_hashtable &v)
+      {
+         return os << "{size:" << v.size()
+                   << " buckets:" << v.bucket_count()
+                   << " buckptr:" << (const void *)v._buckets << '}' ;
+      }
+
+   private:
+      hasher         _hasher  {} ;
+      key_equal      _key_eq  {} ;
+      key_extract    _key_get {} ;
+      float          _max_load_factor = PCOMN_CLOSED_HASH_LOAD_FACTOR ;
+
+      bucket_type *  _buckets      = end_sentinel() ; /* _bucket_count + 1 (end sentinel) buckets */
+      size_type      _bucket_count = 0 ;              /* 0 or 2^n */
+      size_type      _size         = 0 ;
+
+      static bucket_type *end_sentinel()
+      {
+         // Never written: a table with no buckets always allocates them before insertion
+         static bucket_type sentinel {DIB_END, {}} ;
+         return &sentinel ;
+      }
+
+      bool keys_equal(const value_type &value, const key_type &key) const
+      {
+         return !!key_eq()(key_get()(value), key) ;
+      }
+
+      size_type max_growth(size_type bucket_count) const
+      {
+         return (size_type)(bucket_count * _max_load_factor) ;
+      }
+
+      size_type bucket_count_for(size_type count) const
+      {
+         if (!count)
+            return 0 ;
+         size_type result = std::max<size_type>
+            ((size_type)1 << bitop::log2ceil((size_type)ceil(count/_max_load_factor)), 8) ;
+         while (max_growth(result) < count)
+            result *= 2 ;
+         return result ;
+      }
+
+      void allocate(size_type bucket_count) ;
+
+      void deallocate()
+      {
+         if (_bucket_count)
+            delete [] _buckets ;
+      }
+
+      void reset_members()
+      {
+         _buckets = end_sentinel() ;
+         _bucket_count = _size = 0 ;
+      }
+
+      const bucket_type *find_bucket(const key_type &key, size_t hash) const
+      {
+         if (!_bucket_count)
+            return NULL ;
+         const size_t mask = _bucket_count - 1 ;
+         size_t ndx = hash & mask ;
+         // Items of a probe sequence are ordered by their distance from home, so the
+         // search stops at the first item that is closer to its home than the key would
+         // be (this includes an empty bucket).
+         for (unsigned dib = DIB_HOME ; dib <= _buckets[ndx]._dib ; ++dib, ndx = (ndx + 1) & mask)
+            if (dib == _buckets[ndx]._dib && keys_equal(_buckets[ndx].value(), key))
+               return _buckets + ndx ;
+         return NULL ;
+      }
+
+      template<typename Iterator>
+      Iterator find_iterator(const key_type &key) const
+      {
+         const bucket_type * const bucket = find_bucket(key, hash_function()(key)) ;
+         return Iterator(bucket ? bucket : _buckets + _bucket_count) ;
+      }
+
+      template<typename ForwardIterator, typename Found>
+      void probe_many(ForwardIterator b, ForwardIterator e, Found &&found) const
+      {
+         if (!_bucket_count)
+         {
+            for (; b != e ; ++b)
+               found(end()) ;
+            return ;
+         }
+         const size_t mask = _bucket_count - 1 ;
+         size_t hashes[PCOMN_CLOSED_HASH_PREFETCH_BATCH] ;
+         while (b != e)
+         {
+            ForwardIterator batch = b ;
+            size_t n = 0 ;
+            for (; n < PCOMN_CLOSED_HASH_PREFETCH_BATCH && b != e ; ++n, ++b)
+            {
+               hashes[n] = hash_function()(*b) ;
+               PCOMN_PREFETCH(_buckets + (hashes[n] & mask)) ;
+            }
+            for (size_t i = 0 ; i < n ; ++i, ++batch)
+            {
+               const bucket_type * const bucket = find_bucket(*batch, hashes[i]) ;
+               found(const_iterator(bucket ? bucket : _buckets + _bucket_count)) ;
+            }
+         }
+      }
+
+      // Check if the value with the given hash can be inserted without exceeding the
+      // probe distance limit; doesn't modify the table
+      bool fits(size_t hash) const ;
+
+      // Insert the value known to be absent, return the index of its bucket or -1 if the
+      // probe distance limit would be exceeded; in the latter case, the table is left
+      // intact.
+      ssize_t put_value(size_t hash, const value_type &value) ;
+
+      size_type erase_item(const key_type &key, value_type *erased_value)
+      {
+         const bucket_type * const found = find_bucket(key, hash_function()(key)) ;
+         if (!found)
+            return 0 ;
+         if (erased_value)
+            *erased_value = found->value() ;
+         erase_bucket(found - _buckets) ;
+         return 1 ;
+      }
+
+      // Backward-shift deletion: move following items one bucket back until an empty
+      // bucket or an item in its home bucket
+      void erase_bucket(size_t ndx)
+      {
+         NOXCHECK(ndx < _bucket_count) ;
+         NOXCHECK(_buckets[ndx]._dib != DIB_EMPTY) ;
+
+         const size_t mask = _bucket_count - 1 ;
+         for (size_t next ; _buckets[next = (ndx + 1) & mask]._dib > DIB_HOME ; ndx = next)
+         {
+            _buckets[ndx]._dib = _buckets[next]._dib - 1 ;
+            _buckets[ndx]._value = _buckets[next]._value ;
+         }
+         _buckets[ndx]._dib = DIB_EMPTY ;
+         --_size ;
+      }
+
+      // Insert @a item_count items from @a buckets into the table that has no items
+      // from @a buckets yet
+      void copy_buckets(const bucket_type *buckets, size_type bucket_count, size_type item_count) ;
+
+      // Provides strong exception guarantee: the new table is built aside and swapped in
+      // only on success
+      void rehash(size_type new_bucket_count) ;
+
+      // Called when the probe distance limit is exceeded by an insertion into the table
+      // intended to hold @a item_count items; the hash function is considered broken if
+      // the table would be sparse.
+      void grow_on_overflow(size_type item_count)
+      {
+         ensure<std::length_error>((float)item_count/_bucket_count >= _max_load_factor/16,
+                                   "Too many hash collisions in closed_hashtable") ;
+         rehash(_bucket_count*2) ;
+      }
+} ;
+
+/*******************************************************************************
+ closed_hashtable with Robin Hood layout
+*******************************************************************************/
+template<typename V, typename X, typename H, typename P, typename S, unsigned M>
+auto closed_hashtable<V, X, H, P, S, basic_robin_hood_layout<M>>::insert(const value_type &value)
+   -> std::pair<iterator, bool>
+{
+   const auto &key = key_get()(value) ;
+   const size_t hash = hash_function()(key) ;
+
+   if (const bucket_type * const found = find_bucket(key, hash))
+      return {iterator(found), false} ;
+
+   if (_size >= max_growth(_bucket_count))
+      rehash(std::max<size_type>(_bucket_count*2, 8)) ;
+
+   ssize_t ndx ;
+   // Pathologically long probe sequence: grow until the item fits
+   while ((ndx = put_value(hash, value)) < 0)
+      grow_on_overflow(_size + 1) ;
+
+   return {iterator(_buckets + ndx), true} ;
+}
+
+template<typename V, typename X, typename H, typename P, typename S, unsigned M>
+bool closed_hashtable<V, X, H, P, S, basic_robin_hood_layout<M>>::fits(size_t hash) const
+{
+   // Simulate put_value() on distances only
+   const size_t mask = _bucket_count - 1 ;
+   size_t ndx = hash & mask ;
+   for (unsigned dib = DIB_HOME ; dib <= DIB_MAX ; ++dib, ndx = (ndx + 1) & mask)
+   {
+      const unsigned bucket_dib = _buckets[ndx]._dib ;
+      if (bucket_dib == DIB_EMPTY)
+         return true ;
+      if (bucket_dib < dib)
+         dib = bucket_dib ;
+   }
+   return false ;
+}
+
+template<typename V, typename X, typename H, typename P, typename S, unsigned M>
+ssize_t closed_hashtable<V, X, H, P, S, basic_robin_hood_layout<M>>::put_value(size_t hash, const value_type &value)
+{
+   NOXCHECK(_size < _bucket_count) ;
+
+   // The distance never exceeds the bucket count, so only big tables can overflow
+   if (_bucket_count > DIB_MAX && !fits(hash))
+      return -1 ;
+
+   const size_t mask = _bucket_count - 1 ;
+   size_t ndx = hash & mask ;
+   ssize_t result = -1 ;
+   unsigned dib = DIB_HOME ;
+   value_type carry (value) ;
+
+   for (;; ++dib, ndx = (ndx + 1) & mask)
+   {
+      NOXCHECK(dib <= DIB_MAX) ;
+
+      bucket_type &bucket = _buckets[ndx] ;
+      if (bucket._dib == DIB_EMPTY)
+      {
+         bucket._dib = dib ;
+         new (&bucket._value) value_type(carry) ;
+         ++_size ;
+         return result < 0 ? (ssize_t)ndx : result ;
+      }
+      // Rob the rich: the carried item takes the place of an item closer to its home,
+      // the latter continues probing
+      if (bucket._dib < dib)
+      {
+         std::swap(carry, bucket.value()) ;
+         const unsigned displaced_dib = bucket._dib ;
+         bucket._dib = dib ;
+         dib = displaced_dib ;
+         if (result < 0)
+            result = ndx ;
+      }
+   }
+}
+
+template<typename V, typename X, typename H, typename P, typename S, unsigned M>
+void closed_hashtable<V, X, H, P, S, basic_robin_hood_layout<M>>::allocate(size_type bucket_count)
+{
+   NOXCHECK(!_bucket_count) ;
+   NOXCHECK(bitop::tstpow2(bucket_count)) ;
+
+   bucket_type * const buckets = new bucket_type[bucket_count + 1] ;
+   for (size_type i = 0 ; i < bucket_count ; ++i)
+      buckets[i]._dib = DIB_EMPTY ;
+   buckets[bucket_count]._dib = DIB_END ;
+
+   _buckets = buckets ;
+   _bucket_count = bucket_count ;
+}
+
+template<typename V, typename X, typename H, typename P, typename S, unsigned M>
+void closed_hashtable<V, X, H, P, S, basic_robin_hood_layout<M>>::copy_buckets(const bucket_type *buckets,
+                                                                     size_type bucket_count,
+                                                                     size_type item_count)
+{
+   item_count += _size ;
+   for (size_type i = 0 ; i < bucket_count ; ++i)
+      if (buckets[i]._dib != DIB_EMPTY)
+      {
+         const value_type &value = buckets[i].value() ;
+         const size_t hash = hash_function()(key_get()(value)) ;
+         while (put_value(hash, value) < 0)
+            grow_on_overflow(item_count) ;
+      }
+}
+
+template<typename V, typename X, typename H, typename P, typename S, unsigned M>
+void closed_hashtable<V, X, H, P, S, basic_robin_hood_layout<M>>::rehash(size_type new_bucket_count)
+{
+   NOXCHECK(max_growth(new_bucket_count) >= _size) ;
+
+   closed_hashtable rehashed ({0, _max_load_factor}, hash_function(), key_eq(), key_get()) ;
+   rehashed.allocate(new_bucket_count) ;
+   rehashed.copy_buckets(_buckets, _bucket_count, _size) ;
+
+   swap(rehashed) ;
+}
+
+} // end of namespace pcomn
+
+#endif /* __PCOMN_HASHROBIN_H */
@@ -0,0 +1,245 @@
+/*-*- mode: c++; tab-width: 3; indent-tabs-mode: nil; c-file-style: "ellemtel"; c-file-offsets:((innamespace . 0)(inclass . ++)) -*-*/
+#ifndef __PCOMN_HAZARDPTR_H
+#define __PCOMN_HAZARDPTR_H
+/*******************************************************************************
+ FILE         :   pcomn_hazardptr.h
+ COPYRIGHT    :   Yakov Markovitch, 2026. All rights reserved.
+
+ DESCRIPTION  :   Asymmetric hazard pointers and RCU-style snapshot holder.
+
+ PROGRAMMED BY:   Yakov Markovitch
+ CREATION DATE:   16 Oct 2026
+*******************************************************************************/
+/** @file
+ Asymmetric hazard pointers and RCU-style snapshot holder.
+
+ Every reading thread announces the objects it is reading in its own cache line (one
+ per thread, shared by all users of the registry). Since the reader does this without
+ any memory fence, the writer that has unpublished an object issues the process-wide
+ memory barrier (atomic_op::atomic_process_fence()) before checking the announcements
+ and freeing the object. This makes reads almost as cheap as plain loads at the
+ expense of (rare) writes.
+*******************************************************************************/
+#include <pcomn_atomic.h>
+#include <pcomn_except.h>
+#include <pcomn_syncobj.h>
+#include <pcomn_sys.h>
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <algorithm>
+
+namespace pcomn {
+
+namespace detail {
+/*******************************************************************************
+ Per-thread announcements of objects being read
+*******************************************************************************/
+struct alignas(cacheline_t) hazard_record {
+      /// Max. count of simultaneously announced objects per thread (i.e. max. nesting
+      /// depth of hazard_guard)
+      static constexpr unsigned slots = 4 ;
+
+      std::atomic<const void *>  _hazard[slots] {} ;
+      std::atomic<bool>          _used {true} ;
+      unsigned                   _depth = 0 ; /* Slots in use, owner thread only */
+      hazard_record *            _next = nullptr ;
+} ;
+
+template<novalue = novalue()>
+struct hazard_registry_ {
+      /// Get the record of the calling thread, it is released at thread exit.
+      static hazard_record &local()
+      {
+         static thread_local const local_record record ;
+         return *record._record ;
+      }
+
+      /// Check if any thread announces @a ptr.
+      /// Call atomic_process_fence() after unpublishing @a ptr and before the check.
+      static bool is_hazardous(const void *ptr)
+      {
+         for (const hazard_record *r = _head.load(std::memory_order_acquire) ; r ; r = r->_next)
+            for (const auto &hazard: r->_hazard)
+               if (hazard.load(std::memory_order_acquire) == ptr)
+                  return true ;
+         return false ;
+      }
+
+   private:
+      struct local_record {
+            local_record() : _record(acquire_record()) {}
+            ~local_record()
+            {
+               for (auto &hazard: _record->_hazard)
+                  hazard.store(nullptr, std::memory_order_release) ;
+               _record->_depth = 0 ;
+               _record->_used.store(false, std::memory_order_release) ;
+            }
+            hazard_record * const _record ;
+      } ;
+
+      static std::atomic<hazard_record *> _head ;
+
+      // Records are never deallocated, records of exited threads are reused
+      static hazard_record *acquire_record()
+      {
+         for (hazard_record *r = _head.load(std::memory_order_acquire) ; r ; r = r->_next)
+            if (!r->_used.load(std::memory_order_relaxed) &&
+                !r->_used.exchange(true, std::memory_order_acquire))
+               return r ;
+
+         hazard_record * const r = new (sys::alloc_aligned<hazard_record>(1)) hazard_record ;
+         hazard_record *head = _head.load(std::memory_order_relaxed) ;
+         do r->_next = head ;
+         while (!_head.compare_exchange_weak(head, r, std::memory_order_release, std::memory_order_relaxed)) ;
+         return r ;
+      }
+} ;
+
+template<novalue _>
+std::atomic<hazard_record *> hazard_registry_<_>::_head {nullptr} ;
+
+typedef hazard_registry_<> hazard_registry ;
+
+} // end of namespace pcomn::detail
+
+/******************************************************************************/
+/** Announces the object currently published through an atomic pointer for the
+ lifetime of the guard, so that the writer can't free it while it is being read.
+
+ Guards are scoped and may be nested up to detail::hazard_record::slots deep.
+*******************************************************************************/
+template<typename T>
+class hazard_guard {
+      PCOMN_NONCOPYABLE(hazard_guard) ;
+      PCOMN_NONASSIGNABLE(hazard_guard) ;
+   public:
+      template<typename U>
+      explicit hazard_guard(const std::atomic<U *> &source) :
+         _record(detail::hazard_registry::local())
+      {
+         PCOMN_VERIFY(_record._depth < detail::hazard_record::slots) ;
+         _slot = _record._hazard + _record._depth++ ;
+
+         T *data = source.load(std::memory_order_acquire) ;
+         for (T *current ;; data = current)
+         {
+            _slot->store(data, std::memory_order_relaxed) ;
+            // The writer side issues atomic_process_fence() instead of our fence
+            std::atomic_signal_fence(std::memory_order_seq_cst) ;
+            if ((current = source.load(std::memory_order_acquire)) == data)
+               break ;
+         }
+         _data = data ;
+      }
+
+      ~hazard_guard()
+      {
+         _slot->store(nullptr, std::memory_order_release) ;
+         --_record._depth ;
+      }
+
+      T *get() const { return _data ; }
+      T &operator*() const { return *_data ; }
+      T *operator->() const { return _data ; }
+
+   private:
+      detail::hazard_record &       _record ;
+      std::atomic<const void *> *   _slot ;
+      T *                           _data ;
+} ;
+
+/******************************************************************************/
+/** RCU-style holder of an immutable snapshot: readers get the current snapshot
+ without locking, a writer publishes a new snapshot without waiting for readers.
+
+ A replaced snapshot remains valid for readers still using it; it is freed by a
+ subsequent reset() or reclaim() as soon as no reader uses it.
+
+ Writers are serialized by an internal mutex. The holder itself must not be destroyed
+ while readers use it.
+*******************************************************************************/
+template<typename T>
+class snapshot_holder {
+      PCOMN_NONCOPYABLE(snapshot_holder) ;
+      PCOMN_NONASSIGNABLE(snapshot_holder) ;
+   public:
+      typedef T value_type ;
+
+      /// Create a holder of a default-constructed snapshot.
+      snapshot_holder() : snapshot_holder(std::make_unique<T>()) {}
+
+      explicit snapshot_holder(std::unique_ptr<T> &&initial) :
+         _current(PCOMN_ENSURE_ARG(initial).release())
+      {}
+
+      ~snapshot_holder()
+      {
+         delete _current.load(std::memory_order_relaxed) ;
+         for (T *snapshot: _retired)
+            delete snapshot ;
+      }
+
+      /// Call @a reader with the current snapshot (as a const reference) and return the
+      /// result.
+      /// The snapshot is guaranteed to stay alive until @a reader returns, even if
+      /// replaced in the meantime.
+      template<typename F>
+      decltype(auto) read(F &&reader) const
+      {
+         const hazard_guard<const T> guard (_current) ;
+         return std::forward<F>(reader)(*guard) ;
+      }
+
+      /// Publish a new snapshot.
+      /// Never waits for readers: the previous snapshot is freed when there are no
+      /// readers using it anymore.
+      void reset(std::unique_ptr<T> &&snapshot)
+      {
+         T * const published = PCOMN_ENSURE_ARG(snapshot).get() ;
+
+         PCOMN_SCOPE_LOCK (guard, _writer_lock) ;
+         _retired.push_back(_current.exchange(published, std::memory_order_acq_rel)) ;
+         snapshot.release() ;
+         reclaim_retired() ;
+      }
+
+      /// Free replaced snapshots that are not used by readers anymore.
+      /// @return The count of replaced snapshots still in use.
+      size_t reclaim()
+      {
+         PCOMN_SCOPE_LOCK (guard, _writer_lock) ;
+         return reclaim_retired() ;
+      }
+
+   private:
+      std::atomic<T *>  _current ;
+      std::mutex        _writer_lock ;
+      std::vector<T *>  _retired ;
+
+      size_t reclaim_retired()
+      {
+         if (_retired.empty())
+            return 0 ;
+
+         atomic_op::atomic_process_fence() ;
+
+         _retired.erase(std::remove_if(_retired.begin(), _retired.end(), [](T *snapshot)
+         {
+            if (detail::hazard_registry::is_hazardous(snapshot))
+               return false ;
+            delete snapshot ;
+            return true ;
+         }),
+            _retired.end()) ;
+
+         return _retired.size() ;
+      }
+} ;
+
+} // end of namespace pcomn
+
+#endif /* __PCOMN_HAZARDPTR_H */
@@ -0,0 +1,183 @@
+/*-*- tab-width: 3; indent-tabs-mode: nil; c-file-style: "ellemtel"; c-file-offsets:((innamespace . 0)) -*-*/
+/*******************************************************************************
+ FILE         :   pcomn_internstr.cpp
+ COPYRIGHT    :   Yakov Markovitch, 2026. All rights reserved.
+                  See LICENSE for information on usage/redistribution.
+
+ DESCRIPTION  :   The pool of interned strings.
+
+ PROGRAMMED BY:   Yakov Markovitch
+ CREATION DATE:   16 Oct 2026
+*******************************************************************************/
+#include <pcomn_internstr.h>
+#include <pcomn_hashconcur.h>
+#include <pcomn_except.h>
+
+#include <mutex>
+#include <new>
+
+#include <string.h>
+#include <stdlib.h>
+
+namespace pcomn {
+
+namespace {
+/*******************************************************************************
+ The key of an interned string in the pool: the hash is compared first, so the
+ string data is compared only on (almost certain) match.
+*******************************************************************************/
+template<typename C>
+struct intern_key {
+      size_t               _hash ;
+      basic_strslice<C>    _str ;
+
+      struct extract {
+            intern_key operator()(const detail::interned_strdata<C> *data) const
+            {
+               return {data->_hash, basic_strslice<C>(data->_begin, data->_begin + data->_size)} ;
+            }
+      } ;
+
+      struct hash {
+            size_t operator()(const intern_key &key) const { return key._hash ; }
+      } ;
+
+      struct equal {
+            bool operator()(const intern_key &x, const intern_key &y) const
+            {
+               return x._hash == y._hash && x._str == y._str ;
+            }
+      } ;
+} ;
+
+/*******************************************************************************
+ The pool of interned strings of the character type C.
+
+ Strings are allocated sequentially in the arena blocks, which are never freed.
+*******************************************************************************/
+template<typename C>
+class intern_pool {
+      PCOMN_NONCOPYABLE(intern_pool) ;
+      PCOMN_NONASSIGNABLE(intern_pool) ;
+
+      typedef detail::interned_strdata<C> data_type ;
+      typedef intern_key<C>               key_type ;
+
+   public:
+      intern_pool() = default ;
+
+      // Never destroyed: interned strings may be used during the static destruction
+      static intern_pool &instance()
+      {
+         static intern_pool &pool = *new intern_pool ;
+         return pool ;
+      }
+
+      const data_type *intern(const C *s, size_t sz)
+      {
+         if (!sz)
+            return &data_type::zero ;
+
+         const key_type key {hash_bytes(s, sz*sizeof(C)), basic_strslice<C>(s, s + sz)} ;
+         const data_type *data ;
+
+         if (_strings.get(key, data))
+            return data ;
+
+         PCOMN_SCOPE_LOCK (guard, _lock) ;
+
+         // Check again: the string could be added while we were waiting for the lock
+         if (_strings.get(key, data))
+            return data ;
+
+         data = new_data(key._hash, s, sz) ;
+         _strings.insert(data) ;
+         _datasize += sz*sizeof(C) ;
+         return data ;
+      }
+
+      interned_pool_stats stats()
+      {
+         PCOMN_SCOPE_LOCK (guard, _lock) ;
+         // A bucket of the hash set is approximately a pointer plus the sequence
+         // counter and the state
+         return {_strings.size(), _datasize, _memsize + _strings.bucket_count()*2*sizeof(void *)} ;
+      }
+
+   private:
+      static constexpr size_t block_size = 256*KiB ;
+
+      concurrent_hashtable<const data_type *,
+                           typename key_type::extract,
+                           typename key_type::hash,
+                           typename key_type::equal> _strings ;
+      std::mutex  _lock ;
+
+      char *      _free = nullptr ;    /* The free space in the current arena block */
+      size_t      _available = 0 ;
+      size_t      _datasize = 0 ;
+      size_t      _memsize = 0 ;
+
+      // Allocate and initialize the string data; must be called under _lock
+      const data_type *new_data(size_t hash, const C *s, size_t sz)
+      {
+         const size_t memsize =
+            (offsetof(data_type, _begin) + (sz + 1)*sizeof(C) + alignof(data_type) - 1) & ~(alignof(data_type) - 1) ;
+
+         void *mem ;
+         if (memsize > block_size/4)
+            // Don't waste the current block for a long string: allocate it separately
+            mem = allocate_block(memsize) ;
+         else
+         {
+            if (memsize > _available)
+            {
+               _free = static_cast<char *>(allocate_block(block_size)) ;
+               _available = block_size ;
+            }
+            mem = _free ;
+            _free += memsize ;
+            _available -= memsize ;
+         }
+
+         data_type * const data = static_cast<data_type *>(mem) ;
+         data->_hash = hash ;
+         data->_size = sz ;
+         memcpy(data->_begin, s, sz*sizeof(C)) ;
+         data->_begin[sz] = C() ;
+         return data ;
+      }
+
+      void *allocate_block(size_t sz)
+      {
+         void * const block = malloc(sz) ;
+         if (!block)
+            throw std::bad_alloc() ;
+         _memsize += sz ;
+         return block ;
+      }
+} ;
+} // end of anonymous namespace
+
+/*******************************************************************************
+ interned_string
+*******************************************************************************/
+template<typename C>
+auto interned_string<C>::intern(const C *s, size_type sz) -> const data_type *
+{
+   return intern_pool<C>::instance().intern(s, sz) ;
+}
+
+template<typename C>
+interned_pool_stats interned_string<C>::pool_stats()
+{
+   return intern_pool<C>::instance().stats() ;
+}
+
+/*******************************************************************************
+ Force instantiation
+*******************************************************************************/
+template class interned_string<char> ;
+template class interned_string<wchar_t> ;
+
+} // end of namespace pcomn
@@ -0,0 +1,215 @@
+/*-*- mode: c++; tab-width: 3; indent-tabs-mode: nil; c-file-style: "ellemtel"; c-file-offsets:((innamespace . 0)(inclass . ++)) -*-*/
+#ifndef __PCOMN_INTERNSTR_H
+#define __PCOMN_INTERNSTR_H
+/*******************************************************************************
+ FILE         :   pcomn_internstr.h
+ COPYRIGHT    :   Yakov Markovitch, 2026. All rights reserved.
+                  See LICENSE for information on usage/redistribution.
+
+ DESCRIPTION  :   Interned immutable strings.
+
+ PROGRAMMED BY:   Yakov Markovitch
+ CREATION DATE:   16 Oct 2026
+*******************************************************************************/
+/** @file
+ Interned strings: all equal interned_string<C> objects refer to the single copy of
+ the string data in the process-wide pool.
+
+ So the equality is a pointer comparison and the hash is computed once, at interning,
+ and stored in the string header. The pool is append-only: interned strings are never
+ freed and are allocated in large arena blocks, thus an interned string costs its
+ length plus 16 bytes of header, regardless of how many times it is used.
+
+ Interning takes a lock-free lookup in a concurrent hash set; the pool is locked only
+ when a new string is added.
+
+ Appropriate for keys, identifiers, symbols, etc., i.e. for a limited set of strings
+ that are repeated many times and compared often; not appropriate for arbitrary text,
+ since the pool grows without limit.
+*******************************************************************************/
+#include <pcomn_string.h>
+#include <pcomn_strslice.h>
+#include <pcomn_hash.h>
+
+#include <iostream>
+#include <utility>
+
+namespace pcomn {
+
+template<typename C>
+class interned_string ;
+
+/*******************************************************************************
+ internstr
+ winternstr
+*******************************************************************************/
+typedef interned_string<char>    internstr ;
+typedef interned_string<wchar_t> winternstr ;
+
+namespace detail {
+/// The header and data of an interned string; allocated only in the pool arena.
+template<typename C>
+struct interned_strdata {
+      size_t _hash ;
+      size_t _size ;
+      C      _begin[1] ;  /* Null-terminated */
+
+      static const interned_strdata zero ;
+} ;
+
+template<typename C>
+const interned_strdata<C> interned_strdata<C>::zero = {0, 0, {C()}} ;
+} // end of namespace pcomn::detail
+
+/******************************************************************************/
+/** Interning pool statistics.
+*******************************************************************************/
+struct interned_pool_stats {
+      size_t count ;    /**< The count of interned strings */
+      size_t datasize ; /**< The sum of lengths of interned strings (in bytes) */
+      size_t memsize ;  /**< The memory allocated by the pool (arena and hash set) */
+} ;
+
+/******************************************************************************/
+/** Immutable string that refers to the single, process-wide copy of its value.
+
+ Has the size of a pointer and is trivially copyable; the default-constructed string
+ is empty. All the empty strings are equal and refer to the same static data.
+*******************************************************************************/
+template<typename C>
+class interned_string {
+      typedef detail::interned_strdata<C> data_type ;
+   public:
+      typedef C                                 value_type ;
+      typedef C                                 char_type ;
+      typedef std::char_traits<C>               traits_type ;
+      typedef size_t                            size_type ;
+      typedef ptrdiff_t                         difference_type ;
+      typedef const C &                         const_reference ;
+      typedef const C *                         const_pointer ;
+      typedef const C *                         const_iterator ;
+      typedef std::reverse_iterator<const C *>  const_reverse_iterator ;
+
+      constexpr interned_string() : _data(&data_type::zero) {}
+
+      /// Intern a string.
+      template<typename S, typename = enable_if_strchar_t<S, C, nullptr_t>>
+      interned_string(const S &s) :
+         _data(intern(str::cstr(s), str::len(s)))
+      {}
+
+      /// Intern a string slice.
+      interned_string(const basic_strslice<C> &s) :
+         _data(intern(s.begin(), s.size()))
+      {}
+
+      /// Intern a range of characters.
+      interned_string(const C *begin, const C *end) :
+         _data(intern(begin, end - begin))
+      {}
+
+      interned_string(const C *begin, size_type sz) :
+         _data(intern(begin, sz))
+      {}
+
+      const_iterator begin() const { return _data->_begin ; }
+      const_iterator end() const { return begin() + size() ; }
+      const_iterator cbegin() const { return begin() ; }
+      const_iterator cend() const { return end() ; }
+
+      const_reverse_iterator rbegin() const { return const_reverse_iterator(end()) ; }
+      const_reverse_iterator rend() const { return const_reverse_iterator(begin()) ; }
+
+      const C *c_str() const { return begin() ; }
+      const C *data() const { return begin() ; }
+
+      size_type size() const { return _data->_size ; }
+      size_type length() const { return size() ; }
+      bool empty() const { return !size() ; }
+
+      const C &operator[](size_type pos) const
+      {
+         NOXCHECK(pos <= size()) ;
+         return begin()[pos] ;
+      }
+
+      /// Get the hash of the string value.
+      /// Computed at interning, equal to valhash(strslice(*this)).
+      size_t hash() const { return _data->_hash ; }
+
+      /// Lexicographical comparison, the same as std::basic_string::compare().
+      int compare(const interned_string &other) const
+      {
+         return _data == other._data ? 0 : basic_strslice<C>(*this).compare(basic_strslice<C>(other)) ;
+      }
+
+      friend bool operator==(const interned_string &x, const interned_string &y)
+      {
+         return x._data == y._data ;
+      }
+      friend bool operator!=(const interned_string &x, const interned_string &y)
+      {
+         return !(x == y) ;
+      }
+
+      friend bool operator<(const interned_string &x, const interned_string &y)
+      {
+         return x.compare(y) < 0 ;
+      }
+      friend bool operator>(const interned_string &x, const interned_string &y) { return y < x ; }
+      friend bool operator<=(const interned_string &x, const interned_string &y) { return !(y < x) ; }
+      friend bool operator>=(const interned_string &x, const interned_string &y) { return !(x < y) ; }
+
+      /// Get the statistics of the pool of interned strings of type C.
+      static interned_pool_stats pool_stats() ;
+
+   private:
+      const data_type *_data ;
+
+      static const data_type *intern(const C *s, size_type sz) ;
+} ;
+
+PCOMN_STATIC_CHECK(sizeof(internstr) == sizeof(void *)) ;
+
+/*******************************************************************************
+ Explicit instantiation declarations
+*******************************************************************************/
+extern template class interned_string<char> ;
+extern template class interned_string<wchar_t> ;
+
+/*******************************************************************************
+ String traits for interned strings
+*******************************************************************************/
+template<typename C>
+struct string_traits<interned_string<C>> : anystring_traits<interned_string<C>, C> {
+      static size_t len(const interned_string<C> &s) { return s.size() ; }
+} ;
+
+/*******************************************************************************
+ Hashing: the hash is precomputed
+*******************************************************************************/
+template<typename C>
+struct hash_fn<interned_string<C>> {
+      size_t operator()(const interned_string<C> &s) const { return s.hash() ; }
+} ;
+
+/*******************************************************************************
+ Stream output
+*******************************************************************************/
+template<typename C>
+inline std::basic_ostream<C> &operator<<(std::basic_ostream<C> &os, const interned_string<C> &s)
+{
+   return os.write(s.data(), s.size()) ;
+}
+
+} // end of namespace pcomn
+
+namespace std {
+/***************************************************************************//**
+ std::hash specialization for interned_string.
+*******************************************************************************/
+template<typename C>
+struct hash<pcomn::interned_string<C>> : pcomn::hash_fn<pcomn::interned_string<C>> {} ;
+} // end of namespace std
+
+#endif /* __PCOMN_INTERNSTR_H */
@@ -0,0 +1,97 @@
+/*-*- mode:c++;tab-width:3;indent-tabs-mode:nil;c-file-style:"ellemtel";c-file-offsets:((innamespace . 0)(inclass . ++)) -*-*/
+#ifndef __PCOMN_ISAKERNELS_H
+#define __PCOMN_ISAKERNELS_H
+/*******************************************************************************
+ FILE         :   pcomn_isakernels.h
+ COPYRIGHT    :   Yakov Markovitch, 2026. All rights reserved.
+                  See LICENSE for information on usage/redistribution.
+
+ DESCRIPTION  :   Runtime selection of ISA-specific kernel tables.
+
+ CREATION DATE:   16 Oct 2026
+*******************************************************************************/
+/** @file
+ The selection of a kernel table by the CPU the code is executing on, shared by bulk
+ bit kernels (pcomn_bitkernels.h) and byte set scan kernels (pcomn_strscan.h).
+
+ A kernel table is a struct with `isa` and `name` members; the array of tables has an
+ item for every value of the ISA enum, the item is NULL if the ISA is not available
+ on the platform.
+
+ Every ISA-specific kernel table is defined in a separate source file compiled with
+ the -m options of its ISA, regardless of the ISA the rest of the library is compiled
+ for. Such a file must not use any inline functions or templates with external
+ linkage (e.g. std::min): the linker may pick their instances compiled for that ISA
+ for the rest of the library. All its helpers belong to the anonymous namespace.
+*******************************************************************************/
+#include <pcomn_except.h>
+
+#include <atomic>
+#include <stdexcept>
+
+#include <string.h>
+#include <stdlib.h>
+
+namespace pcomn {
+namespace detail {
+
+/// Select the kernel table for the most capable ISA the executing CPU supports.
+///
+/// The environment variable @a override_var may specify the name of another table
+/// to select, e.g. to test or benchmark different variants; it is ignored if the CPU
+/// doesn't support that table's ISA.
+/// @return The table put into @a selected; if there is a concurrent selection, the
+/// first one wins.
+template<typename Kernels, typename ISA, size_t n>
+const Kernels &select_isa_kernels(std::atomic<const Kernels *> &selected,
+                                  const Kernels * const (&tables)[n],
+                                  bool (*is_supported)(ISA),
+                                  const char *override_var)
+{
+   const Kernels *kernels = nullptr ;
+
+   if (const char * const isa_name = getenv(override_var))
+      for (unsigned isa = 0 ; isa < n ; ++isa)
+         if (tables[isa] && !strcmp(tables[isa]->name, isa_name) && is_supported((ISA)isa))
+         {
+            kernels = tables[isa] ;
+            break ;
+         }
+
+   for (unsigned isa = n ; !kernels && isa-- ;)
+      if (is_supported((ISA)isa))
+         kernels = tables[isa] ;
+
+   const Kernels *expected = nullptr ;
+   return selected.compare_exchange_strong(expected, kernels, std::memory_order_acq_rel)
+      ? *kernels
+      : *expected ;
+}
+
+/// Get the kernel table for the specified ISA.
+/// @throw std::invalid_argument if the executing CPU doesn't support @a isa.
+template<typename Kernels, typename ISA, size_t n>
+const Kernels &get_isa_kernels(const Kernels * const (&tables)[n], bool (*is_supported)(ISA),
+                               ISA isa, const char *kernels_kind)
+{
+   PCOMN_THROW_MSG_IF(!is_supported(isa), std::invalid_argument,
+                      "%s ISA variant %u is not supported by the CPU", kernels_kind, (unsigned)isa) ;
+   return *tables[(unsigned)isa] ;
+}
+
+/// Replace the selected kernel table.
+/// @return The ISA of the table replaced.
+template<typename Kernels>
+auto replace_isa_kernels(std::atomic<const Kernels *> &selected, const Kernels &kernels,
+                         const Kernels &(*select)()) -> decltype(kernels.isa)
+{
+   // Make the initial selection first: there must be a table to replace
+   if (!selected.load(std::memory_order_acquire))
+      select() ;
+   return selected.exchange(&kernels, std::memory_order_acq_rel)->isa ;
+}
+
+} // end of namespace pcomn::detail
+} // end of namespace pcomn
+
+#endif /* __PCOMN_ISAKERNELS_H */
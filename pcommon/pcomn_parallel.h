@@ -0,0 +1,393 @@
+/*-*- mode:c++;tab-width:4;indent-tabs-mode:nil;c-file-style:"ellemtel";c-basic-offset:4;c-file-offsets:((innamespace . 0)(inlambda . 0)) -*-*/
+#ifndef __PCOMN_PARALLEL_H
+#define __PCOMN_PARALLEL_H
+/*******************************************************************************
+ FILE         :   pcomn_parallel.h
+ COPYRIGHT    :   Yakov Markovitch, 2026. All rights reserved.
+                  See LICENSE for information on usage/redistribution.
+
+ DESCRIPTION  :   Parallel loops (parallel_for, parallel_reduce) over job_batch
+                  and threadpool.
+
+ PROGRAMMED BY:   Yakov Markovitch
+ CREATION DATE:   16 Oct 2026
+*******************************************************************************/
+/** @file
+ Data-parallel loop primitives.
+
+  - parallel_for(range, grain, fn): call fn(item) for every item of the range;
+  - parallel_reduce(range, init, map, combine): combine(...combine(init, map(item0))...).
+
+ A range is either a random-access sequence (anything std::begin()/std::end() apply to:
+ std::vector, simple_slice, C array, etc.) or an integral count N, which denotes the
+ sequence of indices [0, N).
+
+ Both primitives have two forms: the first one runs the loop over a one-off job_batch
+ with at most hardware threads count workers, the second one takes a threadpool to
+ run on. In both cases the calling thread also participates in the loop, so it is
+ safe to call parallel_for/parallel_reduce from inside a task running on the same pool.
+
+ The range is split into chunks dynamically ("guided" scheduling): every worker claims
+ the next chunk of the size proportional to the remaining part of the range divided
+ by the workers count, but not less than `grain`. Thus the chunks are large at the
+ start, which minimizes the overhead, and become smaller to the end, which balances
+ the load.
+*******************************************************************************/
+#include "pcomn_threadpool.h"
+#include "pcomn_syncobj.h"
+#include "pcomn_iterator.h"
+#include "pcomn_sys.h"
+
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <iterator>
+#include <exception>
+
+namespace pcomn {
+
+/*******************************************************************************
+ Forward declarations
+*******************************************************************************/
+template<typename Range, typename F>
+void parallel_for(Range &&range, size_t grain, F &&fn) ;
+
+template<typename Range, typename F>
+void parallel_for(threadpool &pool, Range &&range, size_t grain, F &&fn) ;
+
+template<typename Range, typename T, typename Map, typename Combine>
+T parallel_reduce(Range &&range, T init, Map &&map, Combine &&combine, size_t grain = 0) ;
+
+template<typename Range, typename T, typename Map, typename Combine>
+T parallel_reduce(threadpool &pool, Range &&range, T init, Map &&map, Combine &&combine, size_t grain = 0) ;
+
+namespace detail {
+/***************************************************************************//**
+ Claims chunks of the index range [0,size) for workers, tracks completion and
+ the first exception thrown by the loop body.
+*******************************************************************************/
+class parallel_chunker {
+    PCOMN_NONCOPYABLE(parallel_chunker) ;
+    PCOMN_NONASSIGNABLE(parallel_chunker) ;
+public:
+    parallel_chunker(size_t size, size_t grain, unsigned workers) noexcept :
+        _size(size),
+        _grain(std::max<size_t>(grain, 1)),
+        _divisor(2*std::max(workers, 1U))
+    {}
+
+    size_t size() const { return _size ; }
+
+    /// Claim the next chunk.
+    /// @return false if there is nothing left to claim.
+    bool next(unipair<size_t> &chunk) noexcept
+    {
+        size_t pos = _cursor.load(std::memory_order_relaxed) ;
+        size_t chunksize ;
+        do {
+            if (pos >= _size)
+                return false ;
+            const size_t remains = _size - pos ;
+            chunksize = std::min(remains, std::max(_grain, remains/_divisor)) ;
+        }
+        while (!_cursor.compare_exchange_weak(pos, pos + chunksize, std::memory_order_relaxed)) ;
+
+        chunk = {pos, pos + chunksize} ;
+        return true ;
+    }
+
+    /// Report `count` items are done.
+    void complete(size_t count) noexcept
+    {
+        if (count && _completed.fetch_add(count, std::memory_order_acq_rel) + count == _size)
+            _finished.unlock() ;
+    }
+
+    /// Stop distributing chunks, remember the exception to rethrow from wait().
+    /// The items of the failed chunk must be complete()d by the caller.
+    void abort(std::exception_ptr &&x) noexcept
+    {
+        if (!_failed.exchange(true, std::memory_order_acq_rel))
+            _exception = std::move(x) ;
+
+        const size_t unclaimed = _cursor.exchange(_size, std::memory_order_relaxed) ;
+        if (unclaimed < _size)
+            complete(_size - unclaimed) ;
+    }
+
+    /// Block until all the items are done, rethrow the loop body exception, if any.
+    void wait()
+    {
+        if (_size)
+            _finished.wait() ;
+        if (_exception)
+            std::rethrow_exception(_exception) ;
+    }
+
+    /// Run the chunk loop: `body(from, to, worker)` is called for every claimed chunk.
+    template<typename Body>
+    void run(Body &body, unsigned worker) noexcept
+    {
+        unipair<size_t> chunk ;
+        try {
+            while (next(chunk))
+            {
+                body(chunk.first, chunk.second, worker) ;
+                complete(chunk.second - chunk.first) ;
+            }
+        }
+        catch (...)
+        {
+            abort(std::current_exception()) ;
+            complete(chunk.second - chunk.first) ;
+        }
+    }
+
+private:
+    const size_t _size ;
+    const size_t _grain ;
+    const size_t _divisor ;
+
+    alignas(cacheline_t) std::atomic<size_t> _cursor {0} ;
+    alignas(cacheline_t) std::atomic<size_t> _completed {0} ;
+
+    std::atomic<bool>   _failed {false} ;
+    std::exception_ptr  _exception ;
+    promise_lock        _finished ;
+} ;
+
+/*******************************************************************************
+ Range adaptor: provides random-access begin iterator and size for both sequences
+ and integral counts.
+*******************************************************************************/
+template<typename Range, bool = std::is_integral<std::decay_t<Range>>::value>
+struct parallel_range {
+    typedef decltype(std::begin(std::declval<Range &>())) iterator ;
+
+    PCOMN_STATIC_CHECK(std::is_base_of<std::random_access_iterator_tag,
+                       typename std::iterator_traits<iterator>::iterator_category>::value) ;
+
+    explicit parallel_range(Range &r) :
+        _begin(std::begin(r)),
+        _size(std::distance(_begin, std::end(r)))
+    {}
+
+    iterator begin() const { return _begin ; }
+    size_t size() const { return _size ; }
+
+private:
+    iterator     _begin ;
+    const size_t _size ;
+} ;
+
+template<typename Range>
+struct parallel_range<Range, true> {
+    typedef std::decay_t<Range>      index_type ;
+    typedef count_iterator<index_type> iterator ;
+
+    explicit parallel_range(Range count) :
+        _size(count > 0 ? (size_t)count : 0)
+    {}
+
+    iterator begin() const { return iterator() ; }
+    size_t size() const { return _size ; }
+
+private:
+    const size_t _size ;
+} ;
+
+template<typename Range>
+inline parallel_range<Range> make_parallel_range(Range &r) { return parallel_range<Range>(r) ; }
+
+/// Get the count of workers (incl. the calling thread) for the loop of `size` items.
+inline unsigned parallel_workers_count(size_t size, size_t grain, size_t max_workers)
+{
+    const size_t g = std::max<size_t>(grain, 1) ;
+    return std::max<size_t>(std::min(max_workers, (size + g - 1)/g), 1) ;
+}
+
+/// Run `body(from, to, worker)` over [0,size) on a one-off job_batch.
+template<typename Body>
+void parallel_execute(size_t size, size_t grain, unsigned workers, Body &body)
+{
+    parallel_chunker chunker (size, grain, workers) ;
+
+    if (workers <= 1)
+    {
+        chunker.run(body, 0) ;
+        chunker.wait() ;
+        return ;
+    }
+
+    job_batch batch (workers - 1) ;
+    for (unsigned worker = 1 ; worker < workers ; ++worker)
+        batch.add_job([&chunker, &body, worker] { chunker.run(body, worker) ; }) ;
+
+    batch.run() ;
+    chunker.run(body, 0) ;
+    batch.wait() ;
+
+    chunker.wait() ;
+}
+
+/// Run `body(from, to, worker)` over [0,size) on a threadpool.
+///
+/// Helper jobs may start after the loop is finished (e.g. when all the pool workers
+/// are busy, the calling thread does all the work), so the chunker is shared with them
+/// and `body` is never touched once all the chunks are claimed.
+///
+/// Helpers are enqueued without blocking: nested loops run on pool workers, and if
+/// all of them were blocked on the full task queue no one would drain it.
+template<typename Body>
+void parallel_execute(threadpool &pool, size_t size, size_t grain, unsigned workers, Body &body)
+{
+    const auto chunker = std::make_shared<parallel_chunker>(size, grain, workers) ;
+
+    for (unsigned worker = 1 ; worker < workers ; ++worker)
+        try {
+            if (!pool.try_enqueue_job([chunker, &body, worker] { chunker->run(body, worker) ; }))
+                break ;
+        }
+        // The pool is stopped, run the rest on the calling thread.
+        catch (const sequence_closed &) { break ; }
+
+    chunker->run(body, 0) ;
+    chunker->wait() ;
+}
+
+template<typename Range, typename F>
+struct parallel_for_body {
+    typename parallel_range<Range>::iterator _begin ;
+    F &_fn ;
+
+    void operator()(size_t from, size_t to, unsigned) const
+    {
+        for (auto i = _begin + from, e = _begin + to ; i != e ; ++i)
+            _fn(*i) ;
+    }
+} ;
+
+/// Per-worker accumulation of partial results; partials are tagged with the chunk
+/// start, so that the final combination preserves the range order and `combine` needs
+/// only to be associative.
+template<typename Range, typename T, typename Map, typename Combine>
+struct parallel_reduce_body {
+    typedef std::vector<std::pair<size_t, T>> partials ;
+
+    typename parallel_range<Range>::iterator _begin ;
+    Map &                   _map ;
+    Combine &               _combine ;
+    std::vector<partials> & _partials ;
+
+    void operator()(size_t from, size_t to, unsigned worker)
+    {
+        auto i = _begin + from ;
+        const auto e = _begin + to ;
+
+        T result (_map(*i)) ;
+        while (++i != e)
+            result = _combine(std::move(result), _map(*i)) ;
+
+        _partials[worker].emplace_back(from, std::move(result)) ;
+    }
+
+    T finish(T init)
+    {
+        partials all ;
+        for (partials &p: _partials)
+            std::move(p.begin(), p.end(), std::back_inserter(all)) ;
+
+        std::sort(all.begin(), all.end(), [](const auto &x, const auto &y) { return x.first < y.first ; }) ;
+
+        for (auto &p: all)
+            init = _combine(std::move(init), std::move(p.second)) ;
+        return init ;
+    }
+} ;
+
+} // end of namespace pcomn::detail
+
+/*******************************************************************************
+ parallel_for
+*******************************************************************************/
+/// Call `fn(item)` for every item of `range` in parallel, on a one-off job_batch with
+/// at most sys::hw_threads_count() threads.
+///
+/// @param range A random-access sequence or an integral count N (then `fn` is called
+///   for indices 0..N-1).
+/// @param grain The minimal count of items processed by a worker at once; 0 is
+///   equivalent to 1.
+/// @param fn The loop body; if it throws, the loop is cancelled as soon as possible
+///   and the (first) exception is rethrown from parallel_for.
+///
+template<typename Range, typename F>
+void parallel_for(Range &&range, size_t grain, F &&fn)
+{
+    const auto r (detail::make_parallel_range(range)) ;
+    detail::parallel_for_body<Range, F> body {r.begin(), fn} ;
+
+    detail::parallel_execute(r.size(), grain,
+                             detail::parallel_workers_count(r.size(), grain, sys::hw_threads_count()),
+                             body) ;
+}
+
+/// Call `fn(item)` for every item of `range` in parallel, on the specified threadpool.
+/// The calling thread participates in the loop.
+///
+template<typename Range, typename F>
+void parallel_for(threadpool &pool, Range &&range, size_t grain, F &&fn)
+{
+    const auto r (detail::make_parallel_range(range)) ;
+    detail::parallel_for_body<Range, F> body {r.begin(), fn} ;
+
+    detail::parallel_execute(pool, r.size(), grain,
+                             detail::parallel_workers_count(r.size(), grain, pool.size() + 1),
+                             body) ;
+}
+
+/*******************************************************************************
+ parallel_reduce
+*******************************************************************************/
+/// Compute `combine(...combine(combine(init, map(item0)), map(item1))..., map(itemN))`
+/// in parallel, on a one-off job_batch with at most sys::hw_threads_count() threads.
+///
+/// The result of `map(item)` must be convertible to T, `combine(T, T)` must return
+/// a value convertible to T.
+/// `combine` must be associative, but needn't be commutative: partial results are
+/// combined in the range order. `init` is used exactly once, so it needn't be
+/// the identity element of `combine`.
+///
+template<typename Range, typename T, typename Map, typename Combine>
+T parallel_reduce(Range &&range, T init, Map &&map, Combine &&combine, size_t grain)
+{
+    const auto r (detail::make_parallel_range(range)) ;
+    const unsigned workers = detail::parallel_workers_count(r.size(), grain, sys::hw_threads_count()) ;
+
+    std::vector<typename detail::parallel_reduce_body<Range, T, Map, Combine>::partials> partials (workers) ;
+    detail::parallel_reduce_body<Range, T, Map, Combine> body {r.begin(), map, combine, partials} ;
+
+    detail::parallel_execute(r.size(), grain, workers, body) ;
+
+    return body.finish(std::move(init)) ;
+}
+
+/// Parallel reduce on the specified threadpool.
+/// The calling thread participates in the loop.
+///
+template<typename Range, typename T, typename Map, typename Combine>
+T parallel_reduce(threadpool &pool, Range &&range, T init, Map &&map, Combine &&combine, size_t grain)
+{
+    const auto r (detail::make_parallel_range(range)) ;
+    const unsigned workers = detail::parallel_workers_count(r.size(), grain, pool.size() + 1) ;
+
+    std::vector<typename detail::parallel_reduce_body<Range, T, Map, Combine>::partials> partials (workers) ;
+    detail::parallel_reduce_body<Range, T, Map, Combine> body {r.begin(), map, combine, partials} ;
+
+    detail::parallel_execute(pool, r.size(), grain, workers, body) ;
+
+    return body.finish(std::move(init)) ;
+}
+
+} // end of namespace pcomn
+
+#endif /* __PCOMN_PARALLEL_H */
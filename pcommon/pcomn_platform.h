@@ -429,6 +429,9 @@
 #     ifdef __AVX2__
 #        define PCOMN_PL_SIMD_AVX2  1
 #     endif
+#     if defined(__AVX512F__) && defined(__AVX512VPOPCNTDQ__)
+#        define PCOMN_PL_SIMD_AVX512 1
+#     endif
 #     ifdef __BMI1__
 #        define PCOMN_PL_BMI1       1
 #     endif
@@ -675,6 +678,18 @@
 #endif
 #endif
 
+/***************************************************************************//**
+ @def PCOMN_PREFETCH(address)
+ Hint the processor to fetch the cache line containing @a address for reading.
+
+ Never faults, even for invalid addresses.
+*******************************************************************************/
+#ifdef PCOMN_COMPILER_GNU
+#  define PCOMN_PREFETCH(address) (__builtin_prefetch((address), 0, 3))
+#else
+#  define PCOMN_PREFETCH(address) ((void)(address))
+#endif
+
 /***************************************************************************//**
  @def PCOMN_ALIGNED(alignment)
 
@@ -18,6 +18,7 @@
 #include <pcomn_atomic.h>
 #include <pcomn_hashclosed.h>
 #include <pcomn_incdlist.h>
+#include <pcomn_eviction.h>
 #include <pcomn_calgorithm.h>
 
 #include <algorithm>
@@ -27,10 +28,15 @@
 namespace pcomn {
 
 /******************************************************************************/
-/** Keyed pool with LRU eviction
+/** Keyed pool with pluggable eviction, LRU by default.
+
+ For a pool, an access to a key is a checkout; with a frequency-based policy
+ (wtinylfu_eviction), the items of frequently checked out keys are retained when
+ the pool is flooded by checkins of one-off keys.
 *******************************************************************************/
 template<typename Key, typename Value,
-         typename Hash = pcomn::hash_fn<Key>, typename Pred = std::equal_to<Key> >
+         typename Hash = pcomn::hash_fn<Key>, typename Pred = std::equal_to<Key>,
+         typename Eviction = lru_eviction>
 class keyed_pool {
    public:
       typedef Key          key_type ;
@@ -38,6 +44,7 @@ class keyed_pool {
       typedef value_type   mapped_type ;
       typedef Hash         hasher ;
       typedef Pred         key_equal ;
+      typedef Eviction     eviction_policy ;
 
       /// Create a keyed pool with specified size limit, hasher, and key equality
       /// predicate
@@ -49,7 +56,9 @@ class keyed_pool {
          _size_limit(szlimit),
          _emptykey_count(0),
          _data({}, hf, keq)
-      {}
+      {
+         _eviction.set_capacity(szlimit) ;
+      }
 
       ~keyed_pool() { clear() ; }
 
@@ -125,7 +134,7 @@ class keyed_pool {
 
    private:
       /*************************************************************************
-       Value entry: a node of an LRU list containing data_type item
+       Value entry: a node of an eviction queue containing data_type item
       *************************************************************************/
       struct value_entry {
             value_entry() : _value() {}
@@ -135,7 +144,7 @@ class keyed_pool {
             value_type &value() { return _value ; }
 
             mutable incdlist_node   _entry_node ;
-            mutable incdlist_node   _lru_node ;
+            mutable eviction_hook   _evict ;
          private:
             value_type _value ;
 
@@ -163,7 +172,7 @@ class keyed_pool {
             PCOMN_NONASSIGNABLE(key_entry) ;
       } ;
 
-      typedef incdlist<value_entry, &value_entry::_lru_node> lru_list ;
+      typedef typename eviction_policy::template queue<value_entry, &value_entry::_evict> eviction_queue ;
 
       typedef closed_hashtable<key_entry *, extract_key<>, hasher, key_equal> pool_data ;
       typedef std::recursive_mutex lock_type ;
@@ -175,8 +184,8 @@ class keyed_pool {
                                        * the pool starts evicting entries */
       size_t            _emptykey_count ;
 
-      lru_list    _lru ;
-      pool_data   _data ;
+      eviction_queue _eviction ;
+      pool_data      _data ;
 
       enum Locking { UNLOCKED, LOCKED } ;
 
@@ -193,33 +202,50 @@ class keyed_pool {
 
       key_entry *provide_entry(const key_type &key, std::unique_ptr<key_entry> &guard) ;
       void save_entry(key_entry *entry, value_entry *data, std::unique_ptr<key_entry> &guard) ;
+
+      // Remove all the items of the key entry from the eviction queue
+      void unlink_items(key_entry *entry)
+      {
+         for (value_entry &item: entry->items())
+            _eviction.erase(item) ;
+      }
+
+      // The hash for the eviction policy; computed only if the policy needs it
+      uint32_t key_hash(const key_type &key) const
+      {
+         if constexpr (eviction_policy::uses_frequency)
+            return wang_hash64to32(_data.hash_function()(key)) ;
+         else
+            return 0 ;
+      }
 } ;
 
 /*******************************************************************************
  keyed_pool
 *******************************************************************************/
-template<typename K, typename V, typename H, typename P>
-size_t keyed_pool<K, V, H, P>::clear()
+template<typename K, typename V, typename H, typename P, typename E>
+size_t keyed_pool<K, V, H, P, E>::clear()
 {
    PCOMN_SCOPE_LOCK (pool_guard, _lock) ;
    if (_data.empty())
       return 0 ;
    const size_t oldsize = _size ;
+   _eviction.clear() ;
    // The hashtable of pointers won't itself delete objects those pointers point to
    clear_icontainer(_data) ;
-   NOXCHECK(_lru.empty()) ;
    _size = 0 ;
    _emptykey_count = 0 ;
    swap_clear(_data) ;
    return oldsize ;
 }
 
-template<typename K, typename V, typename H, typename P>
-inline void keyed_pool<K, V, H, P>::checkout_from_entry(key_entry *entry, value_type &result)
+template<typename K, typename V, typename H, typename P, typename E>
+inline void keyed_pool<K, V, H, P, E>::checkout_from_entry(key_entry *entry, value_type &result)
 {
    NOXCHECK(entry) ;
    NOXCHECK(!entry->items().empty()) ;
 
+   _eviction.erase(entry->items().front()) ;
    pcomn_swap(entry->items().front().value(), result) ;
    if (!entry->items().front()._entry_node.is_only())
       entry->items().pop_front() ;
@@ -234,11 +260,14 @@ inline void keyed_pool<K, V, H, P>::checkout_from_entry(key_entry *entry, value_
    --_size ;
 }
 
-template<typename K, typename V, typename H, typename P>
-bool keyed_pool<K, V, H, P>::checkout_unlocked(const key_type &key, value_type &found_item)
+template<typename K, typename V, typename H, typename P, typename E>
+bool keyed_pool<K, V, H, P, E>::checkout_unlocked(const key_type &key, value_type &found_item)
 {
    const typename pool_data::iterator entry (_data.find(key)) ;
 
+   // Every checkout attempt is an access to the key
+   _eviction.record(key_hash(key)) ;
+
    if (entry == _data.end() || (*entry)->items().empty())
       return false ;
 
@@ -246,9 +275,9 @@ bool keyed_pool<K, V, H, P>::checkout_unlocked(const key_type &key, value_type &
    return true ;
 }
 
-template<typename K, typename V, typename H, typename P>
-inline typename keyed_pool<K, V, H, P>::key_entry *
-keyed_pool<K, V, H, P>::provide_entry(const key_type &key, std::unique_ptr<key_entry> &guard)
+template<typename K, typename V, typename H, typename P, typename E>
+inline typename keyed_pool<K, V, H, P, E>::key_entry *
+keyed_pool<K, V, H, P, E>::provide_entry(const key_type &key, std::unique_ptr<key_entry> &guard)
 {
    const typename pool_data::iterator ientry (_data.find(key)) ;
    key_entry *result ;
@@ -260,13 +289,13 @@ keyed_pool<K, V, H, P>::provide_entry(const key_type &key, std::unique_ptr<key_e
    return result ;
 }
 
-template<typename K, typename V, typename H, typename P>
-inline void keyed_pool<K, V, H, P>::save_entry(key_entry *entry, value_entry *data, std::unique_ptr<key_entry> &guard)
+template<typename K, typename V, typename H, typename P, typename E>
+inline void keyed_pool<K, V, H, P, E>::save_entry(key_entry *entry, value_entry *data, std::unique_ptr<key_entry> &guard)
 {
    NOXCHECK(entry && data && (!guard || guard.get() == entry)) ;
 
    entry->items().push_front(*data) ;
-   _lru.push_back(*data) ;
+   _eviction.insert(*data, key_hash(entry->key())) ;
 
    if (guard)
    {
@@ -277,8 +306,8 @@ inline void keyed_pool<K, V, H, P>::save_entry(key_entry *entry, value_entry *da
    ++_size ;
 }
 
-template<typename K, typename V, typename H, typename P>
-void keyed_pool<K, V, H, P>::put_unlocked(const key_type &key, const value_type &item)
+template<typename K, typename V, typename H, typename P, typename E>
+void keyed_pool<K, V, H, P, E>::put_unlocked(const key_type &key, const value_type &item)
 {
    cleanup(UNLOCKED) ;
    if (_size >= _size_limit)
@@ -293,8 +322,8 @@ void keyed_pool<K, V, H, P>::put_unlocked(const key_type &key, const value_type
    save_entry(entry, data, entry_guard) ;
 }
 
-template<typename K, typename V, typename H, typename P>
-void keyed_pool<K, V, H, P>::checkin_unlocked(const key_type &key, value_type &item)
+template<typename K, typename V, typename H, typename P, typename E>
+void keyed_pool<K, V, H, P, E>::checkin_unlocked(const key_type &key, value_type &item)
 {
    cleanup(UNLOCKED) ;
    if (_size >= _size_limit)
@@ -312,8 +341,8 @@ void keyed_pool<K, V, H, P>::checkin_unlocked(const key_type &key, value_type &i
    save_entry(entry, data.release(), entry_guard) ;
 }
 
-template<typename K, typename V, typename H, typename P>
-size_t keyed_pool<K, V, H, P>::erase(const key_type &key)
+template<typename K, typename V, typename H, typename P, typename E>
+size_t keyed_pool<K, V, H, P, E>::erase(const key_type &key)
 {
    PCOMN_SCOPE_LOCK (pool_guard, _lock) ;
    key_entry *erased = NULL ;
@@ -323,22 +352,24 @@ size_t keyed_pool<K, V, H, P>::erase(const key_type &key)
    NOXCHECK(erased) ;
    const size_t erased_count = erased->items().size() ;
    NOXCHECK(erased_count && erased_count <= _size) ;
+   unlink_items(erased) ;
    delete erased ;
    _size -= erased_count ;
    return erased_count ;
 }
 
-template<typename K, typename V, typename H, typename P>
-size_t keyed_pool<K, V, H, P>::set_size_limit(size_t limit)
+template<typename K, typename V, typename H, typename P, typename E>
+size_t keyed_pool<K, V, H, P, E>::set_size_limit(size_t limit)
 {
    PCOMN_SCOPE_LOCK (pool_guard, _lock) ;
    _size_limit = limit ;
+   _eviction.set_capacity(limit) ;
    cleanup(UNLOCKED) ;
    return size() ;
 }
 
-template<typename K, typename V, typename H, typename P>
-void keyed_pool<K, V, H, P>::retrieve_keys(std::vector<std::pair<key_type, size_t> > &result) const
+template<typename K, typename V, typename H, typename P, typename E>
+void keyed_pool<K, V, H, P, E>::retrieve_keys(std::vector<std::pair<key_type, size_t> > &result) const
 {
    swap_clear(result) ;
 
@@ -348,8 +379,8 @@ void keyed_pool<K, V, H, P>::retrieve_keys(std::vector<std::pair<key_type, size_
       result.push_back(std::pair<key_type, size_t>((*i)->key(), (*i)->items().size())) ;
 }
 
-template<typename K, typename V, typename H, typename P>
-void keyed_pool<K, V, H, P>::cleanup_emptykeys()
+template<typename K, typename V, typename H, typename P, typename E>
+void keyed_pool<K, V, H, P, E>::cleanup_emptykeys()
 {
    if (_emptykey_count <= _data.size()/2)
       return ;
@@ -366,8 +397,8 @@ void keyed_pool<K, V, H, P>::cleanup_emptykeys()
    _emptykey_count = 0 ;
 }
 
-template<typename K, typename V, typename H, typename P>
-void keyed_pool<K, V, H, P>::cleanup(Locking locking)
+template<typename K, typename V, typename H, typename P, typename E>
+void keyed_pool<K, V, H, P, E>::cleanup(Locking locking)
 {
    // Move all stale pool items into a local list and destroy them out of the lock scope,
    // in order to not to hold a lock during items destruction. This can be important if
@@ -383,13 +414,17 @@ void keyed_pool<K, V, H, P>::cleanup(Locking locking)
       return ;
    }
    item_list erasable ;
-   for (const size_t final = _size_limit - midval<size_t>(1, _size_limit, _size_limit/4) ; _size > final ; --_size)
+   const size_t final = eviction_policy::batch_eviction
+      ? _size_limit - midval<size_t>(1, _size_limit, _size_limit/4)
+      : _size_limit - !!_size_limit ;
+
+   for (; _size > final ; --_size)
    {
-      value_entry &entry = _lru.front() ;
+      value_entry &entry = *_eviction.victim() ;
       if (entry._entry_node.is_only())
          ++_emptykey_count ;
+      _eviction.erase(entry) ;
       erasable.push_back(entry) ;
-      _lru.remove(entry) ;
    }
 
    if (locking)
@@ -0,0 +1,148 @@
+/*-*- tab-width: 3; indent-tabs-mode: nil; c-file-style: "ellemtel"; c-file-offsets:((innamespace . 0)) -*-*/
+/*******************************************************************************
+ FILE         :   pcomn_strscan.cpp
+ COPYRIGHT    :   Yakov Markovitch, 2026. All rights reserved.
+                  See LICENSE for information on usage/redistribution.
+
+ DESCRIPTION  :   Generic byte set scan kernels and the runtime selection of
+                  ISA-specific kernels.
+
+ PROGRAMMED BY:   Yakov Markovitch
+ CREATION DATE:   16 Oct 2026
+*******************************************************************************/
+#include <pcomn_strscan.h>
+#include <pcomn_isakernels.h>
+
+#if defined(PCOMN_PL_X86) && defined(PCOMN_COMPILER_GNU)
+#  define PCOMN_STRSCAN_X86 1
+#endif
+
+namespace pcomn {
+namespace strscan {
+
+/*******************************************************************************
+ Generic kernels: the ISA the library is compiled for
+*******************************************************************************/
+namespace {
+inline bool in_set(const uint8_t *set, char c)
+{
+   const uint8_t b = c ;
+   return set[(b & 15) | (b >> 3 & 16)] >> (b >> 4 & 7) & 1 ;
+}
+
+const char *generic_find_first_of(const char *begin, const char *end, const uint8_t *set)
+{
+   while (begin != end && !in_set(set, *begin))
+      ++begin ;
+   return begin ;
+}
+
+const char *generic_find_first_not_of(const char *begin, const char *end, const uint8_t *set)
+{
+   while (begin != end && in_set(set, *begin))
+      ++begin ;
+   return begin ;
+}
+
+const char *generic_rfind_first_of(const char *begin, const char *end, const uint8_t *set)
+{
+   while (end != begin && !in_set(set, end[-1]))
+      --end ;
+   return end ;
+}
+
+const char *generic_rfind_first_not_of(const char *begin, const char *end, const uint8_t *set)
+{
+   while (end != begin && in_set(set, end[-1]))
+      --end ;
+   return end ;
+}
+
+size_t generic_find_all_of(const char *begin, const char *end, const uint8_t *set,
+                           const char **found, size_t maxcount)
+{
+   size_t count = 0 ;
+   for (; begin != end && count < maxcount ; ++begin)
+      if (in_set(set, *begin))
+         found[count++] = begin ;
+   return count ;
+}
+} // end of anonymous namespace
+
+/*******************************************************************************
+ Kernel tables
+*******************************************************************************/
+namespace detail {
+
+std::atomic<const scan_kernels *> selected_scan_kernels {nullptr} ;
+
+static const scan_kernels generic_scan_kernels = {
+   kernel_isa::generic, "generic",
+   generic_find_first_of,
+   generic_find_first_not_of,
+   generic_rfind_first_of,
+   generic_rfind_first_not_of,
+   generic_find_all_of
+} ;
+
+#ifdef PCOMN_STRSCAN_X86
+// Defined in pcomn_strscan_sse42.cpp and pcomn_strscan_avx2.cpp, which are compiled
+// with the appropriate -m options
+extern const scan_kernels sse42_scan_kernels ;
+extern const scan_kernels avx2_scan_kernels ;
+#endif
+
+static const scan_kernels * const kernel_tables[kernel_isa_count] = {
+   &generic_scan_kernels,
+#ifdef PCOMN_STRSCAN_X86
+   &sse42_scan_kernels,
+   &avx2_scan_kernels
+#endif
+} ;
+
+const scan_kernels &select_scan_kernels()
+{
+   return pcomn::detail::select_isa_kernels(selected_scan_kernels, kernel_tables, is_kernel_isa_supported,
+                                            "PCOMN_STRSCAN_ISA") ;
+}
+
+} // end of namespace pcomn::strscan::detail
+
+/*******************************************************************************
+ Kernel selection
+*******************************************************************************/
+bool is_kernel_isa_supported(kernel_isa isa)
+{
+   switch (isa)
+   {
+      case kernel_isa::generic:
+         return true ;
+
+#ifdef PCOMN_STRSCAN_X86
+      case kernel_isa::sse42:
+         __builtin_cpu_init() ;
+         return __builtin_cpu_supports("sse4.2") ;
+
+      case kernel_isa::avx2:
+         __builtin_cpu_init() ;
+         return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("bmi") ;
+#endif
+
+      default: break ;
+   }
+   return false ;
+}
+
+const scan_kernels &get_scan_kernels(kernel_isa isa)
+{
+   return pcomn::detail::get_isa_kernels(detail::kernel_tables, is_kernel_isa_supported, isa, "String scan kernels") ;
+}
+
+kernel_isa set_scan_kernels(kernel_isa isa)
+{
+   return pcomn::detail::replace_isa_kernels(detail::selected_scan_kernels, get_scan_kernels(isa),
+                                             detail::select_scan_kernels) ;
+}
+
+} // end of namespace pcomn::strscan
+} // end of namespace pcomn
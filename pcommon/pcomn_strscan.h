@@ -0,0 +1,187 @@
+/*-*- mode:c++;tab-width:3;indent-tabs-mode:nil;c-file-style:"ellemtel";c-file-offsets:((innamespace . 0)(inclass . ++)) -*-*/
+#ifndef __PCOMN_STRSCAN_H
+#define __PCOMN_STRSCAN_H
+/*******************************************************************************
+ FILE         :   pcomn_strscan.h
+ COPYRIGHT    :   Yakov Markovitch, 2026. All rights reserved.
+                  See LICENSE for information on usage/redistribution.
+
+ DESCRIPTION  :   Byte set membership scans with the implementation selected at
+                  runtime by the CPU the code is executing on.
+
+ CREATION DATE:   16 Oct 2026
+*******************************************************************************/
+/** @file
+ Scanning byte strings for bytes that are (not) in a set: find_first_of,
+ find_first_not_of, their reverse counterparts, and the search for all the positions
+ of set bytes (used for splitting).
+
+ The set of bytes is represented by pcomn::byteset, which is a pair of 16-byte tables
+ indexed by the low nibble of a byte, with a bit for every high nibble. So the vector
+ kernels check membership of 16 (32) bytes at once with two PSHUFB table lookups,
+ for arbitrary sets of bytes.
+
+ Like bitop::bulk() (see pcomn_bitkernels.h), the most advanced kernel variant the
+ executing CPU supports is selected on the first call to strscan::kernels(); the
+ selection can be overriden with PCOMN_STRSCAN_ISA environment variable (generic,
+ sse42, avx2), or by strscan::set_scan_kernels().
+*******************************************************************************/
+#include <pcomn_platform.h>
+
+#include <atomic>
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+namespace pcomn {
+
+/******************************************************************************/
+/** A set of bytes (chars).
+
+ Byte c is in the set iff bit (c >> 4 & 7) of table()[(c & 15) + (c & 0x80 ? 16 : 0)]
+ is set.
+*******************************************************************************/
+class byteset {
+   public:
+      /// Create an empty set.
+      constexpr byteset() = default ;
+
+      /// Create the set of bytes in [begin, end).
+      byteset(const char *begin, const char *end)
+      {
+         while (begin != end)
+            add(*begin++) ;
+      }
+
+      /// Create the set of bytes in a null-terminated string.
+      explicit byteset(const char *chars) : byteset(chars, chars + strlen(chars)) {}
+
+      byteset &add(char c)
+      {
+         _table[index(c)] |= bit(c) ;
+         return *this ;
+      }
+
+      bool test(char c) const { return !!(_table[index(c)] & bit(c)) ; }
+
+      bool empty() const
+      {
+         uint8_t any = 0 ;
+         for (uint8_t t: _table)
+            any |= t ;
+         return !any ;
+      }
+
+      /// Get the membership table for the scan kernels.
+      const uint8_t *table() const { return _table ; }
+
+   private:
+      alignas(32) uint8_t _table[32] = {} ;
+
+      static unsigned index(char c) { return ((uint8_t)c & 15) | ((uint8_t)c >> 3 & 16) ; }
+      static uint8_t bit(char c) { return 1U << ((uint8_t)c >> 4 & 7) ; }
+} ;
+
+namespace strscan {
+
+/// Instruction set variants of the scan kernels, from the least to the most advanced.
+enum class kernel_isa : unsigned {
+   generic, /**< The ISA the library is compiled for (scalar) */
+   sse42,   /**< SSE4.2 (16-byte PSHUFB lookups) */
+   avx2     /**< AVX2, BMI1 (32-byte PSHUFB lookups) */
+} ;
+
+/// The count of kernel_isa values.
+constexpr unsigned kernel_isa_count = (unsigned)kernel_isa::avx2 + 1 ;
+
+/******************************************************************************/
+/** The table of scan kernels for a single ISA variant.
+
+ @a set is byteset::table().
+*******************************************************************************/
+struct scan_kernels {
+      typedef const char *(*find_kernel)(const char *begin, const char *end, const uint8_t *set) ;
+
+      kernel_isa isa ;
+      const char *name ;
+
+      /// Find the first byte in [begin, end) that is in the set; end if none.
+      find_kernel find_first_of ;
+      /// Find the first byte in [begin, end) that is not in the set; end if none.
+      find_kernel find_first_not_of ;
+
+      /// Find the last byte in [begin, end) that is in the set.
+      /// @return The pointer @em past the found byte (like reverse_iterator::base()),
+      /// begin if none.
+      find_kernel rfind_first_of ;
+      /// Find the last byte in [begin, end) that is not in the set.
+      /// @return The pointer @em past the found byte, begin if none.
+      find_kernel rfind_first_not_of ;
+
+      /// Find up to @a maxcount bytes in [begin, end) that are in the set, put pointers
+      /// to them into @a found in ascending order.
+      /// @return The count of found bytes.
+      size_t (*find_all_of)(const char *begin, const char *end, const uint8_t *set,
+                            const char **found, size_t maxcount) ;
+} ;
+
+/// Check if the executing CPU supports the specified kernel variant.
+/// kernel_isa::generic is always supported.
+bool is_kernel_isa_supported(kernel_isa isa) ;
+
+/// Get the table of kernels for the specified ISA.
+/// @throw std::invalid_argument The ISA is not supported by the executing CPU.
+const scan_kernels &get_scan_kernels(kernel_isa isa) ;
+
+/// Select the kernels used by kernels().
+/// @return The previously selected ISA.
+/// @throw std::invalid_argument The ISA is not supported by the executing CPU.
+kernel_isa set_scan_kernels(kernel_isa isa) ;
+
+namespace detail {
+extern std::atomic<const scan_kernels *> selected_scan_kernels ;
+
+const scan_kernels &select_scan_kernels() ;
+} // end of namespace pcomn::strscan::detail
+
+/// Get the currently selected scan kernels.
+inline const scan_kernels &kernels()
+{
+   const scan_kernels * const selected = detail::selected_scan_kernels.load(std::memory_order_acquire) ;
+   return likely(selected) ? *selected : detail::select_scan_kernels() ;
+}
+
+/*******************************************************************************
+ Scans with the selected kernels
+*******************************************************************************/
+inline const char *find_first_of(const char *begin, const char *end, const byteset &set)
+{
+   return kernels().find_first_of(begin, end, set.table()) ;
+}
+
+inline const char *find_first_not_of(const char *begin, const char *end, const byteset &set)
+{
+   return kernels().find_first_not_of(begin, end, set.table()) ;
+}
+
+inline const char *rfind_first_of(const char *begin, const char *end, const byteset &set)
+{
+   return kernels().rfind_first_of(begin, end, set.table()) ;
+}
+
+inline const char *rfind_first_not_of(const char *begin, const char *end, const byteset &set)
+{
+   return kernels().rfind_first_not_of(begin, end, set.table()) ;
+}
+
+inline size_t find_all_of(const char *begin, const char *end, const byteset &set,
+                          const char **found, size_t maxcount)
+{
+   return kernels().find_all_of(begin, end, set.table(), found, maxcount) ;
+}
+
+} // end of namespace pcomn::strscan
+} // end of namespace pcomn
+
+#endif /* __PCOMN_STRSCAN_H */
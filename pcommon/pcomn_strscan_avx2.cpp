@@ -0,0 +1,187 @@
+/*-*- tab-width: 3; indent-tabs-mode: nil; c-file-style: "ellemtel"; c-file-offsets:((innamespace . 0)) -*-*/
+/*******************************************************************************
+ FILE         :   pcomn_strscan_avx2.cpp
+ COPYRIGHT    :   Yakov Markovitch, 2026. All rights reserved.
+                  See LICENSE for information on usage/redistribution.
+
+ DESCRIPTION  :   AVX2 byte set scan kernels.
+                  Must be compiled with -mavx2 -mbmi regardless of the ISA the rest of
+                  the library is compiled for; called only if the CPU supports AVX2 (see
+                  pcomn_strscan.cpp).
+
+ PROGRAMMED BY:   Yakov Markovitch
+ CREATION DATE:   16 Oct 2026
+*******************************************************************************/
+#include <pcomn_strscan.h>
+
+#if defined(PCOMN_PL_X86) && defined(PCOMN_COMPILER_GNU)
+
+#ifndef PCOMN_PL_SIMD_AVX2
+#error pcomn_strscan_avx2.cpp must be compiled for AVX2 instruction set.
+#endif
+
+#include <immintrin.h>
+
+namespace pcomn {
+namespace strscan {
+
+namespace {
+inline bool in_set(const uint8_t *set, char c)
+{
+   const uint8_t b = c ;
+   return set[(b & 15) | (b >> 3 & 16)] >> (b >> 4 & 7) & 1 ;
+}
+
+/*******************************************************************************
+ Membership of 32 bytes at once (see pcomn_strscan_sse42.cpp), PSHUFB works inside
+ 128-bit lanes, so the tables are broadcast to both lanes. The tail of 16..31 bytes
+ is checked with 128-bit vectors.
+*******************************************************************************/
+struct membership {
+      explicit membership(const uint8_t *set) :
+         _table0(_mm256_broadcastsi128_si256(_mm_load_si128((const __m128i *)set))),
+         _table1(_mm256_broadcastsi128_si256(_mm_load_si128((const __m128i *)set + 1))),
+         _bitpos(_mm256_setr_epi8(1, 2, 4, 8, 16, 32, 64, (char)128, 1, 2, 4, 8, 16, 32, 64, (char)128,
+                                  1, 2, 4, 8, 16, 32, 64, (char)128, 1, 2, 4, 8, 16, 32, 64, (char)128)),
+         _nibble(_mm256_set1_epi8(0x0f))
+      {}
+
+      // Get 32 bits, one for every byte in the set
+      unsigned operator()(const char *p) const
+      {
+         const __m256i v = _mm256_loadu_si256((const __m256i *)p) ;
+         const __m256i lo = _mm256_and_si256(v, _nibble) ;
+         const __m256i hi = _mm256_and_si256(_mm256_srli_epi16(v, 4), _nibble) ;
+         const __m256i row = _mm256_blendv_epi8(_mm256_shuffle_epi8(_table0, lo),
+                                                _mm256_shuffle_epi8(_table1, lo), v) ;
+         const __m256i bit = _mm256_shuffle_epi8(_bitpos, hi) ;
+         return _mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_and_si256(row, bit), bit)) ;
+      }
+
+      // Get 16 bits, one for every byte in the set
+      unsigned half(const char *p) const
+      {
+         const __m128i v = _mm_loadu_si128((const __m128i *)p) ;
+         const __m128i nibble = _mm256_castsi256_si128(_nibble) ;
+         const __m128i lo = _mm_and_si128(v, nibble) ;
+         const __m128i hi = _mm_and_si128(_mm_srli_epi16(v, 4), nibble) ;
+         const __m128i row = _mm_blendv_epi8(_mm_shuffle_epi8(_mm256_castsi256_si128(_table0), lo),
+                                             _mm_shuffle_epi8(_mm256_castsi256_si128(_table1), lo), v) ;
+         const __m128i bitpos = _mm256_castsi256_si128(_bitpos) ;
+         const __m128i bit = _mm_shuffle_epi8(bitpos, hi) ;
+         return _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(row, bit), bit)) ;
+      }
+
+   private:
+      const __m256i _table0 ;
+      const __m256i _table1 ;
+      const __m256i _bitpos ;
+      const __m256i _nibble ;
+} ;
+
+template<bool of>
+inline const char *find_first(const char *begin, const char *end, const uint8_t *set)
+{
+   const membership member (set) ;
+   for (; end - begin >= 32 ; begin += 32)
+      if (const unsigned found = of ? member(begin) : ~member(begin))
+         return begin + _tzcnt_u32(found) ;
+
+   if (end - begin >= 16)
+   {
+      if (const unsigned found = of ? member.half(begin) : ~member.half(begin) & 0xffff)
+         return begin + _tzcnt_u32(found) ;
+      begin += 16 ;
+   }
+
+   while (begin != end && in_set(set, *begin) != of)
+      ++begin ;
+   return begin ;
+}
+
+template<bool of>
+inline const char *rfind_first(const char *begin, const char *end, const uint8_t *set)
+{
+   const membership member (set) ;
+   for (; end - begin >= 32 ; end -= 32)
+      if (const unsigned found = of ? member(end - 32) : ~member(end - 32))
+         return end - __builtin_clz(found) ;
+
+   if (end - begin >= 16)
+   {
+      if (const unsigned found = of ? member.half(end - 16) : ~member.half(end - 16) & 0xffff)
+         return end - 16 + (32 - __builtin_clz(found)) ;
+      end -= 16 ;
+   }
+
+   while (end != begin && in_set(set, end[-1]) != of)
+      --end ;
+   return end ;
+}
+
+const char *avx2_find_first_of(const char *begin, const char *end, const uint8_t *set)
+{
+   return find_first<true>(begin, end, set) ;
+}
+
+const char *avx2_find_first_not_of(const char *begin, const char *end, const uint8_t *set)
+{
+   return find_first<false>(begin, end, set) ;
+}
+
+const char *avx2_rfind_first_of(const char *begin, const char *end, const uint8_t *set)
+{
+   return rfind_first<true>(begin, end, set) ;
+}
+
+const char *avx2_rfind_first_not_of(const char *begin, const char *end, const uint8_t *set)
+{
+   return rfind_first<false>(begin, end, set) ;
+}
+
+size_t avx2_find_all_of(const char *begin, const char *end, const uint8_t *set,
+                        const char **found, size_t maxcount)
+{
+   const membership member (set) ;
+   size_t count = 0 ;
+   for (; end - begin >= 32 ; begin += 32)
+      for (unsigned mask = member(begin) ; mask ; mask = _blsr_u32(mask))
+      {
+         if (count == maxcount)
+            return count ;
+         found[count++] = begin + _tzcnt_u32(mask) ;
+      }
+
+   if (end - begin >= 16)
+   {
+      for (unsigned mask = member.half(begin) ; mask ; mask = _blsr_u32(mask))
+      {
+         if (count == maxcount)
+            return count ;
+         found[count++] = begin + _tzcnt_u32(mask) ;
+      }
+      begin += 16 ;
+   }
+
+   for (; begin != end && count < maxcount ; ++begin)
+      if (in_set(set, *begin))
+         found[count++] = begin ;
+   return count ;
+}
+} // end of anonymous namespace
+
+namespace detail {
+extern const scan_kernels avx2_scan_kernels = {
+   kernel_isa::avx2, "avx2",
+   avx2_find_first_of,
+   avx2_find_first_not_of,
+   avx2_rfind_first_of,
+   avx2_rfind_first_not_of,
+   avx2_find_all_of
+} ;
+} // end of namespace pcomn::strscan::detail
+
+} // end of namespace pcomn::strscan
+} // end of namespace pcomn
+
+#endif /* PCOMN_PL_X86 && PCOMN_COMPILER_GNU */
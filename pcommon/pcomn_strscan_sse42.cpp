@@ -0,0 +1,147 @@
+/*-*- tab-width: 3; indent-tabs-mode: nil; c-file-style: "ellemtel"; c-file-offsets:((innamespace . 0)) -*-*/
+/*******************************************************************************
+ FILE         :   pcomn_strscan_sse42.cpp
+ COPYRIGHT    :   Yakov Markovitch, 2026. All rights reserved.
+                  See LICENSE for information on usage/redistribution.
+
+ DESCRIPTION  :   SSE4.2 byte set scan kernels.
+                  Must be compiled with -msse4.2 regardless of the ISA the rest of the
+                  library is compiled for; called only if the CPU supports SSE4.2 (see
+                  pcomn_strscan.cpp).
+
+ PROGRAMMED BY:   Yakov Markovitch
+ CREATION DATE:   16 Oct 2026
+*******************************************************************************/
+#include <pcomn_strscan.h>
+
+#if defined(PCOMN_PL_X86) && defined(PCOMN_COMPILER_GNU)
+
+#ifndef PCOMN_PL_SIMD_SSE42
+#error pcomn_strscan_sse42.cpp must be compiled for SSE4.2 instruction set.
+#endif
+
+#include <nmmintrin.h>
+
+namespace pcomn {
+namespace strscan {
+
+namespace {
+inline bool in_set(const uint8_t *set, char c)
+{
+   const uint8_t b = c ;
+   return set[(b & 15) | (b >> 3 & 16)] >> (b >> 4 & 7) & 1 ;
+}
+
+/*******************************************************************************
+ Membership of 16 bytes at once: the low nibble of a byte selects the table entry
+ (PSHUFB), the sign bit selects the table, the high nibble selects the bit.
+*******************************************************************************/
+struct membership {
+      explicit membership(const uint8_t *set) :
+         _table0(_mm_load_si128((const __m128i *)set)),
+         _table1(_mm_load_si128((const __m128i *)set + 1)),
+         _bitpos(_mm_setr_epi8(1, 2, 4, 8, 16, 32, 64, (char)128, 1, 2, 4, 8, 16, 32, 64, (char)128)),
+         _nibble(_mm_set1_epi8(0x0f))
+      {}
+
+      // Get 16 bits, one for every byte in the set
+      unsigned operator()(const char *p) const
+      {
+         const __m128i v = _mm_loadu_si128((const __m128i *)p) ;
+         const __m128i lo = _mm_and_si128(v, _nibble) ;
+         const __m128i hi = _mm_and_si128(_mm_srli_epi16(v, 4), _nibble) ;
+         const __m128i row = _mm_blendv_epi8(_mm_shuffle_epi8(_table0, lo), _mm_shuffle_epi8(_table1, lo), v) ;
+         const __m128i bit = _mm_shuffle_epi8(_bitpos, hi) ;
+         return _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(row, bit), bit)) ;
+      }
+
+   private:
+      const __m128i _table0 ;
+      const __m128i _table1 ;
+      const __m128i _bitpos ;
+      const __m128i _nibble ;
+} ;
+
+const unsigned all_bytes = 0xffff ;
+
+template<bool of>
+inline const char *find_first(const char *begin, const char *end, const uint8_t *set)
+{
+   const membership member (set) ;
+   for (; end - begin >= 16 ; begin += 16)
+      if (const unsigned found = of ? member(begin) : ~member(begin) & all_bytes)
+         return begin + __builtin_ctz(found) ;
+
+   while (begin != end && in_set(set, *begin) != of)
+      ++begin ;
+   return begin ;
+}
+
+template<bool of>
+inline const char *rfind_first(const char *begin, const char *end, const uint8_t *set)
+{
+   const membership member (set) ;
+   for (; end - begin >= 16 ; end -= 16)
+      if (const unsigned found = of ? member(end - 16) : ~member(end - 16) & all_bytes)
+         return end - 16 + (32 - __builtin_clz(found)) ;
+
+   while (end != begin && in_set(set, end[-1]) != of)
+      --end ;
+   return end ;
+}
+
+const char *sse42_find_first_of(const char *begin, const char *end, const uint8_t *set)
+{
+   return find_first<true>(begin, end, set) ;
+}
+
+const char *sse42_find_first_not_of(const char *begin, const char *end, const uint8_t *set)
+{
+   return find_first<false>(begin, end, set) ;
+}
+
+const char *sse42_rfind_first_of(const char *begin, const char *end, const uint8_t *set)
+{
+   return rfind_first<true>(begin, end, set) ;
+}
+
+const char *sse42_rfind_first_not_of(const char *begin, const char *end, const uint8_t *set)
+{
+   return rfind_first<false>(begin, end, set) ;
+}
+
+size_t sse42_find_all_of(const char *begin, const char *end, const uint8_t *set,
+                         const char **found, size_t maxcount)
+{
+   const membership member (set) ;
+   size_t count = 0 ;
+   for (; end - begin >= 16 ; begin += 16)
+      for (unsigned mask = member(begin) ; mask ; mask &= mask - 1)
+      {
+         if (count == maxcount)
+            return count ;
+         found[count++] = begin + __builtin_ctz(mask) ;
+      }
+
+   for (; begin != end && count < maxcount ; ++begin)
+      if (in_set(set, *begin))
+         found[count++] = begin ;
+   return count ;
+}
+} // end of anonymous namespace
+
+namespace detail {
+extern const scan_kernels sse42_scan_kernels = {
+   kernel_isa::sse42, "sse42",
+   sse42_find_first_of,
+   sse42_find_first_not_of,
+   sse42_rfind_first_of,
+   sse42_rfind_first_not_of,
+   sse42_find_all_of
+} ;
+} // end of namespace pcomn::strscan::detail
+
+} // end of namespace pcomn::strscan
+} // end of namespace pcomn
+
+#endif /* PCOMN_PL_X86 && PCOMN_COMPILER_GNU */
@@ -36,6 +36,7 @@
   strip
   strsplit
   strrsplit
+  byteset
 
   startswith
   endswith
@@ -49,11 +50,13 @@
 #include <pcomn_string.h>
 #include <pcomn_utils.h>
 #include <pcomn_hash.h>
+#include <pcomn_strscan.h>
 
 #include <iostream>
 #include <algorithm>
 #include <iterator>
 #include <array>
+#include <vector>
 
 #include <limits.h>
 
@@ -76,6 +79,106 @@ struct reg_match ;
 
 namespace pcomn {
 
+/// @cond
+namespace str {
+namespace detail {
+/*******************************************************************************
+ Character set scans for strip and split: generic for any character type, byte
+ strings use the vectorized kernels (see pcomn_strscan.h)
+*******************************************************************************/
+template<typename C>
+inline const C *lskip_chars(const C *begin, const C *end, const C *chars)
+{
+   return find_first_not_of(begin, end, chars, chars + str::len(chars)) ;
+}
+
+template<typename C>
+inline const C *rskip_chars(const C *begin, const C *end, const C *chars)
+{
+   typedef std::reverse_iterator<const C *> reverse ;
+   return find_first_not_of(reverse(end), reverse(begin), chars, chars + str::len(chars)).base() ;
+}
+
+template<typename C>
+inline const C *lskip_spaces(const C *begin, const C *end)
+{
+   return lskip_chars(begin, end, ws<C>::spaces()) ;
+}
+
+template<typename C>
+inline const C *rskip_spaces(const C *begin, const C *end)
+{
+   return rskip_chars(begin, end, ws<C>::spaces()) ;
+}
+
+template<typename C>
+inline const C *find_first_of_chars(const C *begin, const C *end, const C *chars, size_t nchars)
+{
+   while (begin != end && !memchr(chars, *begin, nchars))
+      ++begin ;
+   return begin ;
+}
+
+// Return the pointer past the found character, like reverse_iterator::base()
+template<typename C>
+inline const C *rfind_first_of_chars(const C *begin, const C *end, const C *chars, size_t nchars)
+{
+   while (end != begin && !memchr(chars, end[-1], nchars))
+      --end ;
+   return end ;
+}
+
+inline const byteset &spaces_byteset()
+{
+   static const byteset spaces (ws<char>::spaces()) ;
+   return spaces ;
+}
+
+// Check the first (last) character inline: most strings have no leading (trailing)
+// spaces at all
+inline const char *lskip_chars(const char *begin, const char *end, const byteset &set)
+{
+   return set.test(*begin) ? strscan::find_first_not_of(begin + 1, end, set) : begin ;
+}
+
+inline const char *rskip_chars(const char *begin, const char *end, const byteset &set)
+{
+   return set.test(end[-1]) ? strscan::rfind_first_not_of(begin, end - 1, set) : end ;
+}
+
+inline const char *lskip_chars(const char *begin, const char *end, const char *chars)
+{
+   return lskip_chars(begin, end, byteset(chars)) ;
+}
+
+inline const char *rskip_chars(const char *begin, const char *end, const char *chars)
+{
+   return rskip_chars(begin, end, byteset(chars)) ;
+}
+
+inline const char *lskip_spaces(const char *begin, const char *end)
+{
+   return lskip_chars(begin, end, spaces_byteset()) ;
+}
+
+inline const char *rskip_spaces(const char *begin, const char *end)
+{
+   return rskip_chars(begin, end, spaces_byteset()) ;
+}
+
+inline const char *find_first_of_chars(const char *begin, const char *end, const char *chars, size_t nchars)
+{
+   return strscan::find_first_of(begin, end, byteset(chars, chars + nchars)) ;
+}
+
+inline const char *rfind_first_of_chars(const char *begin, const char *end, const char *chars, size_t nchars)
+{
+   return strscan::rfind_first_of(begin, end, byteset(chars, chars + nchars)) ;
+}
+} // end of namespace pcomn::str::detail
+} // end of namespace pcomn::str
+/// @endcond
+
 /***************************************************************************//**
  Non-owning reference to a part (range) of a string, "unowning substring".
 
@@ -293,25 +396,29 @@ struct basic_strslice {
       basic_strslice &lstrip_inplace(const char_type *chars)
       {
          if (!empty())
-            _begin = find_first_not_of(begin(), end(), chars, chars + str::len(chars)) ;
+            _begin = str::detail::lskip_chars(begin(), end(), chars) ;
          return *this ;
       }
 
       basic_strslice &lstrip_inplace()
       {
-         return lstrip_inplace(str::detail::ws<char_type>::spaces()) ;
+         if (!empty())
+            _begin = str::detail::lskip_spaces(begin(), end()) ;
+         return *this ;
       }
 
       basic_strslice &rstrip_inplace(const char_type *chars)
       {
          if (!empty())
-            _end = find_first_not_of(rbegin(), rend(), chars, chars + str::len(chars)).base() ;
+            _end = str::detail::rskip_chars(begin(), end(), chars) ;
          return *this ;
       }
 
       basic_strslice &rstrip_inplace()
       {
-         return rstrip_inplace(str::detail::ws<char_type>::spaces()) ;
+         if (!empty())
+            _end = str::detail::rskip_spaces(begin(), end()) ;
+         return *this ;
       }
 
       basic_strslice &strip_inplace(const char_type *chars)
@@ -722,10 +829,10 @@ strsplit(const basic_strslice<C> &s, const basic_strslice<C> &separators)
 
    if (const size_t dsize = separators.size())
    {
-      for (const C *i = s.begin(), *e = s.end() ; i != e ; ++i)
-         if (memchr(separators.begin(), *i, dsize))
-            return result_type(slice_type(s.begin(), i), slice_type(i + 1, s.end())) ;
-      return result_type(s, slice_type()) ;
+      const C * const i = str::detail::find_first_of_chars(s.begin(), s.end(), separators.begin(), dsize) ;
+      return i != s.end()
+         ? result_type(slice_type(s.begin(), i), slice_type(i + 1, s.end()))
+         : result_type(s, slice_type()) ;
    }
    else
       return result_type(slice_type(), s) ;
@@ -785,10 +892,10 @@ strrsplit(const basic_strslice<C> &s, const basic_strslice<C> &separators)
 
    if (const size_t dsize = separators.size())
    {
-      for (const C *i = s.end(), *e = s.begin() ; i != e ;)
-         if (memchr(separators.begin(), *--i, dsize))
-            return result_type(slice_type(s.begin(), i), slice_type(i + 1, s.end())) ;
-      return result_type(slice_type(), s) ;
+      const C * const i = str::detail::rfind_first_of_chars(s.begin(), s.end(), separators.begin(), dsize) ;
+      return i != s.begin()
+         ? result_type(slice_type(s.begin(), i - 1), slice_type(i, s.end()))
+         : result_type(slice_type(), s) ;
    }
    else
       return result_type(s, slice_type()) ;
@@ -832,6 +939,105 @@ strrsplit(const S &s, const D &sep)
    return strrsplit<char_type>(basic_strslice<char_type>(s), sep) ;
 }
 
+/// @overload
+/// @param s            A string to split.
+/// @param separators   The set of separator bytes.
+///
+inline unipair<strslice> strsplit(const strslice &s, const byteset &separators)
+{
+   const char * const i = strscan::find_first_of(s.begin(), s.end(), separators) ;
+   return i != s.end()
+      ? unipair<strslice>(strslice(s.begin(), i), strslice(i + 1, s.end()))
+      : unipair<strslice>(s, strslice()) ;
+}
+
+/// @overload
+inline unipair<strslice> strrsplit(const strslice &s, const byteset &separators)
+{
+   const char * const i = strscan::rfind_first_of(s.begin(), s.end(), separators) ;
+   return i != s.begin()
+      ? unipair<strslice>(strslice(s.begin(), i - 1), strslice(i, s.end()))
+      : unipair<strslice>(strslice(), s) ;
+}
+
+/// @overload
+/// Takes precedence over the generic overload for any string @a s, which can't
+/// handle byteset.
+template<typename S>
+inline unipair<strslice> strsplit(const S &s, const byteset &separators)
+{
+   return strsplit(strslice(s), separators) ;
+}
+
+/// @overload
+template<typename S>
+inline unipair<strslice> strrsplit(const S &s, const byteset &separators)
+{
+   return strrsplit(strslice(s), separators) ;
+}
+
+/*******************************************************************************
+ Split a string into all the fields at once
+*******************************************************************************/
+/// Split a string into fields delimited by any of separator bytes.
+///
+/// Like Python's str.split(sep), but with a set of single-byte separators: adjacent
+/// separators delimit empty fields, and a string without separators (including the
+/// empty string) is a single field.
+///
+/// @param s            A string to split.
+/// @param separators   The set of separator bytes.
+/// @param fields       The array for at most @a maxfields fields.
+/// @param maxfields    The size of @a fields; if there are more fields in @a s, the last
+///                     one is the rest of the string, unsplit.
+///
+/// @return The count of fields put into @a fields.
+///
+inline size_t strsplit(const strslice &s, const byteset &separators, strslice *fields, size_t maxfields)
+{
+   if (!maxfields)
+      return 0 ;
+
+   const char *found[64] ;
+   const char *field = s.begin() ;
+   size_t count = 0 ;
+
+   for (size_t requested ; (requested = std::min(P_ARRAY_COUNT(found), maxfields - 1 - count)) != 0 ;)
+   {
+      const size_t n = strscan::find_all_of(field, s.end(), separators, found, requested) ;
+      for (size_t i = 0 ; i < n ; field = found[i++] + 1)
+         fields[count++] = strslice(field, found[i]) ;
+      if (n < requested)
+         break ;
+   }
+   fields[count++] = strslice(field, s.end()) ;
+   return count ;
+}
+
+/// @overload
+/// Put all the fields into a vector, reusing its storage.
+///
+/// @param fields The vector the fields replace the contents of.
+/// @return The count of fields.
+///
+inline size_t strsplit(const strslice &s, const byteset &separators, std::vector<strslice> &fields)
+{
+   const char *found[64] ;
+   const char *field = s.begin() ;
+   size_t n ;
+
+   fields.clear() ;
+   do {
+      n = strscan::find_all_of(field, s.end(), separators, found, P_ARRAY_COUNT(found)) ;
+      for (size_t i = 0 ; i < n ; field = found[i++] + 1)
+         fields.emplace_back(field, found[i]) ;
+   }
+   while (n == P_ARRAY_COUNT(found)) ;
+
+   fields.emplace_back(field, s.end()) ;
+   return fields.size() ;
+}
+
 /*******************************************************************************
  Misc functions
 *******************************************************************************/
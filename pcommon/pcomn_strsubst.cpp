@@ -12,6 +12,11 @@
 #include <pcomn_calgorithm.h>
 #include <pcomn_strslice.h>
 
+#include <algorithm>
+
+#include <ctype.h>
+#include <string.h>
+
 namespace pcomn {
 namespace tpl {
 
@@ -147,22 +152,266 @@ bool substitution_map::consume_char(int c, local_state &local) const
    return c != -1 ;
 }
 
-void substitution_map::commit_substitution(detail::output &out, const strslice &placeholder,
-                                           const char *prefix, const char *suffix) const
+bool substitution_map::write_replacement(detail::output &out, const strslice &placeholder) const
 {
    if (const replacement_function *fn = get_keyed_value(_replacement_map, placeholder))
       fn->write(out) ;
    else if (_replacement_def)
       _replacement_def->write(placeholder, out) ;
-   else {
+   else
+      return false ;
+   return true ;
+}
+
+void substitution_map::commit_substitution(detail::output &out, const strslice &placeholder,
+                                           const char *prefix, const char *suffix) const
+{
+   if (!write_replacement(out, placeholder))
+   {
       // No replacement for this placeholder: output the placeholder verbatim.
       if (*prefix)
          out(prefix, strlen(prefix)) ;
       out(placeholder.begin(), placeholder.size()) ;
       if (*suffix)
-         out(prefix, strlen(prefix)) ;
+         out(suffix, strlen(suffix)) ;
    }
 }
 
+/*******************************************************************************
+ compiled_template
+*******************************************************************************/
+static inline bool is_ident_start(int c) { return isascii(c) && (isalpha(c) || c == '_') ; }
+static inline bool is_ident_char(int c) { return isascii(c) && (isalnum(c) || c == '_') ; }
+
+compiled_template::compiled_template(const strslice &template_text)
+{
+   typedef substitution_map::State State ;
+
+   _text.reserve(template_text.size() + 1) ;
+
+   State state = substitution_map::S_TEXT ;
+   // The start of a placeholder name or a comment
+   const char *name = nullptr ;
+
+   // The same state machine as substitution_map::consume_char(), but the literal text
+   // is accumulated in _text and every placeholder closes the current segment
+   const auto finish_placeholder = [&](int nextchar)
+   {
+      if (nextchar == '$')
+         return substitution_map::S_PLACEHOLDER_START ;
+      if (nextchar != -1)
+         _text += (char)nextchar ;
+      return substitution_map::S_TEXT ;
+   } ;
+
+   const char * const end = template_text.end() ;
+   for (const char *p = template_text.begin() ;; ++p)
+   {
+      const int c = p == end ? -1 : (uint8_t)*p ;
+
+      switch (state)
+      {
+         case substitution_map::S_TEXT:
+            if (c == '$')
+               state = substitution_map::S_PLACEHOLDER_START ;
+            else if (c != -1)
+               _text += (char)c ;
+            break ;
+
+         case substitution_map::S_PLACEHOLDER_START:
+            name = p + 1 ;
+            switch (c)
+            {
+               case '$': // "$$"
+                  _text += '$' ;
+                  state = substitution_map::S_TEXT ;
+                  break ;
+
+               case '{':
+                  state = substitution_map::S_PLACEHOLDER_QUOTED ;
+                  break ;
+
+               case '*':
+                  state = substitution_map::S_COMMENTS ;
+                  break ;
+
+               default:
+                  if (is_ident_start(c))
+                  {
+                     name = p ;
+                     state = substitution_map::S_PLACEHOLDER ;
+                  }
+                  else
+                  {
+                     _text += '$' ;
+                     if (c != -1)
+                        _text += (char)c ;
+                     state = substitution_map::S_TEXT ;
+                  }
+                  break ;
+            }
+            break ;
+
+         case substitution_map::S_PLACEHOLDER:
+            if (is_ident_char(c))
+               break ;
+            close_segment(strslice(name, p), "$", "") ;
+            state = finish_placeholder(c) ;
+            break ;
+
+         case substitution_map::S_PLACEHOLDER_QUOTED:
+            if (is_ident_char(c))
+               break ;
+            if (c == '}')
+            {
+               if (p == name)
+                  _text.append("${}", 3) ;
+               else
+                  close_segment(strslice(name, p), "${", "}") ;
+               state = substitution_map::S_TEXT ;
+            }
+            else
+            {
+               _text.append("${", 2).append(name, p) ;
+               state = finish_placeholder(c) ;
+            }
+            break ;
+
+         case substitution_map::S_COMMENTS:
+            if (c == '$' && p != name && p[-1] == '*')
+               state = substitution_map::S_TEXT ;
+            break ;
+      }
+
+      if (c == -1)
+         break ;
+   }
+   // The trailing literal
+   close_segment(strslice(), "", "") ;
+}
+
+void compiled_template::close_segment(const strslice &name, const char *prefix, const char *suffix)
+{
+   segment s ;
+   s.offset = _segments.empty()
+      ? 0
+      : _segments.back().offset + _segments.back().literal_size + _segments.back().verbatim_size ;
+   s.literal_size = _text.size() - s.offset ;
+   s.placeholder = nopos ;
+
+   if (!name.empty())
+   {
+      _text.append(prefix).append(name.begin(), name.end()).append(suffix) ;
+
+      const ssize_t ndx = placeholder_index(name) ;
+      if (ndx >= 0)
+         s.placeholder = ndx ;
+      else
+      {
+         s.placeholder = _placeholders.size() ;
+         _placeholders.emplace_back(name.begin(), name.end()) ;
+      }
+   }
+   s.verbatim_size = _text.size() - s.offset - s.literal_size ;
+
+   _segments.push_back(s) ;
+}
+
+ssize_t compiled_template::placeholder_index(const strslice &name) const
+{
+   const auto found = std::find_if(_placeholders.begin(), _placeholders.end(),
+                                   [&](const std::string &p) { return name == p ; }) ;
+   return found == _placeholders.end() ? -1 : found - _placeholders.begin() ;
+}
+
+size_t compiled_template::size(const strslice *values) const
+{
+   size_t result = 0 ;
+   for (const segment &s: _segments)
+      result += s.literal_size + replacement(s, values).size() ;
+   return result ;
+}
+
+size_t compiled_template::render(char *buf, size_t bufsize, const strslice *values) const
+{
+   size_t result = 0 ;
+   const auto put = [&](const char *data, size_t size)
+   {
+      if (result < bufsize)
+         memcpy(buf + result, data, std::min(size, bufsize - result)) ;
+      result += size ;
+   } ;
+
+   for (const segment &s: _segments)
+   {
+      put(_text.data() + s.offset, s.literal_size) ;
+      const strslice &r = replacement(s, values) ;
+      put(r.begin(), r.size()) ;
+   }
+   return result ;
+}
+
+size_t compiled_template::render(iovec_t *iov, size_t maxcount, const strslice *values) const
+{
+   size_t count = 0 ;
+   // Adjacent pieces (a literal and a verbatim placeholder) are merged into one item
+   const char *last = nullptr ;
+   const auto put = [&](const char *data, size_t size)
+   {
+      if (!size)
+         return ;
+      if (data == last)
+      {
+         if (count <= maxcount)
+            iov[count - 1].iov_len += size ;
+      }
+      else if (count++ < maxcount)
+         iov[count - 1] = make_iovec(data, size) ;
+      last = data + size ;
+   } ;
+
+   for (const segment &s: _segments)
+   {
+      put(_text.data() + s.offset, s.literal_size) ;
+      const strslice &r = replacement(s, values) ;
+      put(r.begin(), r.size()) ;
+   }
+   return count ;
+}
+
+std::string &compiled_template::render(std::string &result, const strslice *values) const
+{
+   const size_t offset = result.size() ;
+   const size_t rendered_size = size(values) ;
+   result.resize(offset + rendered_size) ;
+   render(&result[offset], rendered_size, values) ;
+   return result ;
+}
+
+std::string &compiled_template::render(std::string &result, const substitution_map &smap) const
+{
+   // Evaluate every placeholder into a single scratch string first, then take
+   // slices of it: the string may be reallocated while growing
+   std::string replacements ;
+   detail::out<std::string> out (replacements) ;
+   std::vector<std::pair<size_t, size_t> > bounds ;
+   bounds.reserve(placeholder_count()) ;
+
+   for (const std::string &name: _placeholders)
+   {
+      const size_t start = replacements.size() ;
+      bounds.emplace_back(start, smap.write_replacement(out, strslice(name)) ? replacements.size() : nopos) ;
+   }
+
+   std::vector<strslice> values ;
+   values.reserve(bounds.size()) ;
+   for (const auto &b: bounds)
+      values.push_back(b.second == nopos
+                       ? strslice()
+                       : strslice(replacements.data() + b.first, replacements.data() + b.second)) ;
+
+   return render(result, values.data()) ;
+}
+
 } // end of namespace pcomn::tpl
 } // end of namespace pcomn
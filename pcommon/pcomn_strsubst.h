@@ -30,6 +30,11 @@
     @li "${identifier}" is equivalent to "$identifier". It is required when valid
         identifier characters follow the placeholder but are not part of the placeholder,
         such as "${noun}isation".
+
+    @li $*comment*$ is removed from the output.
+
+    If the same template is substituted many times, compile it once into a
+    pcomn::tpl::compiled_template.
 *******************************************************************************/
 #include <pcomn_iodevice.h>
 #include <pcomn_handle.h>
@@ -40,6 +45,7 @@
 #include <pcomn_hashclosed.h>
 #include <pcomn_algorithm.h>
 #include <pcomn_binstream.h>
+#include <pcomn_buffer.h>
 
 #include <functional>
 #include <type_traits>
@@ -47,6 +53,7 @@
 #include <algorithm>
 #include <memory>
 #include <utility>
+#include <vector>
 #include <new>
 
 #include <ctype.h>
@@ -112,6 +119,8 @@ inline ssize_t format(const output &out, bool v)
 } // end of namespace pcomn::tpl::detail
 /// @endcond
 
+class compiled_template ;
+
 /******************************************************************************/
 /** String template substitutions mapping.
 
@@ -213,9 +222,12 @@ class substitution_map {
 
       /// Make substitutions in a template specified by any readable iodevice (i.e. such
       /// with pcomn::io::reader<> defined).
+      /// Doesn't accept compiled_template, see subst(const substitution_map&,const
+      /// compiled_template&,OutputDevice&).
       template<typename InputDevice, typename OutputDevice>
       friend
-      std::enable_if_t<(!std::is_pod<InputDevice>::value && !std::is_convertible<InputDevice, strslice>::value),
+      std::enable_if_t<(!std::is_pod<InputDevice>::value && !std::is_convertible<InputDevice, strslice>::value &&
+                        !std::is_same<InputDevice, compiled_template>::value),
                        OutputDevice &>
       subst(const substitution_map &s, InputDevice &input, OutputDevice &output)
       {
@@ -235,6 +247,8 @@ class substitution_map {
       }
 
    private:
+      friend class compiled_template ;
+
       struct replacement_function {
             virtual ~replacement_function() {}
             virtual const strslice name() const = 0 ;
@@ -374,6 +388,10 @@ class substitution_map {
 
       _PCOMNEXP bool consume_char(int c, local_state &local) const ;
 
+      // Output placeholder substitution value to out; return false if there is neither
+      // such placeholder registered nor the default replacement.
+      _PCOMNEXP bool write_replacement(detail::output &out, const strslice &placeholder) const ;
+
       // Output placeholder substitution value to out; if there is no such placeholder
       // registered, output the placeholder enclosed in pfx and sfx.
       _PCOMNEXP void commit_substitution(detail::output &out, const strslice &placeholder,
@@ -436,6 +454,107 @@ const substitution_map &substitution_map::substitute(InputDevice &input, OutputD
    return *this ;
 }
 
+/******************************************************************************/
+/** String template parsed once into a sequence of literal and placeholder segments.
+
+ The template syntax is exactly that of subst(). Every placeholder is resolved at
+ construction to an index in the list of distinct placeholder names, so rendering
+ neither rescans the template nor looks up names: the caller passes an array of
+ placeholder_count() values indexed by placeholder_index(), and the result is written
+ in one pass either into a buffer or as a list of iovecs pointing into the template and
+ the values (i.e. without copying at all).
+
+ A value with NULL begin() (e.g. strslice()) means "no value": such placeholder is
+ rendered verbatim, like subst() does for an unknown placeholder; the values array
+ itself may be NULL.
+
+ compiled_template is immutable after construction, so a single instance can be
+ rendered by any number of threads concurrently.
+*******************************************************************************/
+class compiled_template {
+   public:
+      /// Compile a template; the template text is copied.
+      _PCOMNEXP explicit compiled_template(const strslice &template_text) ;
+
+      /// Get the count of distinct placeholders in the template.
+      size_t placeholder_count() const { return _placeholders.size() ; }
+
+      /// Get the name of a placeholder by its index.
+      const std::string &placeholder(size_t ndx) const { return _placeholders[ndx] ; }
+
+      /// Get the index of a placeholder by its name.
+      /// @return Placeholder index, or -1 if the template has no such placeholder.
+      _PCOMNEXP ssize_t placeholder_index(const strslice &name) const ;
+
+      /// Get the size of the text the template renders to with specified values.
+      _PCOMNEXP size_t size(const strslice *values) const ;
+
+      /// Get the maximum count of iovec items render() can produce.
+      size_t max_iovec_count() const { return 2*_segments.size() ; }
+
+      /// Render the template into a buffer.
+      ///
+      /// Like snprintf, writes no more than @a bufsize bytes and returns the full size
+      /// of the rendered text; doesn't append the terminating zero.
+      _PCOMNEXP size_t render(char *buf, size_t bufsize, const strslice *values) const ;
+
+      /// Render the template into a list of iovecs, e.g. for writev().
+      ///
+      /// Fills no more than @a maxcount items and returns the full count of items
+      /// required; the items point into the template and into @a values.
+      _PCOMNEXP size_t render(iovec_t *iov, size_t maxcount, const strslice *values) const ;
+
+      /// Append the rendered template to a string.
+      _PCOMNEXP std::string &render(std::string &result, const strslice *values) const ;
+
+      /// Append the template rendered with values from a substitution map to a string.
+      ///
+      /// Every distinct placeholder is looked up and evaluated exactly once per call,
+      /// even if it occurs in the template several times.
+      _PCOMNEXP std::string &render(std::string &result, const substitution_map &values) const ;
+
+   private:
+      static constexpr size_t nopos = ~(size_t)0 ;
+
+      // Literal text, followed by a placeholder (unless it is the trailing literal).
+      // The placeholder verbatim text (e.g. "${name}") follows the literal in _text.
+      struct segment {
+            size_t offset ;         // Offset of the literal in _text
+            size_t literal_size ;
+            size_t verbatim_size ;
+            size_t placeholder ;    // Index in _placeholders or nopos
+      } ;
+
+      std::string                _text ;
+      std::vector<segment>       _segments ;
+      std::vector<std::string>   _placeholders ;
+
+      // Finish the current segment with the placeholder, or with no placeholder if
+      // the name is empty
+      void close_segment(const strslice &name, const char *prefix, const char *suffix) ;
+
+      strslice replacement(const segment &s, const strslice *values) const
+      {
+         if (s.placeholder != nopos && values && values[s.placeholder].begin())
+            return values[s.placeholder] ;
+         const char * const verbatim = _text.data() + s.offset + s.literal_size ;
+         return strslice(verbatim, verbatim + s.verbatim_size) ;
+      }
+} ;
+
+/// Make substitutions in a compiled template.
+///
+/// Renders the whole text first and writes it to the output device at once.
+template<typename OutputDevice>
+OutputDevice &subst(const substitution_map &s, const compiled_template &tmpl, OutputDevice &output)
+{
+   std::string result ;
+   tmpl.render(result, s) ;
+   detail::out<OutputDevice> textout (output) ;
+   textout(result.data(), result.size()) ;
+   return output ;
+}
+
 /******************************************************************************/
 /** Global swap(substitution_map&,substitution_map&)
 *******************************************************************************/
@@ -10,6 +10,9 @@
  CREATION DATE:   19 Jul 2007
 *******************************************************************************/
 #include <pcomn_textio.h>
+#include <pcomn_strscan.h>
+
+#include <algorithm>
 
 namespace pcomn {
 
@@ -84,7 +87,111 @@ size_t text_writer::write_translate(const char *begin, size_t count)
 }
 
 /*******************************************************************************
- text_reader
+ line_reader
 *******************************************************************************/
+constexpr size_t line_reader::default_blocksize ;
+
+static const byteset newlines ("\r\n") ;
+
+line_reader::line_reader(size_t blocksize) :
+   _blocksize(std::max(blocksize, (size_t)1)),
+   _pos(nullptr),
+   _end(nullptr)
+{}
+
+line_reader::~line_reader() = default ;
+
+ssize_t line_reader::read_block(char *, size_t)
+{
+   return 0 ;
+}
+
+bool line_reader::refill()
+{
+   if (!_blocksize || _exhausted)
+      return false ;
+
+   const size_t remains = _end - _pos ;
+   // Grow the buffer if there is no room for a whole block after the unread data,
+   // i.e. the current line is longer than the block
+   if (_capacity - remains < _blocksize)
+   {
+      const size_t newcapacity = std::max(2*_capacity, remains + _blocksize) ;
+      std::unique_ptr<char[]> newbuffer (new char[newcapacity]) ;
+      memcpy(newbuffer.get(), _pos, remains) ;
+      _buffer = std::move(newbuffer) ;
+      _capacity = newcapacity ;
+   }
+   else if (_pos != _buffer.get())
+      memmove(_buffer.get(), _pos, remains) ;
+
+   _pos = _buffer.get() ;
+   _end = _pos + remains ;
+
+   const ssize_t lastread = read_block(_buffer.get() + remains, _capacity - remains) ;
+   if (lastread <= 0)
+   {
+      _exhausted = true ;
+      return false ;
+   }
+   _end += lastread ;
+   return true ;
+}
+
+bool line_reader::next_line(strslice &line, const char *line_end, const char *next)
+{
+   line = strslice(_pos, line_end) ;
+   _bytecount += next - _pos ;
+   _pos = next ;
+   ++_linecount ;
+   return true ;
+}
+
+bool line_reader::readline(strslice &line)
+{
+   // The offset from _pos where the newline search continues after a refill, so that
+   // long lines are not rescanned
+   size_t scanned = 0 ;
+   for (;;)
+   {
+      const char * const eol = strscan::find_first_of(_pos + scanned, _end, newlines) ;
+      if (eol != _end)
+      {
+         if (*eol == '\n')
+         {
+            _eoltype |= eol_LF ;
+            return next_line(line, eol, eol + 1) ;
+         }
+         // '\r': need the next byte to distinguish CR from CRLF
+         if (eol + 1 == _end && _blocksize && !_exhausted)
+         {
+            // refill() moves the data, so the search restarts
+            scanned = eol - _pos ;
+            refill() ;
+            continue ;
+         }
+         if (eol + 1 != _end && eol[1] == '\n')
+         {
+            _eoltype |= eol_CRLF ;
+            return next_line(line, eol, eol + 2) ;
+         }
+         _eoltype |= eol_CR ;
+         return next_line(line, eol, eol + 1) ;
+      }
+
+      scanned = _end - _pos ;
+      if (!refill())
+      {
+         if (_pos == _end)
+         {
+            line = strslice() ;
+            return false ;
+         }
+         // The last line without newline
+         return next_line(line, _end, _end) ;
+      }
+   }
+}
+
 
 } // end of namespace pcomn
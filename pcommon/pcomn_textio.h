@@ -14,9 +14,11 @@
 #include <pcomn_platform.h>
 #include <pcomn_integer.h>
 #include <pcomn_iodevice.h>
+#include <pcomn_strslice.h>
 
 #include <utility>
 #include <limits>
+#include <memory>
 
 namespace pcomn {
 
@@ -289,6 +291,120 @@ class universal_text_reader : public text_reader {
       int get_char() { return io::reader<Device>::get_char(_device) ; }
 } ;
 
+/******************************************************************************/
+/** Block-oriented universal newline line reader.
+
+ In contrast to text_reader, which calls a virtual function for every byte, reads
+ data by large blocks, finds newlines with vectorized byte set scans (see
+ pcomn_strscan.h), and yields lines as slices without copying.
+
+ Lines are returned without newlines; "\n", "\r\n", and "\r" are all recognized as
+ newlines and reported by eoltype() exactly like text_reader::eoltype() does.
+
+ When constructed over a memory block (e.g. a memory-mapped file), returned lines
+ point directly into that memory and are valid while the memory is. When reading
+ from a device (see universal_line_reader), lines point into the internal buffer
+ and are valid only until the next readline() call.
+
+ @code
+ PMemMapping file ("data.txt") ;
+ line_reader reader (strslice(file.cdata(), file.size())) ;
+ for (strslice line ; reader.readline(line) ;)
+    process(line) ;
+ @endcode
+*******************************************************************************/
+class _PCOMNEXP line_reader {
+      PCOMN_NONCOPYABLE(line_reader) ;
+      PCOMN_NONASSIGNABLE(line_reader) ;
+   public:
+      /// The default size of the block read from a device at once.
+      static constexpr size_t default_blocksize = 64*KiB ;
+
+      /// Create the reader over the memory [begin, end).
+      line_reader(const char *begin, const char *end) :
+         _blocksize(0),
+         _pos(begin),
+         _end(end)
+      {
+         NOXCHECK(begin <= end) ;
+      }
+
+      /// Create the reader over the memory occupied by @a data.
+      explicit line_reader(const strslice &data) : line_reader(data.begin(), data.end()) {}
+
+      virtual ~line_reader() ;
+
+      /// Get the description of newline types encountered during reading.
+      /// @return The bit mask consisting of EOLType flags.
+      unsigned eoltype() const { return _eoltype ; }
+
+      /// Indicates whether there are no more lines.
+      /// @note For a device, may return false before the end of data is actually
+      /// encountered by readline().
+      bool eof() const { return _pos == _end && (!_blocksize || _exhausted) ; }
+
+      /// Get the count of lines read so far.
+      size_t linecount() const { return _linecount ; }
+
+      /// Get the count of bytes read so far, including newlines.
+      size_t bytecount() const { return _bytecount ; }
+
+      /// Read the next line.
+      /// @param line Set to the line without its newline; the last line may have no
+      /// newline at all.
+      /// @return false at the end of data (@a line is set to an empty slice).
+      bool readline(strslice &line) ;
+
+   protected:
+      /// Create the reader that reads from read_block() by @a blocksize bytes.
+      explicit line_reader(size_t blocksize) ;
+
+   private:
+      const size_t            _blocksize ;   /* 0 for a memory block */
+      std::unique_ptr<char[]> _buffer ;
+      size_t                  _capacity = 0 ;
+      const char *            _pos ;
+      const char *            _end ;
+      bool                    _exhausted = false ;
+
+      unsigned _eoltype     = eol_Undefined ;
+      size_t   _linecount   = 0 ;
+      size_t   _bytecount   = 0 ;
+
+      /// Read up to @a size bytes into @a buf.
+      /// @return The count of bytes read, 0 at the end of data.
+      virtual ssize_t read_block(char *buf, size_t size) ;
+
+      // Move unread data to the buffer start and read the next block after it.
+      // Returns false at the end of data.
+      bool refill() ;
+
+      bool next_line(strslice &line, const char *line_end, const char *next) ;
+} ;
+
+/******************************************************************************/
+/** Block-oriented line reader over a pcomn::io::reader device.
+*******************************************************************************/
+template<typename Device>
+class universal_line_reader : public line_reader {
+      typedef line_reader ancestor ;
+   public:
+      typedef typename ::pcomn::io::reader<Device>::device_type device_type ;
+
+      explicit universal_line_reader(device_type device, size_t blocksize = default_blocksize) :
+         ancestor(blocksize),
+         _device(device)
+      {}
+
+   private:
+      device_type _device ;
+
+      ssize_t read_block(char *buf, size_t size) override
+      {
+         return io::reader<Device>::read(_device, buf, size) ;
+      }
+} ;
+
 /*******************************************************************************
                      struct newline_t
 *******************************************************************************/
@@ -199,15 +199,180 @@ void job_batch::assignment::set_exception(std::exception_ptr &&xptr)
              "The " << kind << " is aborted. The exception is " << oexception(xptr)) ;
 }
 
+/*******************************************************************************
+ threadpool::worker_deque
+
+ Chase-Lev work-stealing deque of tasks, as described in "Correct and Efficient
+ Work-Stealing for Weak Memory Models" (N.M.Lê, A.Pop, A.Cohen, F.Zappa Nardelli, 2013).
+
+ push() and take() are called only by the owner worker and work at the bottom end,
+ steal() may be called by any thread and works at the top end.
+ The ring grows on demand and is never shrunk; the retired rings are kept until
+ the deque destruction, since thieves may still read from them.
+*******************************************************************************/
+class alignas(cacheline_t) threadpool::worker_deque {
+    PCOMN_NONCOPYABLE(worker_deque) ;
+    PCOMN_NONASSIGNABLE(worker_deque) ;
+
+    struct ring {
+        explicit ring(int64_t capacity) :
+            _mask(capacity - 1),
+            _items(new std::atomic<assignment *>[capacity])
+        {}
+
+        int64_t capacity() const { return _mask + 1 ; }
+
+        assignment *get(int64_t ndx) const noexcept
+        {
+            return _items[ndx & _mask].load(std::memory_order_relaxed) ;
+        }
+        void put(int64_t ndx, assignment *task) noexcept
+        {
+            _items[ndx & _mask].store(task, std::memory_order_relaxed) ;
+        }
+
+        const int64_t _mask ;
+        std::unique_ptr<std::atomic<assignment *>[]> _items ;
+    } ;
+
+public:
+    worker_deque() { _rings.emplace_back(new ring(256)) ; _ring = _rings.back().get() ; }
+
+    ~worker_deque()
+    {
+        const ring * const r = _ring.load(std::memory_order_relaxed) ;
+        for (int64_t ndx = _top, end = _bottom ; ndx < end ; delete r->get(ndx++)) ;
+    }
+
+    bool _owned = false ; /* Is there an owner worker; access only under _pool_mutex */
+
+    size_t size() const noexcept
+    {
+        const int64_t t = _top.load(std::memory_order_relaxed) ;
+        const int64_t b = _bottom.load(std::memory_order_relaxed) ;
+        return b > t ? b - t : 0 ;
+    }
+
+    void push(assignment *task)
+    {
+        const int64_t b = _bottom.load(std::memory_order_relaxed) ;
+        const int64_t t = _top.load(std::memory_order_acquire) ;
+        ring *r = _ring.load(std::memory_order_relaxed) ;
+
+        if (b - t >= r->capacity())
+            r = grow(r, t, b) ;
+
+        r->put(b, task) ;
+        std::atomic_thread_fence(std::memory_order_release) ;
+        _bottom.store(b + 1, std::memory_order_relaxed) ;
+    }
+
+    assignment *take() noexcept
+    {
+        const int64_t b = _bottom.load(std::memory_order_relaxed) - 1 ;
+        ring * const r = _ring.load(std::memory_order_relaxed) ;
+
+        _bottom.store(b, std::memory_order_relaxed) ;
+        std::atomic_thread_fence(std::memory_order_seq_cst) ;
+
+        int64_t t = _top.load(std::memory_order_relaxed) ;
+        if (t > b)
+        {
+            // Empty
+            _bottom.store(b + 1, std::memory_order_relaxed) ;
+            return nullptr ;
+        }
+
+        assignment *task = r->get(b) ;
+        if (t == b)
+        {
+            // The last item, race against thieves
+            if (!_top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+                task = nullptr ;
+            _bottom.store(b + 1, std::memory_order_relaxed) ;
+        }
+        return task ;
+    }
+
+    assignment *steal() noexcept
+    {
+        for (;;)
+        {
+            int64_t t = _top.load(std::memory_order_acquire) ;
+            std::atomic_thread_fence(std::memory_order_seq_cst) ;
+            const int64_t b = _bottom.load(std::memory_order_acquire) ;
+
+            if (t >= b)
+                return nullptr ;
+
+            assignment * const task = _ring.load(std::memory_order_acquire)->get(t) ;
+            if (_top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+                return task ;
+        }
+    }
+
+private:
+    alignas(cacheline_t) std::atomic<int64_t> _top {0} ;
+    alignas(cacheline_t) std::atomic<int64_t> _bottom {0} ;
+    std::atomic<ring *>  _ring ;
+
+    std::vector<std::unique_ptr<ring>> _rings ;
+
+private:
+    ring *grow(const ring *r, int64_t t, int64_t b)
+    {
+        _rings.reserve(_rings.size() + 1) ;
+
+        ring * const newring = new ring(2*r->capacity()) ;
+        _rings.emplace_back(newring) ;
+
+        for (int64_t ndx = t ; ndx < b ; ++ndx)
+            newring->put(ndx, r->get(ndx)) ;
+
+        _ring.store(newring, std::memory_order_release) ;
+        return newring ;
+    }
+} ;
+
+/*******************************************************************************
+ threadpool::worker_context
+*******************************************************************************/
+struct threadpool::worker_context {
+    const threadpool *_pool  = nullptr ; /* The pool the current thread is a worker of */
+    worker_deque     *_deque = nullptr ; /* Local deque of the current worker */
+    uint32_t          _seed  = (uint32_t)((uintptr_t)this >> 4) | 1 ;
+
+    // xorshift32, for the random victim selection
+    uint32_t random() noexcept
+    {
+        _seed ^= _seed << 13 ;
+        _seed ^= _seed >> 17 ;
+        _seed ^= _seed << 5 ;
+        return _seed ;
+    }
+} ;
+
+threadpool::worker_context &threadpool::this_worker() noexcept
+{
+    static thread_local worker_context context ;
+    return context ;
+}
+
 /*******************************************************************************
  threadpool
 *******************************************************************************/
 static constexpr size_t default_queue_capacity_per_thread = 16 ;
 static constexpr size_t max_sane_queue_capacity = 0x1000000 ; /* 16M tasks, 128MiB */
 
-threadpool::threadpool(size_t threadcount, const strslice &name, size_t max_capacity) :
+// There can momentarily be more deques than max_threadcount(): a dismissed thread
+// releases its deque a bit later than its replacement is started.
+static constexpr size_t max_deque_count = 2*threadpool::max_threadcount() ;
+
+threadpool::threadpool(size_t threadcount, const strslice &name, size_t max_capacity,
+                       Scheduling scheduling) :
     _thread_count(thread_count(0, std::min(threadcount, max_threadcount()))),
-    _task_queue(estimate_max_capacity(threadcount, max_capacity))
+    _task_queue(estimate_max_capacity(threadcount, max_capacity)),
+    _deques(scheduling == WORK_STEALING ? new std::atomic<worker_deque *>[max_deque_count] : nullptr)
 {
     init_threadname(as_mutable(_name), name, "Thread pool name") ;
     check_launch_new_thread(_thread_count.load(std::memory_order_relaxed)) ;
@@ -228,6 +393,10 @@ threadpool::~threadpool()
     // F_AUTOJOIN
     _dropped_thread.clear() ;
     _threads.clear() ;
+
+    // All the workers are joined, delete local deques along with their pending tasks
+    for (unsigned ndx = _deque_count.load(std::memory_order_acquire) ; ndx-- ;)
+        delete _deques[ndx].load(std::memory_order_relaxed) ;
 }
 
 unsigned threadpool::estimate_max_capacity(size_t threadcount, size_t max_capacity)
@@ -242,7 +411,8 @@ unsigned threadpool::estimate_max_capacity(size_t threadcount, size_t max_capaci
 
 unsigned threadpool::clear_queue()
 {
-    return _task_queue.try_pop_some(-1).size() ;
+    const unsigned dropped_count = _task_queue.try_pop_some(-1).size() ;
+    return _deques ? dropped_count + drop_local_tasks() : dropped_count ;
 }
 
 void threadpool::resize(size_t threadcount)
@@ -293,6 +463,12 @@ void threadpool::worker_thread_function(thread_list::iterator self)
 {
     while(check_launch_new_thread(_thread_count.load(std::memory_order_acquire))) ;
 
+    if (_deques)
+    {
+        stealing_worker_function(self) ;
+        return ;
+    }
+
     fwd::optional<task_ptr> task_opt ;
 
     while (handle_pool_resize(self) == CONTINUE && (task_opt = _task_queue.pop_opt()))
@@ -304,6 +480,214 @@ void threadpool::worker_thread_function(thread_list::iterator self)
     }
 }
 
+// Worker thread function for WORK_STEALING mode.
+// The order of task lookup: the local deque, then other workers' deques, and only then
+// the shared queue.
+void threadpool::stealing_worker_function(thread_list::iterator self)
+{
+    worker_deque &local = claim_deque() ;
+    worker_context &context = this_worker() ;
+
+    context._pool = this ;
+    context._deque = &local ;
+
+    const auto release_local (make_finalizer([&]
+    {
+        context._pool = nullptr ;
+        context._deque = nullptr ;
+        release_deque(local) ;
+    })) ;
+
+    const auto exec = [](assignment *task)
+    {
+        const task_ptr current_task (task) ;
+        job_batch::exec_task(*current_task) ;
+    } ;
+
+    const auto is_stopped = [this]
+    {
+        return thread_count::is_stopped(_thread_count.load(std::memory_order_acquire)) ;
+    } ;
+
+    while (handle_pool_resize(self) == CONTINUE && !is_stopped())
+    {
+        if (assignment * const task = local.take())
+        {
+            exec(task) ;
+            continue ;
+        }
+
+        // Register as a sleeper _before_ the last attempt to steal: this way either
+        // we will see a task pushed into some local deque, or its pusher will see us
+        // and post a wakeup (see wake_sleeper()).
+        _sleepers.fetch_add(1, std::memory_order_seq_cst) ;
+
+        assignment * const stolen = steal_task(&local) ;
+        fwd::optional<task_ptr> task_opt ;
+
+        if (!stolen)
+            task_opt = _task_queue.pop_opt() ;
+
+        _sleepers.fetch_sub(1, std::memory_order_seq_cst) ;
+
+        if (stolen)
+            exec(stolen) ;
+
+        else if (!task_opt)
+        {
+            // The queue is closed, but, unless the pool is stopped, pending tasks
+            // may still remain in local deques.
+            assignment * const remaining = !is_stopped() ? steal_task(&local) : nullptr ;
+            if (!remaining)
+                break ;
+            exec(remaining) ;
+        }
+
+        else if (*task_opt)
+            exec(task_opt->release()) ;
+
+        else
+            // Null task is either a wakeup posted by wake_sleeper() or an attempt to
+            // speed up dismissing spare threads.
+            _wakeup_posted.store(false, std::memory_order_release) ;
+    }
+}
+
+bool threadpool::push_local_task(task_ptr &task)
+{
+    worker_context &context = this_worker() ;
+
+    if (context._pool != this)
+        return false ;
+
+    ensure<sequence_closed>(!_local_push_closed.load(std::memory_order_acquire)) ;
+
+    context._deque->push(task.get()) ;
+    task.release() ;
+
+    wake_sleeper() ;
+    return true ;
+}
+
+threadpool::worker_deque &threadpool::claim_deque()
+{
+    PCOMN_SCOPE_LOCK(lock, _pool_mutex) ;
+
+    const unsigned count = _deque_count.load(std::memory_order_relaxed) ;
+
+    // Reuse the deque of some dismissed worker, if any.
+    for (unsigned ndx = 0 ; ndx < count ; ++ndx)
+    {
+        worker_deque &d = *_deques[ndx].load(std::memory_order_relaxed) ;
+        if (!d._owned)
+        {
+            d._owned = true ;
+            return d ;
+        }
+    }
+
+    PCOMN_VERIFY(count < max_deque_count) ;
+
+    worker_deque * const d = new worker_deque ;
+    d->_owned = true ;
+
+    _deques[count].store(d, std::memory_order_release) ;
+    _deque_count.store(count + 1, std::memory_order_release) ;
+
+    return *d ;
+}
+
+void threadpool::release_deque(worker_deque &d) noexcept
+{
+    _pool_mutex.lock() ;
+    d._owned = false ;
+    _pool_mutex.unlock() ;
+
+    // Let somebody else pick up the tasks left by this worker.
+    if (d.size())
+        wake_sleeper() ;
+}
+
+threadpool::assignment *threadpool::steal_task(const worker_deque *self) noexcept
+{
+    const unsigned count = _deque_count.load(std::memory_order_acquire) ;
+    if (!count)
+        return nullptr ;
+
+    unsigned ndx = this_worker().random() % count ;
+
+    for (unsigned n = count ; n-- ; ndx = ndx + 1 < count ? ndx + 1 : 0)
+    {
+        worker_deque * const victim = _deques[ndx].load(std::memory_order_acquire) ;
+
+        if (victim == self)
+            continue ;
+
+        if (assignment * const task = victim->steal())
+        {
+            // There is more work in the victim's deque, wake up another idle worker
+            if (victim->size())
+                wake_sleeper() ;
+            return task ;
+        }
+    }
+    return nullptr ;
+}
+
+void threadpool::wake_sleeper() noexcept
+{
+    // Pairs with _sleepers.fetch_add() in stealing_worker_function(): the task the
+    // caller has just made available is either seen by the would-be sleeper, or the
+    // would-be sleeper is seen here.
+    std::atomic_thread_fence(std::memory_order_seq_cst) ;
+
+    // Post at most one wakeup at a time: a woken worker which has managed to steal
+    // a task wakes up the next one (see steal_task()).
+    if (_sleepers.load(std::memory_order_relaxed) <= 0 ||
+        _wakeup_posted.exchange(true, std::memory_order_acq_rel))
+        return ;
+
+    try {
+        if (_task_queue.try_push(task_ptr()))
+            return ;
+    }
+    // Closed queue wakes up all the sleepers anyway.
+    catch (const sequence_closed &) {}
+
+    _wakeup_posted.store(false, std::memory_order_release) ;
+}
+
+unsigned threadpool::drop_local_tasks() noexcept
+{
+    unsigned dropped_count = 0 ;
+
+    for (unsigned ndx = _deque_count.load(std::memory_order_acquire) ; ndx-- ;)
+    {
+        worker_deque &d = *_deques[ndx].load(std::memory_order_acquire) ;
+        while (assignment * const task = d.steal())
+        {
+            delete task ;
+            ++dropped_count ;
+        }
+    }
+    return dropped_count ;
+}
+
+size_t threadpool::local_pending_count() const noexcept
+{
+    size_t count = 0 ;
+    for (unsigned ndx = _deque_count.load(std::memory_order_acquire) ; ndx-- ;)
+        count += _deques[ndx].load(std::memory_order_acquire)->size() ;
+    return count ;
+}
+
+void threadpool::wait_local_deques_empty()
+{
+    // Local pushes are already closed, so the deques can only become shorter.
+    while (local_pending_count())
+        std::this_thread::sleep_for(100us) ;
+}
+
 threadpool::Dismiss threadpool::handle_pool_resize(thread_list::iterator self) noexcept
 {
     // Check if there are too many threads, and if so, dismiss itself.
@@ -468,15 +852,25 @@ void threadpool::stop(bool complete_pending_tasks)
 {
     PCOMN_SCOPE_XLOCK(lock, _pool_mutex) ;
 
+    // In WORK_STEALING mode, prohibit submission from running tasks along with
+    // closing the queue.
+    _local_push_closed.store(true, std::memory_order_release) ;
+
     if (!complete_pending_tasks)
     {
         // Close both ends, don't wait
        _task_queue.close() ;
        _thread_count.store(thread_count::stopped(), std::memory_order_release) ;
+
+       if (_deques)
+       {
+           lock.unlock() ;
+           drop_local_tasks() ;
+       }
        return ;
     }
 
-    if (_task_queue.close_push())
+    if (_task_queue.close_push() && !(_deques && local_pending_count()))
     {
         // The queue is empty anyway, nothing to wait for.
         _thread_count.store(thread_count::stopped(), std::memory_order_release) ;
@@ -494,6 +888,9 @@ void threadpool::stop(bool complete_pending_tasks)
     lock.unlock() ;
 
     _task_queue.close_push_wait_empty(100'000h) ;
+
+    if (_deques)
+        wait_local_deques_empty() ;
 }
 
 void threadpool::print(std::ostream &os) const
@@ -503,7 +900,7 @@ void threadpool::print(std::ostream &os) const
     const size_t qcapacity = _task_queue.capacity() ;
     const size_t qsize = _task_queue.size() ;
 
-    os << "threadpool{" << squote(_name) ;
+    os << "threadpool{" << squote(_name) << (_deques ? " work-stealing" : "") ;
     if (c._data == thread_count::stopped()._data)
         os << " stopped}" ;
     else
@@ -306,6 +306,14 @@ private:
   actually added, so specifying large maximum capacity does not compromize performance.
 
  @note The size of a task queue entry is 8 bytes.
+
+ The pool can optionally work in WORK_STEALING mode (see threadpool::Scheduling).
+ In this mode every worker thread additionally owns a local unbounded Chase-Lev deque:
+ jobs/tasks submitted from inside a task running on a worker of the same pool go to
+ the worker's local deque instead of the shared queue, the worker takes tasks from
+ its deque in LIFO order, and idle workers steal from other workers' deques (FIFO end)
+ starting from a random victim before they fall back to the shared queue. Tasks
+ submitted from outside the pool go through the shared queue as usual.
 *******************************************************************************/
 class threadpool {
     PCOMN_NONCOPYABLE(threadpool) ;
@@ -333,10 +341,18 @@ public:
     template<typename T>
     using result_queue_ptr = std::shared_ptr<result_queue<T>> ;
 
-    /// Create a threadpool with specified thread count, name, and maximum task queue
-    /// capacity.
+    /// Task scheduling mode of the pool.
+    enum Scheduling : bool {
+        SHARED_QUEUE,   /**< All the tasks go through the single shared task queue */
+        WORK_STEALING   /**< Tasks submitted by a worker go to its local deque,
+                           idle workers steal from other workers' deques */
+    } ;
+
+    /// Create a threadpool with specified thread count, name, maximum task queue
+    /// capacity, and scheduling mode.
     ///
-    threadpool(size_t threadcount, const strslice &name, size_t max_capacity = 0) ;
+    threadpool(size_t threadcount, const strslice &name, size_t max_capacity = 0,
+               Scheduling scheduling = SHARED_QUEUE) ;
 
     explicit threadpool(size_t threadcount, size_t max_capacity = 0) :
         threadpool(threadcount, {}, max_capacity)
@@ -359,12 +375,19 @@ public:
     /// Get the (approximate) count of pending (pushed but not yet popped) items
     /// in the queue.
     ///
-    size_t pending_count() const { return _task_queue.size() ; }
+    /// In WORK_STEALING mode this includes tasks pending in workers' local deques.
+    ///
+    size_t pending_count() const
+    {
+        return _task_queue.size() + (_deques ? local_pending_count() : 0) ;
+    }
 
     /// Get the pool name, set by the constructor.
     /// Never NULL, may be empty.
     const char *name() const { return _name ; } ;
 
+    Scheduling scheduling() const { return _deques ? WORK_STEALING : SHARED_QUEUE ; }
+
     void set_queue_capacity(unsigned new_capacity)
     {
         _task_queue.change_capacity(new_capacity) ;
@@ -385,6 +408,7 @@ public:
     ///
     /// After calling this function the thread pool is intact and ready to handle
     /// new tasks.
+    /// In WORK_STEALING mode also drops the tasks pending in workers' local deques.
     /// @return Dropped tasks count.
     ///
     unsigned clear_queue() ;
@@ -403,6 +427,9 @@ public:
     ///
     /// @note After this call the pool cannot be restarted.
     /// @note By default, stop() _drops_ all noncompleted tasks/jobs.
+    /// @note In WORK_STEALING mode, tasks pending in workers' local deques are treated
+    ///  exactly as tasks pending in the queue; after stop() submission from inside
+    ///  a running task throws sequence_closed as well.
     ///
     void stop(bool complete_pending_tasks = false) ;
 
@@ -411,8 +438,19 @@ public:
     template<typename F, typename... Args>
     void enqueue_job(F &&callable, Args &&... args)
     {
-        _task_queue.push(task_ptr(new job<std::decay_t<F>, std::decay_t<Args>...>
-                                  (std::forward<F>(callable), std::forward<Args>(args)...))) ;
+        enqueue(task_ptr(new job<std::decay_t<F>, std::decay_t<Args>...>
+                         (std::forward<F>(callable), std::forward<Args>(args)...))) ;
+    }
+
+    /// Try to put the callable object into the task queue for subsequent execution
+    /// without blocking.
+    /// The result of execution (return value or exception) is ignored.
+    /// @return false if the task queue is full (the job is not enqueued).
+    template<typename F, typename... Args>
+    bool try_enqueue_job(F &&callable, Args &&... args)
+    {
+        return try_enqueue(task_ptr(new job<std::decay_t<F>, std::decay_t<Args>...>
+                                    (std::forward<F>(callable), std::forward<Args>(args)...))) ;
     }
 
     /// Put the callable object into the task queue for subsequent execution.
@@ -426,7 +464,7 @@ public:
         task_type *new_task = new task_type(std::forward<F>(call), std::forward<Args>(args)...) ;
         auto future_result (new_task->get_future()) ;
 
-        _task_queue.push(task_ptr(new_task)) ;
+        enqueue(task_ptr(new_task)) ;
         return future_result ;
     }
 
@@ -441,7 +479,7 @@ public:
         task_type *new_task = new task_type(std::forward<F>(call), std::forward<Args>(args)...) ;
         new_task->_result_queue = output_funnel ;
 
-        _task_queue.push(task_ptr(new_task)) ;
+        enqueue(task_ptr(new_task)) ;
     }
 
     friend std::ostream &operator<<(std::ostream &os, const threadpool &v)
@@ -478,6 +516,9 @@ private:
     typedef std::unique_ptr<assignment> task_ptr ;
     typedef std::list<pthread> thread_list ;
 
+    class worker_deque ;
+    struct worker_context ;
+
     /***************************************************************************
      task
     ***************************************************************************/
@@ -590,12 +631,49 @@ private:
 
     blocking_ring_queue<task_ptr> _task_queue {estimate_max_capacity(0, 0)} ;
 
+    /* WORK_STEALING mode only, otherwise _deques is NULL.
+     * The array of max_threadcount() slots, only first _deque_count are in use; a deque,
+     * once created, lives until the pool destruction. Workers claim free deques on start
+     * and release on exit, so the deques of dismissed workers remain available for
+     * stealing and then for reuse. */
+    std::unique_ptr<std::atomic<worker_deque *>[]> _deques ;
+    std::atomic<unsigned> _deque_count {0} ;
+    std::atomic<bool>     _local_push_closed {false} ;
+
+    alignas(cacheline_t)
+    std::atomic<int>      _sleepers {0} ;   /* Workers blocked on the shared queue */
+    std::atomic<bool>     _wakeup_posted {false} ;
+
 private:
     enum Dismiss : bool { CONTINUE, DISMISS } ;
 
+    void enqueue(task_ptr &&task)
+    {
+        if (!_deques || !push_local_task(task))
+            _task_queue.push(std::move(task)) ;
+    }
+
+    bool try_enqueue(task_ptr &&task)
+    {
+        return (_deques && push_local_task(task)) || _task_queue.try_push(std::move(task)) ;
+    }
+
     void worker_thread_function(thread_list::iterator) ;
+    void stealing_worker_function(thread_list::iterator) ;
     void start_thread() ;
 
+    // WORK_STEALING mode
+    bool push_local_task(task_ptr &) ;
+    worker_deque &claim_deque() ;
+    void release_deque(worker_deque &) noexcept ;
+    assignment *steal_task(const worker_deque *self) noexcept ;
+    void wake_sleeper() noexcept ;
+    unsigned drop_local_tasks() noexcept ;
+    size_t local_pending_count() const noexcept ;
+    void wait_local_deques_empty() ;
+
+    static worker_context &this_worker() noexcept ;
+
     Dismiss handle_pool_resize(thread_list::iterator self) noexcept ;
     // Returns {dismiss,count_with_updated_pending}
     std::pair<bool, thread_count> check_dismiss_itself(thread_list::iterator self) noexcept ;
@@ -4,12 +4,14 @@
  COPYRIGHT    :   Yakov Markovitch, 2016-2020. All rights reserved.
                   See LICENSE for information on usage/redistribution.
 
- DESCRIPTION  :   Compare performance of std::unordered_map and closed_hashtable.
+ DESCRIPTION  :   Compare performance of std::unordered_map and closed_hashtable
+                  with linear probing, group probing, and Robin Hood bucket layouts.
 
  PROGRAMMED BY:   Yakov Markovitch
  CREATION DATE:   9 Aug 2016
 *******************************************************************************/
 #include <pcomn_hashclosed.h>
+#include <pcomn_hashrobin.h>
 #include <pcomn_stopwatch.h>
 #include <pcomn_unittest.h>
 #include <pcomn_hash.h>
@@ -160,9 +162,13 @@ int main(int argc, char *argv[])
    prepare_data(count) ;
 
    typedef closed_hashtable<data_type, pcomn::select<0>, void, void, data_state_extractor> pcommon_hashtable ;
+   typedef closed_hashtable<data_type, pcomn::select<0>, void, void, void, group_probing_layout> pcommon_group_hashtable ;
+   typedef closed_hashtable<data_type, pcomn::select<0>, void, void, void, robin_hood_layout> pcommon_robin_hashtable ;
    typedef std::unordered_map<md5hash_t, int64_t> stl_hashtable ;
 
    run_hashtable<pcommon_hashtable>(rounds) ;
+   run_hashtable<pcommon_group_hashtable>(rounds) ;
+   run_hashtable<pcommon_robin_hashtable>(rounds) ;
    run_hashtable<stl_hashtable>(rounds) ;
 
    return 0 ;
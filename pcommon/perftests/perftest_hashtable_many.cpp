@@ -0,0 +1,117 @@
+/*-*- tab-width:3;indent-tabs-mode:nil;c-file-style:"ellemtel";c-file-offsets:((innamespace . 0)(inclass . ++)) -*-*/
+/*******************************************************************************
+ FILE         :   perftest_hashtable_many.cpp
+ COPYRIGHT    :   Yakov Markovitch, 2026. All rights reserved.
+                  See LICENSE for information on usage/redistribution.
+
+ DESCRIPTION  :   Compare performance of the batched prefetching closed_hashtable
+                  lookup (count_many) with the lookup one key at a time.
+
+ PROGRAMMED BY:   Yakov Markovitch
+ CREATION DATE:   16 Oct 2026
+*******************************************************************************/
+#include <pcomn_hashclosed.h>
+#include <pcomn_hashrobin.h>
+#include <pcomn_stopwatch.h>
+#include <pcomn_unittest.h>
+
+#include <random>
+#include <algorithm>
+#include <iomanip>
+
+using namespace pcomn ;
+using namespace std ;
+
+static vector<uint64_t> hit_data ;
+static vector<uint64_t> miss_data ;
+
+static void prepare_data(size_t count)
+{
+   std::cerr << "Preparing " << count << " test data points..." << std::endl ;
+
+   mt19937_64 random (1) ;
+   hit_data.resize(count) ;
+   miss_data.resize(count) ;
+   // Odd keys are inserted, even keys are looked for as misses
+   for (size_t i = 0 ; i < count ; ++i)
+   {
+      const uint64_t v = random() ;
+      hit_data[i] = v | 1 ;
+      miss_data[i] = v & ~(uint64_t)1 ;
+   }
+   std::cerr << "OK" << std::endl ;
+}
+
+template<typename Table>
+static void run_hashtable(const char *name, size_t rounds)
+{
+   Table table (hit_data.size()) ;
+   table.insert(hit_data.begin(), hit_data.end()) ;
+
+   vector<uint64_t> hit_order (hit_data) ;
+   shuffle(hit_order.begin(), hit_order.end(), mt19937_64(2)) ;
+
+   std::cout << name << ": " << table << std::endl ;
+
+   PCpuStopwatch stopwatch ;
+   for (size_t r = 0 ; r < rounds ; ++r)
+   {
+      size_t found = 0 ;
+
+      stopwatch.restart() ;
+      for (uint64_t key: hit_order)
+         found += table.count(key) ;
+      const double hit_scalar = stopwatch.stop() ;
+
+      stopwatch.restart() ;
+      found += table.count_many(hit_order.begin(), hit_order.end()) ;
+      const double hit_batch = stopwatch.stop() ;
+
+      stopwatch.restart() ;
+      for (uint64_t key: miss_data)
+         found += table.count(key) ;
+      const double miss_scalar = stopwatch.stop() ;
+
+      stopwatch.restart() ;
+      found += table.count_many(miss_data.begin(), miss_data.end()) ;
+      const double miss_batch = stopwatch.stop() ;
+
+      PCOMN_VERIFY(found == 2*hit_order.size()) ;
+
+      const double count = hit_order.size() ;
+      std::cout << "round " << r + 1 << std::fixed << std::setprecision(2)
+                << "  hits Mops/s: scalar " << count/hit_scalar/1e6
+                << ", batch " << count/hit_batch/1e6
+                << "  misses Mops/s: scalar " << count/miss_scalar/1e6
+                << ", batch " << count/miss_batch/1e6 << std::endl ;
+   }
+   std::cout << std::endl ;
+}
+
+/*******************************************************************************
+
+*******************************************************************************/
+int main(int argc, char *argv[])
+{
+   if (argc != 3)
+   {
+      std::cerr << "Usage: " << PCOMN_PROGRAM_SHORTNAME << " DATA_COUNT ROUND_COUNT" << std::endl ;
+      return 1 ;
+   }
+
+   const size_t count = atoll(argv[1]) ;
+   const size_t rounds = atoll(argv[2]) ;
+   if (!count)
+   {
+      std::cerr << "Zero data count specified" << std::endl ;
+      return 3 ;
+   }
+
+   prepare_data(count) ;
+
+   run_hashtable<closed_hashtable<uint64_t>>("linear probing", rounds) ;
+   run_hashtable<closed_hashtable<uint64_t, void, void, void, void, group_probing_layout>>("group probing", rounds) ;
+   run_hashtable<closed_hashtable<uint64_t, void, void, void, void, robin_hood_layout>>("Robin Hood", rounds) ;
+
+   return 0 ;
+}
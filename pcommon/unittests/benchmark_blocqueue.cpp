@@ -0,0 +1,113 @@
+/*-*- tab-width:4;indent-tabs-mode:nil;c-file-style:"ellemtel";c-basic-offset:4;c-file-offsets:((innamespace . 0)(inlambda . 0)) -*-*/
+/*******************************************************************************
+ FILE         :   benchmark_blocqueue.cpp
+ COPYRIGHT    :   Yakov Markovitch, 2026. All rights reserved.
+                  See LICENSE for information on usage/redistribution.
+
+ DESCRIPTION  :   Producer scaling benchmark for blocking queues with different
+                  underlying containers.
+
+ PROGRAMMED BY:   Yakov Markovitch
+ CREATION DATE:   16 Oct 2026
+*******************************************************************************/
+#include <pcomn_blocqueue.h>
+#include <pcomn_stopwatch.h>
+#include <pcomn_except.h>
+
+#include <iostream>
+#include <iomanip>
+#include <thread>
+#include <vector>
+
+#include <stdlib.h>
+
+using namespace pcomn ;
+
+static void usage(const char *progname)
+{
+    std::cerr << "Usage: " << progname << " items_per_producer [max_producers [consumers [capacity]]]\n"
+        "Measure blocking_queue throughput for 1, 2, 4, ... max_producers producers.\n" ;
+    exit(1) ;
+}
+
+template<typename Q>
+__noinline double run_bench(unsigned producers, unsigned consumers, unsigned capacity, uint64_t pcount)
+{
+    Q queue (capacity) ;
+
+    std::vector<std::thread> threads ;
+    threads.reserve(producers + consumers) ;
+
+    PRealStopwatch wall_stopwatch ;
+    wall_stopwatch.start() ;
+
+    for (unsigned c = consumers ; c-- ;)
+        threads.emplace_back([&queue]
+        {
+            try { for (;;) queue.pop_some(64) ; }
+            catch (const sequence_closed &) {}
+        }) ;
+
+    for (unsigned p = producers ; p-- ;)
+        threads.emplace_back([&queue, pcount]
+        {
+            for (uint64_t i = 0 ; i < pcount ; ++i)
+                queue.push(i) ;
+        }) ;
+
+    // Join producers first (they are at the back), then close and join consumers.
+    for (unsigned p = producers ; p-- ;)
+    {
+        threads.back().join() ;
+        threads.pop_back() ;
+    }
+    queue.close_push_wait_empty(std::chrono::minutes(1)) ;
+
+    for (std::thread &t: threads)
+        t.join() ;
+
+    wall_stopwatch.stop() ;
+
+    return pcount*producers/wall_stopwatch.elapsed() ;
+}
+
+int main(int argc, char *argv[])
+{
+    if (!inrange(argc, 2, 5))
+        usage(*argv) ;
+
+    const long pcount        = atol(argv[1]) ;
+    const int  max_producers = argc > 2 ? atoi(argv[2]) : 16 ;
+    const int  consumers     = argc > 3 ? atoi(argv[3]) : 2 ;
+    const int  capacity      = argc > 4 ? atoi(argv[4]) : 1024 ;
+
+    if (pcount <= 0 || max_producers <= 0 || consumers <= 0 || capacity <= 0)
+        usage(*argv) ;
+
+    try {
+        std::cout << pcount << " items per producer, " << consumers << " consumers, queue capacity "
+                  << capacity << "\n\n"
+                  << std::setw(9) << "producers"
+                  << std::setw(16) << "list, Mops/s"
+                  << std::setw(16) << "ring, Mops/s"
+                  << std::setw(20) << "lockfree, Mops/s" << std::endl ;
+
+        for (unsigned producers = 1 ; producers <= (unsigned)max_producers ; producers *= 2)
+        {
+            std::cout << std::setw(9) << producers << std::fixed << std::setprecision(2) << std::flush
+                      << std::setw(16)
+                      << run_bench<blocking_list_queue<uint64_t>>(producers, consumers, capacity, pcount)/1e6
+                      << std::flush << std::setw(16)
+                      << run_bench<blocking_ring_queue<uint64_t>>(producers, consumers, capacity, pcount)/1e6
+                      << std::flush << std::setw(20)
+                      << run_bench<blocking_lockfree_ring_queue<uint64_t>>(producers, consumers, capacity, pcount)/1e6
+                      << std::endl ;
+        }
+    }
+    catch (const std::exception &x)
+    {
+        std::cerr << STDEXCEPTOUT(x) << std::endl ;
+        return 1 ;
+    }
+    return 0 ;
+}
@@ -0,0 +1,126 @@
+/*-*- tab-width:4;indent-tabs-mode:nil;c-file-style:"ellemtel";c-basic-offset:4;c-file-offsets:((innamespace . 0)(inlambda . 0)) -*-*/
+/*******************************************************************************
+ FILE         :   benchmark_cacher.cpp
+ COPYRIGHT    :   Yakov Markovitch, 2026. All rights reserved.
+                  See LICENSE for information on usage/redistribution.
+
+ DESCRIPTION  :   Hit ratio and throughput benchmark for cacher eviction policies
+                  on Zipfian and scan-mixed access traces.
+
+ PROGRAMMED BY:   Yakov Markovitch
+ CREATION DATE:   16 Oct 2026
+*******************************************************************************/
+#include <pcomn_cacher.h>
+#include <pcomn_stopwatch.h>
+#include <pcomn_except.h>
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <random>
+#include <algorithm>
+#include <cmath>
+
+#include <stdlib.h>
+
+using namespace pcomn ;
+
+static void usage(const char *progname)
+{
+    std::cerr << "Usage: " << progname << " accesses [cache_size [key_count [zipf_skew]]]\n"
+        "Measure hit ratio and throughput of LRU, CLOCK, and W-TinyLFU cacher eviction.\n" ;
+    exit(1) ;
+}
+
+typedef std::vector<uint64_t> trace_type ;
+
+static trace_type zipf_trace(size_t count, size_t keys, double skew, uint64_t seed)
+{
+    std::vector<double> cdf (keys) ;
+    double sum = 0 ;
+    for (size_t k = 0 ; k < keys ; ++k)
+        cdf[k] = sum += 1.0/std::pow(k + 1, skew) ;
+
+    std::mt19937_64 rng (seed) ;
+    std::uniform_real_distribution<double> uniform (0, sum) ;
+    trace_type result (count) ;
+    for (uint64_t &key: result)
+        key = std::lower_bound(cdf.begin(), cdf.end(), uniform(rng)) - cdf.begin() ;
+    return result ;
+}
+
+// Every other access of the Zipfian trace is replaced by the next key of a
+// sequential scan over keys never seen before
+static trace_type scan_mixed_trace(size_t count, size_t keys, double skew, uint64_t seed)
+{
+    trace_type result (zipf_trace(count, keys, skew, seed)) ;
+    uint64_t scankey = keys ;
+    for (size_t i = 1 ; i < result.size() ; i += 2)
+        result[i] = scankey++ ;
+    return result ;
+}
+
+template<typename Eviction>
+__noinline void run_bench(const trace_type &trace, size_t cache_size)
+{
+    cacher<uint64_t, identity, hash_fn<uint64_t>, std::equal_to<uint64_t>, Eviction> cache (cache_size) ;
+    size_t hits = 0 ;
+
+    PRealStopwatch wall_stopwatch ;
+    wall_stopwatch.start() ;
+
+    for (uint64_t key: trace)
+    {
+        uint64_t found ;
+        if (cache.get(key, found))
+            ++hits ;
+        else
+            cache.put(key) ;
+    }
+
+    wall_stopwatch.stop() ;
+
+    std::cout << std::setw(12) << (100.0*hits/trace.size())
+              << std::setw(12) << trace.size()/wall_stopwatch.elapsed()/1e6 << std::flush ;
+}
+
+static void run_trace(const char *name, const trace_type &trace, size_t cache_size)
+{
+    std::cout << std::setw(12) << name << std::fixed << std::setprecision(2) ;
+    run_bench<lru_eviction>(trace, cache_size) ;
+    run_bench<clock_eviction>(trace, cache_size) ;
+    run_bench<wtinylfu_eviction>(trace, cache_size) ;
+    std::cout << std::endl ;
+}
+
+int main(int argc, char *argv[])
+{
+    if (!inrange(argc, 2, 5))
+        usage(*argv) ;
+
+    const long   count      = atol(argv[1]) ;
+    const long   cache_size = argc > 2 ? atol(argv[2]) : 1000 ;
+    const long   keys       = argc > 3 ? atol(argv[3]) : 100000 ;
+    const double skew       = argc > 4 ? atof(argv[4]) : 0.99 ;
+
+    if (count <= 0 || cache_size <= 0 || keys <= 0 || skew <= 0)
+        usage(*argv) ;
+
+    try {
+        std::cout << count << " accesses, cache size " << cache_size << ", " << keys
+                  << " keys, Zipf skew " << skew << "\n\n"
+                  << std::setw(12) << "trace"
+                  << std::setw(24) << "LRU hit%, Mops/s"
+                  << std::setw(24) << "CLOCK hit%, Mops/s"
+                  << std::setw(24) << "W-TinyLFU hit%, Mops/s" << std::endl ;
+
+        run_trace("zipf", zipf_trace(count, keys, skew, 1), cache_size) ;
+        run_trace("scan-mixed", scan_mixed_trace(count, keys, skew, 2), cache_size) ;
+    }
+    catch (const std::exception &x)
+    {
+        std::cerr << STDEXCEPTOUT(x) << std::endl ;
+        return 1 ;
+    }
+    return 0 ;
+}
@@ -0,0 +1,105 @@
+/*-*- tab-width:4;indent-tabs-mode:nil;c-file-style:"ellemtel";c-basic-offset:4;c-file-offsets:((innamespace . 0)(inlambda . 0)) -*-*/
+/*******************************************************************************
+ FILE         :   benchmark_crc32.cpp
+ COPYRIGHT    :   Yakov Markovitch, 2026. All rights reserved.
+                  See LICENSE for information on usage/redistribution.
+
+ DESCRIPTION  :   Throughput benchmark for CRC32 and CRC32C implementations
+                  on a range of buffer sizes.
+
+ PROGRAMMED BY:   Yakov Markovitch
+ CREATION DATE:   16 Oct 2026
+*******************************************************************************/
+#include <pcomn_hash.h>
+#include <pcomn_stopwatch.h>
+#include <pcomn_except.h>
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <random>
+
+#include <stdlib.h>
+
+using namespace pcomn ;
+
+static void usage(const char *progname)
+{
+    std::cerr << "Usage: " << progname << " [total_MiB]\n"
+        "Measure throughput (GB/s) of CRC32 and CRC32C implementations for various buffer sizes.\n" ;
+    exit(1) ;
+}
+
+typedef uint32_t (*crc_using_fn)(crc32_impl_t, uint32_t, const void *, size_t) ;
+
+__noinline void run_bench(crc_using_fn crc, crc32_impl_t impl, const std::vector<char> &data,
+                          size_t bufsize, size_t total)
+{
+    const size_t rounds = std::max<size_t>(total/bufsize, 1) ;
+    const size_t offsets = data.size() - bufsize + 1 ;
+    uint32_t result = 0 ;
+
+    PRealStopwatch wall_stopwatch ;
+    wall_stopwatch.start() ;
+
+    for (size_t i = 0 ; i < rounds ; ++i)
+        result = crc(impl, result, data.data() + (i*64) % offsets, bufsize) ;
+
+    wall_stopwatch.stop() ;
+
+    // Prevent optimizing the calculation out
+    if (result == 0x12345678)
+        std::cout << '!' ;
+
+    std::cout << std::setw(10) << rounds*bufsize/wall_stopwatch.elapsed()/1e9 << std::flush ;
+}
+
+static void run_polynomial(const char *name, crc_using_fn crc, bool hw_supported,
+                           const std::vector<char> &data, size_t total)
+{
+    static const size_t sizes[] = { 16, 64, 256, 1024, 4096, 65536, 1024*1024 } ;
+
+    std::cout << name << (hw_supported ? "" : " (no hardware support, HW is the default)")
+              << "\n\n" << std::setw(10) << "size"
+              << std::setw(10) << "byte"
+              << std::setw(10) << "slice8"
+              << std::setw(10) << "slice16"
+              << std::setw(10) << "HW" << std::endl ;
+
+    for (size_t bufsize: sizes)
+    {
+        std::cout << std::setw(10) << bufsize ;
+        for (crc32_impl_t impl: {CRC32_BYTEWISE, CRC32_SLICE8, CRC32_SLICE16, CRC32_HARDWARE})
+            run_bench(crc, impl, data, bufsize, total) ;
+        std::cout << std::endl ;
+    }
+    std::cout << std::endl ;
+}
+
+int main(int argc, char *argv[])
+{
+    if (!inrange(argc, 1, 2))
+        usage(*argv) ;
+
+    const long total_mib = argc > 1 ? atol(argv[1]) : 256 ;
+    if (total_mib <= 0)
+        usage(*argv) ;
+
+    try {
+        std::vector<char> data (2*MiB) ;
+        std::mt19937 rng (1) ;
+        for (char &c: data)
+            c = rng() ;
+
+        std::cout << total_mib << "MiB per measurement, GB/s\n\n" << std::fixed << std::setprecision(2) ;
+
+        run_polynomial("CRC32", calc_crc32_using, crc32_hw_supported(), data, total_mib*MiB) ;
+        run_polynomial("CRC32C", calc_crc32c_using, crc32c_hw_supported(), data, total_mib*MiB) ;
+    }
+    catch (const std::exception &x)
+    {
+        std::cerr << STDEXCEPTOUT(x) << std::endl ;
+        return 1 ;
+    }
+    return 0 ;
+}
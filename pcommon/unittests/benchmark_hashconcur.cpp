@@ -0,0 +1,145 @@
+/*-*- tab-width:4;indent-tabs-mode:nil;c-file-style:"ellemtel";c-basic-offset:4;c-file-offsets:((innamespace . 0)(inlambda . 0)) -*-*/
+/*******************************************************************************
+ FILE         :   benchmark_hashconcur.cpp
+ COPYRIGHT    :   Yakov Markovitch, 2026. All rights reserved.
+                  See LICENSE for information on usage/redistribution.
+
+ DESCRIPTION  :   Mixed read/write scaling benchmark for concurrent_hashtable vs.
+                  closed_hashtable guarded by shared_mutex.
+
+ PROGRAMMED BY:   Yakov Markovitch
+ CREATION DATE:   16 Oct 2026
+*******************************************************************************/
+#include <pcomn_hashconcur.h>
+#include <pcomn_hashclosed.h>
+#include <pcomn_syncobj.h>
+#include <pcomn_stopwatch.h>
+#include <pcomn_except.h>
+
+#include <iostream>
+#include <iomanip>
+#include <thread>
+#include <vector>
+#include <random>
+
+#include <stdlib.h>
+
+using namespace pcomn ;
+
+static void usage(const char *progname)
+{
+    std::cerr << "Usage: " << progname << " ops_per_thread [max_threads [key_count]]\n"
+        "Measure lookup/replace throughput for 1, 2, 4, ... max_threads threads\n"
+        "and 0%, 1%, 10% of replaces.\n" ;
+    exit(1) ;
+}
+
+/*******************************************************************************
+ Uniform interface over the tables being compared
+*******************************************************************************/
+class locked_table {
+public:
+    bool get(uint64_t key) const
+    {
+        PCOMN_SCOPE_R_LOCK (guard, _lock) ;
+        return _data.find(key) != _data.end() ;
+    }
+    void replace(uint64_t key)
+    {
+        PCOMN_SCOPE_W_LOCK (guard, _lock) ;
+        _data.replace(key) ;
+    }
+private:
+    mutable shared_mutex       _lock ;
+    closed_hashtable<uint64_t> _data ;
+} ;
+
+class concurrent_table {
+public:
+    bool get(uint64_t key) const
+    {
+        uint64_t found ;
+        return _data.get(key, found) ;
+    }
+    void replace(uint64_t key) { _data.replace(key) ; }
+private:
+    concurrent_hashtable<uint64_t> _data ;
+} ;
+
+template<typename Table>
+__noinline double run_bench(unsigned threads, unsigned write_permille, uint64_t count, uint64_t keys)
+{
+    Table table ;
+    for (uint64_t k = 0 ; k < keys ; ++k)
+        table.replace(k) ;
+
+    std::vector<std::thread> workers ;
+    workers.reserve(threads) ;
+    std::atomic<uint64_t> found {0} ;
+
+    PRealStopwatch wall_stopwatch ;
+    wall_stopwatch.start() ;
+
+    for (unsigned t = 0 ; t < threads ; ++t)
+        workers.emplace_back([&, t]
+        {
+            std::mt19937_64 rng (t + 1) ;
+            uint64_t hits = 0 ;
+            for (uint64_t i = 0 ; i < count ; ++i)
+            {
+                const uint64_t r = rng() ;
+                const uint64_t key = r % keys ;
+                if ((r >> 40) % 1000 < write_permille)
+                    table.replace(key) ;
+                else
+                    hits += table.get(key) ;
+            }
+            found += hits ;
+        }) ;
+
+    for (std::thread &t: workers)
+        t.join() ;
+
+    wall_stopwatch.stop() ;
+
+    return count*threads/wall_stopwatch.elapsed() ;
+}
+
+int main(int argc, char *argv[])
+{
+    if (!inrange(argc, 2, 4))
+        usage(*argv) ;
+
+    const long count       = atol(argv[1]) ;
+    const int  max_threads = argc > 2 ? atoi(argv[2]) : std::thread::hardware_concurrency() ;
+    const long keys        = argc > 3 ? atol(argv[3]) : 1000000 ;
+
+    if (count <= 0 || max_threads <= 0 || keys <= 0)
+        usage(*argv) ;
+
+    try {
+        std::cout << count << " operations per thread, " << keys << " keys\n\n"
+                  << std::setw(9) << "threads"
+                  << std::setw(9) << "writes%"
+                  << std::setw(22) << "shared_mutex, Mops/s"
+                  << std::setw(20) << "concurrent, Mops/s" << std::endl ;
+
+        for (unsigned threads = 1 ; threads <= (unsigned)max_threads ; threads *= 2)
+            for (unsigned write_permille: {0, 10, 100})
+            {
+                std::cout << std::setw(9) << threads << std::fixed << std::setprecision(1)
+                          << std::setw(9) << write_permille/10.0 << std::setprecision(2) << std::flush
+                          << std::setw(22)
+                          << run_bench<locked_table>(threads, write_permille, count, keys)/1e6
+                          << std::flush << std::setw(20)
+                          << run_bench<concurrent_table>(threads, write_permille, count, keys)/1e6
+                          << std::endl ;
+            }
+    }
+    catch (const std::exception &x)
+    {
+        std::cerr << STDEXCEPTOUT(x) << std::endl ;
+        return 1 ;
+    }
+    return 0 ;
+}
@@ -0,0 +1,140 @@
+/*-*- tab-width:4;indent-tabs-mode:nil;c-file-style:"ellemtel";c-basic-offset:4;c-file-offsets:((innamespace . 0)(inlambda . 0)) -*-*/
+/*******************************************************************************
+ FILE         :   benchmark_internstr.cpp
+ COPYRIGHT    :   Yakov Markovitch, 2026. All rights reserved.
+                  See LICENSE for information on usage/redistribution.
+
+ DESCRIPTION  :   Memory footprint and lookup/comparison benchmark for interned_string
+                  vs. immutable_string on data with many duplicate strings.
+
+ PROGRAMMED BY:   Yakov Markovitch
+ CREATION DATE:   16 Oct 2026
+*******************************************************************************/
+#include <pcomn_internstr.h>
+#include <pcomn_immutablestr.h>
+#include <pcomn_stopwatch.h>
+#include <pcomn_except.h>
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <unordered_set>
+#include <random>
+
+#include <stdlib.h>
+
+using namespace pcomn ;
+
+static void usage(const char *progname)
+{
+    std::cerr << "Usage: " << progname << " string_count [distinct_count [min_length]]\n"
+        "Create string_count strings taking distinct_count distinct values, as istring\n"
+        "and as internstr, and measure memory, hash set lookup and comparison.\n" ;
+    exit(1) ;
+}
+
+struct istring_hash {
+    size_t operator()(const istring &s) const { return valhash(strslice(s)) ; }
+} ;
+
+// Don't let the optimizer throw away the results
+static volatile size_t sink ;
+
+template<typename String, typename Hash = hash_fn<String>>
+__noinline void run_bench(const char *name, const std::vector<std::string> &source,
+                          size_t distinct, size_t (*memsize)(const std::vector<String> &))
+{
+    PCpuStopwatch stopwatch ;
+
+    // Create
+    stopwatch.start() ;
+    std::vector<String> strings (source.begin(), source.end()) ;
+    stopwatch.stop() ;
+    const double create_time = stopwatch.elapsed() ;
+
+    std::unordered_set<String, Hash> set (strings.begin(), strings.begin() + distinct) ;
+
+    // Lookup
+    stopwatch.restart() ;
+    size_t found = 0 ;
+    for (const String &s: strings)
+        found += set.count(s) ;
+    stopwatch.stop() ;
+    const double lookup_time = stopwatch.elapsed() ;
+
+    // Compare adjacent strings
+    stopwatch.restart() ;
+    size_t equal = 0 ;
+    for (size_t i = 1 ; i < strings.size() ; ++i)
+        equal += strings[i] == strings[i - 1] ;
+    stopwatch.stop() ;
+    const double compare_time = stopwatch.elapsed() ;
+
+    sink = found + equal ;
+
+    const double count = strings.size() ;
+    std::cout << std::setw(10) << name << std::fixed << std::setprecision(2)
+              << std::setw(14) << memsize(strings)/double(MiB)
+              << std::setw(14) << count/create_time/1e6
+              << std::setw(14) << count/lookup_time/1e6
+              << std::setw(14) << count/compare_time/1e6 << std::endl ;
+}
+
+static size_t istring_memsize(const std::vector<istring> &strings)
+{
+    // Every istring has its own copy of the data (malloc overhead is not counted)
+    size_t result = strings.size()*sizeof(istring) ;
+    for (const istring &s: strings)
+        result += sizeof(refcounted_strdata<char>) + s.size() ;
+    return result ;
+}
+
+static size_t internstr_memsize(const std::vector<internstr> &strings)
+{
+    // The pool is shared by all interned strings, but nothing else is interned here
+    return strings.size()*sizeof(internstr) + internstr::pool_stats().memsize ;
+}
+
+int main(int argc, char *argv[])
+{
+    if (!inrange(argc, 2, 4))
+        usage(*argv) ;
+
+    const long count      = atol(argv[1]) ;
+    const long distinct   = argc > 2 ? atol(argv[2]) : count/100 ;
+    const long min_length = argc > 3 ? atol(argv[3]) : 16 ;
+
+    if (count <= 0 || distinct <= 0 || distinct > count || min_length < 0)
+        usage(*argv) ;
+
+    try {
+        // The first distinct strings are all the distinct values, the rest are
+        // random duplicates
+        std::mt19937_64 rng (1) ;
+        std::vector<std::string> values ;
+        values.reserve(distinct) ;
+        for (long i = 0 ; i < distinct ; ++i)
+            values.push_back(std::string(min_length + rng() % 16, 'a' + i % 26) + std::to_string(i)) ;
+
+        std::vector<std::string> source (values) ;
+        source.reserve(count) ;
+        for (long i = distinct ; i < count ; ++i)
+            source.push_back(values[rng() % distinct]) ;
+
+        std::cout << count << " strings, " << distinct << " distinct\n\n"
+                  << std::setw(10) << "type"
+                  << std::setw(14) << "memory, MiB"
+                  << std::setw(14) << "create, M/s"
+                  << std::setw(14) << "lookup, M/s"
+                  << std::setw(14) << "compare, M/s" << std::endl ;
+
+        run_bench<istring, istring_hash>("istring", source, distinct, istring_memsize) ;
+        run_bench<internstr>("internstr", source, distinct, internstr_memsize) ;
+    }
+    catch (const std::exception &x)
+    {
+        std::cerr << STDEXCEPTOUT(x) << std::endl ;
+        return 1 ;
+    }
+    return 0 ;
+}
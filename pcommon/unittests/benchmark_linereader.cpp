@@ -0,0 +1,106 @@
+/*-*- tab-width:4;indent-tabs-mode:nil;c-file-style:"ellemtel";c-basic-offset:4;c-file-offsets:((innamespace . 0)(inlambda . 0)) -*-*/
+/*******************************************************************************
+ FILE         :   benchmark_linereader.cpp
+ COPYRIGHT    :   Yakov Markovitch, 2026. All rights reserved.
+                  See LICENSE for information on usage/redistribution.
+
+ DESCRIPTION  :   Line reading throughput: text_reader::readline() vs. line_reader
+                  over a stdio file and over a memory-mapped file.
+
+ PROGRAMMED BY:   Yakov Markovitch
+ CREATION DATE:   16 Oct 2026
+*******************************************************************************/
+#include <pcomn_textio.h>
+#include <pcomn_mmap.h>
+#include <pcomn_handle.h>
+#include <pcomn_stopwatch.h>
+#include <pcomn_except.h>
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+
+#include <stdlib.h>
+#include <stdio.h>
+
+using namespace pcomn ;
+
+static void usage(const char *progname)
+{
+    std::cerr << "Usage: " << progname << " filename\n"
+        "Read the text file line by line with text_reader and line_reader.\n" ;
+    exit(1) ;
+}
+
+static FILE *open_file(const char *filename)
+{
+    FILE * const f = fopen(filename, "rb") ;
+    PCOMN_THROW_MSG_IF(!f, std::runtime_error, "Cannot open '%s'", filename) ;
+    return f ;
+}
+
+// Don't let the optimizer throw away the results
+static volatile size_t sink ;
+
+template<typename F>
+__noinline void run_bench(const char *name, size_t filesize, F &&read_lines)
+{
+    PRealStopwatch stopwatch ;
+    stopwatch.start() ;
+    const size_t lines = read_lines() ;
+    stopwatch.stop() ;
+
+    sink = lines ;
+    std::cout << std::setw(24) << name << std::setw(12) << lines << std::fixed << std::setprecision(1)
+              << std::setw(14) << filesize/stopwatch.elapsed()/double(MiB) << std::endl ;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc != 2)
+        usage(*argv) ;
+
+    const char * const filename = argv[1] ;
+
+    try {
+        const PMemMapping file (filename) ;
+        const size_t filesize = file.size() ;
+
+        std::cout << filename << ", " << filesize << " bytes\n\n"
+                  << std::setw(24) << "reader"
+                  << std::setw(12) << "lines"
+                  << std::setw(14) << "MiB/s" << std::endl ;
+
+        run_bench("text_reader", filesize, [&]
+        {
+            FILE_safehandle f (open_file(filename)) ;
+            universal_text_reader<FILE *> reader (f.get()) ;
+            size_t count = 0 ;
+            for (std::string line ; (line.clear(), reader.readline(line)) ; ++count) ;
+            return count ;
+        }) ;
+
+        run_bench("line_reader(FILE *)", filesize, [&]
+        {
+            FILE_safehandle f (open_file(filename)) ;
+            universal_line_reader<FILE *> reader (f.get()) ;
+            size_t count = 0 ;
+            for (strslice line ; reader.readline(line) ; ++count) ;
+            return count ;
+        }) ;
+
+        run_bench("line_reader(mmap)", filesize, [&]
+        {
+            line_reader reader (file.cdata(), file.cdata() + filesize) ;
+            size_t count = 0 ;
+            for (strslice line ; reader.readline(line) ; ++count) ;
+            return count ;
+        }) ;
+    }
+    catch (const std::exception &x)
+    {
+        std::cerr << STDEXCEPTOUT(x) << std::endl ;
+        return 1 ;
+    }
+    return 0 ;
+}
@@ -0,0 +1,135 @@
+/*-*- tab-width:4;indent-tabs-mode:nil;c-file-style:"ellemtel";c-basic-offset:4;c-file-offsets:((innamespace . 0)(inlambda . 0)) -*-*/
+/*******************************************************************************
+ FILE         :   benchmark_strscan.cpp
+ COPYRIGHT    :   Yakov Markovitch, 2026. All rights reserved.
+                  See LICENSE for information on usage/redistribution.
+
+ DESCRIPTION  :   Byte set scan benchmark: find_first_of, strip and split of log-like
+                  lines with every scan kernel variant the CPU supports.
+
+ PROGRAMMED BY:   Yakov Markovitch
+ CREATION DATE:   16 Oct 2026
+*******************************************************************************/
+#include <pcomn_strslice.h>
+#include <pcomn_strscan.h>
+#include <pcomn_stopwatch.h>
+#include <pcomn_except.h>
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <random>
+
+#include <stdlib.h>
+
+using namespace pcomn ;
+
+static void usage(const char *progname)
+{
+    std::cerr << "Usage: " << progname << " line_count [field_length [repeat]]\n"
+        "Create line_count log-like lines with fields of ~field_length bytes surrounded\n"
+        "by spaces and measure find_first_of, strip and split throughput.\n" ;
+    exit(1) ;
+}
+
+// Don't let the optimizer throw away the results
+static volatile size_t sink ;
+
+static double mbps(size_t bytes, double seconds) { return bytes/seconds/double(MiB) ; }
+
+__noinline void run_bench(const std::vector<std::string> &lines, size_t repeat)
+{
+    const byteset stopchars ("\"=") ;
+    const byteset separators (" \t;|") ;
+
+    size_t bytes = 0 ;
+    for (const std::string &line: lines)
+        bytes += line.size() ;
+    bytes *= repeat ;
+
+    PCpuStopwatch stopwatch ;
+    size_t result = 0 ;
+
+    // Find the first of rare chars
+    stopwatch.start() ;
+    for (size_t r = 0 ; r < repeat ; ++r)
+        for (const std::string &line: lines)
+            result += strscan::find_first_of(line.data(), line.data() + line.size(), stopchars) - line.data() ;
+    stopwatch.stop() ;
+    const double find_time = stopwatch.elapsed() ;
+
+    // Strip leading and trailing spaces
+    stopwatch.restart() ;
+    for (size_t r = 0 ; r < repeat ; ++r)
+        for (const std::string &line: lines)
+            result += str::strip(line).size() ;
+    stopwatch.stop() ;
+    const double strip_time = stopwatch.elapsed() ;
+
+    // Split into fields, reusing the vector
+    std::vector<strslice> fields ;
+    stopwatch.restart() ;
+    for (size_t r = 0 ; r < repeat ; ++r)
+        for (const std::string &line: lines)
+            result += strsplit(line, separators, fields) ;
+    stopwatch.stop() ;
+    const double split_time = stopwatch.elapsed() ;
+
+    sink = result ;
+
+    std::cout << std::setw(10) << strscan::kernels().name << std::fixed << std::setprecision(1)
+              << std::setw(14) << mbps(bytes, find_time)
+              << std::setw(14) << mbps(bytes, strip_time)
+              << std::setw(14) << mbps(bytes, split_time) << std::endl ;
+}
+
+int main(int argc, char *argv[])
+{
+    if (!inrange(argc, 2, 4))
+        usage(*argv) ;
+
+    const long count        = atol(argv[1]) ;
+    const long field_length = argc > 2 ? atol(argv[2]) : 24 ;
+    const long repeat       = argc > 3 ? atol(argv[3]) : 10 ;
+
+    if (count <= 0 || field_length <= 0 || repeat <= 0)
+        usage(*argv) ;
+
+    try {
+        // Lines like "   2026-10-16 12:00:00 host;service|message text   "
+        std::mt19937_64 rng (1) ;
+        static const char separators[] = " ;|\t" ;
+        std::vector<std::string> lines ;
+        lines.reserve(count) ;
+        for (long i = 0 ; i < count ; ++i)
+        {
+            std::string line (rng() % 64, ' ') ;
+            for (unsigned fields = 4 + rng() % 8 ; fields-- ;)
+            {
+                line.append(field_length/2 + rng() % field_length, 'a' + rng() % 26) ;
+                line += separators[rng() % (sizeof separators - 1)] ;
+            }
+            line.append(rng() % 64, ' ') ;
+            lines.push_back(std::move(line)) ;
+        }
+
+        std::cout << count << " lines, average field length " << field_length << "\n\n"
+                  << std::setw(10) << "kernels"
+                  << std::setw(14) << "find, MiB/s"
+                  << std::setw(14) << "strip, MiB/s"
+                  << std::setw(14) << "split, MiB/s" << std::endl ;
+
+        for (unsigned isa = 0 ; isa < strscan::kernel_isa_count ; ++isa)
+            if (strscan::is_kernel_isa_supported((strscan::kernel_isa)isa))
+            {
+                strscan::set_scan_kernels((strscan::kernel_isa)isa) ;
+                run_bench(lines, repeat) ;
+            }
+    }
+    catch (const std::exception &x)
+    {
+        std::cerr << STDEXCEPTOUT(x) << std::endl ;
+        return 1 ;
+    }
+    return 0 ;
+}
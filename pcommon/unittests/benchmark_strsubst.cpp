@@ -0,0 +1,138 @@
+/*-*- tab-width:4;indent-tabs-mode:nil;c-file-style:"ellemtel";c-basic-offset:4;c-file-offsets:((innamespace . 0)(inlambda . 0)) -*-*/
+/*******************************************************************************
+ FILE         :   benchmark_strsubst.cpp
+ COPYRIGHT    :   Yakov Markovitch, 2026. All rights reserved.
+                  See LICENSE for information on usage/redistribution.
+
+ DESCRIPTION  :   String template rendering: subst() vs. compiled_template rendered
+                  through a substitution_map, into a buffer and into an iovec list.
+
+ PROGRAMMED BY:   Yakov Markovitch
+ CREATION DATE:   16 Oct 2026
+*******************************************************************************/
+#include <pcomn_strsubst.h>
+#include <pcomn_stopwatch.h>
+#include <pcomn_except.h>
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+
+#include <stdlib.h>
+
+using namespace pcomn ;
+using namespace pcomn::tpl ;
+
+static void usage(const char *progname)
+{
+    std::cerr << "Usage: " << progname << " [repeat]\n"
+        "Render an HTTP-response-like template repeat times in different ways.\n" ;
+    exit(1) ;
+}
+
+static const char Template[] =
+    "HTTP/1.1 $status $reason\r\n"
+    "Server: ${server}\r\n"
+    "Content-Type: $content_type; charset=$charset\r\n"
+    "Content-Length: $length\r\n"
+    "$* Headers for the cache *$"
+    "Cache-Control: max-age=$max_age\r\n"
+    "X-Request-Id: $request_id\r\n"
+    "\r\n" ;
+
+// Don't let the optimizer throw away the results
+static volatile size_t sink ;
+
+template<typename F>
+__noinline void run_bench(const char *name, size_t repeat, F &&render)
+{
+    PCpuStopwatch stopwatch ;
+    size_t result = 0 ;
+    stopwatch.start() ;
+    for (size_t r = 0 ; r < repeat ; ++r)
+        result += render() ;
+    stopwatch.stop() ;
+
+    sink = result ;
+    std::cout << std::setw(28) << name << std::fixed << std::setprecision(1)
+              << std::setw(14) << stopwatch.elapsed()/repeat*1e9 << std::endl ;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc > 2)
+        usage(*argv) ;
+
+    const long repeat = argc > 1 ? atol(argv[1]) : 1000000 ;
+    if (repeat <= 0)
+        usage(*argv) ;
+
+    try {
+        substitution_map smap ;
+        smap
+            ("status", 200)
+            ("reason", "OK")
+            ("server", "pcommon")
+            ("content_type", "text/html")
+            ("charset", "utf-8")
+            ("length", 4096)
+            ("max_age", 3600)
+            ("request_id", "5c0f3a8e-62b1-4f8e-9a53-1d2e3f4a5b6c") ;
+
+        const compiled_template tmpl (Template) ;
+
+        std::vector<strslice> values (tmpl.placeholder_count()) ;
+        const auto set_value = [&](const char *name, const strslice &value)
+        {
+            const ssize_t ndx = tmpl.placeholder_index(name) ;
+            PCOMN_THROW_MSG_IF(ndx < 0, std::invalid_argument, "No placeholder '%s'", name) ;
+            values[ndx] = value ;
+        } ;
+        set_value("status", "200") ;
+        set_value("reason", "OK") ;
+        set_value("server", "pcommon") ;
+        set_value("content_type", "text/html") ;
+        set_value("charset", "utf-8") ;
+        set_value("length", "4096") ;
+        set_value("max_age", "3600") ;
+        set_value("request_id", "5c0f3a8e-62b1-4f8e-9a53-1d2e3f4a5b6c") ;
+
+        std::cout << std::setw(28) << "method" << std::setw(14) << "ns/render" << std::endl ;
+
+        run_bench("subst(template)", repeat, [&]
+        {
+            std::string result ;
+            return subst(smap, Template, result).size() ;
+        }) ;
+
+        run_bench("subst(compiled_template)", repeat, [&]
+        {
+            std::string result ;
+            return subst(smap, tmpl, result).size() ;
+        }) ;
+
+        run_bench("render(std::string)", repeat, [&]
+        {
+            std::string result ;
+            return tmpl.render(result, values.data()).size() ;
+        }) ;
+
+        char buf[1024] ;
+        run_bench("render(char *)", repeat, [&]
+        {
+            return tmpl.render(buf, sizeof buf, values.data()) ;
+        }) ;
+
+        std::vector<iovec_t> iov (tmpl.max_iovec_count()) ;
+        run_bench("render(iovec_t *)", repeat, [&]
+        {
+            return tmpl.render(iov.data(), iov.size(), values.data()) ;
+        }) ;
+    }
+    catch (const std::exception &x)
+    {
+        std::cerr << STDEXCEPTOUT(x) << std::endl ;
+        return 1 ;
+    }
+    return 0 ;
+}
@@ -11,9 +11,11 @@
 *******************************************************************************/
 #include <pcomn_bitarray.h>
 #include <pcomn_bitvector.h>
+#include <pcomn_bitkernels.h>
 #include <pcomn_unittest.h>
 
 #include <initializer_list>
+#include <vector>
 
 using namespace pcomn ;
 
@@ -25,6 +27,20 @@ static T &set_bits(T &a, std::initializer_list<unsigned> bits, bool value = true
    return a ;
 }
 
+// Pseudorandom bits with approximately density/1024 of 1s; 1s are grouped into runs so
+// there are a lot of zero words even for dense arrays.
+static std::vector<bool> random_bits(size_t count, unsigned density, uint64_t seed)
+{
+   std::vector<bool> result (count) ;
+   uint64_t v = seed ;
+   for (size_t pos = 0 ; pos < count ; ++pos)
+   {
+      v = v*6364136223846793005ULL + 1442695040888963407ULL ;
+      result[pos] = (pos / 256) % 3 && (v >> 54) < density ;
+   }
+   return result ;
+}
+
 /*******************************************************************************
  class BitArrayTests
 *******************************************************************************/
@@ -35,6 +51,8 @@ class BitArrayTests : public CppUnit::TestFixture {
       void Test_Bit_Count() ;
       void Test_Bit_Search() ;
       void Test_Positional_Iterator() ;
+      void Test_Rank_Select() ;
+      void Test_Bitwise_Operations() ;
 
       CPPUNIT_TEST_SUITE(BitArrayTests) ;
 
@@ -43,9 +61,13 @@ class BitArrayTests : public CppUnit::TestFixture {
       CPPUNIT_TEST(Test_Bit_Count) ;
       CPPUNIT_TEST(Test_Bit_Search) ;
       CPPUNIT_TEST(Test_Positional_Iterator) ;
+      CPPUNIT_TEST(Test_Rank_Select) ;
+      CPPUNIT_TEST(Test_Bitwise_Operations) ;
 
       CPPUNIT_TEST_SUITE_END() ;
 
+      friend class BitKernelTests ;
+
    public:
       void setUp()
       {}
@@ -54,6 +76,42 @@ class BitArrayTests : public CppUnit::TestFixture {
       {}
 } ;
 
+/*******************************************************************************
+ class BitKernelTests
+ Every bulk kernel variant the CPU supports vs. the generic one, then BitArrayTests
+ with every variant.
+*******************************************************************************/
+class BitKernelTests : public CppUnit::TestFixture {
+
+      void Test_Kernel_Selection() ;
+      void Test_Kernels() ;
+      void Test_BitArray_All_Kernels() ;
+
+      CPPUNIT_TEST_SUITE(BitKernelTests) ;
+
+      CPPUNIT_TEST(Test_Kernel_Selection) ;
+      CPPUNIT_TEST(Test_Kernels) ;
+      CPPUNIT_TEST(Test_BitArray_All_Kernels) ;
+
+      CPPUNIT_TEST_SUITE_END() ;
+
+   public:
+      void setUp() { _selected = bitop::bulk().isa ; }
+      void tearDown() { bitop::set_bulk_kernels(_selected) ; }
+
+   private:
+      bitop::kernel_isa _selected ;
+
+      static std::vector<bitop::kernel_isa> supported_kernels()
+      {
+         std::vector<bitop::kernel_isa> result ;
+         for (unsigned isa = 0 ; isa < bitop::kernel_isa_count ; ++isa)
+            if (bitop::is_kernel_isa_supported((bitop::kernel_isa)isa))
+               result.push_back((bitop::kernel_isa)isa) ;
+         return result ;
+      }
+} ;
+
 /*******************************************************************************
  BitArrayTests
 *******************************************************************************/
@@ -357,6 +415,257 @@ void BitArrayTests::Test_Positional_Iterator()
    CPPUNIT_LOG_ASSERT(++bp == ep) ;
 }
 
+void BitArrayTests::Test_Rank_Select()
+{
+   bitarray empty ;
+   CPPUNIT_LOG_EQ(empty.rank1(0), 0) ;
+   CPPUNIT_LOG_EQ(empty.select1(0), 0) ;
+   CPPUNIT_LOG_EQ(empty.select0(0), 0) ;
+
+   CPPUNIT_LOG(std::endl) ;
+   bitarray b127 (127) ;
+   set_bits(b127, {0, 63, 64, 126}) ;
+   CPPUNIT_LOG_EQ(b127.rank1(0), 0) ;
+   CPPUNIT_LOG_EQ(b127.rank1(1), 1) ;
+   CPPUNIT_LOG_EQ(b127.rank1(64), 2) ;
+   CPPUNIT_LOG_EQ(b127.rank1(127), 4) ;
+   CPPUNIT_LOG_EQ(b127.rank0(127), 123) ;
+   CPPUNIT_LOG_EQ(b127.select1(0), 0) ;
+   CPPUNIT_LOG_EQ(b127.select1(2), 64) ;
+   CPPUNIT_LOG_EQ(b127.select1(3), 126) ;
+   CPPUNIT_LOG_EQ(b127.select1(4), 127) ;
+   CPPUNIT_LOG_EQ(b127.select0(0), 1) ;
+   CPPUNIT_LOG_EQ(b127.select0(61), 62) ;
+   CPPUNIT_LOG_EQ(b127.select0(62), 65) ;
+   CPPUNIT_LOG_EQ(b127.select0(122), 125) ;
+   CPPUNIT_LOG_EQ(b127.select0(123), 127) ;
+
+   CPPUNIT_LOG(std::endl) ;
+   // The index is dropped on modification, copies are independent
+   const bitarray b127_copy (b127) ;
+   CPPUNIT_LOG_RUN(b127.set(1)) ;
+   CPPUNIT_LOG_EQ(b127.rank1(64), 3) ;
+   CPPUNIT_LOG_EQ(b127.select1(2), 63) ;
+   CPPUNIT_LOG_EQ(b127_copy.rank1(64), 2) ;
+   CPPUNIT_LOG_EQ(b127_copy.select1(2), 64) ;
+   CPPUNIT_LOG_RUN(b127.flip()) ;
+   CPPUNIT_LOG_EQ(b127.rank1(127), 122) ;
+   CPPUNIT_LOG_EQ(b127.select0(2), 63) ;
+
+   CPPUNIT_LOG(std::endl) ;
+   // Compare with the straightforward implementation over bit densities from sparse to
+   // dense, crossing several select samples.
+   for (unsigned density: {1, 64, 512, 1023})
+   {
+      bitarray bits (200003) ;
+      uint64_t v = density ;
+      for (size_t pos = 0 ; pos < bits.size() ; ++pos)
+      {
+         v = v*6364136223846793005ULL + 1442695040888963407ULL ;
+         if ((v >> 54) < density)
+            bits.set(pos) ;
+      }
+
+      std::vector<size_t> ones ;
+      std::vector<size_t> zeros ;
+      for (size_t pos = 0 ; pos < bits.size() ; ++pos)
+      {
+         CPPUNIT_EQUAL(bits.rank1(pos), ones.size()) ;
+         (bits.test(pos) ? ones : zeros).push_back(pos) ;
+      }
+      CPPUNIT_EQUAL(bits.rank1(bits.size()), ones.size()) ;
+
+      for (size_t k = 0 ; k < ones.size() ; ++k)
+         CPPUNIT_EQUAL(bits.select1(k), ones[k]) ;
+      for (size_t k = 0 ; k < zeros.size() ; ++k)
+         CPPUNIT_EQUAL(bits.select0(k), zeros[k]) ;
+
+      CPPUNIT_LOG_EQ(bits.select1(ones.size()), bits.size()) ;
+      CPPUNIT_LOG_EQ(bits.select0(zeros.size()), bits.size()) ;
+   }
+}
+
+void BitArrayTests::Test_Bitwise_Operations()
+{
+   bitarray b130 (130) ;
+   bitarray b70 (70) ;
+   set_bits(b130, {0, 1, 64, 129}) ;
+   set_bits(b70, {1, 2, 64, 69}) ;
+
+   // The result size is the max of the operand sizes
+   bitarray expected_and (130) ;
+   bitarray expected_or (130) ;
+   bitarray expected_xor (130) ;
+   bitarray expected_130_minus_70 (130) ;
+   bitarray expected_70_minus_130 (130) ;
+   set_bits(expected_and, {1, 64}) ;
+   set_bits(expected_or, {0, 1, 2, 64, 69, 129}) ;
+   set_bits(expected_xor, {0, 2, 69, 129}) ;
+   set_bits(expected_130_minus_70, {0, 129}) ;
+   set_bits(expected_70_minus_130, {2, 69}) ;
+
+   CPPUNIT_LOG_EQ(bitarray(b130) &= b70, expected_and) ;
+   CPPUNIT_LOG_EQ(bitarray(b70) &= b130, expected_and) ;
+   CPPUNIT_LOG_EQ(bitarray(b130) |= b70, expected_or) ;
+   CPPUNIT_LOG_EQ(bitarray(b70) ^= b130, expected_xor) ;
+   CPPUNIT_LOG_EQ(bitarray(b130) -= b70, expected_130_minus_70) ;
+   CPPUNIT_LOG_EQ(bitarray(b70) -= b130, expected_70_minus_130) ;
+   CPPUNIT_LOG_EQ((bitarray(b70) -= b130).count(), 2) ;
+   CPPUNIT_LOG_EQ((bitarray(b70) ^= b70).count(), 0) ;
+   CPPUNIT_LOG_ASSERT((bitarray(b70) ^= b70).none()) ;
+
+   CPPUNIT_LOG(std::endl) ;
+   // Compare with std::vector<bool> for different sizes and densities; long zero runs
+   // check the nonzero map is kept consistent
+   for (size_t xsize: {1, 63, 65, 4097, 70001})
+      for (size_t ysize: {1, 64, 4096, 70001})
+         for (unsigned density: {1, 300, 1024})
+         {
+            const std::vector<bool> &x = random_bits(xsize, density, xsize + density) ;
+            const std::vector<bool> &y = random_bits(ysize, 1024 - density/2, ysize) ;
+            const bitarray bx (x.begin(), x.end()) ;
+            const bitarray by (y.begin(), y.end()) ;
+            const size_t rsize = std::max(xsize, ysize) ;
+
+            const auto check = [&](const bitarray &result, const char *opname, auto op)
+            {
+               std::vector<bool> expected (rsize) ;
+               for (size_t pos = 0 ; pos < rsize ; ++pos)
+                  expected[pos] = op(pos < xsize && x[pos], pos < ysize && y[pos]) ;
+
+               const bitarray bexpected (expected.begin(), expected.end()) ;
+               const size_t ones = std::count(expected.begin(), expected.end(), true) ;
+
+               if (result != bexpected || result.count() != ones ||
+                   std::vector<size_t>(result.begin_positional(), result.end_positional()) !=
+                   std::vector<size_t>(bexpected.begin_positional(), bexpected.end_positional()))
+               {
+                  CPPUNIT_LOG_LINE("Mismatch: " << xsize << ' ' << opname << ' ' << ysize << " density=" << density) ;
+                  CPPUNIT_FAIL("Bitwise operation result mismatch") ;
+               }
+            } ;
+
+            check(bitarray(bx) &= by, "&=", [](bool a, bool b) { return a && b ; }) ;
+            check(bitarray(bx) |= by, "|=", [](bool a, bool b) { return a || b ; }) ;
+            check(bitarray(bx) ^= by, "^=", [](bool a, bool b) { return a != b ; }) ;
+            check(bitarray(bx) -= by, "-=", [](bool a, bool b) { return a && !b ; }) ;
+         }
+}
+
+/*******************************************************************************
+ BitKernelTests
+*******************************************************************************/
+void BitKernelTests::Test_Kernel_Selection()
+{
+   const std::vector<bitop::kernel_isa> &isas = supported_kernels() ;
+   CPPUNIT_LOG_ASSERT(!isas.empty()) ;
+   CPPUNIT_LOG_ASSERT(isas.front() == bitop::kernel_isa::generic) ;
+
+   for (bitop::kernel_isa isa: isas)
+      CPPUNIT_LOG_LINE("Supported bulk kernels: " << bitop::get_bulk_kernels(isa).name) ;
+   CPPUNIT_LOG_LINE("Selected bulk kernels: " << bitop::bulk().name) ;
+
+   CPPUNIT_LOG_ASSERT(bitop::is_kernel_isa_supported(bitop::bulk().isa)) ;
+   CPPUNIT_LOG_ASSERT(bitop::set_bulk_kernels(bitop::kernel_isa::generic) == _selected) ;
+   CPPUNIT_LOG_ASSERT(bitop::bulk().isa == bitop::kernel_isa::generic) ;
+   CPPUNIT_LOG_EQ(std::string(bitop::bulk().name), "generic") ;
+
+   for (unsigned isa = 0 ; isa < bitop::kernel_isa_count ; ++isa)
+      if (!bitop::is_kernel_isa_supported((bitop::kernel_isa)isa))
+      {
+         CPPUNIT_LOG_EXCEPTION(bitop::set_bulk_kernels((bitop::kernel_isa)isa), std::invalid_argument) ;
+         CPPUNIT_LOG_ASSERT(bitop::bulk().isa == bitop::kernel_isa::generic) ;
+      }
+}
+
+void BitKernelTests::Test_Kernels()
+{
+   const bitop::bulk_kernels &generic = bitop::get_bulk_kernels(bitop::kernel_isa::generic) ;
+
+   // Check all the lengths around vector sizes and unaligned data
+   std::vector<uint64_t> x (300) ;
+   std::vector<uint64_t> y (300) ;
+   uint64_t v = 1 ;
+   for (size_t i = 0 ; i < x.size() ; ++i)
+   {
+      v = v*6364136223846793005ULL + 1442695040888963407ULL ;
+      x[i] = i % 5 ? v : 0 ;
+      y[i] = i % 7 ? v*0x9E3779B97F4A7C15ULL : 0 ;
+   }
+
+   for (bitop::kernel_isa isa: supported_kernels())
+   {
+      const bitop::bulk_kernels &kernels = bitop::get_bulk_kernels(isa) ;
+      CPPUNIT_LOG_LINE("Testing " << kernels.name << " bulk kernels") ;
+
+      for (size_t offset = 0 ; offset < 4 ; ++offset)
+         for (size_t n = 0 ; n + offset <= 200 ; ++n)
+         {
+            const uint64_t * const xdata = x.data() + offset ;
+            const uint64_t * const ydata = y.data() + offset ;
+
+            CPPUNIT_EQUAL(kernels.popcount(xdata, n), generic.popcount(xdata, n)) ;
+
+            for (auto op: {&bitop::bulk_kernels::and_assign, &bitop::bulk_kernels::or_assign,
+                           &bitop::bulk_kernels::xor_assign, &bitop::bulk_kernels::andnot_assign,
+                           &bitop::bulk_kernels::notand_assign})
+            {
+               // The guard word after the data must not be touched
+               std::vector<uint64_t> result (xdata, xdata + n + 1) ;
+               std::vector<uint64_t> expected (result) ;
+               (kernels.*op)(result.data(), ydata, n) ;
+               (generic.*op)(expected.data(), ydata, n) ;
+               CPPUNIT_EQUAL(result, expected) ;
+            }
+
+            std::vector<uint64_t> map ((n + 63)/64 + 1, 0x5555) ;
+            std::vector<uint64_t> expected_map (map) ;
+            kernels.nonzero_map(xdata, n, map.data()) ;
+            generic.nonzero_map(xdata, n, expected_map.data()) ;
+            CPPUNIT_EQUAL(map, expected_map) ;
+
+            // Equality: the same, then differ at every position in the last 10 words
+            std::vector<uint64_t> copy (xdata, xdata + n) ;
+            CPPUNIT_EQUAL(kernels.equal(xdata, copy.data(), n), true) ;
+            for (size_t i = n - std::min<size_t>(n, 10) ; i < n ; ++i)
+            {
+               copy[i] ^= 1ULL << (i % 64) ;
+               CPPUNIT_EQUAL(kernels.equal(xdata, copy.data(), n), false) ;
+               copy[i] = xdata[i] ;
+            }
+
+            // Nonzero search: zero data, then a single nonzero word at every position
+            std::vector<uint64_t> zeros (n + 1) ;
+            CPPUNIT_EQUAL(kernels.find_nonzero(zeros.data() + 1, n), n) ;
+            for (size_t i = 0 ; i < n ; ++i)
+            {
+               zeros[i + 1] = 1ULL << 63 ;
+               CPPUNIT_EQUAL(kernels.find_nonzero(zeros.data() + 1, n), i) ;
+               CPPUNIT_EQUAL(kernels.popcount(zeros.data() + 1, n), 1) ;
+               zeros[i + 1] = 0 ;
+            }
+         }
+   }
+}
+
+void BitKernelTests::Test_BitArray_All_Kernels()
+{
+   for (bitop::kernel_isa isa: supported_kernels())
+   {
+      bitop::set_bulk_kernels(isa) ;
+      CPPUNIT_LOG_LINE("Testing bitarray with " << bitop::bulk().name << " bulk kernels") ;
+
+      BitArrayTests tests ;
+      tests.Test_Constructors() ;
+      tests.Test_Set_Reset_Bits() ;
+      tests.Test_Bit_Count() ;
+      tests.Test_Bit_Search() ;
+      tests.Test_Positional_Iterator() ;
+      tests.Test_Rank_Select() ;
+      tests.Test_Bitwise_Operations() ;
+   }
+}
+
 /*******************************************************************************
  main
 *******************************************************************************/
@@ -364,7 +673,8 @@ int main(int argc, char *argv[])
 {
    return unit::run_tests
        <
-          BitArrayTests
+          BitArrayTests,
+          BitKernelTests
        >
        (argc, argv) ;
 }
@@ -38,6 +38,7 @@ class BitOperationsTests : public CppUnit::TestFixture {
       void Test_Log2() ;
       void Test_BoolsToBits() ;
       void Test_BitsExtract() ;
+      void Test_Select1() ;
       void Test_CellOps() ;
 
       CPPUNIT_TEST_SUITE(BitOperationsTests) ;
@@ -56,6 +57,7 @@ class BitOperationsTests : public CppUnit::TestFixture {
       CPPUNIT_TEST(Test_Log2) ;
       CPPUNIT_TEST(Test_BoolsToBits) ;
       CPPUNIT_TEST(Test_BitsExtract) ;
+      CPPUNIT_TEST(Test_Select1) ;
       CPPUNIT_TEST(Test_CellOps) ;
 
       CPPUNIT_TEST_SUITE_END() ;
@@ -654,6 +656,43 @@ void BitOperationsTests::Test_BitsExtract()
    CPPUNIT_LOG_EQUAL(bits_extract(uint8_t(0b11110010), uint8_t(0b00100111)), uint8_t(0b1010)) ;
 }
 
+void BitOperationsTests::Test_Select1()
+{
+   using namespace bitop ;
+
+   CPPUNIT_LOG_EQUAL(select1(uint8_t(0b10110100), 0), 2U) ;
+   CPPUNIT_LOG_EQUAL(select1(uint8_t(0b10110100), 1), 4U) ;
+   CPPUNIT_LOG_EQUAL(select1(uint8_t(0b10110100), 2), 5U) ;
+   CPPUNIT_LOG_EQUAL(select1(uint8_t(0b10110100), 3), 7U) ;
+   CPPUNIT_LOG_EQUAL(select1(uint8_t(0b10110100), 4), 8U) ;
+   CPPUNIT_LOG_EQUAL(select1(uint8_t(0), 0), 8U) ;
+   CPPUNIT_LOG_EQUAL(select1(uint8_t(0xff), 7), 7U) ;
+   CPPUNIT_LOG_EQUAL(select1(uint8_t(0xff), 8), 8U) ;
+
+   CPPUNIT_LOG(std::endl) ;
+
+   CPPUNIT_LOG_EQUAL(select1(uint32_t(0x80000001), 1), 31U) ;
+   CPPUNIT_LOG_EQUAL(select1(uint32_t(0x80000001), 2), 32U) ;
+   CPPUNIT_LOG_EQUAL(select1(uint64_t(0x8000000000000000ULL), 0), 63U) ;
+   CPPUNIT_LOG_EQUAL(select1(uint64_t(-1), 63), 63U) ;
+   CPPUNIT_LOG_EQUAL(select1(uint64_t(-1), 64), 64U) ;
+   CPPUNIT_LOG_EQUAL(select1(uint64_t(0x0101010101010101ULL), 5), 40U) ;
+
+   // Compare with the straightforward implementation
+   uint64_t v = 0x9E3779B97F4A7C15ULL ;
+   for (unsigned i = 0 ; i < 1000 ; ++i, v = v*6364136223846793005ULL + 1442695040888963407ULL)
+   {
+      const uint64_t x = v & (v >> 7) ;
+      unsigned pos = 0 ;
+      for (unsigned n = 0 ; n <= popcount(x) ; ++n, ++pos)
+      {
+         while (pos < 64 && !(x & (1ULL << pos)))
+            ++pos ;
+         CPPUNIT_EQUAL(select1(x, n), pos) ;
+      }
+   }
+}
+
 void BitOperationsTests::Test_CellOps()
 {
    using namespace bitop ;
@@ -10,6 +10,7 @@
  CREATION DATE:   24 Jan 2020
 *******************************************************************************/
 #include <pcomn_bitvector.h>
+#include <pcomn_bitrank.h>
 #include <pcomn_unittest.h>
 
 #include <initializer_list>
@@ -39,6 +40,7 @@ class BitVectorTests : public CppUnit::TestFixture {
     void Test_Boundary_Iterator() ;
     void Test_Atomic_Set_Reset_Bits() ;
     void Test_Equality() ;
+    void Test_Rank_Select() ;
 
     CPPUNIT_TEST_SUITE(BitVectorTests) ;
 
@@ -52,6 +54,7 @@ class BitVectorTests : public CppUnit::TestFixture {
     CPPUNIT_TEST(Test_Boundary_Iterator) ;
     CPPUNIT_TEST(Test_Atomic_Set_Reset_Bits) ;
     CPPUNIT_TEST(Test_Equality) ;
+    CPPUNIT_TEST(Test_Rank_Select) ;
 
     CPPUNIT_TEST_SUITE_END() ;
 } ;
@@ -605,6 +608,51 @@ void BitVectorTests::Test_Atomic_Set_Reset_Bits()
         ) ;
 }
 
+void BitVectorTests::Test_Rank_Select()
+{
+    const bitrank_index empty ;
+    CPPUNIT_LOG_EQ(empty.size(), 0) ;
+    CPPUNIT_LOG_EQ(empty.rank1(0), 0) ;
+    CPPUNIT_LOG_EQ(empty.select1(0), 0) ;
+
+    CPPUNIT_LOG(std::endl) ;
+    // The bits of the last word beyond the size must be ignored
+    uint64_t words[20] = {} ;
+    basic_bitvector<uint64_t> bv (1217, words) ;
+    set_bits(bv, {0, 1, 511, 512, 1024, 1216}) ;
+    words[19] |= ~0ULL << 2 ;
+
+    const bitrank_index index (bv) ;
+    CPPUNIT_LOG_EQ(index.size(), 1217) ;
+    CPPUNIT_LOG_EQ(index.count(), 6) ;
+    CPPUNIT_LOG_EQ(index.count(false), 1211) ;
+    CPPUNIT_LOG_EQ(index.rank1(2), 2) ;
+    CPPUNIT_LOG_EQ(index.rank1(512), 3) ;
+    CPPUNIT_LOG_EQ(index.rank1(513), 4) ;
+    CPPUNIT_LOG_EQ(index.rank1(1216), 5) ;
+    CPPUNIT_LOG_EQ(index.rank1(1217), 6) ;
+    CPPUNIT_LOG_EQ(index.rank0(1217), 1211) ;
+    CPPUNIT_LOG_EQ(index.select1(2), 511) ;
+    CPPUNIT_LOG_EQ(index.select1(4), 1024) ;
+    CPPUNIT_LOG_EQ(index.select1(5), 1216) ;
+    CPPUNIT_LOG_EQ(index.select1(6), 1217) ;
+    CPPUNIT_LOG_EQ(index.select0(0), 2) ;
+    CPPUNIT_LOG_EQ(index.select0(508), 510) ;
+    CPPUNIT_LOG_EQ(index.select0(509), 513) ;
+    CPPUNIT_LOG_EQ(index.select0(1210), 1215) ;
+    CPPUNIT_LOG_EQ(index.select0(1211), 1217) ;
+    CPPUNIT_LOG_ASSERT(index.memsize() >= 6*sizeof(uint64_t)) ;
+
+    CPPUNIT_LOG(std::endl) ;
+    // Full blocks only: the rank at the end is taken from the sentinel
+    const basic_bitvector<uint64_t> full (words, 16) ;
+    const bitrank_index full_index (full) ;
+    CPPUNIT_LOG_EQ(full_index.rank1(1024), 4) ;
+    CPPUNIT_LOG_EQ(full_index.select1(3), 512) ;
+    CPPUNIT_LOG_EQ(full_index.select1(4), 1024) ;
+    CPPUNIT_LOG_EQ(full_index.select0(1019), 1023) ;
+}
+
 /*******************************************************************************
  main
 *******************************************************************************/
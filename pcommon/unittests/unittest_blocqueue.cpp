@@ -170,6 +170,9 @@ class BlockingQueueTests : public CppUnit::TestFixture {
     template<typename T>
     void Test_ItemQueue_SingleThreaded() ;
 
+    template<typename T, unsigned producers, unsigned consumers>
+    void Test_ItemQueue_MultiThreaded() ;
+
     CPPUNIT_TEST_SUITE(BlockingQueueTests) ;
 
     CPPUNIT_TEST(Test_BlockingQueue_TestFixture) ;
@@ -179,6 +182,12 @@ class BlockingQueueTests : public CppUnit::TestFixture {
 
     CPPUNIT_TEST(Test_ItemQueue_SingleThreaded<blocking_list_queue<unsigned>>) ;
     CPPUNIT_TEST(Test_ItemQueue_SingleThreaded<blocking_ring_queue<unsigned>>) ;
+    CPPUNIT_TEST(Test_ItemQueue_SingleThreaded<blocking_lockfree_ring_queue<unsigned>>) ;
+
+    CPPUNIT_TEST(P_PASS(Test_ItemQueue_MultiThreaded<blocking_ring_queue<uint64_t>, 4, 2>)) ;
+    CPPUNIT_TEST(P_PASS(Test_ItemQueue_MultiThreaded<blocking_lockfree_ring_queue<uint64_t>, 1, 1>)) ;
+    CPPUNIT_TEST(P_PASS(Test_ItemQueue_MultiThreaded<blocking_lockfree_ring_queue<uint64_t>, 4, 2>)) ;
+    CPPUNIT_TEST(P_PASS(Test_ItemQueue_MultiThreaded<blocking_lockfree_ring_queue<uint64_t>, 16, 3>)) ;
 
     CPPUNIT_TEST_SUITE_END() ;
 
@@ -603,6 +612,58 @@ void BlockingQueueTests::Test_ItemQueue_SingleThreaded()
     }
 }
 
+// Every producer pushes its own distinct range of values, consumers alternately pop
+// one-by-one and in bunches; check every value is delivered exactly once.
+template<typename Q, unsigned producers, unsigned consumers>
+void BlockingQueueTests::Test_ItemQueue_MultiThreaded()
+{
+    const uint64_t pcount = 50'000 ;
+    const uint64_t total = pcount*producers ;
+
+    Q q (63) ;
+
+    std::vector<std::vector<uint64_t>> consumed (consumers) ;
+    std::vector<std::thread> consumer_threads ;
+    std::vector<std::thread> producer_threads ;
+
+    for (unsigned c = 0 ; c < consumers ; ++c)
+        consumer_threads.emplace_back([&q, &received = consumed[c], c]
+        {
+            try {
+                for (;;)
+                    if (c & 1)
+                        for (uint64_t v: q.pop_some(7))
+                            received.push_back(v) ;
+                    else
+                        received.push_back(q.pop()) ;
+            }
+            catch (const sequence_closed &) {}
+        }) ;
+
+    for (unsigned p = 0 ; p < producers ; ++p)
+        producer_threads.emplace_back([&q, p]
+        {
+            for (uint64_t i = p*pcount, e = i + pcount ; i < e ; ++i)
+                q.push(i) ;
+        }) ;
+
+    for (std::thread &t: producer_threads)
+        t.join() ;
+
+    CPPUNIT_LOG_ASSERT(q.close_push_wait_empty(3s)) ;
+
+    for (std::thread &t: consumer_threads)
+        t.join() ;
+
+    std::vector<uint64_t> all ;
+    for (const auto &c: consumed)
+        all.insert(all.end(), c.begin(), c.end()) ;
+
+    CPPUNIT_LOG_EQ(all.size(), total) ;
+    pcomn::sort(all) ;
+    CPPUNIT_LOG_ASSERT(std::equal(all.begin(), all.end(), count_iterator<uint64_t>(0))) ;
+}
+
 /*******************************************************************************
                             class BlockingQueueFuzzyTests
 *******************************************************************************/
@@ -19,6 +19,7 @@
 #include <vector>
 #include <iterator>
 #include <type_traits>
+#include <thread>
 
 #include <sys/types.h>
 
@@ -59,11 +60,17 @@ class CacherTests : public CppUnit::TestFixture  {
 
       void Test_Cacher_Basic() ;
       void Test_Cacher_LRU() ;
+      void Test_Cacher_Eviction() ;
+      void Test_Sharded_Cacher() ;
+      void Test_Sharded_Cacher_Concurrent() ;
 
       CPPUNIT_TEST_SUITE(CacherTests) ;
 
       CPPUNIT_TEST(Test_Cacher_Basic) ;
       CPPUNIT_TEST(Test_Cacher_LRU) ;
+      CPPUNIT_TEST(Test_Cacher_Eviction) ;
+      CPPUNIT_TEST(Test_Sharded_Cacher) ;
+      CPPUNIT_TEST(Test_Sharded_Cacher_Concurrent) ;
 
       CPPUNIT_TEST_SUITE_END() ;
 
@@ -74,9 +81,9 @@ class CacherTests : public CppUnit::TestFixture  {
       }
 } ;
 
-template<typename V, typename X, typename H, typename C>
-static std::vector<typename std::remove_cv<typename std::remove_reference<typename cacher<V, X, H, C>::key_type>::type>::type>
-cacher_keys(const cacher<V, X, H, C> &c)
+template<typename Cacher>
+static std::vector<typename std::remove_cv<typename std::remove_reference<typename Cacher::key_type>::type>::type>
+cacher_keys(const Cacher &c)
 {
    decltype(cacher_keys(c)) result ;
    c.keys(std::back_inserter(result)) ;
@@ -180,6 +187,187 @@ void CacherTests::Test_Cacher_LRU()
    test_cacher Cacher ;
 }
 
+template<typename Eviction>
+using int_cacher = cacher<int, identity, hash_fn<int>, std::equal_to<int>, Eviction> ;
+
+// Access 20 "hot" keys, then run a long scan of one-off keys interleaved with
+// accesses to the hot keys; return the count of hot keys that survived the scan.
+template<typename Eviction>
+static unsigned scan_hot_survivors(int_cacher<Eviction> &c, double &hitratio)
+{
+   unsigned hits = 0 ;
+   unsigned total = 0 ;
+   const auto access = [&](int key)
+   {
+      int found ;
+      ++total ;
+      if (c.get(key, found))
+         ++hits ;
+      else
+         c.put(key) ;
+   } ;
+   for (int round = 0 ; round < 20 ; ++round)
+      for (int key = 0 ; key < 20 ; ++key)
+         access(key) ;
+
+   hits = total = 0 ;
+   for (int key = 1000 ; key < 101000 ; ++key)
+   {
+      access(key) ;
+      if (!(key & 1))
+         access(key/2 % 20) ;
+   }
+   hitratio = (double)hits/total ;
+
+   unsigned survivors = 0 ;
+   for (int key = 0 ; key < 20 ; ++key)
+      survivors += c.exists(key) ;
+   return survivors ;
+}
+
+void CacherTests::Test_Cacher_Eviction()
+{
+   CPPUNIT_LOG("\n**** CLOCK ****" << std::endl) ;
+   int_cacher<clock_eviction> Clock (4) ;
+   for (int i = 0 ; i < 4 ; ++i)
+      Clock.put(i) ;
+   CPPUNIT_LOG_EQUAL(Clock.size(), (size_t)4) ;
+   // Referenced entries get the second chance
+   CPPUNIT_LOG_EQUAL(Clock.get(0), 0) ;
+   CPPUNIT_LOG_EQUAL(Clock.get(2), 2) ;
+   CPPUNIT_LOG_ASSERT(Clock.put(4)) ;
+   CPPUNIT_LOG_ASSERT(Clock.put(5)) ;
+   CPPUNIT_LOG_EQUAL(CPPUNIT_SORTED(cacher_keys(Clock)), CPPUNIT_CONTAINER(std::vector<int>, (0)(2)(4)(5))) ;
+   CPPUNIT_LOG_ASSERT(Clock.erase(4)) ;
+   CPPUNIT_LOG_EQUAL(Clock.set_size_limit(2), (size_t)1) ;
+   CPPUNIT_LOG_EQUAL(Clock.clear(), (size_t)1) ;
+   CPPUNIT_LOG_EQUAL(Clock.size(), (size_t)0) ;
+
+   CPPUNIT_LOG("\n**** Scan resistance ****" << std::endl) ;
+   double hitratio = 0 ;
+   int_cacher<lru_eviction> Lru (50) ;
+   CPPUNIT_LOG_ASSERT(scan_hot_survivors(Lru, hitratio) < 20) ;
+   CPPUNIT_LOG_EXPRESSION(hitratio) ;
+   CPPUNIT_LOG_ASSERT(Lru.size() <= 50) ;
+
+   int_cacher<wtinylfu_eviction> TinyLfu (50) ;
+   CPPUNIT_LOG_EQUAL(scan_hot_survivors(TinyLfu, hitratio), 20U) ;
+   CPPUNIT_LOG_EXPRESSION(hitratio) ;
+   // Every access to a hot key during the scan is a hit
+   CPPUNIT_LOG_ASSERT(hitratio > 0.33) ;
+   CPPUNIT_LOG_ASSERT(TinyLfu.size() <= 51) ;
+
+   CPPUNIT_LOG_EQUAL(TinyLfu.erase(0), true) ;
+   CPPUNIT_LOG_IS_FALSE(TinyLfu.exists(0)) ;
+   CPPUNIT_LOG_ASSERT(TinyLfu.set_size_limit(10) <= 10) ;
+   CPPUNIT_LOG_EQUAL(TinyLfu.set_size_limit(0), (size_t)0) ;
+   CPPUNIT_LOG_ASSERT(TinyLfu.put(1)) ;
+   CPPUNIT_LOG_EQUAL(TinyLfu.size(), (size_t)0) ;
+}
+
+typedef sharded_cacher<citem_ptr, item_name> test_sharded_cacher ;
+
+void CacherTests::Test_Sharded_Cacher()
+{
+   test_sharded_cacher Cacher (100, 3) ;
+
+   CPPUNIT_LOG_EQUAL(Cacher.shard_count(), 4U) ;
+   CPPUNIT_LOG_EQUAL(Cacher.size(), (size_t)0) ;
+   CPPUNIT_LOG_EQUAL(Cacher.size_limit(), (size_t)100) ;
+   CPPUNIT_LOG_IS_FALSE(Cacher.erase("FooBar")) ;
+   CPPUNIT_LOG_IS_FALSE(Cacher.exists("FooBar")) ;
+
+   citem_ptr Item ;
+   citem_ptr NewItem ;
+   CPPUNIT_LOG_IS_FALSE(Cacher.get("FooBar", Item)) ;
+   CPPUNIT_LOG_IS_FALSE(Item) ;
+
+   CPPUNIT_LOG_ASSERT(Cacher.put(citem_ptr(new CacherItem("FooBar", 13)))) ;
+   CPPUNIT_LOG_RUN(NewItem = new CacherItem("Quux", 14)) ;
+   CPPUNIT_LOG_ASSERT(Cacher.put(NewItem, Item)) ;
+   CPPUNIT_LOG_EQUAL(NewItem, Item) ;
+   CPPUNIT_LOG_EQUAL(Cacher.size(), (size_t)2) ;
+   CPPUNIT_LOG_EQUAL(CPPUNIT_SORTED(cacher_keys(Cacher)), CPPUNIT_STRVECTOR(("FooBar")("Quux"))) ;
+
+   Item.reset() ;
+   CPPUNIT_LOG_IS_FALSE(Cacher.put(citem_ptr(new CacherItem("Quux", 15)), Item)) ;
+   CPPUNIT_LOG_EQUAL(Item, NewItem) ;
+   CPPUNIT_LOG_EQUAL(CacherItem::destroyed.size(), (size_t)1) ;
+
+   CPPUNIT_LOG_ASSERT(Cacher.replace(citem_ptr(new CacherItem("Quux", 16)))) ;
+   CPPUNIT_LOG_EQUAL(Cacher.get("Quux")->second, 16) ;
+   CPPUNIT_LOG_IS_FALSE(Cacher.replace(citem_ptr(new CacherItem("Xyzzy", 17)))) ;
+   CPPUNIT_LOG_EQUAL(Cacher.size(), (size_t)3) ;
+
+   CPPUNIT_LOG_ASSERT(Cacher.erase("FooBar")) ;
+   CPPUNIT_LOG_IS_FALSE(Cacher.exists("FooBar")) ;
+
+   CPPUNIT_LOG(std::endl) ;
+   const std::vector<std::string> keys (CPPUNIT_STRVECTOR(("Quux")("Bar")("Xyzzy"))) ;
+   CPPUNIT_LOG_EQUAL(Cacher.erase(keys.begin(), keys.end()), (size_t)2) ;
+   CPPUNIT_LOG_EQUAL(Cacher.size(), (size_t)0) ;
+
+   for (int i = 0 ; i < 50 ; ++i)
+      Cacher.put(citem_ptr(new CacherItem(std::to_string(i), i))) ;
+   CPPUNIT_LOG_EQUAL(Cacher.size(), (size_t)50) ;
+   CPPUNIT_LOG_EQUAL(Cacher.clear(), (size_t)50) ;
+   CPPUNIT_LOG_EQUAL(Cacher.size(), (size_t)0) ;
+
+   // The size limit is split between the shards
+   CPPUNIT_LOG(std::endl) ;
+   for (int i = 0 ; i < 1000 ; ++i)
+      Cacher.put(citem_ptr(new CacherItem(std::to_string(i), i))) ;
+   CPPUNIT_LOG_EXPRESSION(Cacher.size()) ;
+   CPPUNIT_LOG_ASSERT(Cacher.size() <= 100) ;
+   CPPUNIT_LOG_ASSERT(Cacher.size() >= 50) ;
+
+   CPPUNIT_LOG_EQUAL(Cacher.set_size_limit(0), (size_t)0) ;
+   CPPUNIT_LOG_ASSERT(Cacher.put(citem_ptr(new CacherItem("Xyzzy", 15)))) ;
+   CPPUNIT_LOG_EQUAL(Cacher.size(), (size_t)0) ;
+}
+
+void CacherTests::Test_Sharded_Cacher_Concurrent()
+{
+   // Hits only mark entries as referenced, which gives them the second chance on
+   // eviction: a hot entry survives a stream of new entries.
+   sharded_cacher<int> Lazy (4, 1) ;
+   for (int i = 0 ; i < 4 ; ++i)
+      Lazy.put(i) ;
+   for (int i = 4 ; i < 100 ; ++i)
+   {
+      CPPUNIT_EQUAL(Lazy.get(0), 0) ;
+      Lazy.put(i) ;
+   }
+   CPPUNIT_LOG_ASSERT(Lazy.exists(0)) ;
+   CPPUNIT_LOG_IS_FALSE(Lazy.exists(1)) ;
+
+   CPPUNIT_LOG(std::endl) ;
+   sharded_cacher<int> Cacher (1000) ;
+   std::atomic<unsigned> mismatches {0} ;
+   std::vector<std::thread> threads ;
+   for (int n = 0 ; n < 4 ; ++n)
+      threads.emplace_back([&Cacher, &mismatches, n]
+      {
+         for (int i = 0 ; i < 100000 ; ++i)
+         {
+            const int key = (i*7 + n) % 3000 ;
+            int found ;
+            if (!Cacher.get(key, found))
+               Cacher.put(key) ;
+            else
+               mismatches += found != key ;
+            if (!(i % 1000))
+               Cacher.erase(i % 3000) ;
+         }
+      }) ;
+   for (std::thread &t: threads)
+      t.join() ;
+
+   CPPUNIT_LOG_EQUAL(mismatches.load(), 0U) ;
+   CPPUNIT_LOG_EXPRESSION(Cacher.size()) ;
+   CPPUNIT_LOG_ASSERT(Cacher.size() < Cacher.size_limit() + Cacher.shard_count()) ;
+}
+
 /*******************************************************************************
                             KeyedPoolTests
 *******************************************************************************/
@@ -189,6 +377,7 @@ class KeyedPoolTests : public CppUnit::TestFixture  {
       void Test_Keyed_Pool_Basic() ;
       void Test_Keyed_Pool_Erase() ;
       void Test_Keyed_Pool_Lru() ;
+      void Test_Keyed_Pool_Eviction() ;
 
       CPPUNIT_TEST_SUITE(KeyedPoolTests) ;
 
@@ -196,6 +385,7 @@ class KeyedPoolTests : public CppUnit::TestFixture  {
       CPPUNIT_TEST(Test_Keyed_Pool_Basic) ;
       CPPUNIT_TEST(Test_Keyed_Pool_Erase) ;
       CPPUNIT_TEST(Test_Keyed_Pool_Lru) ;
+      CPPUNIT_TEST(Test_Keyed_Pool_Eviction) ;
 
       CPPUNIT_TEST_SUITE_END() ;
 
@@ -699,6 +889,59 @@ void KeyedPoolTests::Test_Keyed_Pool_Lru()
    }
 }
 
+void KeyedPoolTests::Test_Keyed_Pool_Eviction()
+{
+   // Check out and check in back an item of one of 4 "hot" keys after every 4 checkins
+   // of one-off keys; with the pool size limit 10, this is an LRU-killing pattern.
+   const auto run_scan = [](auto &pool)
+   {
+      unsigned hits = 0 ;
+      int item = 0 ;
+      for (int round = 0 ; round < 20 ; ++round)
+         for (int key = 0 ; key < 4 ; ++key)
+         {
+            const std::string hot ("hot" + std::to_string(key)) ;
+            pool.checkout(hot, item) ;
+            pool.put(hot, key) ;
+         }
+      for (int i = 0 ; i < 1000 ; ++i)
+      {
+         const std::string oneoff (std::to_string(i)) ;
+         pool.checkout(oneoff, item) ;
+         pool.put(oneoff, i) ;
+         if (i % 4)
+            continue ;
+         const std::string hot ("hot" + std::to_string(i/4 % 4)) ;
+         hits += pool.checkout(hot, item) ;
+         pool.put(hot, i) ;
+      }
+      return hits ;
+   } ;
+
+   keyed_pool<std::string, int> LruPool (10) ;
+   keyed_pool<std::string, int, hash_fn<std::string>, std::equal_to<std::string>, wtinylfu_eviction>
+      TinyLfuPool (10) ;
+
+   unsigned lru_hits = 0 ;
+   unsigned tinylfu_hits = 0 ;
+   CPPUNIT_LOG_RUN(lru_hits = run_scan(LruPool)) ;
+   CPPUNIT_LOG_RUN(tinylfu_hits = run_scan(TinyLfuPool)) ;
+   CPPUNIT_LOG_EXPRESSION(lru_hits) ;
+   CPPUNIT_LOG_EXPRESSION(tinylfu_hits) ;
+   CPPUNIT_LOG_ASSERT(tinylfu_hits > 200) ;
+   CPPUNIT_LOG_ASSERT(tinylfu_hits > 10*lru_hits) ;
+   CPPUNIT_LOG_ASSERT(TinyLfuPool.size() <= 10) ;
+
+   CPPUNIT_LOG(std::endl) ;
+   CPPUNIT_LOG_EQUAL(TinyLfuPool.set_size_limit(3), (size_t)2) ;
+   CPPUNIT_LOG_EQUAL(TinyLfuPool.clear(), (size_t)2) ;
+   CPPUNIT_LOG_EQUAL(TinyLfuPool.size(), (size_t)0) ;
+   CPPUNIT_LOG_RUN(TinyLfuPool.put("hot0", 1)) ;
+   CPPUNIT_LOG_RUN(TinyLfuPool.put("hot0", 2)) ;
+   CPPUNIT_LOG_EQUAL(TinyLfuPool.erase("hot0"), (size_t)2) ;
+   CPPUNIT_LOG_EQUAL(TinyLfuPool.size(), (size_t)0) ;
+}
+
 int main(int argc, char *argv[])
 {
    pcomn::unit::TestRunner runner ;
@@ -19,6 +19,7 @@
 
 #include <errno.h>
 #include <stdlib.h>
+#include <string.h>
 
 /*******************************************************************************
                      class CfgParserTests
@@ -32,12 +33,14 @@ class CfgParserTests : public CppUnit::TestFixture {
       void Test_CfgFileRead() ;
       void Test_CfgIterators() ;
       void Test_CfgFileWrite() ;
+      void Test_CfgFileObject() ;
 
       CPPUNIT_TEST_SUITE(CfgParserTests) ;
 
       CPPUNIT_TEST(Test_CfgFileRead) ;
       CPPUNIT_TEST(Test_CfgIterators) ;
       CPPUNIT_TEST(Test_CfgFileWrite) ;
+      CPPUNIT_TEST(Test_CfgFileObject) ;
 
       CPPUNIT_TEST_SUITE_END() ;
 } ;
@@ -292,6 +295,114 @@ void CfgParserTests::Test_CfgFileWrite()
    CPPUNIT_LOG_ASSERT(cfgfile_write_value("foobar.write.ini", NULL, NULL, NULL)) ;
    CPPUNIT_LOG_EQUAL(pcomn::unit::full_file("foobar.write.ini"),
                      std::string("[Quux]\nBye = baby\n\n")) ;
+
+   CPPUNIT_LOG(std::endl) ;
+   // A failed write doesn't leave its modification in the cache
+   CPPUNIT_LOG_ASSERT(Cleanup_CfgFile("foobar.readonly.ini")) ;
+   CPPUNIT_LOG_ASSERT(cfgfile_write_value("foobar.readonly.ini", "Foo", "Bar", "1")) ;
+   CPPUNIT_LOG_EQUAL(chmod("foobar.readonly.ini", 0444), 0) ;
+   if (!access("foobar.readonly.ini", W_OK))
+      CPPUNIT_LOG("The process can write read-only files, skip the failed write test" << std::endl) ;
+   else
+   {
+      CPPUNIT_LOG_IS_FALSE(cfgfile_write_value("foobar.readonly.ini", "Foo", "Bar", "2")) ;
+      CPPUNIT_LOG_IS_FALSE(cfgfile_write_value("foobar.readonly.ini", "Foo", NULL, NULL)) ;
+      CPPUNIT_LOG_EQUAL(cfgfile_get_value("foobar.readonly.ini", "Foo", "Bar", buf), (size_t)1) ;
+      CPPUNIT_LOG_EQUAL(std::string(buf), std::string("1")) ;
+
+      CPPUNIT_LOG_EQUAL(chmod("foobar.readonly.ini", 0644), 0) ;
+      CPPUNIT_LOG_ASSERT(cfgfile_write_value("foobar.readonly.ini", "Foo", "Quux", "3")) ;
+      CPPUNIT_LOG_EQUAL(pcomn::unit::full_file("foobar.readonly.ini"),
+                        std::string("[Foo]\nBar = 1\nQuux = 3\n\n")) ;
+   }
+   CPPUNIT_LOG_ASSERT(Cleanup_CfgFile("foobar.readonly.ini")) ;
+}
+
+void CfgParserTests::Test_CfgFileObject()
+{
+   typedef std::pair<std::string, std::string> strpair ;
+
+   const std::string cfgfile_path (CPPUNIT_AT_TESTDIR("CfgParserTests.TestRead.windows.eol.lst")) ;
+   {
+      const pcomn::cfgfile cfg (cfgfile_path) ;
+      CPPUNIT_LOG_ASSERT(cfg.exists()) ;
+      CPPUNIT_LOG_IS_FALSE(cfg.modified()) ;
+      CPPUNIT_LOG_EQUAL(cfg.sectnames(), CPPUNIT_STRVECTOR(("Bar") ("Quux") ("Restaurant"))) ;
+
+      CPPUNIT_LOG_EQUAL(cfg.get_value("", "Leben"), std::string("ist wunderschoen")) ;
+      CPPUNIT_LOG_EQUAL(cfg.get_value("RESTAURANT", "OF"), std::string("the Universe")) ;
+      CPPUNIT_LOG_EQUAL(cfg.get_value("Restaurant", "by", "Troll"), std::string("Troll")) ;
+      CPPUNIT_LOG_IS_NULL(cfg.find_value("Restaurant", "by")) ;
+      CPPUNIT_LOG_IS_NULL(cfg.find_value("Nothing", "by")) ;
+      CPPUNIT_LOG_ASSERT(cfg.find_value("Bar", "15")) ;
+      CPPUNIT_LOG_EQUAL(*cfg.find_value("Bar", "15"), std::string()) ;
+      // The second appearance of [Bar]
+      CPPUNIT_LOG_EQUAL(cfg.get_value("Bar", "quux"), std::string("foobar")) ;
+
+      CPPUNIT_LOG_EQUAL(cfg.section("Bar"),
+                        (std::vector<strpair>{{"hello", "world"}, {"15", ""}, {"2x2", "4"}, {"quux", "foobar"}})) ;
+      CPPUNIT_LOG_EQUAL(cfg.section(""), (std::vector<strpair>{{"Leben", "ist wunderschoen"}})) ;
+      CPPUNIT_LOG_ASSERT(cfg.section("Quux").empty()) ;
+      CPPUNIT_LOG_ASSERT(cfg.section("Nothing").empty()) ;
+   }
+
+   CPPUNIT_LOG(std::endl) ;
+   const char * const fname = "foobar.object.ini" ;
+   CPPUNIT_LOG_ASSERT(Cleanup_CfgFile(fname)) ;
+   {
+      pcomn::cfgfile cfg (fname) ;
+      CPPUNIT_LOG_IS_FALSE(cfg.exists()) ;
+      CPPUNIT_LOG_IS_FALSE(cfg.revalidate()) ;
+      CPPUNIT_LOG_ASSERT(cfg.sectnames().empty()) ;
+
+      // Batched modifications: the file is written only by flush()
+      CPPUNIT_LOG_RUN(cfg.set_value("", "Hello", "world")) ;
+      CPPUNIT_LOG_RUN(cfg.set_value("Bar", "hello", "world")) ;
+      CPPUNIT_LOG_RUN(cfg.set_value("Bar", "world", "15")) ;
+      CPPUNIT_LOG_RUN(cfg.set_value("Quux", "Bye", "baby")) ;
+      CPPUNIT_LOG_RUN(cfg.set_value("bar", "HELLO", "12")) ;
+      CPPUNIT_LOG_ASSERT(cfg.modified()) ;
+      CPPUNIT_LOG_EQUAL(cfg.get_value("Bar", "hello"), std::string("12")) ;
+      CPPUNIT_LOG_EQUAL(cfg.sectnames(), CPPUNIT_STRVECTOR(("Bar") ("Quux"))) ;
+      CPPUNIT_LOG_IS_FALSE(cfg.revalidate()) ;
+      CPPUNIT_LOG_EQUAL(access(fname, 0), -1) ;
+
+      CPPUNIT_LOG_RUN(cfg.flush()) ;
+      CPPUNIT_LOG_ASSERT(cfg.exists()) ;
+      CPPUNIT_LOG_IS_FALSE(cfg.modified()) ;
+      CPPUNIT_LOG_EQUAL(pcomn::unit::full_file(fname),
+                        std::string("Hello = world\n\n"
+                                    "[Bar]\nHELLO = 12\nworld = 15\n\n"
+                                    "[Quux]\nBye = baby\n\n")) ;
+      CPPUNIT_LOG_IS_FALSE(cfg.revalidate()) ;
+
+      CPPUNIT_LOG_IS_FALSE(cfg.del_value("Bar", "nothing")) ;
+      CPPUNIT_LOG_IS_FALSE(cfg.del_section("Nothing")) ;
+      CPPUNIT_LOG_IS_FALSE(cfg.modified()) ;
+      CPPUNIT_LOG_ASSERT(cfg.del_value("Bar", "World")) ;
+      CPPUNIT_LOG_ASSERT(cfg.del_section("Quux")) ;
+      CPPUNIT_LOG_IS_NULL(cfg.find_value("Bar", "world")) ;
+      CPPUNIT_LOG_EQUAL(cfg.sectnames(), CPPUNIT_STRVECTOR(("Bar"))) ;
+      CPPUNIT_LOG_RUN(cfg.flush()) ;
+      CPPUNIT_LOG_EQUAL(pcomn::unit::full_file(fname), std::string("Hello = world\n\n[Bar]\nHELLO = 12\n\n\n")) ;
+   }
+
+   CPPUNIT_LOG(std::endl) ;
+   // The C API cache must notice the file is changed by someone else
+   char buf[256] ;
+   CPPUNIT_LOG_EQUAL(cfgfile_get_value(fname, "Bar", "hello", buf), strlen("12")) ;
+   CPPUNIT_LOG_EQUAL(std::string(buf), std::string("12")) ;
+   {
+      pcomn::cfgfile cfg (fname) ;
+      CPPUNIT_LOG_RUN(cfg.set_value("Bar", "hello", "Hello, world!")) ;
+      CPPUNIT_LOG_RUN(cfg.flush()) ;
+   }
+   CPPUNIT_LOG_EQUAL(cfgfile_get_value(fname, "Bar", "hello", buf), strlen("Hello, world!")) ;
+   CPPUNIT_LOG_EQUAL(std::string(buf), std::string("Hello, world!")) ;
+
+   CPPUNIT_LOG_ASSERT(Cleanup_CfgFile(fname)) ;
+   CPPUNIT_LOG_EQUAL(cfgfile_get_value(fname, "Bar", "hello", buf, "Troll"), (size_t)0) ;
+   CPPUNIT_LOG_EQUAL(cfgfile_get_intval(fname, "Bar", "hello", 7), 7) ;
 }
 
 int main(int argc, char *argv[])
@@ -17,6 +17,7 @@
 
 #include <typeinfo>
 #include <memory>
+#include <vector>
 #include <fstream>
 
 #include <stdio.h>
@@ -29,12 +30,14 @@ class HashFnTests : public CppUnit::TestFixture {
       void Test_Hash_Functions() ;
       void Test_String_Hash() ;
       void Test_Tuple_Hash() ;
+      void Test_CRC32() ;
 
       CPPUNIT_TEST_SUITE(HashFnTests) ;
 
       CPPUNIT_TEST(Test_Hash_Functions) ;
       CPPUNIT_TEST(Test_String_Hash) ;
       CPPUNIT_TEST(Test_Tuple_Hash) ;
+      CPPUNIT_TEST(Test_CRC32) ;
 
       CPPUNIT_TEST_SUITE_END() ;
 } ;
@@ -158,6 +161,50 @@ void HashFnTests::Test_Tuple_Hash()
                      pcomn::tuplehash(10, 0.25, "Bar", 1024*1024*8192LL, 'A')) ;
 }
 
+void HashFnTests::Test_CRC32()
+{
+   const char Check[] = "123456789" ;
+
+   CPPUNIT_LOG_EQUAL(calc_crc32(0, Check, 9), (uint32_t)0xcbf43926) ;
+   CPPUNIT_LOG_EQUAL(calc_crc32c(0, Check, 9), (uint32_t)0xe3069283) ;
+   CPPUNIT_LOG_EQUAL(pcomn::calc_crc32(0, Check), (uint32_t)0xcbf43926) ;
+   CPPUNIT_LOG_EQUAL(calc_crc32(0, Check, 0), (uint32_t)0) ;
+   CPPUNIT_LOG_EQUAL(calc_crc32c(0, NULL, 10), (uint32_t)0) ;
+
+   CPPUNIT_LOG_EQUAL(calc_crc32(calc_crc32(0, Check, 4), Check + 4, 5), (uint32_t)0xcbf43926) ;
+   CPPUNIT_LOG_EQUAL(calc_crc32c(calc_crc32c(0, Check, 5), Check + 5, 4), (uint32_t)0xe3069283) ;
+
+   CPPUNIT_LOG(std::endl << "CRC32 hardware support: " << crc32_hw_supported()
+               << ", CRC32C hardware support: " << crc32c_hw_supported() << std::endl) ;
+
+   // All the implementations must agree for every length and alignment, including
+   // lengths around PCLMULQDQ folding boundaries (64 and 16 bytes)
+   std::vector<unsigned char> data (2048) ;
+   unsigned seed = 1 ;
+   for (unsigned char &c: data)
+      c = (seed = seed * 1103515245 + 12345) >> 16 ;
+
+   size_t mismatches = 0 ;
+   for (size_t offset = 0 ; offset < 8 ; ++offset)
+      for (size_t len = 0 ; len + offset <= data.size() ; len += 1 + (len >= 300) * 13)
+      {
+         const unsigned char * const buf = data.data() + offset ;
+         const uint32_t crc32 = calc_crc32_using(CRC32_BYTEWISE, 0x5a5a, buf, len) ;
+         const uint32_t crc32c = calc_crc32c_using(CRC32_BYTEWISE, 0x5a5a, buf, len) ;
+
+         for (crc32_impl_t impl: {CRC32_SLICE8, CRC32_SLICE16, CRC32_HARDWARE})
+            mismatches +=
+               (calc_crc32_using(impl, 0x5a5a, buf, len) != crc32) +
+               (calc_crc32c_using(impl, 0x5a5a, buf, len) != crc32c) ;
+
+         mismatches +=
+            (calc_crc32(0x5a5a, buf, len) != crc32) +
+            (calc_crc32c(0x5a5a, buf, len) != crc32c) +
+            (calc_crc32(calc_crc32(0x5a5a, buf, len/3), buf + len/3, len - len/3) != crc32) ;
+      }
+   CPPUNIT_LOG_EQUAL(mismatches, (size_t)0) ;
+}
+
 int main(int argc, char *argv[])
 {
    return pcomn::unit::run_tests
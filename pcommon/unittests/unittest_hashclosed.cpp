@@ -10,6 +10,7 @@
  CREATION DATE:   20 Apr 2008
 *******************************************************************************/
 #include <pcomn_hashclosed.h>
+#include <pcomn_hashrobin.h>
 #include <pcomn_string.h>
 #include <pcomn_strslice.h>
 #include <pcomn_hashclosed.h>
@@ -18,6 +19,10 @@
 #include <typeinfo>
 #include <memory>
 #include <fstream>
+#include <random>
+#include <set>
+#include <vector>
+#include <algorithm>
 
 #include <stdio.h>
 
@@ -57,6 +62,17 @@ class ClosedHashTests : public CppUnit::TestFixture {
       void Test_Closed_Hash_Strslice() ;
       void Test_Closed_Hash_PtrVal() ;
 
+      template<typename CtrlGroup>
+      void Test_Group_Hash_Insert_Erase() ;
+      template<typename CtrlGroup>
+      void Test_Group_Hash_Churn() ;
+      template<typename Layout>
+      void Test_Closed_Hash_Find_Many() ;
+      void Test_Group_Hash_Low_Load() ;
+      void Test_Robin_Hood_Insert_Erase() ;
+      void Test_Robin_Hood_Churn() ;
+      void Test_Robin_Hood_Overflow() ;
+
       CPPUNIT_TEST_SUITE(ClosedHashTests) ;
 
       CPPUNIT_TEST(Test_Hashtable_Bucket) ;
@@ -74,6 +90,20 @@ class ClosedHashTests : public CppUnit::TestFixture {
       CPPUNIT_TEST(Test_Closed_Hash_CString) ;
       CPPUNIT_TEST(Test_Closed_Hash_Strslice) ;
       CPPUNIT_TEST(Test_Closed_Hash_PtrVal) ;
+      CPPUNIT_TEST(Test_Group_Hash_Insert_Erase<pcomn::detail::ctrl_group_portable>) ;
+      CPPUNIT_TEST(Test_Group_Hash_Insert_Erase<pcomn::detail::native_ctrl_group>) ;
+      CPPUNIT_TEST(Test_Group_Hash_Churn<pcomn::detail::ctrl_group_portable>) ;
+      CPPUNIT_TEST(Test_Group_Hash_Low_Load) ;
+      CPPUNIT_TEST(Test_Group_Hash_Churn<pcomn::detail::native_ctrl_group>) ;
+#ifdef PCOMN_AVX2_INTRINSICS
+      CPPUNIT_TEST(Test_Group_Hash_Churn<pcomn::detail::ctrl_group_sse2>) ;
+#endif
+      CPPUNIT_TEST(Test_Closed_Hash_Find_Many<pcomn::linear_probing_layout>) ;
+      CPPUNIT_TEST(Test_Closed_Hash_Find_Many<pcomn::group_probing_layout>) ;
+      CPPUNIT_TEST(Test_Closed_Hash_Find_Many<pcomn::robin_hood_layout>) ;
+      CPPUNIT_TEST(Test_Robin_Hood_Insert_Erase) ;
+      CPPUNIT_TEST(Test_Robin_Hood_Churn) ;
+      CPPUNIT_TEST(Test_Robin_Hood_Overflow) ;
 
       CPPUNIT_TEST_SUITE_END() ;
 } ;
@@ -738,6 +768,446 @@ void ClosedHashTests::Test_Closed_Hash_PtrVal()
    CPPUNIT_LOG_EQ(TestHash.size(), 3) ;
 }
 
+/*******************************************************************************
+ Group probing layout
+*******************************************************************************/
+// Keys with equal residues modulo 8 have the same 7 hash bits, and every 64
+// consecutive keys start probing from the same slot, so both hash bits
+// false matches and long probe sequences are exercised.
+struct colliding_hash {
+      size_t operator()(long v) const { return (size_t)(v & 7) | ((size_t)v >> 6 << 7) ; }
+} ;
+
+template<typename CtrlGroup>
+void ClosedHashTests::Test_Group_Hash_Insert_Erase()
+{
+   using namespace pcomn ;
+   typedef closed_hashtable<long, identity, void, void, void, basic_group_probing_layout<CtrlGroup>> testtable_type ;
+
+   CPPUNIT_LOG_LINE("Group width " << (unsigned)CtrlGroup::width) ;
+
+   testtable_type IntHash ;
+   CPPUNIT_LOG_ASSERT(IntHash.empty()) ;
+   CPPUNIT_LOG_EQ(IntHash.bucket_count(), 0) ;
+   CPPUNIT_LOG_EQ(IntHash.load_factor(), 1.0) ;
+   CPPUNIT_LOG_EQ(IntHash.count(1), 0) ;
+   CPPUNIT_LOG_EQ(IntHash.erase(1), 0) ;
+   CPPUNIT_LOG_ASSERT(IntHash.begin() == IntHash.end()) ;
+   CPPUNIT_LOG_ASSERT(IntHash.find(1) == IntHash.end()) ;
+
+   CPPUNIT_LOG(std::endl) ;
+   CPPUNIT_LOG_ASSERT(IntHash.insert(20).second) ;
+   CPPUNIT_LOG_EXPRESSION(IntHash) ;
+   CPPUNIT_LOG_EQ(IntHash.size(), 1) ;
+   CPPUNIT_LOG_EQ(IntHash.bucket_count(), CtrlGroup::width - 1) ;
+   CPPUNIT_LOG_IS_FALSE(IntHash.insert(20).second) ;
+   CPPUNIT_LOG_EQUAL(IntHash.insert(20).first, IntHash.begin()) ;
+   CPPUNIT_LOG_EQUAL(IntHash.find(20), IntHash.begin()) ;
+   CPPUNIT_LOG_EQUAL(*IntHash.begin(), 20L) ;
+   CPPUNIT_LOG_EQUAL(++IntHash.begin(), IntHash.end()) ;
+   CPPUNIT_LOG_EQUAL(IntHash.find(19), IntHash.end()) ;
+
+   CPPUNIT_LOG(std::endl) ;
+   for (long i = 0 ; i < 1000 ; ++i)
+      IntHash.insert(i) ;
+   CPPUNIT_LOG_EXPRESSION(IntHash) ;
+   CPPUNIT_LOG_EQ(IntHash.size(), 1000) ;
+   CPPUNIT_LOG_ASSERT(IntHash.load_factor() <= IntHash.max_load_factor()) ;
+   CPPUNIT_LOG_EQ(std::distance(IntHash.begin(), IntHash.end()), 1000) ;
+   CPPUNIT_LOG_EQ(std::set<long>(IntHash.begin(), IntHash.end()).size(), 1000) ;
+   CPPUNIT_LOG_EQ(IntHash.count(999), 1) ;
+   CPPUNIT_LOG_EQ(IntHash.count(1000), 0) ;
+   CPPUNIT_LOG_EQ(IntHash.count(-1), 0) ;
+
+   CPPUNIT_LOG(std::endl) ;
+   for (long i = 0 ; i < 1000 ; i += 2)
+      IntHash.erase(i) ;
+   CPPUNIT_LOG_EQ(IntHash.size(), 500) ;
+   CPPUNIT_LOG_EQ(std::distance(IntHash.begin(), IntHash.end()), 500) ;
+   CPPUNIT_LOG_EQ(IntHash.count(998), 0) ;
+   CPPUNIT_LOG_EQ(IntHash.count(999), 1) ;
+
+   long erased = 0 ;
+   CPPUNIT_LOG_EQ(IntHash.erase(501, erased), 1) ;
+   CPPUNIT_LOG_EQUAL(erased, 501L) ;
+   CPPUNIT_LOG_RUN(IntHash.erase(IntHash.find(503))) ;
+   CPPUNIT_LOG_EQ(IntHash.size(), 498) ;
+   CPPUNIT_LOG_EQ(IntHash.count(501) + IntHash.count(503), 0) ;
+
+   CPPUNIT_LOG(std::endl) ;
+   testtable_type IntHashCopy (IntHash) ;
+   CPPUNIT_LOG_EQ(IntHashCopy.size(), 498) ;
+   CPPUNIT_LOG_ASSERT(std::set<long>(IntHash.begin(), IntHash.end()) ==
+                      std::set<long>(IntHashCopy.begin(), IntHashCopy.end())) ;
+
+   testtable_type IntHashMoved (std::move(IntHash)) ;
+   CPPUNIT_LOG_ASSERT(IntHash.empty()) ;
+   CPPUNIT_LOG_ASSERT(IntHash.begin() == IntHash.end()) ;
+   CPPUNIT_LOG_EQ(IntHashMoved.size(), 498) ;
+   CPPUNIT_LOG_EQ(IntHashMoved.count(999), 1) ;
+
+   CPPUNIT_LOG_RUN(IntHashCopy.clear()) ;
+   CPPUNIT_LOG_ASSERT(IntHashCopy.empty()) ;
+   CPPUNIT_LOG_EQ(IntHashCopy.bucket_count(), 0) ;
+   CPPUNIT_LOG_ASSERT(IntHashCopy.insert(7).second) ;
+   CPPUNIT_LOG_EQ(IntHashCopy.count(7), 1) ;
+
+   CPPUNIT_LOG(std::endl) ;
+   testtable_type IntHashReserved ({100, 0.5}) ;
+   CPPUNIT_LOG_EQ(IntHashReserved.max_load_factor(), 0.5) ;
+   CPPUNIT_LOG_EQ(IntHashReserved.bucket_count(), 255) ;
+   CPPUNIT_LOG_RUN(IntHashReserved.reserve(200)) ;
+   CPPUNIT_LOG_EQ(IntHashReserved.bucket_count(), 511) ;
+
+   CPPUNIT_LOG(std::endl) ;
+   typedef closed_hashtable<KeyedHashval, ::extract_key, void, void, void, basic_group_probing_layout<CtrlGroup>> keyedtable_type ;
+   keyedtable_type KeyedHash ;
+   KeyedHashval v3467 = { 3467, "v:3467" } ;
+   KeyedHashval old ;
+
+   CPPUNIT_LOG_ASSERT(KeyedHash.insert(v3467).second) ;
+   CPPUNIT_LOG_RUN(strcpy(v3467.str, "new:3467")) ;
+   CPPUNIT_LOG_IS_FALSE(KeyedHash.replace(v3467, old).second) ;
+   CPPUNIT_LOG_EQUAL(std::string(old.str), std::string("v:3467")) ;
+   CPPUNIT_LOG_EQUAL(std::string(KeyedHash.find(3467)->str), std::string("new:3467")) ;
+   CPPUNIT_LOG_ASSERT(find_keyed_value(KeyedHash, 3467, old)) ;
+   CPPUNIT_LOG_EQUAL(std::string(old.str), std::string("new:3467")) ;
+}
+
+template<typename CtrlGroup>
+void ClosedHashTests::Test_Group_Hash_Churn()
+{
+   using namespace pcomn ;
+   typedef closed_hashtable<long, identity, colliding_hash, void, void,
+                            basic_group_probing_layout<CtrlGroup>> testtable_type ;
+
+   CPPUNIT_LOG_LINE("Group width " << (unsigned)CtrlGroup::width) ;
+
+   testtable_type IntHash ;
+   std::set<long> Checker ;
+   std::mt19937 random (1) ;
+   std::uniform_int_distribution<long> keys (0, 4095) ;
+
+   size_t max_buckets = 0 ;
+   bool consistent = true ;
+   for (unsigned i = 0 ; i < 200000 ; ++i)
+   {
+      const long key = keys(random) ;
+      switch (random() % 3)
+      {
+         case 0:
+         case 1:
+            consistent &= IntHash.insert(key).second == Checker.insert(key).second ;
+            break ;
+         default:
+            consistent &= IntHash.erase(key) == Checker.erase(key) ;
+      }
+      max_buckets = std::max(max_buckets, IntHash.bucket_count()) ;
+      // Keep the table under constant pressure
+      if (Checker.size() > 3000)
+         for (unsigned n = 0 ; n < 1000 ; ++n)
+         {
+            IntHash.erase(*Checker.begin()) ;
+            Checker.erase(Checker.begin()) ;
+         }
+   }
+   CPPUNIT_LOG_ASSERT(consistent) ;
+   CPPUNIT_LOG_EXPRESSION(IntHash) ;
+   CPPUNIT_LOG_EQ(IntHash.size(), Checker.size()) ;
+   CPPUNIT_LOG_ASSERT(std::set<long>(IntHash.begin(), IntHash.end()) == Checker) ;
+
+   // Deleted slots must be reused or collected rather than grow the table
+   CPPUNIT_LOG_EXPRESSION(max_buckets) ;
+   CPPUNIT_LOG_ASSERT(max_buckets <= 8191) ;
+
+   for (long key = -10 ; key < 4106 ; ++key)
+      if (IntHash.count(key) != Checker.count(key))
+      {
+         CPPUNIT_LOG_EQ(IntHash.count(key), Checker.count(key)) ;
+         break ;
+      }
+}
+
+void ClosedHashTests::Test_Group_Hash_Low_Load()
+{
+   using namespace pcomn ;
+   typedef closed_hashtable<long, identity, void, void, void,
+                            basic_group_probing_layout<detail::ctrl_group_portable>> testtable_type ;
+
+   // With the group width 8 and the load factor below 1/7, the minimum capacity (7)
+   // has no growth reserve: the table must grow past it
+   testtable_type IntHash ({0, 0.125}) ;
+   CPPUNIT_LOG_EQ(IntHash.max_load_factor(), 0.125) ;
+
+   for (long i = 0 ; i < 100 ; ++i)
+      IntHash.insert(i) ;
+   CPPUNIT_LOG_EXPRESSION(IntHash) ;
+   CPPUNIT_LOG_EQ(IntHash.size(), 100) ;
+   CPPUNIT_LOG_ASSERT(IntHash.load_factor() <= IntHash.max_load_factor()) ;
+   CPPUNIT_LOG_EQ(IntHash.count(99), 1) ;
+   CPPUNIT_LOG_EQ(IntHash.count(100), 0) ;
+
+   CPPUNIT_LOG(std::endl) ;
+   // Erase and insert a single item: Deleted slots must be collected without hanging
+   testtable_type SingleHash ({0, 0.125}) ;
+   for (long i = 0 ; i < 100 ; ++i)
+   {
+      SingleHash.insert(i) ;
+      SingleHash.erase(i) ;
+   }
+   CPPUNIT_LOG_ASSERT(SingleHash.empty()) ;
+   CPPUNIT_LOG_ASSERT(SingleHash.insert(1000).second) ;
+   CPPUNIT_LOG_EQ(SingleHash.count(1000), 1) ;
+   CPPUNIT_LOG_EQ(SingleHash.count(0), 0) ;
+}
+
+template<typename Layout>
+void ClosedHashTests::Test_Closed_Hash_Find_Many()
+{
+   using namespace pcomn ;
+   typedef closed_hashtable<long, identity, void, void, void, Layout> testtable_type ;
+   typedef typename testtable_type::const_iterator const_iterator ;
+
+   testtable_type IntHash ;
+   const std::vector<long> keys {1, 2, 3} ;
+   std::vector<const_iterator> found ;
+
+   CPPUNIT_LOG_EQ(IntHash.count_many(keys.begin(), keys.end()), 0) ;
+   CPPUNIT_LOG_RUN(IntHash.find_many(keys.begin(), keys.end(), std::back_inserter(found))) ;
+   CPPUNIT_LOG_EQ(found.size(), 3) ;
+   CPPUNIT_LOG_ASSERT(std::all_of(found.begin(), found.end(), [&](const_iterator i) { return i == IntHash.cend() ; })) ;
+   CPPUNIT_LOG_EQ(IntHash.count_many(keys.begin(), keys.begin()), 0) ;
+
+   CPPUNIT_LOG(std::endl) ;
+   // Even keys are present, odd keys are absent; the count of keys is not divisible
+   // by the batch size
+   for (long i = 0 ; i < 10000 ; i += 2)
+      IntHash.insert(i) ;
+   std::vector<long> probes ;
+   for (long i = 1000 ; i < 1000 + 3*PCOMN_CLOSED_HASH_PREFETCH_BATCH + 5 ; ++i)
+      probes.push_back(i) ;
+
+   found.clear() ;
+   CPPUNIT_LOG_RUN(IntHash.find_many(probes.begin(), probes.end(), std::back_inserter(found))) ;
+   CPPUNIT_LOG_EQ(found.size(), probes.size()) ;
+   CPPUNIT_LOG_EQ(IntHash.count_many(probes.begin(), probes.end()), (probes.size() + 1)/2) ;
+
+   bool consistent = true ;
+   for (size_t i = 0 ; i < probes.size() ; ++i)
+      consistent &= found[i] == IntHash.find(probes[i]) &&
+         (found[i] == IntHash.cend() || *found[i] == probes[i]) ;
+   CPPUNIT_LOG_ASSERT(consistent) ;
+
+   const_iterator results[4] ;
+   const long few[] = {4, 5, 9998, 9999} ;
+   CPPUNIT_LOG_ASSERT(IntHash.find_many(std::begin(few), std::end(few), results) == std::end(results)) ;
+   CPPUNIT_LOG_EQUAL(*results[0], 4L) ;
+   CPPUNIT_LOG_ASSERT(results[1] == IntHash.cend()) ;
+   CPPUNIT_LOG_EQUAL(*results[2], 9998L) ;
+   CPPUNIT_LOG_ASSERT(results[3] == IntHash.cend()) ;
+}
+
+/*******************************************************************************
+ Robin Hood layout
+*******************************************************************************/
+void ClosedHashTests::Test_Robin_Hood_Insert_Erase()
+{
+   using namespace pcomn ;
+   // Identity hash allows to create predictable collisions
+   typedef closed_hashtable<long, identity, hash_identity, void, void, robin_hood_layout> testtable_type ;
+
+   testtable_type IntHash ;
+   CPPUNIT_LOG_ASSERT(IntHash.empty()) ;
+   CPPUNIT_LOG_EQ(IntHash.bucket_count(), 0) ;
+   CPPUNIT_LOG_EQ(IntHash.count(1), 0) ;
+   CPPUNIT_LOG_EQ(IntHash.erase(1), 0) ;
+   CPPUNIT_LOG_ASSERT(IntHash.begin() == IntHash.end()) ;
+   CPPUNIT_LOG_ASSERT(IntHash.find(1) == IntHash.end()) ;
+
+   CPPUNIT_LOG(std::endl) ;
+   CPPUNIT_LOG_ASSERT(IntHash.insert(20).second) ;
+   CPPUNIT_LOG_EXPRESSION(IntHash) ;
+   CPPUNIT_LOG_EQ(IntHash.bucket_count(), 8) ;
+   CPPUNIT_LOG_IS_FALSE(IntHash.insert(20).second) ;
+   CPPUNIT_LOG_EQUAL(IntHash.insert(20).first, IntHash.begin()) ;
+   CPPUNIT_LOG_EQUAL(*IntHash.begin(), 20L) ;
+   CPPUNIT_LOG_EQUAL(++IntHash.begin(), IntHash.end()) ;
+   CPPUNIT_LOG_RUN(IntHash.clear()) ;
+
+   CPPUNIT_LOG(std::endl) ;
+   // 1, 9, 17 share the home bucket 1; 2 is displaced by 9 and 17, 3 by 2
+   testtable_type RHash ({4, 0.875}) ;
+   CPPUNIT_LOG_EQ(RHash.bucket_count(), 8) ;
+   CPPUNIT_LOG_ASSERT(RHash.insert(1).second) ;
+   CPPUNIT_LOG_ASSERT(RHash.insert(2).second) ;
+   CPPUNIT_LOG_ASSERT(RHash.insert(3).second) ;
+   CPPUNIT_LOG_ASSERT(RHash.insert(9).second) ;
+   CPPUNIT_LOG_ASSERT(RHash.insert(17).second) ;
+   CPPUNIT_LOG_EQ(RHash.size(), 5) ;
+   CPPUNIT_LOG_EQ(RHash.bucket_count(), 8) ;
+   CPPUNIT_LOG_EQ(RHash.max_probe_length(), 2) ;
+   CPPUNIT_LOG_EQUAL(std::vector<long>(RHash.begin(), RHash.end()), (std::vector<long>{1, 9, 17, 2, 3})) ;
+
+   CPPUNIT_LOG_EQ(RHash.count(25), 0) ;
+   CPPUNIT_LOG_EQ(RHash.count(4), 0) ;
+
+   CPPUNIT_LOG(std::endl) ;
+   // Backward shift: no tombstones are left
+   CPPUNIT_LOG_EQ(RHash.erase(1), 1) ;
+   CPPUNIT_LOG_EQUAL(std::vector<long>(RHash.begin(), RHash.end()), (std::vector<long>{9, 17, 2, 3})) ;
+   CPPUNIT_LOG_EQ(RHash.max_probe_length(), 1) ;
+   CPPUNIT_LOG_EQ(RHash.erase(2), 1) ;
+   CPPUNIT_LOG_EQUAL(std::vector<long>(RHash.begin(), RHash.end()), (std::vector<long>{9, 17, 3})) ;
+   CPPUNIT_LOG_EQ(RHash.max_probe_length(), 1) ;
+
+   long erased = 0 ;
+   CPPUNIT_LOG_EQ(RHash.erase(9, erased), 1) ;
+   CPPUNIT_LOG_EQUAL(erased, 9L) ;
+   CPPUNIT_LOG_EQUAL(std::vector<long>(RHash.begin(), RHash.end()), (std::vector<long>{17, 3})) ;
+   CPPUNIT_LOG_EQ(RHash.max_probe_length(), 0) ;
+   CPPUNIT_LOG_RUN(RHash.erase(RHash.find(17))) ;
+   CPPUNIT_LOG_EQUAL(std::vector<long>(RHash.begin(), RHash.end()), (std::vector<long>{3})) ;
+
+   CPPUNIT_LOG(std::endl) ;
+   for (long i = 0 ; i < 1000 ; ++i)
+      RHash.insert(i) ;
+   CPPUNIT_LOG_EXPRESSION(RHash) ;
+   CPPUNIT_LOG_EQ(RHash.size(), 1000) ;
+   CPPUNIT_LOG_ASSERT(RHash.load_factor() <= RHash.max_load_factor()) ;
+
+   testtable_type RHashCopy (RHash) ;
+   CPPUNIT_LOG_EQ(RHashCopy.size(), 1000) ;
+   CPPUNIT_LOG_ASSERT(std::set<long>(RHash.begin(), RHash.end()) ==
+                      std::set<long>(RHashCopy.begin(), RHashCopy.end())) ;
+
+   testtable_type RHashMoved (std::move(RHash)) ;
+   CPPUNIT_LOG_ASSERT(RHash.empty()) ;
+   CPPUNIT_LOG_ASSERT(RHash.begin() == RHash.end()) ;
+   CPPUNIT_LOG_EQ(RHashMoved.size(), 1000) ;
+   CPPUNIT_LOG_EQ(RHashMoved.count(999), 1) ;
+
+   CPPUNIT_LOG(std::endl) ;
+   testtable_type RHashDense ({0, 1.0}) ;
+   CPPUNIT_LOG_EQ(RHashDense.max_load_factor(), 0.9375) ;
+   testtable_type RHashSparse ({100, 0.05}) ;
+   CPPUNIT_LOG_EQ(RHashSparse.max_load_factor(), 0.125) ;
+   CPPUNIT_LOG_EQ(RHashSparse.bucket_count(), 1024) ;
+   CPPUNIT_LOG_RUN(RHashSparse.reserve(200)) ;
+   CPPUNIT_LOG_EQ(RHashSparse.bucket_count(), 2048) ;
+
+   // All the keys collide: the probe sequence is as long as the table
+   CPPUNIT_LOG(std::endl) ;
+   struct constant_hash { size_t operator()(long) const { return 5 ; } } ;
+   typedef closed_hashtable<long, identity, constant_hash, void, void, robin_hood_layout> collidingtable_type ;
+
+   collidingtable_type CHash ;
+   for (long i = 0 ; i < 300 ; ++i)
+      CHash.insert(i) ;
+   CPPUNIT_LOG_EXPRESSION(CHash) ;
+   CPPUNIT_LOG_EQ(CHash.size(), 300) ;
+   CPPUNIT_LOG_EQ(CHash.max_probe_length(), 299) ;
+   CPPUNIT_LOG_EQ(CHash.count(0), 1) ;
+   CPPUNIT_LOG_EQ(CHash.count(299), 1) ;
+   CPPUNIT_LOG_EQ(CHash.count(300), 0) ;
+   for (long i = 0 ; i < 300 ; i += 2)
+      CHash.erase(i) ;
+   CPPUNIT_LOG_EQ(CHash.size(), 150) ;
+   CPPUNIT_LOG_EQ(CHash.max_probe_length(), 149) ;
+   CPPUNIT_LOG_EQ(CHash.count(0), 0) ;
+   CPPUNIT_LOG_EQ(CHash.count(299), 1) ;
+}
+
+void ClosedHashTests::Test_Robin_Hood_Churn()
+{
+   using namespace pcomn ;
+   typedef closed_hashtable<long, identity, void, void, void, robin_hood_layout> testtable_type ;
+
+   // Keep the table at the maximum load under constant churn
+   testtable_type IntHash ({4000, 0.9375}) ;
+   const size_t bucket_count = IntHash.bucket_count() ;
+   CPPUNIT_LOG_EQ(bucket_count, 8192) ;
+
+   std::set<long> Checker ;
+   std::mt19937 random (1) ;
+   std::uniform_int_distribution<long> keys (0, 1L << 30) ;
+
+   while (Checker.size() < 7600)
+   {
+      const long key = keys(random) ;
+      IntHash.insert(key) ;
+      Checker.insert(key) ;
+   }
+   CPPUNIT_LOG_EXPRESSION(IntHash) ;
+   CPPUNIT_LOG_EXPRESSION(IntHash.max_probe_length()) ;
+
+   bool consistent = true ;
+   size_t max_probe = 0 ;
+   for (unsigned i = 0 ; i < 200000 ; ++i)
+   {
+      auto victim = Checker.lower_bound(keys(random)) ;
+      if (victim == Checker.end())
+         victim = Checker.begin() ;
+      consistent &= IntHash.erase(*victim) == 1 ;
+      Checker.erase(victim) ;
+
+      const long key = keys(random) ;
+      consistent &= IntHash.insert(key).second == Checker.insert(key).second ;
+
+      if (!(i % 10000))
+         max_probe = std::max(max_probe, IntHash.max_probe_length()) ;
+   }
+   CPPUNIT_LOG_ASSERT(consistent) ;
+   CPPUNIT_LOG_EXPRESSION(IntHash) ;
+   CPPUNIT_LOG_EQ(IntHash.size(), Checker.size()) ;
+   CPPUNIT_LOG_ASSERT(std::set<long>(IntHash.begin(), IntHash.end()) == Checker) ;
+   CPPUNIT_LOG_EQ(IntHash.count_many(Checker.begin(), Checker.end()), Checker.size()) ;
+
+   // No tombstones: the table doesn't grow under churn, and probe sequences stay short
+   CPPUNIT_LOG_EQ(IntHash.bucket_count(), bucket_count) ;
+   CPPUNIT_LOG_EXPRESSION(max_probe) ;
+   CPPUNIT_LOG_ASSERT(max_probe < 64) ;
+}
+
+void ClosedHashTests::Test_Robin_Hood_Overflow()
+{
+   using namespace pcomn ;
+   struct constant_hash { size_t operator()(long) const { return 5 ; } } ;
+   // Limit the probe distance to 15 to overflow it with a few keys
+   typedef closed_hashtable<long, identity, constant_hash, void, void,
+                            basic_robin_hood_layout<15>> collidingtable_type ;
+
+   // All the keys collide: 16 keys take the maximum probe distance, the next one
+   // exceeds it while the table is too sparse to blame anything but the hash function
+   collidingtable_type CHash ({256, 0.9375}) ;
+   const size_t bucket_count = CHash.bucket_count() ;
+   CPPUNIT_LOG_EQ(bucket_count, 512) ;
+
+   for (long i = 0 ; i < 16 ; ++i)
+      CHash.insert(i) ;
+   CPPUNIT_LOG_EQ(CHash.size(), 16) ;
+   CPPUNIT_LOG_EQ(CHash.max_probe_length(), 15) ;
+
+   CPPUNIT_LOG_EXCEPTION(CHash.insert(16), std::length_error) ;
+
+   // The table is left intact
+   CPPUNIT_LOG_EQ(CHash.size(), 16) ;
+   CPPUNIT_LOG_EQ(CHash.bucket_count(), bucket_count) ;
+   CPPUNIT_LOG_EQ(CHash.max_probe_length(), 15) ;
+   CPPUNIT_LOG_EQ(CHash.count(16), 0) ;
+   CPPUNIT_LOG_EQ(CHash.count(15), 1) ;
+
+   std::set<long> expected ;
+   for (long i = 0 ; i < 16 ; ++i)
+      expected.insert(expected.end(), i) ;
+   CPPUNIT_LOG_ASSERT(std::set<long>(CHash.begin(), CHash.end()) == expected) ;
+
+   // Erasing makes room for the key
+   CPPUNIT_LOG_EQ(CHash.erase(0), 1) ;
+   CPPUNIT_LOG_ASSERT(CHash.insert(16).second) ;
+   CPPUNIT_LOG_EQ(CHash.count(16), 1) ;
+   CPPUNIT_LOG_EQ(CHash.size(), 16) ;
+}
+
 int main(int argc, char *argv[])
 {
    pcomn::unit::TestRunner runner ;
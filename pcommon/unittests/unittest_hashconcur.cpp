@@ -0,0 +1,246 @@
+/*-*- tab-width:3;indent-tabs-mode:nil;c-file-style:"ellemtel";c-file-offsets:((innamespace . 0)(inclass . ++)) -*-*/
+/*******************************************************************************
+ FILE         :   unittest_hashconcur.cpp
+ COPYRIGHT    :   Yakov Markovitch, 2026. All rights reserved.
+                  See LICENSE for information on usage/redistribution.
+
+ DESCRIPTION  :   Unittests for pcomn::concurrent_hashtable.
+
+ PROGRAMMED BY:   Yakov Markovitch
+ CREATION DATE:   16 Oct 2026
+*******************************************************************************/
+#include <pcomn_hashconcur.h>
+#include <pcomn_unittest.h>
+
+#include <vector>
+#include <set>
+#include <thread>
+#include <algorithm>
+#include <numeric>
+
+/*******************************************************************************
+ Versioned value: check is a function of key and version, so a torn read
+ is detected
+*******************************************************************************/
+struct versioned {
+      uint64_t key ;
+      uint64_t version ;
+      uint64_t check ;
+
+      static versioned make(uint64_t k, uint64_t v)
+      {
+         return {k, v, pcomn::wang_hash64to32(k) ^ (v * 0x9E3779B97F4A7C15ULL)} ;
+      }
+
+      bool is_consistent() const { return check == make(key, version).check ; }
+} ;
+
+struct versioned_key {
+      uint64_t operator()(const versioned &v) const { return v.key ; }
+} ;
+
+typedef pcomn::concurrent_hashtable<versioned, versioned_key> versioned_table ;
+
+/*******************************************************************************
+ ConcurrentHashTests
+*******************************************************************************/
+class ConcurrentHashTests : public CppUnit::TestFixture {
+
+      void Test_Concurrent_Hash_Basic() ;
+      void Test_Concurrent_Hash_Grow() ;
+      void Test_Concurrent_Hash_Readers() ;
+
+      CPPUNIT_TEST_SUITE(ConcurrentHashTests) ;
+
+      CPPUNIT_TEST(Test_Concurrent_Hash_Basic) ;
+      CPPUNIT_TEST(Test_Concurrent_Hash_Grow) ;
+      CPPUNIT_TEST(Test_Concurrent_Hash_Readers) ;
+
+      CPPUNIT_TEST_SUITE_END() ;
+} ;
+
+void ConcurrentHashTests::Test_Concurrent_Hash_Basic()
+{
+   using namespace pcomn ;
+
+   concurrent_hashtable<long> IntHash ;
+   CPPUNIT_LOG_ASSERT(IntHash.empty()) ;
+   CPPUNIT_LOG_EQ(IntHash.bucket_count(), 8) ;
+   CPPUNIT_LOG_EQ(IntHash.max_load_factor(), PCOMN_CLOSED_HASH_LOAD_FACTOR) ;
+   CPPUNIT_LOG_EQ(IntHash.count(0), 0) ;
+
+   long found = -1 ;
+   CPPUNIT_LOG_IS_FALSE(IntHash.get(10, found)) ;
+   CPPUNIT_LOG_EQ(found, -1) ;
+
+   CPPUNIT_LOG_ASSERT(IntHash.insert(10)) ;
+   CPPUNIT_LOG_ASSERT(IntHash.insert(0)) ;
+   CPPUNIT_LOG_IS_FALSE(IntHash.insert(10)) ;
+   CPPUNIT_LOG_EQ(IntHash.size(), 2) ;
+   CPPUNIT_LOG_ASSERT(IntHash.get(10, found)) ;
+   CPPUNIT_LOG_EQ(found, 10) ;
+   CPPUNIT_LOG_EQ(IntHash.count(0), 1) ;
+   CPPUNIT_LOG_EQ(IntHash.count(1), 0) ;
+
+   CPPUNIT_LOG_EQ(IntHash.erase(1), 0) ;
+   CPPUNIT_LOG_EQ(IntHash.erase(10), 1) ;
+   CPPUNIT_LOG_EQ(IntHash.erase(10), 0) ;
+   CPPUNIT_LOG_EQ(IntHash.size(), 1) ;
+   CPPUNIT_LOG_EQ(IntHash.count(10), 0) ;
+   CPPUNIT_LOG_EQ(IntHash.count(0), 1) ;
+   CPPUNIT_LOG_ASSERT(IntHash.insert(10)) ;
+   CPPUNIT_LOG_EQ(IntHash.count(10), 1) ;
+
+   CPPUNIT_LOG(std::endl) ;
+   versioned_table VHash ({100, 0.5}) ;
+   CPPUNIT_LOG_EQ(VHash.max_load_factor(), 0.5) ;
+   CPPUNIT_LOG_EQ(VHash.bucket_count(), 256) ;
+
+   versioned v ;
+   CPPUNIT_LOG_ASSERT(VHash.insert(versioned::make(1, 1))) ;
+   CPPUNIT_LOG_IS_FALSE(VHash.insert(versioned::make(1, 2))) ;
+   CPPUNIT_LOG_ASSERT(VHash.get(1, v)) ;
+   CPPUNIT_LOG_EQ(v.version, 1) ;
+
+   CPPUNIT_LOG_IS_FALSE(VHash.replace(versioned::make(1, 3))) ;
+   CPPUNIT_LOG_ASSERT(VHash.get(1, v)) ;
+   CPPUNIT_LOG_EQ(v.version, 3) ;
+   CPPUNIT_LOG_ASSERT(VHash.replace(versioned::make(2, 1))) ;
+   CPPUNIT_LOG_EQ(VHash.size(), 2) ;
+
+   CPPUNIT_LOG_EQ(VHash.erase(1, v), 1) ;
+   CPPUNIT_LOG_EQ(v.key, 1) ;
+   CPPUNIT_LOG_EQ(v.version, 3) ;
+   CPPUNIT_LOG_ASSERT(v.is_consistent()) ;
+
+   const std::vector<versioned> values (VHash.values()) ;
+   CPPUNIT_LOG_EQ(values.size(), 1) ;
+   CPPUNIT_LOG_EQ(values.front().key, 2) ;
+
+   CPPUNIT_LOG_RUN(VHash.clear()) ;
+   CPPUNIT_LOG_ASSERT(VHash.empty()) ;
+   CPPUNIT_LOG_EQ(VHash.bucket_count(), 8) ;
+   CPPUNIT_LOG_EQ(VHash.count(2), 0) ;
+   CPPUNIT_LOG_ASSERT(VHash.values().empty()) ;
+
+   CPPUNIT_LOG_RUN(VHash.reserve(1000)) ;
+   CPPUNIT_LOG_EQ(VHash.bucket_count(), 2048) ;
+   CPPUNIT_LOG_RUN(VHash.reserve(10)) ;
+   CPPUNIT_LOG_EQ(VHash.bucket_count(), 2048) ;
+}
+
+void ConcurrentHashTests::Test_Concurrent_Hash_Grow()
+{
+   using namespace pcomn ;
+
+   concurrent_hashtable<long> IntHash ;
+   std::vector<long> keys (100000) ;
+   std::iota(keys.begin(), keys.end(), 0) ;
+
+   CPPUNIT_LOG_RUN(IntHash.insert(keys.begin(), keys.end())) ;
+   CPPUNIT_LOG_EXPRESSION(IntHash) ;
+   CPPUNIT_LOG_EQ(IntHash.size(), 100000) ;
+   CPPUNIT_LOG_EQ(IntHash.bucket_count(), 262144) ;
+   CPPUNIT_LOG_ASSERT(std::all_of(keys.begin(), keys.end(), [&](long k) { return IntHash.count(k) ; })) ;
+   CPPUNIT_LOG_EQ(IntHash.count(100000), 0) ;
+
+   // Churn: erased buckets are reused or dropped by rehashing, the table doesn't grow
+   const size_t bucket_count = IntHash.bucket_count() ;
+   for (long i = 0 ; i < 1000000 ; ++i)
+   {
+      IntHash.erase(i) ;
+      IntHash.insert(i + 100000) ;
+   }
+   CPPUNIT_LOG_EXPRESSION(IntHash) ;
+   CPPUNIT_LOG_EQ(IntHash.size(), 100000) ;
+   CPPUNIT_LOG_EQ(IntHash.bucket_count(), bucket_count) ;
+   CPPUNIT_LOG_EQ(IntHash.count(999999), 0) ;
+   CPPUNIT_LOG_EQ(IntHash.count(1000000), 1) ;
+   CPPUNIT_LOG_EQ(IntHash.count(1099999), 1) ;
+
+   const std::vector<long> values (IntHash.values()) ;
+   CPPUNIT_LOG_EQ(std::set<long>(values.begin(), values.end()).size(), 100000) ;
+   CPPUNIT_LOG_EQ(*std::min_element(values.begin(), values.end()), 1000000) ;
+}
+
+void ConcurrentHashTests::Test_Concurrent_Hash_Readers()
+{
+   // Keys [0, permanent_count) are always in the table, their values are being
+   // replaced with new versions; the transient keys are being inserted and erased
+   // making the table to rehash.
+   static const uint64_t permanent_count = 1000 ;
+   static const uint64_t transient_base = 1ULL << 32 ;
+
+   versioned_table VHash ;
+   for (uint64_t k = 0 ; k < permanent_count ; ++k)
+      VHash.insert(versioned::make(k, 0)) ;
+
+   std::atomic<bool>     stop {false} ;
+   std::atomic<unsigned> missing {0} ;
+   std::atomic<unsigned> torn {0} ;
+   std::atomic<unsigned> stale {0} ;
+   std::atomic<uint64_t> reads {0} ;
+
+   std::vector<std::thread> readers ;
+   for (unsigned n = 0 ; n < 4 ; ++n)
+      readers.emplace_back([&, n]
+      {
+         std::vector<uint64_t> last_version (permanent_count) ;
+         uint64_t count = 0 ;
+         for (uint64_t k = n ; !stop.load(std::memory_order_relaxed) ; k = (k + 7) % permanent_count, ++count)
+         {
+            versioned v ;
+            if (!VHash.get(k, v))
+               ++missing ;
+            else if (v.key != k || !v.is_consistent())
+               ++torn ;
+            // A reader never sees versions going back
+            else if (v.version < last_version[k])
+               ++stale ;
+            else
+               last_version[k] = v.version ;
+
+            VHash.count(transient_base + k) ;
+         }
+         reads += count ;
+      }) ;
+
+   const size_t initial_bucket_count = VHash.bucket_count() ;
+   size_t max_bucket_count = 0 ;
+   for (uint64_t version = 1 ; version <= 200 ; ++version)
+   {
+      for (uint64_t k = 0 ; k < permanent_count ; ++k)
+         VHash.replace(versioned::make(k, version)) ;
+      // Grow the table with transient keys and then erase them all
+      for (uint64_t k = 0 ; k < permanent_count * (version % 4) ; ++k)
+         VHash.insert(versioned::make(transient_base + k, version)) ;
+      max_bucket_count = std::max(max_bucket_count, VHash.bucket_count()) ;
+      for (uint64_t k = 0 ; k < permanent_count * (version % 4) ; ++k)
+         VHash.erase(transient_base + k) ;
+   }
+   stop = true ;
+   for (std::thread &t: readers)
+      t.join() ;
+
+   CPPUNIT_LOG_EXPRESSION(VHash) ;
+   CPPUNIT_LOG_EXPRESSION(reads.load()) ;
+   CPPUNIT_LOG_ASSERT(max_bucket_count > initial_bucket_count) ;
+   CPPUNIT_LOG_EQ(VHash.size(), permanent_count) ;
+   CPPUNIT_LOG_EQ(missing.load(), 0) ;
+   CPPUNIT_LOG_EQ(torn.load(), 0) ;
+   CPPUNIT_LOG_EQ(stale.load(), 0) ;
+
+   versioned v ;
+   CPPUNIT_LOG_ASSERT(VHash.get(permanent_count - 1, v)) ;
+   CPPUNIT_LOG_EQ(v.version, 200) ;
+}
+
+int main(int argc, char *argv[])
+{
+   pcomn::unit::TestRunner runner ;
+   runner.addTest(ConcurrentHashTests::suite()) ;
+
+   return
+      pcomn::unit::run_tests(runner, argc, argv, "unittest.hashconcur.trace.ini",
+                             "Concurrent read-mostly hashtable tests") ;
+}
@@ -0,0 +1,187 @@
+/*-*- tab-width:3;indent-tabs-mode:nil;c-file-style:"ellemtel";c-file-offsets:((innamespace . 0)(inclass . ++)) -*-*/
+/*******************************************************************************
+ FILE         :   unittest_internstr.cpp
+ COPYRIGHT    :   Yakov Markovitch, 2026. All rights reserved.
+                  See LICENSE for information on usage/redistribution.
+
+ DESCRIPTION  :   Unittests for pcomn::interned_string.
+
+ PROGRAMMED BY:   Yakov Markovitch
+ CREATION DATE:   16 Oct 2026
+*******************************************************************************/
+#include <pcomn_internstr.h>
+#include <pcomn_immutablestr.h>
+#include <pcomn_unittest.h>
+
+#include <vector>
+#include <set>
+#include <unordered_set>
+#include <thread>
+#include <algorithm>
+
+using namespace pcomn ;
+
+/*******************************************************************************
+ InternedStringTests
+*******************************************************************************/
+class InternedStringTests : public CppUnit::TestFixture {
+
+      void Test_Interned_String_Empty() ;
+      void Test_Interned_String_Identity() ;
+      void Test_Interned_String_Conversion() ;
+      void Test_Interned_String_Concurrent() ;
+
+      CPPUNIT_TEST_SUITE(InternedStringTests) ;
+
+      CPPUNIT_TEST(Test_Interned_String_Empty) ;
+      CPPUNIT_TEST(Test_Interned_String_Identity) ;
+      CPPUNIT_TEST(Test_Interned_String_Conversion) ;
+      CPPUNIT_TEST(Test_Interned_String_Concurrent) ;
+
+      CPPUNIT_TEST_SUITE_END() ;
+} ;
+
+void InternedStringTests::Test_Interned_String_Empty()
+{
+   const internstr empty ;
+   CPPUNIT_LOG_ASSERT(empty.empty()) ;
+   CPPUNIT_LOG_EQ(empty.size(), 0) ;
+   CPPUNIT_LOG_ASSERT(empty.c_str()) ;
+   CPPUNIT_LOG_EQ(*empty.c_str(), '\0') ;
+   CPPUNIT_LOG_EQ(empty.hash(), 0) ;
+
+   CPPUNIT_LOG_ASSERT(internstr("") == empty) ;
+   CPPUNIT_LOG_ASSERT(internstr(std::string()) == empty) ;
+   CPPUNIT_LOG_ASSERT(internstr(strslice()) == empty) ;
+   CPPUNIT_LOG_EQ(internstr("").c_str(), empty.c_str()) ;
+
+   CPPUNIT_LOG_ASSERT(winternstr(L"") == winternstr()) ;
+   CPPUNIT_LOG_ASSERT(winternstr().empty()) ;
+}
+
+void InternedStringTests::Test_Interned_String_Identity()
+{
+   const size_t initial_count = internstr::pool_stats().count ;
+
+   const internstr foo ("Hello, world!") ;
+   CPPUNIT_LOG_EQ(internstr::pool_stats().count, initial_count + 1) ;
+
+   CPPUNIT_LOG_EQ(foo.size(), 13) ;
+   CPPUNIT_LOG_EQ(std::string(foo.c_str()), "Hello, world!") ;
+
+   // Equal strings share the single copy
+   CPPUNIT_LOG_ASSERT(internstr(std::string("Hello, world!")) == foo) ;
+   CPPUNIT_LOG_EQ(internstr(std::string("Hello, world!")).c_str(), foo.c_str()) ;
+   CPPUNIT_LOG_EQ(internstr(strslice("Say \"Hello, world!\"")(5, -1)).c_str(), foo.c_str()) ;
+   CPPUNIT_LOG_EQ(internstr::pool_stats().count, initial_count + 1) ;
+
+   CPPUNIT_LOG_ASSERT(internstr("Hello, world") != foo) ;
+   CPPUNIT_LOG_ASSERT(internstr("Hello, world!!") != foo) ;
+   CPPUNIT_LOG_EQ(internstr::pool_stats().count, initial_count + 3) ;
+
+   // Strings with embedded zeros
+   const char zeros[] = "a\0b" ;
+   const internstr a_zero_b (zeros, zeros + 3) ;
+   CPPUNIT_LOG_EQ(a_zero_b.size(), 3) ;
+   CPPUNIT_LOG_ASSERT(a_zero_b != internstr("a")) ;
+   CPPUNIT_LOG_ASSERT(a_zero_b == internstr(zeros, 3)) ;
+
+   // The hash is precomputed and is the same as the hash of the string value
+   CPPUNIT_LOG_EQ(foo.hash(), valhash(strslice("Hello, world!"))) ;
+   CPPUNIT_LOG_EQ(valhash(foo), foo.hash()) ;
+   CPPUNIT_LOG_EQ(std::hash<internstr>()(foo), foo.hash()) ;
+
+   // Ordering is lexicographical, not by address
+   CPPUNIT_LOG_ASSERT(internstr("abc") < internstr("abd")) ;
+   CPPUNIT_LOG_ASSERT(internstr("abc") < internstr("abcd")) ;
+   CPPUNIT_LOG_ASSERT(internstr("b") > internstr("abcd")) ;
+   CPPUNIT_LOG_ASSERT(internstr("b") >= internstr("b")) ;
+   CPPUNIT_LOG_ASSERT(internstr() < internstr("a")) ;
+   CPPUNIT_LOG_EQ(internstr("abc").compare(internstr("abc")), 0) ;
+
+   const std::set<internstr> ordered {"b", "c", "a", "b"} ;
+   CPPUNIT_LOG_EQ(ordered.size(), 3) ;
+   CPPUNIT_LOG_EQ(std::string(ordered.begin()->c_str()), "a") ;
+
+   const std::unordered_set<internstr> hashed {"b", "c", "a", "b"} ;
+   CPPUNIT_LOG_EQ(hashed.size(), 3) ;
+   CPPUNIT_LOG_EQ(hashed.count("c"), 1) ;
+   CPPUNIT_LOG_EQ(hashed.count("d"), 0) ;
+
+   // Long strings are allocated separately from the arena blocks
+   const std::string long_string (1*MiB, 'x') ;
+   const internstr long_interned (long_string) ;
+   CPPUNIT_LOG_EQ(long_interned.size(), long_string.size()) ;
+   CPPUNIT_LOG_ASSERT(long_interned == internstr(long_string)) ;
+   CPPUNIT_LOG_ASSERT(long_interned != internstr(long_string.substr(1))) ;
+   CPPUNIT_LOG_ASSERT(internstr::pool_stats().memsize > long_string.size()) ;
+
+   const winternstr wfoo (L"Hello, world!") ;
+   CPPUNIT_LOG_ASSERT(wfoo == winternstr(std::wstring(L"Hello, world!"))) ;
+   CPPUNIT_LOG_ASSERT(wfoo != winternstr(L"Hello")) ;
+   CPPUNIT_LOG_EQ(wfoo.size(), 13) ;
+   CPPUNIT_LOG_EQ(wfoo.hash(), valhash(wstrslice(L"Hello, world!"))) ;
+}
+
+void InternedStringTests::Test_Interned_String_Conversion()
+{
+   const internstr foo ("foo") ;
+
+   CPPUNIT_LOG_EQ(str::len(foo), 3) ;
+   CPPUNIT_LOG_EQ(str::cstr(foo), foo.c_str()) ;
+
+   CPPUNIT_LOG_EQ(strslice(foo), strslice("foo")) ;
+   CPPUNIT_LOG_EQ(strslice(foo).begin(), foo.begin()) ;
+   CPPUNIT_LOG_EQ(istring(foo), istring("foo")) ;
+   CPPUNIT_LOG_EQ(std::string(foo.begin(), foo.end()), "foo") ;
+   CPPUNIT_LOG_EQ(internstr(istring("foo")), foo) ;
+
+   CPPUNIT_LOG_EQ(string_cast(foo), "foo") ;
+   CPPUNIT_LOG_EQ(string_cast(internstr()), "") ;
+}
+
+void InternedStringTests::Test_Interned_String_Concurrent()
+{
+   static const size_t strcount = 20000 ;
+   static const unsigned threadcount = 8 ;
+
+   std::vector<std::string> strings ;
+   for (size_t i = 0 ; i < strcount ; ++i)
+      strings.push_back("concurrent:" + std::to_string(i)) ;
+
+   const size_t initial_count = internstr::pool_stats().count ;
+
+   // Every thread interns all the strings, in different order
+   std::vector<std::vector<const char *>> interned (threadcount, std::vector<const char *>(strcount)) ;
+   std::vector<std::thread> threads ;
+   for (unsigned n = 0 ; n < threadcount ; ++n)
+      threads.emplace_back([&, n]
+      {
+         for (size_t i = 0 ; i < strcount ; ++i)
+         {
+            const size_t ndx = (n & 1) ? strcount - 1 - i : (i*7 + n) % strcount ;
+            interned[n][ndx] = internstr(strings[ndx]).c_str() ;
+         }
+      }) ;
+   for (std::thread &t: threads)
+      t.join() ;
+
+   CPPUNIT_LOG_EQ(internstr::pool_stats().count, initial_count + strcount) ;
+
+   for (unsigned n = 1 ; n < threadcount ; ++n)
+      CPPUNIT_LOG_ASSERT(interned[n] == interned[0]) ;
+
+   size_t mismatches = 0 ;
+   for (size_t i = 0 ; i < strcount ; ++i)
+      mismatches += strings[i] != interned[0][i] || internstr(strings[i]).c_str() != interned[0][i] ;
+   CPPUNIT_LOG_EQ(mismatches, 0) ;
+
+   CPPUNIT_LOG_EXPRESSION(internstr::pool_stats().count) ;
+   CPPUNIT_LOG_EXPRESSION(internstr::pool_stats().datasize) ;
+   CPPUNIT_LOG_EXPRESSION(internstr::pool_stats().memsize) ;
+}
+
+int main(int argc, char *argv[])
+{
+   return pcomn::unit::run_tests<InternedStringTests>(argc, argv) ;
+}
@@ -0,0 +1,202 @@
+/*-*- tab-width:4;indent-tabs-mode:nil;c-file-style:"ellemtel";c-basic-offset:4;c-file-offsets:((innamespace . 0)(inlambda . 0)) -*-*/
+/*******************************************************************************
+ FILE         :   unittest_parallel.cpp
+ COPYRIGHT    :   Yakov Markovitch, 2026. All rights reserved.
+                  See LICENSE for information on usage/redistribution.
+
+ DESCRIPTION  :   Unittests for parallel_for and parallel_reduce.
+
+ PROGRAMMED BY:   Yakov Markovitch
+ CREATION DATE:   16 Oct 2026
+*******************************************************************************/
+#include <pcomn_unittest_mt.h>
+#include <pcomn_parallel.h>
+#include <pcomn_vector.h>
+
+#include <numeric>
+#include <string>
+#include <thread>
+
+using namespace pcomn ;
+using namespace std::chrono ;
+
+/*******************************************************************************
+                            class ParallelTests
+*******************************************************************************/
+class ParallelTests : public CppUnit::TestFixture {
+
+    void Test_ParallelFor() ;
+    void Test_ParallelFor_ThreadPool() ;
+    void Test_ParallelFor_Exception() ;
+    void Test_ParallelReduce() ;
+    void Test_ParallelReduce_ThreadPool() ;
+
+    CPPUNIT_TEST_SUITE(ParallelTests) ;
+
+    CPPUNIT_TEST(Test_ParallelFor) ;
+    CPPUNIT_TEST(Test_ParallelFor_ThreadPool) ;
+    CPPUNIT_TEST(Test_ParallelFor_Exception) ;
+    CPPUNIT_TEST(Test_ParallelReduce) ;
+    CPPUNIT_TEST(Test_ParallelReduce_ThreadPool) ;
+
+    CPPUNIT_TEST_SUITE_END() ;
+
+private:
+    unit::watchdog watchdog {10s} ;
+
+public:
+    void setUp() { watchdog.arm() ; }
+    void tearDown() { watchdog.disarm() ; }
+} ;
+
+/*******************************************************************************
+ ParallelTests
+*******************************************************************************/
+void ParallelTests::Test_ParallelFor()
+{
+    // Empty ranges
+    CPPUNIT_LOG_RUN(parallel_for(0, 1, [](int) { throw std::logic_error("Must not be called") ; })) ;
+    CPPUNIT_LOG_RUN(parallel_for(std::vector<int>(), 0, [](int) { throw std::logic_error("Must not be called") ; })) ;
+
+    // Count range: every index is visited exactly once
+    for (size_t count: {1, 2, 7, 1000, 100000})
+        for (size_t grain: {0, 1, 16, 5000})
+        {
+            std::vector<std::atomic<unsigned>> visited (count) ;
+            parallel_for(count, grain, [&](size_t i) { ++visited[i] ; }) ;
+
+            CPPUNIT_LOG_EQUAL(std::count_if(visited.begin(), visited.end(), [](auto &v) { return v.load() == 1 ; }),
+                              (ptrdiff_t)count) ;
+        }
+    CPPUNIT_LOG(std::endl) ;
+
+    // Sequence range: items are passed by reference
+    std::vector<unsigned> v (54321) ;
+    std::iota(v.begin(), v.end(), 0) ;
+
+    CPPUNIT_LOG_RUN(parallel_for(v, 100, [](unsigned &item) { item *= 2 ; })) ;
+    unsigned mismatch = 0 ;
+    for (unsigned i = 0 ; i < v.size() ; ++i)
+        mismatch += v[i] != 2*i ;
+    CPPUNIT_LOG_EQ(mismatch, 0) ;
+
+    simple_slice<unsigned> s (v.data() + 1, v.data() + 11) ;
+    CPPUNIT_LOG_RUN(parallel_for(s, 1, [](unsigned &item) { item = 0 ; })) ;
+    CPPUNIT_LOG_EQ(v[0], 0) ;
+    CPPUNIT_LOG_EQ(v[10], 0) ;
+    CPPUNIT_LOG_EQ(v[11], 22) ;
+}
+
+void ParallelTests::Test_ParallelFor_ThreadPool()
+{
+    threadpool pool (3, "ParFor") ;
+
+    std::vector<std::atomic<unsigned>> visited (100000) ;
+    CPPUNIT_LOG_RUN(parallel_for(pool, visited.size(), 10, [&](size_t i) { ++visited[i] ; })) ;
+    CPPUNIT_LOG_EQUAL(std::count_if(visited.begin(), visited.end(), [](auto &v) { return v.load() == 1 ; }),
+                      (ptrdiff_t)visited.size()) ;
+
+    // Nested loops on the same pool must not deadlock, even when the pool is saturated
+    std::atomic<unsigned> total {0} ;
+    CPPUNIT_LOG_RUN(parallel_for(pool, 64, 1, [&](int)
+    {
+        parallel_for(pool, 100, 1, [&](int) { ++total ; }) ;
+    })) ;
+    CPPUNIT_LOG_EQ(total.load(), 6400) ;
+
+    // ...and when the task queue is full of stale helper jobs
+    CPPUNIT_LOG_RUN(pool.set_queue_capacity(2)) ;
+    total = 0 ;
+    CPPUNIT_LOG_RUN(parallel_for(pool, 64, 1, [&](int)
+    {
+        parallel_for(pool, 100, 1, [&](int) { ++total ; }) ;
+    })) ;
+    CPPUNIT_LOG_EQ(total.load(), 6400) ;
+
+    // Loop on a stopped pool runs on the calling thread
+    CPPUNIT_LOG_RUN(pool.stop()) ;
+    total = 0 ;
+    CPPUNIT_LOG_RUN(parallel_for(pool, 1000, 1, [&](int) { ++total ; })) ;
+    CPPUNIT_LOG_EQ(total.load(), 1000) ;
+}
+
+void ParallelTests::Test_ParallelFor_Exception()
+{
+    std::atomic<unsigned> called {0} ;
+
+    CPPUNIT_LOG_EXCEPTION_MSG(parallel_for(1000000, 1, [&](size_t i)
+    {
+        ++called ;
+        if (i == 1000)
+            throw std::runtime_error("Item 1000") ;
+    }),
+        std::runtime_error, "Item 1000") ;
+
+    CPPUNIT_LOG_EXPRESSION(called.load()) ;
+    CPPUNIT_LOG_ASSERT(called.load() < 1000000) ;
+
+    threadpool pool (2, "ParForX") ;
+    CPPUNIT_LOG_EXCEPTION(parallel_for(pool, 1000, 1, [](size_t i)
+    {
+        if (i % 100 == 99)
+            throw std::out_of_range("Item") ;
+    }),
+        std::out_of_range) ;
+    CPPUNIT_LOG_EQ(pool.size(), 2) ;
+}
+
+void ParallelTests::Test_ParallelReduce()
+{
+    const auto plus = [](uint64_t x, uint64_t y) { return x + y ; } ;
+    const auto ident = [](uint64_t x) { return x ; } ;
+
+    CPPUNIT_LOG_EQ(parallel_reduce(0, 7, ident, plus), 7) ;
+    CPPUNIT_LOG_EQ(parallel_reduce(1, 7, ident, plus), 7) ;
+    CPPUNIT_LOG_EQ(parallel_reduce(10, 7, ident, plus), 52) ;
+    CPPUNIT_LOG_EQ(parallel_reduce(1000000, 0ULL, ident, plus), 999999ULL*1000000/2) ;
+    CPPUNIT_LOG_EQ(parallel_reduce(1000000, 0ULL, ident, plus, 100000), 999999ULL*1000000/2) ;
+
+    // Non-commutative combine: the order must be preserved
+    std::vector<std::string> words ;
+    std::string expected ("^") ;
+    for (unsigned i = 0 ; i < 2000 ; ++i)
+    {
+        words.push_back(std::to_string(i)) ;
+        expected += words.back() ;
+    }
+
+    CPPUNIT_LOG_EQUAL(parallel_reduce(words, std::string("^"),
+                                      [](const std::string &w) { return w ; },
+                                      [](std::string x, const std::string &y) { return x += y ; }),
+                      expected) ;
+}
+
+void ParallelTests::Test_ParallelReduce_ThreadPool()
+{
+    threadpool pool (4, "ParRed") ;
+
+    std::vector<double> v (100000) ;
+    std::iota(v.begin(), v.end(), 1.0) ;
+
+    CPPUNIT_LOG_EQ(parallel_reduce(pool, v, 0.0,
+                                   [](double x) { return x ; },
+                                   [](double x, double y) { return std::max(x, y) ; }),
+                   100000.0) ;
+
+    CPPUNIT_LOG_EQ(parallel_reduce(pool, 100000, size_t(),
+                                   [](size_t i) { return size_t(i % 3 == 0) ; },
+                                   [](size_t x, size_t y) { return x + y ; }, 64),
+                   33334) ;
+}
+
+/*******************************************************************************
+ main
+*******************************************************************************/
+int main(int argc, char *argv[])
+{
+    return pcomn::unit::run_tests
+        <
+            ParallelTests
+        >
+        (argc, argv, "unittest.diag.ini") ;
+}
@@ -14,6 +14,9 @@
 #include <pcomn_meta.h>
 
 #include <memory>
+#include <algorithm>
+#include <vector>
+#include <random>
 #include <cctype>
 #include <clocale>
 
@@ -28,6 +31,7 @@ class StrSliceTests : public CppUnit::TestFixture {
       void Test_Strslice_String_Concat() ;
       void Test_Strslice_IsProperty() ;
       void Test_String_Split() ;
+      void Test_String_Split_Fields() ;
       void Test_Strslice_Strip() ;
       void Test_Strslice_Strnew() ;
       void Test_Strslice_Quote() ;
@@ -40,11 +44,51 @@ class StrSliceTests : public CppUnit::TestFixture {
       CPPUNIT_TEST(Test_Strslice_String_Concat) ;
       CPPUNIT_TEST(Test_Strslice_IsProperty) ;
       CPPUNIT_TEST(Test_String_Split) ;
+      CPPUNIT_TEST(Test_String_Split_Fields) ;
       CPPUNIT_TEST(Test_Strslice_Strip) ;
       CPPUNIT_TEST(Test_Strslice_Strnew) ;
       CPPUNIT_TEST(Test_Strslice_Quote) ;
 
       CPPUNIT_TEST_SUITE_END() ;
+
+      friend class StrScanTests ;
+} ;
+
+/*******************************************************************************
+ class StrScanTests
+ Every scan kernel variant the CPU supports vs. the generic one, then StrSliceTests
+ with every variant.
+*******************************************************************************/
+class StrScanTests : public CppUnit::TestFixture {
+
+      void Test_Kernel_Selection() ;
+      void Test_Kernels() ;
+      void Test_StrSlice_All_Kernels() ;
+
+      CPPUNIT_TEST_SUITE(StrScanTests) ;
+
+      CPPUNIT_TEST(Test_Kernel_Selection) ;
+      CPPUNIT_TEST(Test_Kernels) ;
+      CPPUNIT_TEST(Test_StrSlice_All_Kernels) ;
+
+      CPPUNIT_TEST_SUITE_END() ;
+
+   public:
+      void setUp() { _selected = pcomn::strscan::kernels().isa ; }
+      void tearDown() { pcomn::strscan::set_scan_kernels(_selected) ; }
+
+   private:
+      pcomn::strscan::kernel_isa _selected ;
+
+      static std::vector<pcomn::strscan::kernel_isa> supported_kernels()
+      {
+         using namespace pcomn::strscan ;
+         std::vector<kernel_isa> result ;
+         for (unsigned isa = 0 ; isa < kernel_isa_count ; ++isa)
+            if (is_kernel_isa_supported((kernel_isa)isa))
+               result.push_back((kernel_isa)isa) ;
+         return result ;
+      }
 } ;
 
 
@@ -221,8 +265,98 @@ void StrSliceTests::Test_String_Split()
    CPPUNIT_LOG_EQUAL(strrsplit(std::string("abcdcf"), 'c'), unipair<strslice>("abcd", "f")) ;
 }
 
+void StrSliceTests::Test_String_Split_Fields()
+{
+   using namespace pcomn ;
+
+   const byteset commas (",") ;
+   const byteset delims (",; ") ;
+   std::vector<strslice> fields ;
+
+   CPPUNIT_LOG_EQUAL(strsplit(strslice("ab,cd,e"), commas), unipair<strslice>("ab", "cd,e")) ;
+   CPPUNIT_LOG_EQUAL(strsplit(strslice("abcd"), commas), unipair<strslice>("abcd", "")) ;
+   CPPUNIT_LOG_IS_NULL(strsplit(strslice("abcd"), commas).second.begin()) ;
+   CPPUNIT_LOG_EQUAL(strrsplit(strslice("ab,cd,e"), commas), unipair<strslice>("ab,cd", "e")) ;
+   CPPUNIT_LOG_EQUAL(strrsplit(strslice("abcd"), commas), unipair<strslice>("", "abcd")) ;
+   CPPUNIT_LOG_IS_NULL(strrsplit(strslice("abcd"), commas).first.begin()) ;
+
+   const std::string str ("ab,cd,e") ;
+   CPPUNIT_LOG_EQUAL(strsplit(str, commas), unipair<strslice>("ab", "cd,e")) ;
+   CPPUNIT_LOG_EQUAL(strrsplit(str, commas), unipair<strslice>("ab,cd", "e")) ;
+   CPPUNIT_LOG_EQUAL(strsplit("ab;cd,e", delims), unipair<strslice>("ab", "cd,e")) ;
+   CPPUNIT_LOG_EQUAL(strrsplit("ab;cd e", delims), unipair<strslice>("ab;cd", "e")) ;
+   CPPUNIT_LOG_EQUAL(strrsplit("abcd", commas), unipair<strslice>("", "abcd")) ;
+
+   CPPUNIT_LOG(std::endl) ;
+   CPPUNIT_LOG_EQUAL(strsplit("a,b;;c d", delims, fields), (size_t)5) ;
+   CPPUNIT_LOG_EQUAL(fields, (std::vector<strslice>{"a", "b", "", "c", "d"})) ;
+   CPPUNIT_LOG_EQUAL(strsplit(",a,", commas, fields), (size_t)3) ;
+   CPPUNIT_LOG_EQUAL(fields, (std::vector<strslice>{"", "a", ""})) ;
+   CPPUNIT_LOG_EQUAL(strsplit("abc", commas, fields), (size_t)1) ;
+   CPPUNIT_LOG_EQUAL(fields, (std::vector<strslice>{"abc"})) ;
+   CPPUNIT_LOG_EQUAL(strsplit("", commas, fields), (size_t)1) ;
+   CPPUNIT_LOG_EQUAL(fields, (std::vector<strslice>{""})) ;
+   CPPUNIT_LOG_EQUAL(strsplit(",", commas, fields), (size_t)2) ;
+   CPPUNIT_LOG_EQUAL(strsplit("abc", byteset(), fields), (size_t)1) ;
+
+   // More than 64 separators (the size of the internal position buffer)
+   std::string many ;
+   for (int i = 0 ; i < 200 ; ++i)
+      many.append(std::to_string(i)).append(i % 3 ? "," : ";") ;
+   CPPUNIT_LOG_EQUAL(strsplit(many, delims, fields), (size_t)201) ;
+   CPPUNIT_LOG_EQUAL(fields[0], strslice("0")) ;
+   CPPUNIT_LOG_EQUAL(fields[199], strslice("199")) ;
+   CPPUNIT_LOG_EQUAL(fields[200], strslice("")) ;
+
+   CPPUNIT_LOG(std::endl) ;
+   strslice farray[4] ;
+   CPPUNIT_LOG_EQUAL(strsplit("a,b,c,d,e,f", commas, farray, 0), (size_t)0) ;
+   CPPUNIT_LOG_EQUAL(strsplit("a,b,c,d,e,f", commas, farray, 1), (size_t)1) ;
+   CPPUNIT_LOG_EQUAL(farray[0], strslice("a,b,c,d,e,f")) ;
+   CPPUNIT_LOG_EQUAL(strsplit("a,b,c,d,e,f", commas, farray, 4), (size_t)4) ;
+   CPPUNIT_LOG_EQUAL(farray[2], strslice("c")) ;
+   CPPUNIT_LOG_EQUAL(farray[3], strslice("d,e,f")) ;
+   CPPUNIT_LOG_EQUAL(strsplit("a,b", commas, farray, 4), (size_t)2) ;
+   CPPUNIT_LOG_EQUAL(farray[1], strslice("b")) ;
+
+   std::vector<strslice> fixed (80) ;
+   CPPUNIT_LOG_EQUAL(strsplit(many, delims, fixed.data(), fixed.size()), (size_t)80) ;
+   CPPUNIT_LOG_EQUAL(fixed[78], strslice("78")) ;
+   CPPUNIT_LOG_ASSERT(fixed[79].startswith("79,80,81;")) ;
+   CPPUNIT_LOG_ASSERT(fixed[79].endswith(";199,")) ;
+}
+
 void StrSliceTests::Test_Strslice_Strip()
 {
+   using namespace pcomn ;
+
+   CPPUNIT_LOG_EQUAL(str::strip(strslice("  Hello, world!\t\n")), strslice("Hello, world!")) ;
+   CPPUNIT_LOG_EQUAL(str::lstrip(strslice("  Hello, world!\t\n")), strslice("Hello, world!\t\n")) ;
+   CPPUNIT_LOG_EQUAL(str::rstrip(strslice("  Hello, world!\t\n")), strslice("  Hello, world!")) ;
+   CPPUNIT_LOG_EQUAL(str::strip(strslice("Hello")), strslice("Hello")) ;
+   CPPUNIT_LOG_EQUAL(str::strip(strslice(" \t\r\n\f\v ")), strslice()) ;
+   CPPUNIT_LOG_EQUAL(str::strip(strslice()), strslice()) ;
+   CPPUNIT_LOG_EQUAL(str::strip(std::string("  abc  ")), strslice("abc")) ;
+
+   CPPUNIT_LOG(std::endl) ;
+   CPPUNIT_LOG_EQUAL(strslice("xxyHelloyx").strip_inplace("xy"), strslice("Hello")) ;
+   CPPUNIT_LOG_EQUAL(strslice("xxyHelloyx").lstrip_inplace("xy"), strslice("Helloyx")) ;
+   CPPUNIT_LOG_EQUAL(strslice("xxyHelloyx").rstrip_inplace("xy"), strslice("xxyHello")) ;
+   CPPUNIT_LOG_EQUAL(strslice("xxyHelloyx").strip_inplace(""), strslice("xxyHelloyx")) ;
+   CPPUNIT_LOG_EQUAL(strslice("\x80\xff a \xff\x80").strip_inplace("\x80\xff"), strslice(" a ")) ;
+
+   // Long strings are processed by vector kernels (if any)
+   const std::string spaces (100, ' ') ;
+   const std::string text = "text with\tspaces inside" ;
+   CPPUNIT_LOG_EQUAL(str::strip(spaces + text + spaces), strslice(text)) ;
+   CPPUNIT_LOG_EQUAL(str::lstrip(spaces + text + spaces).size(), text.size() + spaces.size()) ;
+   CPPUNIT_LOG_EQUAL(str::rstrip(spaces + text + spaces).size(), text.size() + spaces.size()) ;
+   CPPUNIT_LOG_EQUAL(str::strip(spaces), strslice()) ;
+
+   CPPUNIT_LOG(std::endl) ;
+   CPPUNIT_LOG_EQUAL(str::strip(wstrslice(L"  Hello, world!\t\n")), wstrslice(L"Hello, world!")) ;
+   CPPUNIT_LOG_EQUAL(wstrslice(L"xxyHelloyx").lstrip_inplace(L"xy"), wstrslice(L"Helloyx")) ;
+   CPPUNIT_LOG_EQUAL(wstrslice(L"xxyHelloyx").rstrip_inplace(L"xy"), wstrslice(L"xxyHello")) ;
 }
 
 void StrSliceTests::Test_Strslice_Strnew()
@@ -257,10 +391,123 @@ void StrSliceTests::Test_Strslice_Quote()
    CPPUNIT_LOG_EQ(string_cast(quote('\'')), R"('\'')") ;
 }
 
+/*******************************************************************************
+ StrScanTests
+*******************************************************************************/
+void StrScanTests::Test_Kernel_Selection()
+{
+   using namespace pcomn::strscan ;
+
+   const std::vector<kernel_isa> &isas = supported_kernels() ;
+   CPPUNIT_LOG_ASSERT(!isas.empty()) ;
+   CPPUNIT_LOG_ASSERT(isas.front() == kernel_isa::generic) ;
+
+   for (kernel_isa isa: isas)
+      CPPUNIT_LOG_LINE("Supported scan kernels: " << get_scan_kernels(isa).name) ;
+   CPPUNIT_LOG_LINE("Selected scan kernels: " << kernels().name) ;
+
+   CPPUNIT_LOG_ASSERT(is_kernel_isa_supported(kernels().isa)) ;
+   CPPUNIT_LOG_ASSERT(set_scan_kernels(kernel_isa::generic) == _selected) ;
+   CPPUNIT_LOG_ASSERT(kernels().isa == kernel_isa::generic) ;
+   CPPUNIT_LOG_EQUAL(std::string(kernels().name), std::string("generic")) ;
+
+   for (unsigned isa = 0 ; isa < kernel_isa_count ; ++isa)
+      if (!is_kernel_isa_supported((kernel_isa)isa))
+      {
+         CPPUNIT_LOG_EXCEPTION(set_scan_kernels((kernel_isa)isa), std::invalid_argument) ;
+         CPPUNIT_LOG_ASSERT(kernels().isa == kernel_isa::generic) ;
+      }
+}
+
+void StrScanTests::Test_Kernels()
+{
+   using namespace pcomn ;
+   using namespace pcomn::strscan ;
+
+   const scan_kernels &generic = get_scan_kernels(kernel_isa::generic) ;
+
+   // Check the byteset itself
+   const byteset digits ("0123456789") ;
+   size_t mismatches = 0 ;
+   for (unsigned c = 0 ; c < 256 ; ++c)
+      mismatches += digits.test(c) != !!isdigit(c) ;
+   CPPUNIT_LOG_EQUAL(mismatches, (size_t)0) ;
+   CPPUNIT_LOG_ASSERT(byteset().empty()) ;
+   CPPUNIT_LOG_IS_FALSE(digits.empty()) ;
+   CPPUNIT_LOG_ASSERT(byteset().add('\xff').test('\xff')) ;
+   CPPUNIT_LOG_IS_FALSE(byteset().add('\xff').test('\x7f')) ;
+
+   // Random text over a small alphabet with high bytes, so that every set has both
+   // long runs and frequent members
+   std::mt19937 rng (1) ;
+   static const char alphabet[] = "ab, \t;\x80\xfe\x00z" ;
+   std::string text (600, ' ') ;
+   for (char &c: text)
+      c = alphabet[rng() % (sizeof alphabet - 1)] ;
+   // Long runs of the same byte
+   std::fill(text.begin() + 100, text.begin() + 180, ' ') ;
+   std::fill(text.begin() + 300, text.begin() + 370, 'a') ;
+
+   const byteset sets[] = {
+      byteset(), byteset(" "), byteset(" \t"), byteset(",;"), byteset("a"),
+      byteset("\x80\xfe"), byteset(text.data() + 9, text.data() + 10), byteset(alphabet, alphabet + 10)
+   } ;
+
+   for (kernel_isa isa: supported_kernels())
+   {
+      const scan_kernels &k = get_scan_kernels(isa) ;
+      CPPUNIT_LOG_LINE("Testing " << k.name << " scan kernels") ;
+
+      size_t errors = 0 ;
+      for (const byteset &set: sets)
+         for (size_t offset = 0 ; offset < 4 ; ++offset)
+            for (size_t n = 0 ; n + offset <= text.size() ; n += 1 + n/64)
+            {
+               const char * const b = text.data() + offset ;
+               const char * const e = b + n ;
+               const uint8_t * const t = set.table() ;
+
+               errors += k.find_first_of(b, e, t) != generic.find_first_of(b, e, t) ;
+               errors += k.find_first_not_of(b, e, t) != generic.find_first_not_of(b, e, t) ;
+               errors += k.rfind_first_of(b, e, t) != generic.rfind_first_of(b, e, t) ;
+               errors += k.rfind_first_not_of(b, e, t) != generic.rfind_first_not_of(b, e, t) ;
+
+               // The reference implementation
+               errors += generic.find_first_of(b, e, t) !=
+                  std::find_if(b, e, [&](char c) { return set.test(c) ; }) ;
+
+               const char *found[64] ;
+               const char *expected[64] ;
+               for (size_t maxcount: {0, 1, 5, 64})
+               {
+                  const size_t count = k.find_all_of(b, e, t, found, maxcount) ;
+                  const size_t expected_count = generic.find_all_of(b, e, t, expected, maxcount) ;
+                  errors += count != expected_count || !std::equal(found, found + count, expected) ;
+               }
+            }
+      CPPUNIT_LOG_EQUAL(errors, (size_t)0) ;
+   }
+}
+
+void StrScanTests::Test_StrSlice_All_Kernels()
+{
+   for (pcomn::strscan::kernel_isa isa: supported_kernels())
+   {
+      pcomn::strscan::set_scan_kernels(isa) ;
+      CPPUNIT_LOG_LINE("Testing strslice with " << pcomn::strscan::kernels().name << " scan kernels") ;
+
+      StrSliceTests tests ;
+      tests.Test_String_Split() ;
+      tests.Test_String_Split_Fields() ;
+      tests.Test_Strslice_Strip() ;
+   }
+}
+
 int main(int argc, char *argv[])
 {
    pcomn::unit::TestRunner runner ;
    runner.addTest(StrSliceTests::suite()) ;
+   runner.addTest(StrScanTests::suite()) ;
 
    return
       pcomn::unit::run_tests(runner, argc, argv, "unittest.diag.ini",
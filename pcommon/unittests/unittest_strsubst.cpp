@@ -34,6 +34,8 @@ class StrSubstTests : public CppUnit::TestFixture {
       void Test_Template_Sources() ;
       void Test_Substitution_Output() ;
       void Test_Removing_Comments() ;
+      void Test_Compiled_Template() ;
+      void Test_Compiled_Template_Render() ;
 
       CPPUNIT_TEST_SUITE(StrSubstTests) ;
 
@@ -43,6 +45,8 @@ class StrSubstTests : public CppUnit::TestFixture {
       CPPUNIT_TEST(Test_Template_Sources) ;
       CPPUNIT_TEST(Test_Substitution_Output) ;
       CPPUNIT_TEST(Test_Removing_Comments) ;
+      CPPUNIT_TEST(Test_Compiled_Template) ;
+      CPPUNIT_TEST(Test_Compiled_Template_Render) ;
 
       CPPUNIT_TEST_SUITE_END() ;
 } ;
@@ -297,6 +301,140 @@ void StrSubstTests::Test_Removing_Comments()
    CPPUNIT_LOG_EQUAL(subst(smap, "$foo_str$WORLD$*!@#$%^\n()*$!", result), std::string("Hello, world!")) ;
 }
 
+void StrSubstTests::Test_Compiled_Template()
+{
+   using namespace tpl ;
+
+   substitution_map smap ;
+   std::string Bye ("Bye") ;
+   unsigned long long Big = 18446744073709551615ULL ;
+   CPPUNIT_LOG_RUN(smap
+                   ("foo_int", 20)
+                   ("foo_char", 'R')
+                   ("foo_str", "Hello, ")
+                   ("foo_bye", std::cref(Bye))
+                   ("WORLD", "world")
+                   ("TheAnswer", (short)42)
+                   ("foo_big", Big)) ;
+
+   // A compiled template must give exactly the same result as subst()
+   static const char * const Templates[] = {
+      "", "$", "$$", "$$_", "$**$", "$*", "*$", "${}", "${", "${foo", "${foo_str", "$ ", "$-$",
+      "Hello!", "$foo_bye", "$foo_bye, baby!", "${foo_str}world!", "${foo_str}",
+      "$foo_str$WORLD!", "$foo_str$$WORLD!", "${foo_str$WORLD}", "${foo_str }$WORLD",
+      "The Big is ${foo_big}ULL, $$foo_int==$foo_int, and $unknown==$$unknown",
+      "${foo_char}eference to ${foo_char}eturn: $foo_charvalue",
+      "${unknown}, ${foo_char} and $unknown again",
+      "Answer to the Ultimate Question of $$Life, $ *$the Universe and Everything is $TheAnswer$* not closed comment",
+      "The $**$Big $* comments should be removed *$is $*rm*$${foo_big}ULL",
+      "$foo_str$WORLD$*!@#$%^\n()*$!",
+   } ;
+
+   for (const char *text: Templates)
+   {
+      std::string expected ;
+      subst(smap, text, expected) ;
+      std::string result ;
+      CPPUNIT_LOG_EQUAL(subst(smap, compiled_template(text), result), expected) ;
+   }
+
+   CPPUNIT_LOG(std::endl) ;
+   // The unknown quoted placeholder is output verbatim
+   std::string result ;
+   CPPUNIT_LOG_EQUAL(subst(smap, "${unknown}!", result), std::string("${unknown}!")) ;
+
+   const compiled_template Tmpl ("$foo_bye, $foo_bye! ${foo_int}0") ;
+   CPPUNIT_LOG_EQUAL(Tmpl.placeholder_count(), (size_t)2) ;
+   result.clear() ;
+   CPPUNIT_LOG_EQUAL(subst(smap, Tmpl, result), std::string("Bye, Bye! 200")) ;
+   CPPUNIT_LOG_RUN(Bye = "Hi") ;
+   result.clear() ;
+   CPPUNIT_LOG_EQUAL(subst(smap, Tmpl, result), std::string("Hi, Hi! 200")) ;
+
+   // A non-const template
+   compiled_template MutableTmpl ("$foo_bye!") ;
+   result.clear() ;
+   CPPUNIT_LOG_EQUAL(subst(smap, MutableTmpl, result), std::string("Hi!")) ;
+
+   // The default replacement
+   CPPUNIT_LOG_RUN(smap("<?>")) ;
+   result.clear() ;
+   CPPUNIT_LOG_EQUAL(subst(smap, compiled_template("${unknown}, $foo_int and $unknown"), result),
+                     std::string("<?>, 20 and <?>")) ;
+}
+
+void StrSubstTests::Test_Compiled_Template_Render()
+{
+   using namespace tpl ;
+
+   const compiled_template Empty ("") ;
+   CPPUNIT_LOG_EQUAL(Empty.placeholder_count(), (size_t)0) ;
+   CPPUNIT_LOG_EQUAL(Empty.size(nullptr), (size_t)0) ;
+   char c = '#' ;
+   CPPUNIT_LOG_EQUAL(Empty.render(&c, 1, nullptr), (size_t)0) ;
+   CPPUNIT_LOG_EQUAL(c, '#') ;
+
+   const compiled_template Tmpl ("$$$GREETING, ${OBJECT}s!$* comment *$ $GREETING, $UNKNOWN$OBJECT") ;
+
+   CPPUNIT_LOG_EQUAL(Tmpl.placeholder_count(), (size_t)3) ;
+   CPPUNIT_LOG_EQUAL(Tmpl.placeholder(0), std::string("GREETING")) ;
+   CPPUNIT_LOG_EQUAL(Tmpl.placeholder(1), std::string("OBJECT")) ;
+   CPPUNIT_LOG_EQUAL(Tmpl.placeholder(2), std::string("UNKNOWN")) ;
+   CPPUNIT_LOG_EQUAL(Tmpl.placeholder_index("OBJECT"), (ssize_t)1) ;
+   CPPUNIT_LOG_EQUAL(Tmpl.placeholder_index("GREETING"), (ssize_t)0) ;
+   CPPUNIT_LOG_EQUAL(Tmpl.placeholder_index("GREET"), (ssize_t)-1) ;
+   CPPUNIT_LOG_EQUAL(Tmpl.placeholder_index(""), (ssize_t)-1) ;
+
+   // No values: all placeholders are rendered verbatim
+   std::string result ;
+   CPPUNIT_LOG_EQUAL(Tmpl.render(result, nullptr), std::string("$$GREETING, ${OBJECT}s! $GREETING, $UNKNOWN$OBJECT")) ;
+
+   const strslice Values[] = { "Hello", "world", strslice() } ;
+   const std::string Expected ("$Hello, worlds! Hello, $UNKNOWNworld") ;
+
+   result = "> " ;
+   CPPUNIT_LOG_EQUAL(Tmpl.render(result, Values), "> " + Expected) ;
+   CPPUNIT_LOG_EQUAL(Tmpl.size(Values), Expected.size()) ;
+
+   CPPUNIT_LOG(std::endl) ;
+   char buf[64] ;
+   memset(buf, '#', sizeof buf) ;
+   CPPUNIT_LOG_EQUAL(Tmpl.render(buf, sizeof buf, Values), Expected.size()) ;
+   CPPUNIT_LOG_EQUAL(std::string(buf, Expected.size()), Expected) ;
+   CPPUNIT_LOG_EQUAL(buf[Expected.size()], '#') ;
+
+   // Truncated output
+   memset(buf, '#', sizeof buf) ;
+   CPPUNIT_LOG_EQUAL(Tmpl.render(buf, 10, Values), Expected.size()) ;
+   CPPUNIT_LOG_EQUAL(std::string(buf, 11), std::string("$Hello, wo#")) ;
+   CPPUNIT_LOG_EQUAL(Tmpl.render(buf, 0, Values), Expected.size()) ;
+   CPPUNIT_LOG_EQUAL(*buf, '$') ;
+
+   CPPUNIT_LOG(std::endl) ;
+   const auto concat = [](const iovec_t *iov, size_t count)
+   {
+      std::string s ;
+      for (const iovec_t *v = iov ; v != iov + count ; ++v)
+         s.append((const char *)v->iov_base, v->iov_len) ;
+      return s ;
+   } ;
+
+   std::vector<iovec_t> iov (Tmpl.max_iovec_count()) ;
+   const size_t count = Tmpl.render(iov.data(), iov.size(), Values) ;
+   CPPUNIT_LOG_ASSERT(count <= iov.size()) ;
+   // "$", "Hello", ", ", "world", "s! ", "Hello", ", $UNKNOWN", "world"
+   CPPUNIT_LOG_EQUAL(count, (size_t)8) ;
+   CPPUNIT_LOG_EQUAL(concat(iov.data(), count), Expected) ;
+   // Values are referenced, not copied
+   CPPUNIT_LOG_EQUAL((const void *)iov[1].iov_base, (const void *)Values[0].begin()) ;
+   CPPUNIT_LOG_EQUAL((const void *)iov[3].iov_base, (const void *)Values[1].begin()) ;
+
+   std::fill(iov.begin(), iov.end(), make_iovec()) ;
+   CPPUNIT_LOG_EQUAL(Tmpl.render(iov.data(), 3, Values), (size_t)8) ;
+   CPPUNIT_LOG_EQUAL(concat(iov.data(), 3), std::string("$Hello, ")) ;
+   CPPUNIT_LOG_IS_NULL(iov[3].iov_base) ;
+}
+
 /*******************************************************************************
  main
 *******************************************************************************/
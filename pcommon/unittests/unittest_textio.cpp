@@ -20,6 +20,7 @@
 
 #include <fstream>
 #include <sstream>
+#include <random>
 
 using namespace pcomn ;
 
@@ -33,6 +34,8 @@ class TextIOTests : public CppUnit::TestFixture {
       void Test_Text_Writer() ;
       void Test_IO_Writers() ;
       void Test_IO_Readers() ;
+      void Test_Line_Reader() ;
+      void Test_Line_Reader_Blocks() ;
 
       CPPUNIT_TEST_SUITE(TextIOTests) ;
 
@@ -41,6 +44,8 @@ class TextIOTests : public CppUnit::TestFixture {
       CPPUNIT_TEST(Test_Text_Writer) ;
       CPPUNIT_TEST(Test_IO_Writers) ;
       CPPUNIT_TEST(Test_IO_Readers) ;
+      CPPUNIT_TEST(Test_Line_Reader) ;
+      CPPUNIT_TEST(Test_Line_Reader_Blocks) ;
 
       CPPUNIT_TEST_SUITE_END() ;
 } ;
@@ -301,6 +306,125 @@ void TextIOTests::Test_IO_Readers()
    }
 }
 
+void TextIOTests::Test_Line_Reader()
+{
+   strslice line ;
+   {
+      line_reader reader (strslice("line 1\nline 2\r\n\rline 3\n\nline 5")) ;
+      CPPUNIT_LOG_EQUAL(reader.eoltype(), (unsigned)eol_Undefined) ;
+      CPPUNIT_LOG_IS_FALSE(reader.eof()) ;
+
+      CPPUNIT_LOG_ASSERT(reader.readline(line)) ;
+      CPPUNIT_LOG_EQUAL(line, strslice("line 1")) ;
+      CPPUNIT_LOG_EQUAL(reader.eoltype(), (unsigned)eol_LF) ;
+
+      CPPUNIT_LOG_ASSERT(reader.readline(line)) ;
+      CPPUNIT_LOG_EQUAL(line, strslice("line 2")) ;
+      CPPUNIT_LOG_EQUAL(reader.eoltype(), (unsigned)(eol_CRLF | eol_LF)) ;
+
+      CPPUNIT_LOG_ASSERT(reader.readline(line)) ;
+      CPPUNIT_LOG_EQUAL(line, strslice()) ;
+      CPPUNIT_LOG_EQUAL(reader.eoltype(), (unsigned)(eol_CRLF | eol_LF | eol_CR)) ;
+
+      CPPUNIT_LOG_ASSERT(reader.readline(line)) ;
+      CPPUNIT_LOG_EQUAL(line, strslice("line 3")) ;
+      CPPUNIT_LOG_ASSERT(reader.readline(line)) ;
+      CPPUNIT_LOG_EQUAL(line, strslice()) ;
+      CPPUNIT_LOG_ASSERT(reader.readline(line)) ;
+      CPPUNIT_LOG_EQUAL(line, strslice("line 5")) ;
+      CPPUNIT_LOG_ASSERT(reader.eof()) ;
+
+      CPPUNIT_LOG_IS_FALSE(reader.readline(line)) ;
+      CPPUNIT_LOG_ASSERT(line.empty()) ;
+      CPPUNIT_LOG_IS_FALSE(reader.readline(line)) ;
+      CPPUNIT_LOG_EQUAL(reader.linecount(), (size_t)6) ;
+      CPPUNIT_LOG_EQUAL(reader.bytecount(), strlen("line 1\nline 2\r\n\rline 3\n\nline 5")) ;
+   }
+   {
+      const char data[] = "abc\ndef\r" ;
+      line_reader reader (data, data + strlen(data)) ;
+      CPPUNIT_LOG_ASSERT(reader.readline(line)) ;
+      CPPUNIT_LOG_EQUAL(line, strslice("abc")) ;
+      // Zero-copy: the line points into the source memory
+      CPPUNIT_LOG_EQUAL(line.begin(), data + 0) ;
+      CPPUNIT_LOG_ASSERT(reader.readline(line)) ;
+      CPPUNIT_LOG_EQUAL(line, strslice("def")) ;
+      CPPUNIT_LOG_EQUAL(reader.eoltype(), (unsigned)(eol_LF | eol_CR)) ;
+      CPPUNIT_LOG_IS_FALSE(reader.readline(line)) ;
+   }
+   {
+      line_reader reader (strslice("")) ;
+      CPPUNIT_LOG_ASSERT(reader.eof()) ;
+      CPPUNIT_LOG_IS_FALSE(reader.readline(line)) ;
+      CPPUNIT_LOG_EQUAL(reader.linecount(), (size_t)0) ;
+      CPPUNIT_LOG_EQUAL(reader.eoltype(), (unsigned)eol_Undefined) ;
+   }
+   {
+      std::istringstream is ("line 1\r\nline 2\r\nline 3\r\n") ;
+      universal_line_reader<std::istream> reader (is, 4) ;
+      CPPUNIT_LOG_ASSERT(reader.readline(line)) ;
+      CPPUNIT_LOG_EQUAL(line, strslice("line 1")) ;
+      CPPUNIT_LOG_ASSERT(reader.readline(line)) ;
+      CPPUNIT_LOG_EQUAL(line, strslice("line 2")) ;
+      CPPUNIT_LOG_ASSERT(reader.readline(line)) ;
+      CPPUNIT_LOG_EQUAL(line, strslice("line 3")) ;
+      CPPUNIT_LOG_IS_FALSE(reader.readline(line)) ;
+      CPPUNIT_LOG_ASSERT(reader.eof()) ;
+      CPPUNIT_LOG_EQUAL(reader.eoltype(), (unsigned)eol_CRLF) ;
+      CPPUNIT_LOG_EQUAL(reader.bytecount(), (size_t)24) ;
+   }
+}
+
+// Check line_reader against text_reader on random text with mixed newlines and every
+// newline position relative to block boundaries
+void TextIOTests::Test_Line_Reader_Blocks()
+{
+   std::mt19937 rng (1) ;
+   static const char alphabet[] = "abcdefgh\r\n\r\n" ;
+   std::string text (3000, ' ') ;
+   for (char &c: text)
+      c = alphabet[rng() % (sizeof alphabet - 1)] ;
+   // A long line, longer than any block below
+   text.replace(1000, 300, std::string(300, 'x')) ;
+
+   for (const char *tail: {"", "\n", "\r", "\r\n", "end"})
+   {
+      const std::string data = text + tail ;
+
+      std::vector<std::string> expected ;
+      std::istringstream is (data) ;
+      universal_text_reader<std::istream> txtreader (is) ;
+      for (std::string s ; !(s = txtreader.readline<std::string>()).empty() ; )
+         expected.push_back(s.back() == '\n' ? s.substr(0, s.size() - 1) : s) ;
+
+      size_t errors = 0 ;
+      for (size_t blocksize: {1, 2, 3, 7, 16, 64, 1000, 5000, 0})
+      {
+         std::vector<std::string> lines ;
+         unsigned eoltype ;
+         size_t bytecount ;
+         if (blocksize)
+         {
+            universal_line_reader<strslice> reader (strslice(data), blocksize) ;
+            for (strslice line ; reader.readline(line) ;)
+               lines.push_back(std::string(line)) ;
+            eoltype = reader.eoltype() ;
+            bytecount = reader.bytecount() ;
+         }
+         else
+         {
+            line_reader reader (data.data(), data.data() + data.size()) ;
+            for (strslice line ; reader.readline(line) ;)
+               lines.push_back(std::string(line)) ;
+            eoltype = reader.eoltype() ;
+            bytecount = reader.bytecount() ;
+         }
+         errors += lines != expected || eoltype != txtreader.eoltype() || bytecount != data.size() ;
+      }
+      CPPUNIT_LOG_EQUAL(errors, (size_t)0) ;
+   }
+}
+
 /*******************************************************************************
  main
 *******************************************************************************/
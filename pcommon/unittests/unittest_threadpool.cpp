@@ -64,12 +64,14 @@ class ThreadPoolTests : public CppUnit::TestFixture {
     void Test_ThreadPool_Init() ;
     void Test_ThreadPool_SingleThreaded() ;
     void Test_ThreadPool_MultiThreaded() ;
+    void Test_ThreadPool_WorkStealing() ;
 
     CPPUNIT_TEST_SUITE(ThreadPoolTests) ;
 
     CPPUNIT_TEST(Test_ThreadPool_Init) ;
     CPPUNIT_TEST(Test_ThreadPool_SingleThreaded) ;
     CPPUNIT_TEST(Test_ThreadPool_MultiThreaded) ;
+    CPPUNIT_TEST(Test_ThreadPool_WorkStealing) ;
 
     CPPUNIT_TEST_SUITE_END() ;
 
@@ -349,12 +351,134 @@ void ThreadPoolTests::Test_ThreadPool_Init()
 
 void ThreadPoolTests::Test_ThreadPool_SingleThreaded()
 {
+    threadpool pool (1, "TryEnqueue") ;
+    promise_lock started ;
+    promise_lock release ;
+    std::atomic<unsigned> done {0} ;
+
+    CPPUNIT_LOG_RUN(pool.set_queue_capacity(1)) ;
+    CPPUNIT_LOG_RUN(pool.enqueue_job([&]{ started.unlock() ; release.wait() ; ++done ; })) ;
+    CPPUNIT_LOG_RUN(started.wait()) ;
+
+    // The worker is busy, the queue has room for exactly one job
+    CPPUNIT_LOG_ASSERT(pool.try_enqueue_job([&]{ ++done ; })) ;
+    CPPUNIT_LOG_IS_FALSE(pool.try_enqueue_job([&]{ ++done ; })) ;
+    CPPUNIT_LOG_EQ(pool.pending_count(), 1) ;
+
+    CPPUNIT_LOG_RUN(release.unlock()) ;
+    CPPUNIT_LOG_RUN(pool.stop(true)) ;
+    CPPUNIT_LOG_EQ(done.load(), 2) ;
+
+    CPPUNIT_LOG_EXCEPTION(pool.try_enqueue_job([]{}), sequence_closed) ;
 }
 
 void ThreadPoolTests::Test_ThreadPool_MultiThreaded()
 {
 }
 
+static std::atomic<unsigned> leaf_count {0} ;
+
+// Binary tree of jobs, every job submits two children from inside the pool.
+static void spawn_subtree(threadpool &pool, unsigned depth)
+{
+    if (!depth)
+    {
+        ++leaf_count ;
+        return ;
+    }
+    pool.enqueue_job(spawn_subtree, std::ref(pool), depth - 1) ;
+    pool.enqueue_job(spawn_subtree, std::ref(pool), depth - 1) ;
+}
+
+void ThreadPoolTests::Test_ThreadPool_WorkStealing()
+{
+    const auto wait_leaves = [](unsigned count)
+    {
+        while (leaf_count.load() < count)
+            std::this_thread::sleep_for(1ms) ;
+        return leaf_count.load() ;
+    } ;
+
+    {
+        threadpool p1 (2, "Steal1") ;
+        CPPUNIT_LOG_EQUAL(p1.scheduling(), threadpool::SHARED_QUEUE) ;
+
+        threadpool p4 (4, "Steal4", 0, threadpool::WORK_STEALING) ;
+        CPPUNIT_LOG_EQUAL(p4.scheduling(), threadpool::WORK_STEALING) ;
+        CPPUNIT_LOG_EXPRESSION(p4) ;
+
+        // The tree is much bigger than the shared queue capacity: submissions from
+        // inside the pool go to local deques, which are unbounded.
+        leaf_count = 0 ;
+        CPPUNIT_LOG_RUN(p4.enqueue_job(spawn_subtree, std::ref(p4), 16)) ;
+        CPPUNIT_LOG_EQUAL(wait_leaves(1U << 16), 1U << 16) ;
+
+        CPPUNIT_LOG_EQUAL(p4.enqueue_task([]{ return std::string("Hello!") ; }).get(), std::string("Hello!")) ;
+
+        CPPUNIT_LOG(std::endl) ;
+        // Dismissed workers leave their local deques to others
+        leaf_count = 0 ;
+        CPPUNIT_LOG_RUN(p4.enqueue_job(spawn_subtree, std::ref(p4), 14)) ;
+        CPPUNIT_LOG_RUN(p4.resize(1)) ;
+        CPPUNIT_LOG_RUN(p4.resize(3)) ;
+        CPPUNIT_LOG_EQUAL(wait_leaves(1U << 14), 1U << 14) ;
+        CPPUNIT_LOG_EXPRESSION(p4) ;
+    }
+
+    CPPUNIT_LOG(std::endl) ;
+    {
+        // stop(true) completes the tasks pending in local deques
+        threadpool p3 (3, "Steal3", 0, threadpool::WORK_STEALING) ;
+        std::atomic<bool> submitted {false} ;
+
+        leaf_count = 0 ;
+        p3.enqueue_job([&]
+        {
+            for (unsigned i = 0 ; i < 10000 ; ++i)
+                p3.enqueue_job([] { ++leaf_count ; }) ;
+            submitted = true ;
+        }) ;
+
+        while (!submitted)
+            std::this_thread::yield() ;
+
+        CPPUNIT_LOG_RUN(p3.stop(true)) ;
+        // stop(true) waits until the deques are empty, not until the last popped tasks
+        // complete
+        CPPUNIT_LOG_EQUAL(wait_leaves(10000), 10000U) ;
+        CPPUNIT_LOG_EQ(p3.pending_count(), 0) ;
+        CPPUNIT_LOG_EXCEPTION(p3.enqueue_job([]{}), sequence_closed) ;
+    }
+
+    CPPUNIT_LOG(std::endl) ;
+    {
+        // clear_queue() and stop(false) drop the tasks pending in local deques
+        threadpool p2 (2, "Steal2", 0, threadpool::WORK_STEALING) ;
+        counting_semaphore started ;
+        counting_semaphore proceed ;
+
+        leaf_count = 0 ;
+        p2.enqueue_job([&]
+        {
+            for (unsigned i = 0 ; i < 1000 ; ++i)
+                p2.enqueue_job([] { std::this_thread::sleep_for(1ms) ; ++leaf_count ; }) ;
+            started.release() ;
+            proceed.acquire() ;
+        }) ;
+        CPPUNIT_LOG_RUN(started.acquire()) ;
+
+        const unsigned dropped = p2.clear_queue() ;
+        CPPUNIT_LOG_EXPRESSION(dropped) ;
+        CPPUNIT_LOG_ASSERT(dropped) ;
+        CPPUNIT_LOG_RUN(proceed.release()) ;
+
+        CPPUNIT_LOG_RUN(p2.stop(false)) ;
+        CPPUNIT_LOG_EQ(p2.pending_count(), 0) ;
+        CPPUNIT_LOG_EXPRESSION(leaf_count.load()) ;
+        CPPUNIT_LOG_ASSERT(leaf_count.load() + dropped <= 1000) ;
+    }
+}
+
 /*******************************************************************************
  main
 *******************************************************************************/
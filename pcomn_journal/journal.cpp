@@ -17,8 +17,11 @@
 #include <pcomn_utils.h>
 #include <pcomn_integer.h>
 #include <pcomn_alloca.h>
+#include <pcomn_hash.h>
+#include <pcomn_parallel.h>
 
 #include <functional>
+#include <vector>
 
 #define LOGINFO(output) LOGPXINFO(PCOMN_Journal, output)
 #define LOGDBG(output)  LOGPXDBG(PCOMN_Journal, output)
@@ -97,11 +100,13 @@ size_t Port::store_operation(opcode_t code, opversion_t version,
    htod(wrapping.header) ;
    htod(wrapping.tail) ;
 
+   const record_crc_function crc = record_crc(unsafe_storage()->record_format()) ;
+
    // Optimize for bodiless operation
    if (!data_size)
    {
       wrapping.tail.crc32 =
-         calc_crc32(0, &wrapping.header, sizeof wrapping.header + offsetof(OperationTail, crc32)) ;
+         crc(0, &wrapping.header, sizeof wrapping.header + offsetof(OperationTail, crc32)) ;
 
       htod(wrapping.tail.crc32) ;
 
@@ -130,10 +135,11 @@ size_t Port::store_operation(opcode_t code, opversion_t version,
    // The whole operation data should be aligned to 8
    NOXCHECK(is_aligned(bufsizev(datavec_begin, datavec_end))) ;
 
+   // Ignore the last 4 bytes of the tail: they hold the checksum itself
    wrapping.tail.crc32 =
-      calc_crc32(calc_crc32v(calc_crc32(0, &wrapping.header, sizeof wrapping.header),
-                             datavec_begin + 1, datavec_end - 1),
-                 4, *(datavec_end - 1)) ;
+      crc(calc_record_crcv(crc, crc(0, &wrapping.header, sizeof wrapping.header),
+                           datavec_begin + 1, datavec_end - 1),
+          &wrapping.tail, sizeof wrapping.tail - 4) ;
 
    htod(wrapping.tail.crc32) ;
 
@@ -179,7 +185,7 @@ std::string Journallable::operation_name(opcode_t opcode, opversion_t version) c
    return !name.empty() ? name : forged_opname(opcode, version) ;
 }
 
-void Journallable::restore_from(Port &journal, bool set_journal)
+void Journallable::restore_from(Port &journal, bool set_journal, unsigned replay_threads)
 {
    write_guard lock (_lock) ;
 
@@ -200,13 +206,14 @@ void Journallable::restore_from(Port &journal, bool set_journal)
    storage.
       replay_checkpoint(std::bind(&Journallable::load_checkpoint, this, _1, _2)) ;
 
-   LOGDBG("Loading operations for " << *this) ;
+   if (!replay_threads)
+      replay_threads = sys::hw_threads_count() ;
 
-   unsigned opcount ;
-   for (opcount = 0 ;
-        storage.
-           replay_record(std::bind(&Journallable::load_operation, this, _1, _2, _3, _4)) ;
-        ++opcount) ;
+   LOGDBG("Loading operations for " << *this << " in " << replay_threads << " threads") ;
+
+   const unsigned opcount = replay_threads > 1
+      ? load_operations(storage, replay_threads)
+      : load_operations(storage) ;
 
    LOGDBG("Successfully loaded " << opcount << " operations for " << *this) ;
 
@@ -242,6 +249,178 @@ void Journallable::load_checkpoint(pcomn::binary_ibufstream &checkpoint_stream,
    restore_checkpoint(checkpoint_stream, data_size) ;
 }
 
+unsigned Journallable::load_operations(Storage &storage)
+{
+   unsigned opcount ;
+   for (opcount = 0 ;
+        storage.
+           replay_record(std::bind(&Journallable::load_operation, this, _1, _2, _3, _4)) ;
+        ++opcount) ;
+   return opcount ;
+}
+
+unsigned Journallable::load_operations(Storage &storage, unsigned threads)
+{
+   // Limits of a batch of records read at once
+   static const size_t REPLAY_BATCH_OPS  = 4096 ;
+   static const size_t REPLAY_BATCH_SIZE = 4*MiB ;
+
+   struct record {
+         opcode_t       opcode ;
+         opversion_t    opversion ;
+         size_t         offset ;       /* Data offset in the batch buffer */
+         size_t         size ;
+         operation_ptr  op ;
+         uint64_t       partition ;
+   } ;
+
+   // A run of partitioned operations, followed by a NOPARTITION operation (barrier)
+   // unless the run is the last in the batch
+   struct run {
+         size_t   end ;          /* The end of the run in the batch, the barrier index */
+         size_t   lanes_begin ;  /* The start of the run's lane offsets in lane_ends */
+   } ;
+
+   // A batch of decoded records, partitioned into per-lane queues
+   struct batch_type {
+         std::vector<record>     records ;
+         std::vector<char>       data ;
+         std::vector<run>        runs ;
+         std::vector<size_t>     lane_ends ;  /* The ends of lane queues in lane_ops */
+         std::vector<uint32_t>   lane_ops ;   /* Record indices by run, then by lane */
+         bool                    more = true ;
+
+         void clear()
+         {
+            records.clear() ;
+            data.clear() ;
+            runs.clear() ;
+            lane_ends.clear() ;
+            lane_ops.clear() ;
+         }
+   } ;
+
+   threadpool pool (threads - 1, "jreplay") ;
+
+   // Read a batch sequentially (the storage checks CRC32 of every record), decode it
+   // concurrently, then distribute the operations of every run over lane queues in a
+   // single pass
+   const auto read_batch = [&](batch_type &batch)
+   {
+      batch.clear() ;
+
+      const auto read_record = [&](opcode_t opcode, opversion_t opversion, const void *opdata, size_t size)
+      {
+         NOXCHECK(opdata || !size) ;
+
+         batch.records.push_back({opcode, opversion, batch.data.size(), size, {}, Operation::NOPARTITION}) ;
+         batch.data.insert(batch.data.end(),
+                           static_cast<const char *>(opdata), static_cast<const char *>(opdata) + size) ;
+         return true ;
+      } ;
+
+      while (batch.records.size() < REPLAY_BATCH_OPS && batch.data.size() < REPLAY_BATCH_SIZE &&
+             (batch.more = storage.replay_record(read_record))) ;
+
+      parallel_for(pool, batch.records.size(), 16, [&](size_t ndx)
+      {
+         record &r = batch.records[ndx] ;
+
+         TRACEPX(PCOMN_Journal, DBGL_VERBOSE, "Decoding operation "
+                 << operation_name(r.opcode, r.opversion) << " size=" << r.size) ;
+
+         r.op = create_operation(r.opcode, r.opversion) ;
+         r.op->restore(r.size ? batch.data.data() + r.offset : NULL, r.size) ;
+         r.partition = r.op->partition_key() ;
+      }) ;
+
+      // Counting sort of every run's records by lane keeps the journal order inside
+      // a lane
+      batch.lane_ops.resize(batch.records.size()) ;
+      std::vector<unsigned> lanes (batch.records.size()) ;
+
+      for (size_t begin = 0 ; begin <= batch.records.size() ;)
+      {
+         size_t end = begin ;
+         for (; end < batch.records.size() && batch.records[end].partition != Operation::NOPARTITION ; ++end)
+            lanes[end] = hash_64(batch.records[end].partition) % threads ;
+
+         const size_t lanes_begin = batch.lane_ends.size() ;
+         batch.runs.push_back({end, lanes_begin}) ;
+         batch.lane_ends.resize(lanes_begin + threads) ;
+
+         size_t * const lane_ends = batch.lane_ends.data() + lanes_begin ;
+         for (size_t i = begin ; i < end ; ++i)
+            ++lane_ends[lanes[i]] ;
+         // Make the lane ends, lane queues of the run start at its beginning
+         size_t offset = begin ;
+         for (unsigned lane = 0 ; lane < threads ; ++lane)
+            lane_ends[lane] = offset += lane_ends[lane] ;
+         for (size_t i = end ; i-- != begin ;)
+            batch.lane_ops[--lane_ends[lanes[i]]] = i ;
+         for (unsigned lane = 0 ; lane < threads ; ++lane)
+            lane_ends[lane] = lane + 1 < threads ? lane_ends[lane + 1] : end ;
+
+         begin = end + 1 ;
+      }
+   } ;
+
+   const auto apply_batch = [&](const batch_type &batch)
+   {
+      size_t begin = 0 ;
+      for (const run &r: batch.runs)
+      {
+         const size_t * const lane_ends = batch.lane_ends.data() + r.lanes_begin ;
+
+         if (r.end - begin > 1)
+            parallel_for(pool, threads, 1, [&](size_t lane)
+            {
+               for (size_t i = lane ? lane_ends[lane - 1] : begin ; i < lane_ends[lane] ; ++i)
+                  apply_restored(*batch.records[batch.lane_ops[i]].op) ;
+            }) ;
+         else if (r.end > begin)
+            apply_restored(*batch.records[begin].op) ;
+
+         if (r.end < batch.records.size())
+            apply_restored(*batch.records[r.end].op) ;
+         begin = r.end + 1 ;
+      }
+   } ;
+
+   // Read and decode the next batch while the current one is being applied
+   batch_type batches[2] ;
+   unsigned opcount = 0 ;
+
+   read_batch(batches[0]) ;
+
+   for (unsigned current = 0 ;; current ^= 1)
+   {
+      batch_type &batch = batches[current] ;
+      batch_type &next = batches[current ^ 1] ;
+
+      std::future<void> read_ahead ;
+      if (batch.more)
+         read_ahead = pool.enqueue_task([&] { read_batch(next) ; }) ;
+
+      try {
+         apply_batch(batch) ;
+      }
+      catch (...)
+      {
+         // The read-ahead task references the batches
+         if (read_ahead.valid())
+            read_ahead.wait() ;
+         throw ;
+      }
+      opcount += batch.records.size() ;
+
+      if (!read_ahead.valid())
+         break ;
+      read_ahead.get() ;
+   }
+   return opcount ;
+}
+
 bool Journallable::load_operation(opcode_t opcode, opversion_t opversion,
                                   const void *opdata, size_t data_size)
 {
@@ -265,12 +444,27 @@ void Journallable::apply(const Operation &op)
                   "Operation %s is not compatible with journallable of type %s",
                   op.name().c_str(), PCOMN_TYPENAME(*this)) ;
 
-   // FIXME: exclusive lock
-   write_guard lock (_lock) ;
+   Storage *journal_storage ;
+   {
+      // FIXME: exclusive lock
+      write_guard lock (_lock) ;
+
+      ENSURE_STATE("apply a new operation", ST_RESTORED, ST_ACTIVE, ST_CHECKPOINT) ;
+
+      apply_created(op) ;
 
-   ENSURE_STATE("apply a new operation", ST_RESTORED, ST_ACTIVE, ST_CHECKPOINT) ;
+      if (state() == ST_RESTORED)
+         return ;
 
-   apply_created(op) ;
+      journal_storage = unlocked_journal()->unsafe_storage() ;
+      // Prevent set_journal() from disconnecting the journal until the record is written
+      _complock.lock_shared() ;
+   }
+   // Wait for the record completion outside the object lock: while we are waiting,
+   // concurrent appliers may put their records into the same storage write.
+   read_guard complock (_complock, std::adopt_lock) ;
+
+   journal_storage->complete_append() ;
 }
 
 void Journallable::apply_restored(const Operation &op)
@@ -396,6 +590,9 @@ Port *Journallable::set_journal(Port *new_journal)
       NOXCHECK(_journal) ;
       NOXCHECK(_journal->target() == this) ;
 
+      // Wait for pending record completions in apply()
+      write_guard complock (_complock) ;
+
       _journal->close() ;
       _journal->_target = NULL ;
       _state = ST_RESTORED ;
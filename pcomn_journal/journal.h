@@ -109,6 +109,13 @@ namespace jrn {
 *******************************************************************************/
 const uint16_t FORMAT_VERSION = 1 ;
 
+/// Journal format version where operation records are checksummed with CRC32C
+/// (Castagnoli) instead of CRC32.
+///
+/// The format version is per journal file: segments of both versions can coexist in
+/// the same journal; checkpoints are always FORMAT_VERSION.
+const uint16_t FORMAT_VERSION_CRC32C = 2 ;
+
 /*******************************************************************************
  Typedefs for POD journal types
 *******************************************************************************/
@@ -325,6 +332,10 @@ class _PCOMNEXP Storage {
 
       const magic_t &user_magic() const { return _user_magic ; }
 
+      /// Get the format version of operation records appended to the storage
+      /// (either FORMAT_VERSION or FORMAT_VERSION_CRC32C).
+      uint16_t record_format() const { return _record_format ; }
+
       bool replay_record(const record_handler &handler) ;
 
       void replay_checkpoint(const checkpoint_handler &handler) ;
@@ -340,11 +351,14 @@ class _PCOMNEXP Storage {
 
    protected:
       explicit Storage() :
-         _state(SST_INITIAL)
+         _state(SST_INITIAL),
+         _record_format(FORMAT_VERSION)
       {}
 
       void set_state(State st) { _state = st ; }
 
+      void set_record_format(uint16_t format_version) { _record_format = format_version ; }
+
       /// Toggle the storage into write mode.
       void make_writable() ;
 
@@ -362,6 +376,12 @@ class _PCOMNEXP Storage {
          return append_record(&v, &v + 1) ;
       }
 
+      /// Wait until all the records appended before the call are actually written.
+      ///
+      /// Does not lock the storage; for storages that write records synchronously
+      /// from do_append_record() this is no-op.
+      void complete_append() { do_complete_append() ; }
+
       std::pair<binary_obufstream *, generation_t> create_checkpoint() ;
 
       void close_checkpoint(bool commit) ;
@@ -387,6 +407,14 @@ class _PCOMNEXP Storage {
       /// While calling this function, the journal is always in writable mode.
       virtual size_t do_append_record(const iovec_t *begin, const iovec_t *end) = 0 ;
 
+      /// Should wait until all the records passed to do_append_record() before the call
+      /// are written to the active journal segment.
+      ///
+      /// Called without the storage lock. Storages that delay writes (e.g. to
+      /// coalesce records of concurrent appenders) must override this method; the
+      /// default implementation does nothing.
+      virtual void do_complete_append() {}
+
       /// Should create new checkpoint and get an output stream connected to it.
       ///
       /// Should flush and close the active journal segment and create a new checkpoint
@@ -405,6 +433,7 @@ class _PCOMNEXP Storage {
       shared_mutex   _lock ;
       State          _state ;
       magic_t        _user_magic ;
+      uint16_t       _record_format ;
 
       // Note that we shouldn't acquire the writer lock when
       typedef shared_lock<shared_mutex> read_guard ;
@@ -447,8 +476,22 @@ class _PCOMNEXP Journallable {
 
       /// Restore the state of a journallable object from the journal.
       ///
+      /// @param journal         The journal to restore from.
+      /// @param set_journal     Connect the object to @a journal after restoring.
+      /// @param replay_threads  The count of threads (including the calling one) to
+      /// replay journal records; 0 means sys::hw_threads_count(), 1 (default) means
+      /// sequential replay.
+      ///
+      /// In parallel mode, records are read in batches; every batch is decoded
+      /// (create_operation() and Operation::restore()) concurrently while the previous
+      /// batch is being applied, and distributed once over per-thread queues by
+      /// Operation::partition_key(). Operations with the same partition key are applied
+      /// in journal order while operations from different partitions are applied
+      /// concurrently. Operations without a partition key are applied exclusively,
+      /// as barriers.
+      ///
       /// ST_INITIAL -> ST_RESTORED [-> ST_ACTIVE]
-      void restore_from(Port &journal, bool set_journal) ;
+      void restore_from(Port &journal, bool set_journal, unsigned replay_threads = 1) ;
 
       /// Set a journal.
       ///
@@ -485,6 +528,12 @@ class _PCOMNEXP Journallable {
       ///
       /// Checks whether @a op is compatible by type with the target by calling
       /// Journallable::is_op_compatible()
+      ///
+      /// If the journal storage delays record writes (see Storage::complete_append()),
+      /// waits for the record of @a op to be written @em after releasing the object
+      /// lock, so that concurrent apply() calls may share a single storage write. In
+      /// this case, if the write fails, the exception is thrown from apply() though
+      /// the operation is already applied to the object.
       void apply(const Operation &op) ;
 
       /// @overload
@@ -500,6 +549,9 @@ class _PCOMNEXP Journallable {
    protected:
       Journallable() ;
 
+      /// Should create an empty operation object for restoring from the journal.
+      ///
+      /// @note While replaying a journal in parallel mode, called concurrently.
       virtual operation_ptr create_operation(opcode_t opcode, opversion_t version) const = 0 ;
 
       virtual void start_checkpoint() = 0 ;
@@ -543,6 +595,8 @@ class _PCOMNEXP Journallable {
 
    private:
       mutable shared_mutex    _lock ;
+      shared_mutex            _complock ;  /* Held shared while waiting for a record
+                                            * write completion */
       std::mutex              _cplock ;    /* Checkpoint lock */
       State                   _state ;
       Port *                  _journal ; /* The current journal (may change during object lifetime) */
@@ -559,6 +613,10 @@ class _PCOMNEXP Journallable {
 
       generation_t take_checkpoint_unlocked(unsigned flags) ;
 
+      // Replay journal records, return the count of replayed records
+      unsigned load_operations(Storage &storage) ;
+      unsigned load_operations(Storage &storage, unsigned threads) ;
+
       void apply_restored(const Operation &op) ;
       void apply_created(const Operation &op) ;
 
@@ -603,6 +661,18 @@ class _PCOMNEXP Operation : public PRefCount {
       /// Get the actual type of Journallable this operaion apply
       const std::type_info &target_type() const { return _target_type ; }
 
+      /// Partition key of an operation that doesn't belong to any partition.
+      static constexpr uint64_t NOPARTITION = ~0ULL ;
+
+      /// Get the key of the target's partition this operation modifies.
+      ///
+      /// Used by parallel replay (see Journallable::restore_from()): operations with
+      /// different keys must modify independent parts of the target and so may be
+      /// applied concurrently, operations with the same key are applied in journal
+      /// order. An operation with NOPARTITION key (the default) is applied after all
+      /// preceding operations and before all following ones.
+      virtual uint64_t partition_key() const { return NOPARTITION ; }
+
       void save(binary_obufstream &storage) const { do_save(storage) ; }
 
       friend std::ostream &operator<<(std::ostream &os, const Operation &op)
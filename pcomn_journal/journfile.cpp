@@ -20,6 +20,8 @@
 #include <pcomn_mmap.h>
 
 #include <sys/uio.h>
+#include <sys/mman.h>
+#include <fcntl.h>
 #include <errno.h>
 
 namespace pcomn {
@@ -32,12 +34,16 @@ static const magic_t ZERO_MAGIC = {{}} ;
 *******************************************************************************/
 MMapStorage::RecFile::RecFile(int dirfd, const char *filename,
                               int64_t segid, generation_t generation,
-                              unsigned mask, bool is_checkpoint) :
+                              unsigned mask, bool is_checkpoint, int oflags,
+                              uint16_t format_version) :
 
-   _fd(PCOMN_ENSURE_POSIX(::openat(dirfd, PCOMN_ENSURE_ARG(filename), O_CREAT|O_EXCL|O_WRONLY, mask),
+   _fd(PCOMN_ENSURE_POSIX(::openat(dirfd, PCOMN_ENSURE_ARG(filename),
+                                   O_CREAT|O_EXCL|O_WRONLY|oflags, mask),
                           "creat")),
 
    _is_checkpoint(is_checkpoint),
+   _dsync(!!(oflags & O_DSYNC)),
+   _format_version(format_version),
    _crc32_mode(false),
    _state(ST_CREATED),
    _corruption(FMTERR_OK),
@@ -54,6 +60,7 @@ MMapStorage::RecFile::RecFile(int dirfd, const char *filename,
 {
    PCOMN_ASSERT_ARG(segid >= -1) ;
    PCOMN_ASSERT_ARG(generation >= 0 && is_aligned(generation)) ;
+   PCOMN_ASSERT_ARG(is_valid_format_version(format_version)) ;
 
    TRACEPX(PCOMN_Journmmap, DBGL_MIDLEV, "Created " << *this << " as '" << filename << "'") ;
 }
@@ -62,6 +69,8 @@ MMapStorage::RecFile::RecFile(int fd, bool is_checkpoint) :
    _fd(fd),
 
    _is_checkpoint(is_checkpoint),
+   _dsync(false),
+   _format_version(FORMAT_VERSION),
    _crc32_mode(false),
    _state(ST_READABLE),
    _corruption(FMTERR_OK),
@@ -97,7 +106,11 @@ MMapStorage::RecFile::RecFile(int fd, bool is_checkpoint) :
    ensure<storage_error>((kind == KIND_CHECKPOINT) == is_checkpoint,
                           errmsg[is_checkpoint], errcode[is_checkpoint]) ;
 
+   ensure<storage_error>(is_valid_format_version(header.format_version),
+                         "Unsupported journal format version", ERR_CORRUPT) ;
+
    // Fill in data members from the header
+   _format_version = header.format_version ;
    _generation = header.generation ;
    _uid = header.uid ;
    _seg_id = header.nextseg_id - 1 ;
@@ -186,7 +199,7 @@ void MMapStorage::RecFile::init(const magic_t &usermagic)
    FileHeader header ;
    init_header(header) ;
 
-   header.format_version = FORMAT_VERSION ;
+   header.format_version = format_version() ;
    header.generation = generation() ;
    header.nextseg_id = next_segment() ;
    header.uid = _uid ;
@@ -286,6 +299,27 @@ size_t MMapStorage::RecFile::write_buffer(const void *buf, size_t sz)
    return written ;
 }
 
+void MMapStorage::RecFile::datasync()
+{
+   TRACEPX(PCOMN_Journmmap, DBGL_LOWLEV, *this << "::datasync()") ;
+
+   PCOMN_ENSURE_POSIX(::fdatasync(fd()), "fdatasync") ;
+}
+
+void MMapStorage::RecFile::preallocate(fileoff_t size)
+{
+   TRACEPX(PCOMN_Journmmap, DBGL_LOWLEV, *this << "::preallocate(" << size << ')') ;
+
+#ifdef FALLOC_FL_KEEP_SIZE
+   // Keep the file size: the size of a segment file is the end of its data
+   if (size > 0 && ::fallocate(fd(), FALLOC_FL_KEEP_SIZE, 0, size))
+      LOGPXWARN(PCOMN_Journmmap, "Cannot preallocate " << size << " bytes for " << *this
+                << ": " << strerror(errno)) ;
+#else
+   (void)size ;
+#endif
+}
+
 size_t MMapStorage::RecFile::write_vector(const iovec_t *begin, const iovec_t *end)
 {
    TRACEPX(PCOMN_Journmmap, DBGL_LOWLEV, *this << "::write_vector(begin=" << begin << ", end=" << end << ')') ;
@@ -453,5 +487,88 @@ bool MMapStorage::SegmentFile::commit()
    return ancestor::commit(NULL) ;
 }
 
+// The size of a range of a mapped segment asynchronously read ahead while the segment
+// is being replayed
+static const size_t MAPPED_READAHEAD = 4*MiB ;
+
+bool MMapStorage::SegmentFile::map_data()
+{
+   ensure_readable() ;
+
+   if (is_mapped())
+      return true ;
+   if (_unmappable)
+      return false ;
+
+   const fileoff_t pos = PCOMN_ENSURE_POSIX(lseek(fd(), 0, SEEK_CUR), "lseek") ;
+   const fileoff_t end = data_end() ;
+   if (pos >= end)
+      return false ;
+
+   try {
+      _mapping = PMemMapping(fd(), 0, end, O_RDONLY) ;
+   }
+   catch (const system_error &x)
+   {
+      _unmappable = true ;
+      LOGPXWARN(PCOMN_Journmmap, "Cannot map " << *this << ", falling back to read(2). " << x.what()) ;
+      return false ;
+   }
+
+   // Advice is only a hint: ignore errors
+   madvise(const_cast<void *>(_mapping.data()), _mapping.size(), MADV_SEQUENTIAL) ;
+
+   _mappos = _readahead_end = pos ;
+   advance_mapped(0) ;
+
+   TRACEPX(PCOMN_Journmmap, DBGL_MIDLEV, "Mapped " << _mapping.size() << " bytes of " << *this
+           << " for reading from " << pos) ;
+   return true ;
+}
+
+void MMapStorage::SegmentFile::advance_mapped(size_t size)
+{
+   NOXCHECK(_mappos + size <= _mapping.size()) ;
+
+   _mappos += size ;
+
+   // Keep at least a half of the read-ahead window ahead of the read position
+   if (_readahead_end >= _mapping.size() || _readahead_end - _mappos >= MAPPED_READAHEAD/2)
+      return ;
+
+   const size_t pagemask = sys::pagesize() - 1 ;
+   const size_t from = _readahead_end & ~pagemask ;
+   _readahead_end = std::min(_mappos + MAPPED_READAHEAD, _mapping.size()) ;
+
+   madvise(const_cast<char *>(_mapping.cdata()) + from, _readahead_end - from, MADV_WILLNEED) ;
+}
+
+size_t MMapStorage::SegmentFile::read_mapped(const iovec_t *begin, const iovec_t *end)
+{
+   NOXCHECK(is_mapped()) ;
+
+   size_t total = 0 ;
+   for (const iovec_t *v = begin ; v != end && _mappos < _mapping.size() ; ++v)
+   {
+      const size_t sz = std::min(v->iov_len, _mapping.size() - _mappos) ;
+      memcpy(v->iov_base, _mapping.cdata() + _mappos, sz) ;
+      advance_mapped(sz) ;
+      total += sz ;
+   }
+   return total ;
+}
+
+const char *MMapStorage::SegmentFile::mapped_data(size_t size)
+{
+   NOXCHECK(is_mapped()) ;
+
+   if (_mapping.size() - _mappos < size)
+      return NULL ;
+
+   const char * const data = _mapping.cdata() + _mappos ;
+   advance_mapped(size) ;
+   return data ;
+}
+
 } // end of namespace pcomn::jrn
 } // end of namespace pcomn
@@ -94,8 +94,22 @@ MMapStorage::MMapStorage(const strslice &journal_path,
              // Check for the presence of segments sudirectory (possibly, a symbolic link)
              faccessat(dirfd(), pcomn::str::cstr(make_filename(name(), EXT_SEGDIR)), F_OK, 0)),
 
-   _nobakseg(!!(open_flags & OF_NOBAKSEG))
+   _nobakseg(!!(open_flags & OF_NOBAKSEG)),
+   _mmap_replay(!!(open_flags & OF_MMAPREPLAY)),
+
+   _durability(open_flags & OF_DSYNC ? DUR_DSYNC : DUR_NONE),
+   _sync_interval(0),
+   _segment_prealloc(0),
+
+   _group_commit(false),
+   _batch_ops(0),
+   _enqueued(0),
+   _committed(0),
+   _writing(false)
 {
+   if (open_flags & OF_CRC32C)
+      set_record_format(FORMAT_VERSION_CRC32C) ;
+
    if (access_mode == MD_WRONLY ||
 
        access_mode == MD_RDWR &&
@@ -121,8 +135,22 @@ MMapStorage::MMapStorage(const strslice &journal_path, const strslice &segdir_pa
    _cpstream_bufsz(cpstream_bufsz),
    // TODO: should normalize the path
    _nosegdir((open_flags & OF_NOSEGDIR) || segdir_path.empty() || segdir_path == strslice(".")),
-   _nobakseg(!!(open_flags & OF_NOBAKSEG))
+   _nobakseg(!!(open_flags & OF_NOBAKSEG)),
+   _mmap_replay(!!(open_flags & OF_MMAPREPLAY)),
+
+   _durability(open_flags & OF_DSYNC ? DUR_DSYNC : DUR_NONE),
+   _sync_interval(0),
+   _segment_prealloc(0),
+
+   _group_commit(false),
+   _batch_ops(0),
+   _enqueued(0),
+   _committed(0),
+   _writing(false)
 {
+   if (open_flags & OF_CRC32C)
+      set_record_format(FORMAT_VERSION_CRC32C) ;
+
    // If the segment directory name is not specified, use the checkpoint directory
    create_storage(segdir_path.stdstring().c_str()) ;
 }
@@ -156,6 +184,15 @@ bool MMapStorage::do_close_storage()
 
 
       case SST_WRITABLE:
+         if (is_group_commit())
+            try {
+               flush_batch() ;
+            }
+            catch (const std::exception &x)
+            {
+               LOGERR(STDEXCEPTOUT(x) << " while closing " << *this) ;
+            }
+
          if (!_checkpoint)
          {
             NOXCHECK(_segment) ;
@@ -471,7 +508,9 @@ MMapStorage::SegmentFile *MMapStorage::new_segment_file(int64_t id)
       try {
          TRACEPX(PCOMN_Journmmap, DBGL_ALWAYS, "Attempting to create '" << filename << "'") ;
 
-         new_segment.reset(new SegmentFile(_segdirfd, filename, id, current_generation(), 0600)) ;
+         new_segment.reset(new SegmentFile(_segdirfd, filename, id, current_generation(), 0600,
+                                           _durability == DUR_DSYNC ? O_DSYNC : 0,
+                                           record_format())) ;
       }
       catch (const system_error &x)
       {
@@ -491,6 +530,7 @@ MMapStorage::SegmentFile *MMapStorage::new_segment_file(int64_t id)
 
       // Initialize new segment
       new_segment->init(user_magic()) ;
+      new_segment->preallocate(_segment_prealloc) ;
 
       // Check whether the actual name of the just created segment (filename) matches the
       // requested (segment_filename).
@@ -744,7 +784,9 @@ size_t MMapStorage::read_record(SegmentFile &segment, const record_handler &hand
          make_iovec(&header, sizeof (OperationHeader))
       } ;
 
-   const size_t sz_head = segment.readv(iov_head) ;
+   const bool mapped = segment.is_mapped() ;
+
+   const size_t sz_head = mapped ? segment.read_mapped(iov_head) : segment.readv(iov_head) ;
 
    size_t sz_full = sz_head ;
 
@@ -768,10 +810,11 @@ size_t MMapStorage::read_record(SegmentFile &segment, const record_handler &hand
    }
 
    PTVSafePtr<char> data_guard ;
-   char *data_buf ;
+   char *data_buf = NULL ;
 
    try {
-      uint32_t opcrc = calc_crc32(0, &header, sizeof(OperationHeader)) ;
+      const record_crc_function crc = record_crc(segment.format_version()) ;
+      uint32_t opcrc = crc(0, &header, sizeof(OperationHeader)) ;
 
       dtoh(header) ;
 
@@ -786,13 +829,16 @@ size_t MMapStorage::read_record(SegmentFile &segment, const record_handler &hand
       OperationTail tail ;
 
       // Allocate a buffer: if it is not too big, allocate it on the stack, otherwise in
-      // the heap
-      if (aligned_datasize <= MAX_ALLOCA)
+      // the heap. If the segment is memory-mapped, the buffer is not needed at all: the
+      // data is passed to the handler directly from the mapping.
+      if (mapped)
+         ;
+      else if (aligned_datasize <= MAX_ALLOCA)
          data_buf = P_ALLOCA(char, aligned_datasize) ;
       else
          data_guard.reset(data_buf = new char [aligned_datasize]) ;
 
-      const iovec_t iov_data[] =
+      iovec_t iov_data[] =
          {
             make_iovec(header._extra, remheader_size),
             make_iovec(data_buf, aligned_datasize),
@@ -803,14 +849,29 @@ size_t MMapStorage::read_record(SegmentFile &segment, const record_handler &hand
 
       const size_t sz_body = bufsizev(iov_begin, iov_end) ;
 
-      if (segment.readv(iov_begin, iov_end) != sz_body)
+      if (mapped)
+      {
+         // Copy the rest of the header and the tail, take the data from the mapping
+         const char * const mapped_data =
+            segment.read_mapped(iov_data + 0, iov_data + 1) == remheader_size
+            ? segment.mapped_data(aligned_datasize) : NULL ;
+
+         iov_data[1].iov_base = data_buf = const_cast<char *>(mapped_data) ;
+
+         if (!mapped_data || segment.read_mapped(iov_data + 2, iov_end) != sizeof tail)
+         {
+            LOGWARN("The tail of " << segment << " is truncated, the segment was not properly closed") ;
+            return 0 ;
+         }
+      }
+      else if (segment.readv(iov_begin, iov_end) != sz_body)
       {
          LOGWARN("The tail of " << segment << " is truncated, the segment was not properly closed") ;
          return 0 ;
       }
 
       // Validate operation tail, ignore the last 4 bytes that hold crc32
-      opcrc = calc_crc32(calc_crc32v(opcrc, iov_begin, iov_end - 1), 4, *(iov_end - 1)) ;
+      opcrc = crc(calc_record_crcv(crc, opcrc, iov_begin, iov_end - 1), &tail, sizeof tail - 4) ;
       dtoh(tail) ;
 
       if (tail.data_size != header.data_size || tail.crc32 != opcrc)
@@ -844,8 +905,19 @@ size_t MMapStorage::read_record(SegmentFile &segment, const record_handler &hand
 bool MMapStorage::do_replay_record(const record_handler &handler)
 {
    size_t recsize = 0 ;
-   while (!_segments.empty() && (recsize = read_record(*_segments.back(), handler)) == 0)
+   while (!_segments.empty())
+   {
+      SegmentFile &segment = *_segments.back() ;
+      // Map every segment on its first read; if the mapping fails, read_record() falls
+      // back to readv()
+      if (mmap_replay() && !segment.is_mapped())
+         segment.map_data() ;
+
+      if ((recsize = read_record(segment, handler)) != 0)
+         break ;
+
       _segments.pop_back() ;
+   }
 
    if (!recsize)
       return false ;
@@ -920,10 +992,192 @@ size_t MMapStorage::do_append_record(const iovec_t *begin, const iovec_t *end)
 {
    PCOMN_VERIFY(_segment) ;
 
-   const size_t written = _segment->writev(begin, end) ;
-   _lastgen += written ;
+   if (!is_group_commit())
+   {
+      const size_t written = _segment->writev(begin, end) ;
+      _lastgen += written ;
+
+      sync_segment() ;
+
+      return written ;
+   }
+
+   // Group commit: only put the record into the pending batch, the batch will be
+   // written by do_complete_append()
+   const size_t sz = bufsizev(begin, end) ;
+
+   std::lock_guard<std::mutex> lock (_batch_lock) ;
+
+   if (_batch_error)
+      std::rethrow_exception(_batch_error) ;
 
-   return written ;
+   for (const iovec_t *v = begin ; v != end ; ++v)
+      _batch.insert(_batch.end(),
+                    static_cast<const char *>(v->iov_base),
+                    static_cast<const char *>(v->iov_base) + v->iov_len) ;
+   ++_batch_ops ;
+   ++_enqueued ;
+   _lastgen += sz ;
+
+   if (_gcparams.max_size && _batch.size() >= _gcparams.max_size)
+      _batch_full.notify_one() ;
+
+   return sz ;
+}
+
+void MMapStorage::do_complete_append()
+{
+   if (!is_group_commit())
+      return ;
+
+   std::unique_lock<std::mutex> lock (_batch_lock) ;
+
+   // Wait for all the records enqueued so far, this includes the record of the caller
+   const uint64_t last_record = _enqueued ;
+
+   while (_committed < last_record && !_batch_error)
+   {
+      if (_writing)
+      {
+         // Somebody is already writing a batch, our record is either in it or will be
+         // in the next batch
+         _batch_done.wait(lock) ;
+         continue ;
+      }
+
+      // Become the batch writer; let the batch grow while the latency permits
+      _writing = true ;
+      if (_gcparams.max_latency.count())
+         _batch_full.wait_for(lock, _gcparams.max_latency, [this]
+         {
+            return _gcparams.max_size && _batch.size() >= _gcparams.max_size ;
+         }) ;
+
+      write_batch(lock) ;
+   }
+
+   if (_committed < last_record)
+      std::rethrow_exception(_batch_error) ;
+}
+
+void MMapStorage::write_batch(std::unique_lock<std::mutex> &batch_lock)
+{
+   NOXCHECK(batch_lock.owns_lock()) ;
+   NOXCHECK(_writing) ;
+
+   _writebuf.swap(_batch) ;
+   const unsigned opcount = _batch_ops ;
+   const uint64_t last_record = _enqueued ;
+   _batch_ops = 0 ;
+
+   TRACEPX(PCOMN_Journmmap, DBGL_LOWLEV, "Writing a batch of " << opcount << " records, "
+           << _writebuf.size() << " bytes to " << *this) ;
+
+   batch_lock.unlock() ;
+
+   std::exception_ptr error ;
+   try {
+      if (opcount)
+      {
+         _segment->write_records(_writebuf.data(), _writebuf.size(), opcount) ;
+         sync_segment() ;
+      }
+   }
+   catch (const std::exception &x)
+   {
+      LOGERR(STDEXCEPTOUT(x) << " while writing a batch of "
+               << opcount << " records to " << *this) ;
+      error = std::current_exception() ;
+   }
+   _writebuf.clear() ;
+
+   batch_lock.lock() ;
+
+   if (error)
+      _batch_error = error ;
+   else
+      _committed = last_record ;
+
+   _writing = false ;
+   _batch_done.notify_all() ;
+}
+
+void MMapStorage::flush_batch()
+{
+   std::unique_lock<std::mutex> lock (_batch_lock) ;
+
+   _batch_done.wait(lock, [this] { return !_writing ; }) ;
+
+   if (_batch_ops && !_batch_error)
+   {
+      _writing = true ;
+      write_batch(lock) ;
+   }
+
+   if (_batch_error)
+      std::rethrow_exception(_batch_error) ;
+}
+
+void MMapStorage::set_group_commit(const GroupCommit &params)
+{
+   TRACEPX(PCOMN_Journmmap, DBGL_ALWAYS, "Set group commit for " << *this
+           << ": max_latency=" << params.max_latency.count() << "us max_size=" << params.max_size) ;
+
+   std::lock_guard<std::mutex> lock (_batch_lock) ;
+
+   _gcparams = params ;
+   _group_commit = true ;
+}
+
+void MMapStorage::set_durability(Durability durability, std::chrono::milliseconds sync_interval)
+{
+   TRACEPX(PCOMN_Journmmap, DBGL_ALWAYS, "Set durability " << (int)durability
+           << " sync_interval=" << sync_interval.count() << "ms for " << *this) ;
+
+   PCOMN_ASSERT_ARG(inrange(durability, DUR_NONE, DUR_DSYNC)) ;
+   PCOMN_ASSERT_ARG(sync_interval.count() >= 0) ;
+
+   _durability = durability ;
+   _sync_interval = sync_interval ;
+}
+
+void MMapStorage::sync_segment()
+{
+   switch (_durability)
+   {
+      case DUR_NONE:
+         return ;
+
+      case DUR_DSYNC:
+         // The active segment may be created before switching to DUR_DSYNC
+         if (_segment->dsync())
+            return ;
+         break ;
+
+      case DUR_INTERVAL:
+      {
+         const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now() ;
+         if (now - _last_sync < _sync_interval)
+            return ;
+         _last_sync = now ;
+         break ;
+      }
+
+      default:
+         break ;
+   }
+   _segment->datasync() ;
+}
+
+void MMapStorage::reset_group_commit()
+{
+   TRACEPX(PCOMN_Journmmap, DBGL_ALWAYS, "Reset group commit for " << *this) ;
+
+   if (!is_group_commit())
+      return ;
+
+   flush_batch() ;
+   _group_commit = false ;
 }
 
 std::pair<binary_obufstream *, generation_t> MMapStorage::do_create_checkpoint()
@@ -944,6 +1198,10 @@ std::pair<binary_obufstream *, generation_t> MMapStorage::do_create_checkpoint()
       NOXCHECK(_segment) ;
       NOXCHECK(!_checkpoint) ;
 
+      // Records of the pending batch belong to the current segment
+      if (is_group_commit())
+         flush_batch() ;
+
       // Swap segments: create a new segment, commit the current one, set the new segment
       // as the active segment of this storage
       new_segment_file(_segment->next_segment()) ;
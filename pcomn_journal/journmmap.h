@@ -27,10 +27,15 @@
 #include <pcomn_hash.h>
 #include <pcomn_flgout.h>
 #include <pcomn_ivector.h>
+#include <pcomn_mmap.h>
 #include <pcomn_unistd.h>
 
 #include <vector>
 #include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <exception>
 
 #include <stddef.h>
 
@@ -139,8 +144,28 @@ class _PCOMNEXP MMapStorage : public Storage {
       enum OpenFlags {
          OF_NOBAKSEG = 0x1000,   /**< When in MD_WRONLY/MD_RDWR mode, don't create backup
                                     files while creating new segments */
-         OF_NOSEGDIR = 0x2000    /**< Don't attempt to search a segments directory while
+         OF_NOSEGDIR = 0x2000,   /**< Don't attempt to search a segments directory while
                                     opening in MD_RDONLY/MD_RDWR, use checkpoint directory */
+         OF_DSYNC    = 0x4000,   /**< Start with DUR_DSYNC durability (see set_durability()) */
+         OF_MMAPREPLAY = 0x8000, /**< Replay segments through memory mapping, passing
+                                    operation data to handlers directly from the mapping */
+         OF_CRC32C   = 0x10000   /**< Create new segments in FORMAT_VERSION_CRC32C, i.e.
+                                    checksum operation records with CRC32C */
+      } ;
+
+      /// Durability policies for journal segment data.
+      ///
+      /// Note that segments are always synced when committed (i.e. on checkpoint or
+      /// close), policies only control data written between commits.
+      enum Durability {
+         DUR_NONE,      /**< Don't sync appended records */
+         DUR_SYNC,      /**< fdatasync() after every record or, in group commit mode,
+                           after every batch */
+         DUR_INTERVAL,  /**< fdatasync() after a record or a batch if at least the sync
+                           interval has passed since the previous fdatasync(); there
+                           is no timer, records appended last stay unsynced until
+                           the next append or segment commit */
+         DUR_DSYNC      /**< Create segments with O_DSYNC */
       } ;
 
       /// File suffix of segment files (includes initial '.')
@@ -168,6 +193,17 @@ class _PCOMNEXP MMapStorage : public Storage {
             magic_t        user_magic ;   /**< User magic number */
       } ;
 
+      /************************************************************************/
+      /** Group commit parameters.
+      *************************************************************************/
+      struct GroupCommit {
+            std::chrono::microseconds max_latency {0} ; /**< How long a batch may wait
+                                                           for more records before it
+                                                           is written */
+            size_t   max_size = 0 ;  /**< The size (bytes) after which a batch is written
+                                        without waiting for max_latency; 0 - no limit */
+      } ;
+
       static FilenameKind filekind_to_namekind(FileKind kind)
       {
          return
@@ -211,6 +247,55 @@ class _PCOMNEXP MMapStorage : public Storage {
       /// Get the journal name
       const std::string &name() const { return _name ; }
 
+      /// Switch the storage into group commit mode.
+      ///
+      /// In group commit mode do_append_record() only copies a record into the pending
+      /// batch. The batch is written to the active segment with a single write (and,
+      /// depending on durability(), a single fdatasync) by the first appender that waits for its
+      /// record completion in do_complete_append(); appenders that come while the
+      /// batch is being written wait for the next batch. Every appender returns from
+      /// do_complete_append() only after its own record is written.
+      ///
+      /// @note Must not be called concurrently with appending records.
+      void set_group_commit(const GroupCommit &params) ;
+
+      /// Switch group commit mode off, writing the pending batch, if any.
+      /// @note Must not be called concurrently with appending records.
+      void reset_group_commit() ;
+
+      bool is_group_commit() const { return _group_commit ; }
+
+      const GroupCommit &group_commit() const { return _gcparams ; }
+
+      /// Set the durability policy for appended records.
+      ///
+      /// @param durability    The policy.
+      /// @param sync_interval The minimal interval between fdatasync() calls for
+      /// DUR_INTERVAL, ignored for other policies.
+      ///
+      /// DUR_DSYNC takes full effect starting from the next segment; until then, the
+      /// active segment is synced as with DUR_SYNC.
+      ///
+      /// DUR_INTERVAL checks the interval only when a record or a batch is written:
+      /// there is no timer, so if the journal becomes idle, the records appended after
+      /// the last fdatasync() remain unsynced until the next append or segment commit
+      /// (checkpoint or close).
+      /// @note Must not be called concurrently with appending records.
+      void set_durability(Durability durability,
+                          std::chrono::milliseconds sync_interval = std::chrono::milliseconds()) ;
+
+      Durability durability() const { return _durability ; }
+
+      std::chrono::milliseconds sync_interval() const { return _sync_interval ; }
+
+      /// Set the size of disk space to preallocate for every new segment file.
+      ///
+      /// Preallocation doesn't change the size of a segment file, it only reserves disk
+      /// blocks so that appends need not allocate them; 0 means no preallocation.
+      void set_segment_prealloc(size_t size) { _segment_prealloc = size ; }
+
+      size_t segment_prealloc() const { return _segment_prealloc ; }
+
       const std::string &dirname() const { return _dirname ; }
 
       /// Get the file descriptor of the checkpoint directory
@@ -223,6 +308,9 @@ class _PCOMNEXP MMapStorage : public Storage {
       /// Don't backup existing segment files, always overwrite
       bool nobakseg() const { return _nobakseg ; }
 
+      /// Indicate whether segments are replayed through memory mapping (OF_MMAPREPLAY)
+      bool mmap_replay() const { return _mmap_replay ; }
+
       std::string segment_dirname() const
       {
          return nosegdir() ? dirname() : journal_abspath(make_filename(name(), EXT_SEGDIR)) ;
@@ -350,6 +438,9 @@ class _PCOMNEXP MMapStorage : public Storage {
 
             FileState state() const { return _state ; }
 
+            /// Get the journal format version of the file
+            uint16_t format_version() const { return _format_version ; }
+
             const magic_t &storage_magic() const
             {
                return _is_checkpoint ? STORAGE_CHECKPOINT_MAGIC : STORAGE_SEGMENT_MAGIC ;
@@ -386,6 +477,25 @@ class _PCOMNEXP MMapStorage : public Storage {
                return writev(&v, &v + 1) ;
             }
 
+            /// Write @a count complete records placed contiguously into @a buf.
+            size_t write_records(const void *buf, size_t sz, unsigned count)
+            {
+               const size_t written = write_buffer(buf, sz) ;
+
+               _opcount.fetch_add(count, std::memory_order_acq_rel) ;
+               return written ;
+            }
+
+            /// Flush written data to the disk (fdatasync).
+            void datasync() ;
+
+            /// Reserve disk space for @a size bytes of the file, not changing the file
+            /// size; silently does nothing where not supported.
+            void preallocate(fileoff_t size) ;
+
+            /// Indicate whether the file is open with O_DSYNC
+            bool dsync() const { return _dsync ; }
+
             /// Indicate whether CRC32 calculation mode is on
             bool crc32_mode() const { return _crc32_mode ; }
 
@@ -424,9 +534,12 @@ class _PCOMNEXP MMapStorage : public Storage {
 
          protected:
             /// Create an empty writable record file
+            /// @param oflags Additional open(2) flags (e.g. O_DSYNC)
+            /// @param format_version The journal format version to write into the header
             RecFile(int dirfd, const char *filename,
                     int64_t segid, generation_t generation,
-                    unsigned mask, bool is_checkpoint) ;
+                    unsigned mask, bool is_checkpoint, int oflags = 0,
+                    uint16_t format_version = FORMAT_VERSION) ;
 
             /// Create an empty writable record file
             RecFile(int fd, bool is_checkpoint) ;
@@ -464,6 +577,8 @@ class _PCOMNEXP MMapStorage : public Storage {
             fd_safehandle  _fd ;
 
             const bool     _is_checkpoint ;
+            const bool     _dsync ;
+            uint16_t       _format_version ;
             bool           _crc32_mode ;
             FileState      _state ;
             FormatError    _corruption ;
@@ -540,20 +655,61 @@ class _PCOMNEXP MMapStorage : public Storage {
             template<typename S>
             SegmentFile(int dirfd, const S &filename,
                         int64_t segid, generation_t generation,
-                        enable_if_strchar_t<S, char, unsigned> mask) :
-
-               ancestor(dirfd, str::cstr(filename), segid, generation, mask, false)
+                        enable_if_strchar_t<S, char, unsigned> mask, int oflags = 0,
+                        uint16_t format_version = FORMAT_VERSION) :
+
+               ancestor(dirfd, str::cstr(filename), segid, generation, mask, false, oflags,
+                        format_version),
+               _mappos(0),
+               _readahead_end(0),
+               _unmappable(false)
             {}
 
             /// Create a read-only CheckpointFile object from a file descriptor open in
             /// read mode.
             explicit SegmentFile(int fd) :
-               ancestor(fd, false)
+               ancestor(fd, false),
+               _mappos(0),
+               _readahead_end(0),
+               _unmappable(false)
             {}
 
             bool commit() ;
 
             int64_t this_segment() const { return next_segment() - 1 ; }
+
+            /// Map the readable segment into memory for reading from the current file
+            /// position on.
+            ///
+            /// After the segment is mapped, records should be read with read_mapped()
+            /// and mapped_data() instead of readv().
+            /// @return true if the segment is mapped; false if there is no data to read
+            /// or the mapping failed (then it is not retried), in which case the segment
+            /// remains readable by readv().
+            bool map_data() ;
+
+            bool is_mapped() const { return !!_mapping.data() ; }
+
+            /// Copy data from the mapping into @a begin..@a end buffers and advance
+            /// the read position; much like readv(), may read less than requested
+            /// at the end of the segment.
+            size_t read_mapped(const iovec_t *begin, const iovec_t *end) ;
+
+            template<size_t n>
+            size_t read_mapped(const iovec_t (&vec)[n]) { return read_mapped(vec + 0, vec + n) ; }
+
+            /// Get a pointer to @a size bytes at the read position inside the mapping and
+            /// advance the position.
+            /// @return NULL if there are less than @a size bytes left in the segment.
+            const char *mapped_data(size_t size) ;
+
+         private:
+            PMemMapping _mapping ;
+            size_t      _mappos ;         /* Read position inside _mapping */
+            size_t      _readahead_end ;  /* End of the range read ahead with MADV_WILLNEED */
+            bool        _unmappable ;     /* Mapping attempt failed, don't retry */
+
+            void advance_mapped(size_t size) ;
       } ;
 
    protected:
@@ -565,6 +721,7 @@ class _PCOMNEXP MMapStorage : public Storage {
       std::pair<binary_obufstream *, generation_t> do_create_checkpoint() ;
       void do_close_checkpoint(bool commit) ;
       size_t do_append_record(const iovec_t *begin, const iovec_t *end) ;
+      void do_complete_append() ;
       /// Close the storage.
       ///
       /// If the storage is readable, closes all open segments
@@ -600,6 +757,29 @@ class _PCOMNEXP MMapStorage : public Storage {
 
       const bool           _nobakseg ; /* Don't backup existing segment files,
                                         * overwrite */
+      const bool           _mmap_replay ; /* Read segments through memory mapping */
+
+      Durability           _durability ;
+      std::chrono::milliseconds _sync_interval ;
+      std::chrono::steady_clock::time_point _last_sync ;
+      size_t               _segment_prealloc ; /* Disk space to reserve for new segments */
+
+      /* Group commit state; everything below _batch_lock is protected by it, except
+       * for _writebuf, which is accessed only by the batch writer (_writing==true) */
+      bool                    _group_commit ;
+      GroupCommit             _gcparams ;
+
+      std::mutex              _batch_lock ;
+      std::condition_variable _batch_full ;  /* Notified when the pending batch has
+                                              * reached _gcparams.max_size */
+      std::condition_variable _batch_done ;  /* Notified when a batch is written */
+      std::vector<char>       _batch ;       /* Pending records */
+      std::vector<char>       _writebuf ;    /* The batch being written */
+      unsigned                _batch_ops ;   /* Count of records in _batch */
+      uint64_t                _enqueued ;    /* Total count of records put into batches */
+      uint64_t                _committed ;   /* Total count of written records */
+      std::exception_ptr      _batch_error ; /* Sticky: set if writing a batch failed */
+      bool                    _writing ;     /* Some thread is writing a batch */
 
    private:
       enum CreateStage {
@@ -640,6 +820,18 @@ class _PCOMNEXP MMapStorage : public Storage {
       // Should be called from under the lock
       generation_t current_generation() const { return _lastgen ; }
 
+      // Write the pending batch, if any, and wait until there are no batches being
+      // written. Call from under the storage writer lock before switching segments.
+      void flush_batch() ;
+
+      // Sync the active segment according to the durability policy; call after every
+      // record or batch written to the segment, only from the (single) segment writer
+      void sync_segment() ;
+
+      // Take the pending batch and write it to the active segment; call with locked
+      // _batch_lock by the batch writer, i.e. with _writing set
+      void write_batch(std::unique_lock<std::mutex> &batch_lock) ;
+
       static strslice ensure_name_form_path(const strslice &path) ;
 
       static const char *ensure_journal_name(const char *name)
@@ -68,6 +68,28 @@ inline uint32_t calc_crc32v(uint32_t init_crc, const iovec_t *begin, const iovec
    return init_crc ;
 }
 
+inline bool is_valid_format_version(unsigned format_version)
+{
+   return format_version == FORMAT_VERSION || format_version == FORMAT_VERSION_CRC32C ;
+}
+
+/// Checksum function of operation records: calc_crc32 or calc_crc32c.
+typedef uint32_t (*record_crc_function)(uint32_t, const void *, size_t) ;
+
+/// Get the operation record checksum function for a journal format version.
+inline record_crc_function record_crc(unsigned format_version)
+{
+   return format_version == FORMAT_VERSION_CRC32C ? ::calc_crc32c : ::calc_crc32 ;
+}
+
+inline uint32_t calc_record_crcv(record_crc_function crc, uint32_t init_crc,
+                                 const iovec_t *begin, const iovec_t *end)
+{
+   for (; begin != end ; ++begin)
+      init_crc = crc(init_crc, begin->iov_base, begin->iov_len) ;
+   return init_crc ;
+}
+
 /******************************************************************************/
 /** On-disk structure of the both checkpoint and segment header.
 
@@ -140,7 +162,8 @@ struct OperationHeader {
 struct OperationTail {
       uint32_le data_size ;   /**< Same as OperationHeader::data_size (must match) */
 
-      uint32_le crc32 ;       /**< Operation CRC32 (includes the operation header) */
+      uint32_le crc32 ;       /**< Operation CRC32 (includes the operation header);
+                                 CRC32C in FORMAT_VERSION_CRC32C segments */
 } ;
 
 /*******************************************************************************
@@ -273,7 +296,7 @@ inline typename if_not_integer<I>::type &dtoh(I &value)
 #define PCOMN_CHECK_VERSION_SANITY_HTOD(type, var)                      \
 {                                                                       \
    pcomn::conditional_throw<std::logic_error>                           \
-      ((var).format_version != FORMAT_VERSION, "Invalid"  #type "::format_version") ; \
+      (!is_valid_format_version((var).format_version), "Invalid"  #type "::format_version") ; \
    pcomn::conditional_throw<std::logic_error>                           \
       ((var).flags, "Nonzero " #type "::flags") ;                      \
 }
@@ -334,7 +357,7 @@ inline FileHeader &dtoh(FileHeader &header)
 inline FileHeader &check_sanity(FileHeader &header)
 {
    pcomn::conditional_throw<format_error>
-      (header.format_version != FORMAT_VERSION,
+      (!is_valid_format_version(header.format_version),
        "Invalid journal format version", ERR_CORRUPT, FMTERR_VERSION_MISMATCH) ;
 
    pcomn::conditional_throw<format_error>
@@ -0,0 +1,156 @@
+/*-*- tab-width:3; indent-tabs-mode:nil; c-file-style:"ellemtel"; c-file-offsets:((innamespace . 0)(inclass . ++)) -*-*/
+/*******************************************************************************
+ FILE         :   benchmark_journal.cpp
+ COPYRIGHT    :   Yakov Markovitch, 2026. All rights reserved.
+                  See LICENSE for information on usage/redistribution.
+
+ DESCRIPTION  :   Journal append throughput benchmark for MMapStorage durability
+                  policies, with and without group commit.
+
+ PROGRAMMED BY:   Yakov Markovitch
+ CREATION DATE:   16 Oct 2026
+*******************************************************************************/
+#include "test_journal.h"
+
+#include <pcomn_journal/journmmap.h>
+
+#include <pcomn_stopwatch.h>
+#include <pcomn_except.h>
+#include <pcomn_unistd.h>
+
+#include <iostream>
+#include <iomanip>
+#include <thread>
+#include <vector>
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <dirent.h>
+
+using namespace pcomn ;
+
+typedef pj::MMapStorage Storage ;
+
+static void usage(const char *progname)
+{
+   std::cerr << "Usage: " << progname << " DIR [ops [threads [value_size]]]\n"
+      "Measure journal append throughput for every MMapStorage durability policy.\n"
+      "Journals are created (and then removed) in subdirectories of existing DIR.\n" ;
+   exit(1) ;
+}
+
+static void remove_dir(const std::string &dirname)
+{
+   if (DIR * const dir = opendir(dirname.c_str()))
+   {
+      for (struct dirent *entry ; (entry = readdir(dir)) != NULL ;)
+         if (*entry->d_name != '.')
+            unlink((dirname + '/' + entry->d_name).c_str()) ;
+      closedir(dir) ;
+   }
+   rmdir(dirname.c_str()) ;
+}
+
+static void run_bench(const std::string &dir, Storage::Durability durability, bool group,
+                      unsigned ops, unsigned threads, size_t value_size)
+{
+   char name[64] ;
+   sprintf(name, "/bench%d%c", (int)durability, group ? 'g' : 'p') ;
+   const std::string journal_dir (dir + name) ;
+
+   remove_dir(journal_dir) ;
+   PCOMN_ENSURE_POSIX(mkdir(journal_dir.c_str(), 0777), "mkdir") ;
+
+   double elapsed ;
+   {
+      JournallableStringMap map ;
+      Storage * const storage = new Storage(journal_dir + "/bench", "",
+                                            durability == Storage::DUR_DSYNC ? Storage::OF_DSYNC : 0) ;
+      pj::Port port (storage) ;
+
+      storage->set_durability(durability, std::chrono::milliseconds(10)) ;
+      storage->set_segment_prealloc(64*MiB) ;
+      if (group)
+      {
+         // No batch latency: a batch is whatever has been appended while the previous
+         // batch was being written
+         Storage::GroupCommit params ;
+         params.max_size = 256*KiB ;
+         storage->set_group_commit(params) ;
+      }
+      map.set_journal(&port) ;
+
+      const std::string value (value_size, 'x') ;
+      const unsigned per_thread = ops/threads ;
+
+      PRealStopwatch stopwatch ;
+      stopwatch.start() ;
+
+      std::vector<std::thread> appliers ;
+      for (unsigned t = 0 ; t < threads ; ++t)
+         appliers.emplace_back([&map, &value, t, per_thread]
+         {
+            char key[32] ;
+            for (unsigned i = 0 ; i < per_thread ; ++i)
+            {
+               sprintf(key, "%u.%u", t, i % 1024) ;
+               map.insert(key, value) ;
+            }
+         }) ;
+      for (std::thread &t: appliers)
+         t.join() ;
+
+      stopwatch.stop() ;
+      elapsed = stopwatch.elapsed() ;
+
+      map.set_journal(NULL) ;
+   }
+   remove_dir(journal_dir) ;
+
+   std::cout << std::setw(14) << ops/elapsed << std::flush ;
+}
+
+int main(int argc, char *argv[])
+{
+   if (!inrange(argc, 2, 5))
+      usage(*argv) ;
+
+   const std::string dir (argv[1]) ;
+   const long ops        = argc > 2 ? atol(argv[2]) : 20000 ;
+   const long threads    = argc > 3 ? atol(argv[3]) : 4 ;
+   const long value_size = argc > 4 ? atol(argv[4]) : 64 ;
+
+   if (ops <= 0 || threads <= 0 || value_size < 0)
+      usage(*argv) ;
+
+   static const std::pair<Storage::Durability, const char *> policies[] =
+   {
+      { Storage::DUR_NONE,     "none" },
+      { Storage::DUR_SYNC,     "sync" },
+      { Storage::DUR_INTERVAL, "interval(10ms)" },
+      { Storage::DUR_DSYNC,    "dsync" }
+   } ;
+
+   try {
+      std::cout << ops << " operations, " << threads << " threads, "
+                << value_size << " bytes values\n\n"
+                << std::setw(16) << "durability"
+                << std::setw(14) << "plain ops/s"
+                << std::setw(14) << "group ops/s" << std::endl ;
+
+      std::cout << std::fixed << std::setprecision(0) ;
+      for (const auto &policy: policies)
+      {
+         std::cout << std::setw(16) << policy.second ;
+         run_bench(dir, policy.first, false, ops, threads, value_size) ;
+         run_bench(dir, policy.first, true, ops, threads, value_size) ;
+         std::cout << std::endl ;
+      }
+   }
+   catch (const std::exception &x)
+   {
+      std::cerr << STDEXCEPTOUT(x) << std::endl ;
+      return 1 ;
+   }
+   return 0 ;
+}
@@ -86,18 +86,39 @@ class JournallableStringMap : public pj::Journallable {
       JournallableStringMap()
       {}
 
-      explicit JournallableStringMap(const string_map &initval) :
-         _data(initval)
-      {}
+      explicit JournallableStringMap(const string_map &initval)
+      {
+         assign(initval.begin(), initval.end()) ;
+      }
 
       template<typename InputIterator>
-      JournallableStringMap(InputIterator begin, InputIterator end) :
-         _data(begin, end)
-      {}
+      JournallableStringMap(InputIterator begin, InputIterator end)
+      {
+         assign(begin, end) ;
+      }
 
-      string_map data() const { return _data ; }
+      string_map data() const
+      {
+         string_map result ;
+         for (const string_map &shard: _data)
+            result.insert(shard.begin(), shard.end()) ;
+         return result ;
+      }
 
-      size_t size() const { return _data.size() ; }
+      size_t size() const
+      {
+         size_t result = 0 ;
+         for (const string_map &shard: _data)
+            result += shard.size() ;
+         return result ;
+      }
+
+      /// Operations on different shards modify different maps, so they may be applied
+      /// concurrently without locking while replaying a journal in parallel.
+      static uint64_t shard_ndx(const std::string &key)
+      {
+         return std::hash<std::string>()(key) % SHARDS ;
+      }
 
       JournallableStringMap &insert(const std::string &key, const std::string &value) ;
 
@@ -172,13 +193,15 @@ class JournallableStringMap : public pj::Journallable {
 
          check_exception(S_RESTORE_CHECKPOINT) ;
 
-         string_map restored ;
+         string_map restored[SHARDS] ;
          for (std::string key, value ; !(key = pcomn::readline(checkpoint)).empty() ; )
          {
             value = pcomn::readline(checkpoint) ;
-            pcomn_swap(restored[strip_lf(key)], strip_lf(value)) ;
+            strip_lf(key) ;
+            pcomn_swap(restored[shard_ndx(key)][key], strip_lf(value)) ;
          }
-         pcomn_swap(_data, restored) ;
+         for (unsigned i = 0 ; i < SHARDS ; ++i)
+            pcomn_swap(_data[i], restored[i]) ;
          TRACEPX(PCOMN_Test, DBGL_ALWAYS, "Checkpoint of " << *this << " restored OK") ;
       }
 
@@ -191,7 +214,7 @@ class JournallableStringMap : public pj::Journallable {
          {
             guard lock (_mutex) ;
             NOXCHECK(_snapshot.empty()) ;
-            _snapshot = _data ;
+            _snapshot = data() ;
          }
          TRACEPX(PCOMN_Test, DBGL_ALWAYS, "Checkpoint of " << *this << " started") ;
       }
@@ -237,14 +260,25 @@ class JournallableStringMap : public pj::Journallable {
       }
 
    private:
+      static const unsigned SHARDS = 16 ;
+
       std::mutex  _mutex ;
-      string_map  _data ;
+      string_map  _data[SHARDS] ;
       string_map  _snapshot ;
 
       mutable pcomn::PTSafePtr<AbstractExceptionContainer> _exception ;
       Stage                                        _xstage ; /* Where to throw exception */
 
       typedef std::lock_guard<std::mutex> guard ;
+
+      string_map &shard(const std::string &key) { return _data[shard_ndx(key)] ; }
+
+      template<typename InputIterator>
+      void assign(InputIterator begin, InputIterator end)
+      {
+         for (; begin != end ; ++begin)
+            shard(begin->first).insert(*begin) ;
+      }
 } ;
 
 const pj::magic_t JournallableStringMap::MAGIC = {{ '@', 'J', 'S', '_', 'm', 'a', 'p', '\0' }} ;
@@ -272,15 +306,17 @@ template<> class StringMapOp<SM_OP_ADD> : public pj::TargetOperation<Journallabl
          PCOMN_VERIFY((pcomn::one_of<1, 2>::is(opversion))) ;
       }
 
+      uint64_t partition_key() const { return JournallableStringMap::shard_ndx(_key) ; }
+
    protected:
       void do_apply(JournallableStringMap &target) const
       {
          switch (version())
          {
-            case 1: target._data[_key] = _data ;
+            case 1: target.shard(_key)[_key] = _data ;
                break ;
 
-            case 2: target._data[_key] =
+            case 2: target.shard(_key)[_key] =
                pcomn::str::to_upper(_key).append(1, '-').append(pcomn::str::to_upper(_key)) ;
                break ;
 
@@ -338,10 +374,12 @@ template<> class StringMapOp<SM_OP_DEL> : public pj::TargetOperation<Journallabl
          PCOMN_VERIFY(opversion = 1) ;
       }
 
+      uint64_t partition_key() const { return JournallableStringMap::shard_ndx(_key) ; }
+
    protected:
       void do_apply(JournallableStringMap &target) const
       {
-         target._data.erase(_key) ;
+         target.shard(_key).erase(_key) ;
       }
       void do_save(pcomn::binary_obufstream &os) const
       {
@@ -368,7 +406,8 @@ class StringMapOp<SM_OP_CLR> : public pj::TargetOperation<JournallableStringMap,
   protected:
       void do_apply(JournallableStringMap &target) const
       {
-         target._data.clear() ;
+         for (JournallableStringMap::string_map &shard: target._data)
+            shard.clear() ;
       }
 } ;
 
@@ -19,6 +19,8 @@
 #include <pcomn_path.h>
 
 #include <memory>
+#include <thread>
+#include <vector>
 
 namespace pj = pcomn::jrn ;
 
@@ -42,6 +44,11 @@ class JournalTests : public JournalFixture {
       void Test_Journal_Open_Segment_Corrupt() ;
       void Test_Journal_Open_Read_Write() ;
       void Test_Journal_Op_Version() ;
+      void Test_Journal_Group_Commit() ;
+      void Test_Journal_Durability() ;
+      void Test_Journal_Parallel_Replay() ;
+      void Test_Journal_Mmap_Replay() ;
+      void Test_Journal_CRC32C_Format() ;
 
       CPPUNIT_TEST_SUITE(JournalTests) ;
 
@@ -58,6 +65,11 @@ class JournalTests : public JournalFixture {
       CPPUNIT_TEST(Test_Journal_Open_Segment_Corrupt) ;
       CPPUNIT_TEST(Test_Journal_Open_Read_Write) ;
       CPPUNIT_TEST(Test_Journal_Op_Version) ;
+      CPPUNIT_TEST(Test_Journal_Group_Commit) ;
+      CPPUNIT_TEST(Test_Journal_Durability) ;
+      CPPUNIT_TEST(Test_Journal_Parallel_Replay) ;
+      CPPUNIT_TEST(Test_Journal_Mmap_Replay) ;
+      CPPUNIT_TEST(Test_Journal_CRC32C_Format) ;
 
       CPPUNIT_TEST_SUITE_END() ;
 
@@ -633,6 +645,326 @@ void JournalTests::Test_Journal_Op_Version()
                         )) ;
 }
 
+void JournalTests::Test_Journal_Group_Commit()
+{
+   const std::string &JournalPath = journalPath("grouptest") ;
+   const unsigned ThreadCount = 4 ;
+   const unsigned OpsPerThread = 300 ;
+
+   JournallableStringMap Map ;
+   {
+      std::unique_ptr<pj::Port> PortP ;
+      pj::MMapStorage *Storage ;
+
+      CPPUNIT_LOG_RUN(Storage = new pj::MMapStorage(JournalPath, "")) ;
+      CPPUNIT_LOG_RUN(PortP.reset(new pj::Port(Storage))) ;
+
+      pj::MMapStorage::GroupCommit params ;
+      params.max_latency = std::chrono::microseconds(200) ;
+      params.max_size = 4096 ;
+
+      CPPUNIT_LOG_IS_FALSE(Storage->is_group_commit()) ;
+      CPPUNIT_LOG_RUN(Storage->set_group_commit(params)) ;
+      CPPUNIT_LOG_ASSERT(Storage->is_group_commit()) ;
+      CPPUNIT_LOG_EQUAL(Storage->group_commit().max_size, (size_t)4096) ;
+      CPPUNIT_LOG_RUN(Storage->set_durability(pj::MMapStorage::DUR_SYNC)) ;
+
+      CPPUNIT_LOG_IS_NULL(Map.set_journal(PortP.get())) ;
+      CPPUNIT_LOG(std::endl) ;
+
+      std::vector<std::thread> appliers ;
+      for (unsigned t = 0 ; t < ThreadCount ; ++t)
+         appliers.emplace_back([&Map, t]
+         {
+            char key[32] ;
+            for (unsigned i = 0 ; i < OpsPerThread ; ++i)
+            {
+               sprintf(key, "%u.%u", t, i) ;
+               Map.insert(key, std::string(i % 64, 'a' + t)) ;
+            }
+         }) ;
+
+      // Take a checkpoint while appliers are running: pending batches must go to the
+      // segment that is being committed
+      CPPUNIT_LOG_RUN(Map.take_checkpoint()) ;
+
+      for (std::thread &t: appliers)
+         t.join() ;
+
+      CPPUNIT_LOG_EQUAL(Map.size(), (size_t)ThreadCount*OpsPerThread) ;
+      CPPUNIT_LOG_EQUAL(Map.erase("0.0").size(), (size_t)ThreadCount*OpsPerThread - 1) ;
+
+      CPPUNIT_LOG_RUN(Storage->reset_group_commit()) ;
+      CPPUNIT_LOG_IS_FALSE(Storage->is_group_commit()) ;
+      CPPUNIT_LOG_EQUAL(Map.insert("foo", "bar").size(), (size_t)ThreadCount*OpsPerThread) ;
+   }
+
+   std::unique_ptr<pj::Port> PortP ;
+   CPPUNIT_LOG_RUN(PortP.reset(new pj::Port(new pj::MMapStorage(JournalPath, pj::MD_RDONLY)))) ;
+
+   JournallableStringMap RestoredMap ;
+
+   CPPUNIT_LOG_RUN(RestoredMap.restore_from(*PortP, false)) ;
+   CPPUNIT_LOG_EQUAL(RestoredMap.size(), (size_t)ThreadCount*OpsPerThread) ;
+   CPPUNIT_LOG_ASSERT(RestoredMap.data() == Map.data()) ;
+}
+
+void JournalTests::Test_Journal_Durability()
+{
+   typedef pj::MMapStorage S ;
+   const std::string &JournalPath = journalPath("durtest") ;
+   const size_t Prealloc = 256*1024 ;
+
+   JournallableStringMap Map ;
+   {
+      std::unique_ptr<pj::Port> PortP ;
+      S *Storage ;
+
+      CPPUNIT_LOG_RUN(Storage = new S(JournalPath, "", S::OF_DSYNC)) ;
+      CPPUNIT_LOG_RUN(PortP.reset(new pj::Port(Storage))) ;
+      CPPUNIT_LOG_EQUAL(Storage->durability(), S::DUR_DSYNC) ;
+      CPPUNIT_LOG_EQUAL(Storage->segment_prealloc(), (size_t)0) ;
+
+      CPPUNIT_LOG_RUN(Storage->set_segment_prealloc(Prealloc)) ;
+      CPPUNIT_LOG_EQUAL(Storage->segment_prealloc(), Prealloc) ;
+
+      CPPUNIT_LOG_IS_NULL(Map.set_journal(PortP.get())) ;
+      CPPUNIT_LOG(std::endl) ;
+
+      CPPUNIT_LOG_EQUAL(Map.insert("dsync", "1").insert("dsync", "2").size(), (size_t)1) ;
+
+      CPPUNIT_LOG_RUN(Storage->set_durability(S::DUR_SYNC)) ;
+      CPPUNIT_LOG_EQUAL(Storage->durability(), S::DUR_SYNC) ;
+      CPPUNIT_LOG_EQUAL(Map.insert("sync", "1").insert("sync", "2").size(), (size_t)2) ;
+
+      CPPUNIT_LOG_RUN(Storage->set_durability(S::DUR_INTERVAL, std::chrono::milliseconds(50))) ;
+      CPPUNIT_LOG_EQUAL(Storage->durability(), S::DUR_INTERVAL) ;
+      CPPUNIT_LOG_EQUAL(Storage->sync_interval().count(), 50) ;
+      CPPUNIT_LOG_EQUAL(Map.insert("interval", "1").insert("interval", "2").size(), (size_t)3) ;
+
+      // The new segment is preallocated, but its size is still the size of its data
+      CPPUNIT_LOG_RUN(Map.take_checkpoint()) ;
+      CPPUNIT_LOG_EQUAL(Map.insert("after", "checkpoint").size(), (size_t)4) ;
+
+      const std::set<std::string> &files = ls(dataDir()) ;
+      unsigned segments = 0 ;
+      for (const std::string &file: files)
+         if (S::parse_filename(file) == S::NK_SEGMENT)
+         {
+            ++segments ;
+            CPPUNIT_LOG_ASSERT((size_t)filestat(journalPath(file)).st_size < Prealloc) ;
+         }
+      CPPUNIT_LOG_ASSERT(segments) ;
+
+      CPPUNIT_LOG_RUN(Storage->set_durability(S::DUR_NONE)) ;
+      CPPUNIT_LOG_EQUAL(Map.erase("dsync").size(), (size_t)3) ;
+   }
+
+   std::unique_ptr<pj::Port> PortP ;
+   CPPUNIT_LOG_RUN(PortP.reset(new pj::Port(new S(JournalPath, pj::MD_RDONLY)))) ;
+
+   JournallableStringMap RestoredMap ;
+
+   CPPUNIT_LOG_RUN(RestoredMap.restore_from(*PortP, false)) ;
+   CPPUNIT_LOG_EQUAL(RestoredMap.data(),
+                     CPPUNIT_STRMAP(std::string,
+                                    (std::make_pair("after", "checkpoint"))
+                                    (std::make_pair("interval", "2"))
+                                    (std::make_pair("sync", "2")))) ;
+}
+
+void JournalTests::Test_Journal_Parallel_Replay()
+{
+   const std::string &JournalPath = journalPath("replaytest") ;
+
+   JournallableStringMap Map ;
+   {
+      std::unique_ptr<pj::Port> PortP ;
+      CPPUNIT_LOG_RUN(PortP.reset(new pj::Port(new pj::MMapStorage(JournalPath, "")))) ;
+      CPPUNIT_LOG_IS_NULL(Map.set_journal(PortP.get())) ;
+      CPPUNIT_LOG(std::endl) ;
+
+      // More than a replay batch of operations; every key is overwritten and some keys
+      // are erased, so the result depends on the order of operations on the same key.
+      // CLR (which has no partition key) must be applied between its neighbours.
+      char key[32] ;
+      for (unsigned pass = 0 ; pass < 3 ; ++pass)
+      {
+         if (pass == 2)
+            CPPUNIT_LOG_EQUAL(Map.clear().size(), (size_t)0) ;
+
+         for (unsigned i = 0 ; i < 3000 ; ++i)
+         {
+            sprintf(key, "key%u", i % 1000) ;
+            Map.insert(key, std::to_string(pass*10000 + i)) ;
+            if (i % 7 == pass)
+               Map.erase(key) ;
+         }
+      }
+      CPPUNIT_LOG_ASSERT(Map.size() > 500) ;
+      CPPUNIT_LOG_ASSERT(Map.size() < 1000) ;
+   }
+
+   for (unsigned threads: {1, 2, 4, 0})
+   {
+      std::unique_ptr<pj::Port> PortP ;
+      CPPUNIT_LOG_RUN(PortP.reset(new pj::Port(new pj::MMapStorage(JournalPath, pj::MD_RDONLY)))) ;
+
+      JournallableStringMap RestoredMap ;
+
+      CPPUNIT_LOG_RUN(RestoredMap.restore_from(*PortP, false, threads)) ;
+      CPPUNIT_LOG_EQUAL(RestoredMap.changecount(), (uint64_t)Map.changecount()) ;
+      CPPUNIT_LOG_EQUAL(RestoredMap.size(), Map.size()) ;
+      CPPUNIT_LOG_ASSERT(RestoredMap.data() == Map.data()) ;
+   }
+}
+
+void JournalTests::Test_Journal_Mmap_Replay()
+{
+   typedef pj::MMapStorage S ;
+   const std::string &JournalPath = journalPath("mmaptest") ;
+
+   JournallableStringMap Map ;
+   {
+      std::unique_ptr<pj::Port> PortP ;
+      CPPUNIT_LOG_RUN(PortP.reset(new pj::Port(new S(JournalPath, "")))) ;
+      CPPUNIT_LOG_IS_NULL(Map.set_journal(PortP.get())) ;
+      CPPUNIT_LOG(std::endl) ;
+
+      // Both small values and values that don't fit into a stack buffer
+      char key[32] ;
+      for (unsigned i = 0 ; i < 2000 ; ++i)
+      {
+         sprintf(key, "key%u", i % 500) ;
+         Map.insert(key, std::string(i * 37 % 9000, 'a' + i % 26)) ;
+      }
+      CPPUNIT_LOG_RUN(Map.set_journal(NULL)) ;
+   }
+
+   // Append a new segment on every reopening
+   for (unsigned pass = 0 ; pass < 2 ; ++pass)
+   {
+      std::unique_ptr<pj::Port> PortP ;
+      CPPUNIT_LOG_RUN(PortP.reset(new pj::Port(new S(JournalPath, pj::MD_RDWR, S::OF_MMAPREPLAY)))) ;
+
+      JournallableStringMap RestoredMap ;
+      CPPUNIT_LOG_RUN(RestoredMap.restore_from(*PortP, true)) ;
+      CPPUNIT_LOG_ASSERT(RestoredMap.data() == Map.data()) ;
+
+      char key[32] ;
+      for (unsigned i = 0 ; i < 1000 ; ++i)
+      {
+         sprintf(key, "pass%u.%u", pass, i % 300) ;
+         RestoredMap.insert(key, std::to_string(i)) ;
+         Map.insert(key, std::to_string(i)) ;
+         if (i % 5 == pass)
+         {
+            RestoredMap.erase(key) ;
+            Map.erase(key) ;
+         }
+      }
+      CPPUNIT_LOG_RUN(RestoredMap.set_journal(NULL)) ;
+   }
+
+   for (unsigned threads: {1, 4})
+   {
+      std::unique_ptr<pj::Port> PortP ;
+      S *Storage ;
+      CPPUNIT_LOG_RUN(PortP.reset(new pj::Port(Storage = new S(JournalPath, pj::MD_RDONLY, S::OF_MMAPREPLAY)))) ;
+      CPPUNIT_LOG_ASSERT(Storage->mmap_replay()) ;
+
+      JournallableStringMap RestoredMap ;
+
+      CPPUNIT_LOG_RUN(RestoredMap.restore_from(*PortP, false, threads)) ;
+      CPPUNIT_LOG_EQUAL(RestoredMap.changecount(), (uint64_t)Map.changecount()) ;
+      CPPUNIT_LOG_ASSERT(RestoredMap.data() == Map.data()) ;
+   }
+
+   // Cut the last record of the last segment: both read modes must stop at the same
+   // record
+   std::string lastseg ;
+   for (const std::string &file: ls(dataDir()))
+      if (S::parse_filename(file) == S::NK_SEGMENT && file.compare(0, 9, "mmaptest.") == 0)
+         lastseg = std::max(lastseg, file) ;
+   CPPUNIT_LOG_EQUAL(lastseg, std::string("mmaptest.2.pseg")) ;
+   CPPUNIT_LOG_RUN(PCOMN_ENSURE_POSIX(truncate(journalPath(lastseg).c_str(),
+                                               filestat(journalPath(lastseg)).st_size - 13), "truncate")) ;
+
+   JournallableStringMap ReadMap ;
+   JournallableStringMap MappedMap ;
+   {
+      pj::Port Port (new S(JournalPath, pj::MD_RDONLY)) ;
+      CPPUNIT_LOG_RUN(ReadMap.restore_from(Port, false)) ;
+   }
+   {
+      pj::Port Port (new S(JournalPath, pj::MD_RDONLY, S::OF_MMAPREPLAY)) ;
+      CPPUNIT_LOG_RUN(MappedMap.restore_from(Port, false)) ;
+   }
+   CPPUNIT_LOG_EQUAL(MappedMap.changecount(), Map.changecount() - 1) ;
+   CPPUNIT_LOG_EQUAL(MappedMap.changecount(), ReadMap.changecount()) ;
+   CPPUNIT_LOG_ASSERT(MappedMap.data() == ReadMap.data()) ;
+}
+
+void JournalTests::Test_Journal_CRC32C_Format()
+{
+   typedef pj::MMapStorage S ;
+   const std::string &JournalPath = journalPath("crctest") ;
+
+   const auto file_format = [&](const std::string &filename)
+   {
+      pcomn::fd_safehandle fd (PCOMN_ENSURE_POSIX(open(journalPath(filename).c_str(), O_RDONLY), "open")) ;
+      pj::header_buffer<pj::FileHeader> header ;
+      CPPUNIT_LOG_ASSERT(S::file_kind(fd, NULL, &header) != S::KIND_UNKNOWN) ;
+      return (unsigned)header.format_version ;
+   } ;
+
+   JournallableStringMap Map ;
+   {
+      std::unique_ptr<pj::Port> PortP ;
+      S *Storage ;
+      CPPUNIT_LOG_RUN(PortP.reset(new pj::Port(Storage = new S(JournalPath, "", S::OF_CRC32C)))) ;
+      CPPUNIT_LOG_EQUAL(Storage->record_format(), pj::FORMAT_VERSION_CRC32C) ;
+      CPPUNIT_LOG_IS_NULL(Map.set_journal(PortP.get())) ;
+      CPPUNIT_LOG(std::endl) ;
+
+      for (unsigned i = 0 ; i < 200 ; ++i)
+         Map.insert(std::to_string(i % 50), std::string(i, 'a' + i % 26)) ;
+      CPPUNIT_LOG_EQUAL(Map.clear().size(), (size_t)0) ;
+      CPPUNIT_LOG_EQUAL(Map.insert("Hello", "world").size(), (size_t)1) ;
+      CPPUNIT_LOG_RUN(Map.set_journal(NULL)) ;
+   }
+
+   // Reopen without OF_CRC32C: old segments remain CRC32C, the new one is CRC32
+   {
+      std::unique_ptr<pj::Port> PortP ;
+      S *Storage ;
+      CPPUNIT_LOG_RUN(PortP.reset(new pj::Port(Storage = new S(JournalPath, pj::MD_RDWR)))) ;
+      CPPUNIT_LOG_EQUAL(Storage->record_format(), pj::FORMAT_VERSION) ;
+
+      JournallableStringMap RestoredMap ;
+      CPPUNIT_LOG_RUN(RestoredMap.restore_from(*PortP, true)) ;
+      CPPUNIT_LOG_ASSERT(RestoredMap.data() == Map.data()) ;
+      CPPUNIT_LOG_EQUAL(RestoredMap.insert("Bye", "baby").size(), (size_t)2) ;
+      CPPUNIT_LOG_RUN(RestoredMap.set_journal(NULL)) ;
+      CPPUNIT_LOG_RUN(Map.insert("Bye", "baby")) ;
+   }
+
+   CPPUNIT_LOG_EQUAL(file_format("crctest.pchkp"), (unsigned)pj::FORMAT_VERSION) ;
+   CPPUNIT_LOG_EQUAL(file_format("crctest.0.pseg"), (unsigned)pj::FORMAT_VERSION_CRC32C) ;
+   CPPUNIT_LOG_EQUAL(file_format("crctest.1.pseg"), (unsigned)pj::FORMAT_VERSION) ;
+
+   for (unsigned flags: {0u, (unsigned)S::OF_MMAPREPLAY})
+   {
+      std::unique_ptr<pj::Port> PortP ;
+      CPPUNIT_LOG_RUN(PortP.reset(new pj::Port(new S(JournalPath, pj::MD_RDONLY, flags)))) ;
+
+      JournallableStringMap RestoredMap ;
+      CPPUNIT_LOG_RUN(RestoredMap.restore_from(*PortP, false)) ;
+      CPPUNIT_LOG_EQUAL(RestoredMap.changecount(), Map.changecount()) ;
+      CPPUNIT_LOG_ASSERT(RestoredMap.data() == Map.data()) ;
+   }
+}
+
 int main(int argc, char *argv[])
 {
    pcomn::unit::TestRunner runner ;
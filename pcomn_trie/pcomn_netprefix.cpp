@@ -11,7 +11,18 @@
 #include "pcomn_netprefix.h"
 #include "pcomn_calgorithm.h"
 
+#include <pcomn_handle.h>
+#include <pcomn_file.h>
+#include <pcomn_path.h>
+#include <pcomn_except.h>
+
 #include <numeric>
+#include <string>
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
 
 namespace pcomn {
 
@@ -20,6 +31,12 @@ namespace pcomn {
 *******************************************************************************/
 static constexpr size_t trie_maxdepth = (256+5)/6 ;
 
+constexpr unsigned shortest_netprefix_set::lookup_batch ;
+
+constexpr uint16_t shortest_netprefix_set::file_version ;
+constexpr magic64  shortest_netprefix_set::file_magic ;
+constexpr uint32_t shortest_netprefix_set::byte_order_mark ;
+
 const shortest_netprefix_set::node_type shortest_netprefix_set::_nomatch_root ;
 const shortest_netprefix_set::node_type shortest_netprefix_set::_anymatch_root (~uint64_t()) ;
 
@@ -43,6 +60,7 @@ shortest_netprefix_set::shortest_netprefix_set(std::true_type, std::vector<Subne
 
 shortest_netprefix_set::shortest_netprefix_set(shortest_netprefix_set &&other) :
     _nodes(std::move(other._nodes)),
+    _mapping(std::move(other._mapping)),
     _depth(other._depth),
     _root(other._root)
 {
@@ -50,6 +68,91 @@ shortest_netprefix_set::shortest_netprefix_set(shortest_netprefix_set &&other) :
     other._depth = 0 ;
 }
 
+shortest_netprefix_set::shortest_netprefix_set(PMemMapping &&mapping, unsigned addr_bits)
+{
+    static const char invalid_file[] = "Invalid compiled network prefix trie file" ;
+
+    const size_t size = mapping.size() ;
+    ensure<std::invalid_argument>(size >= sizeof(file_header), invalid_file) ;
+
+    const file_header &header = *static_cast<const file_header *>(mapping.data()) ;
+
+    ensure<std::invalid_argument>(header._magic == file_magic, invalid_file) ;
+    ensure<std::invalid_argument>
+        (header._byte_order == byte_order_mark,
+         "Compiled network prefix trie file has foreign byte order") ;
+    ensure<std::invalid_argument>
+        (header._version == file_version,
+         "Unsupported version of compiled network prefix trie file") ;
+    ensure<std::invalid_argument>
+        (header._addr_bits == addr_bits,
+         "Compiled network prefix trie file is for another address family") ;
+    ensure<std::invalid_argument>
+        (header._nodes_offset == sizeof(file_header) &&
+         header._nodes_count <= (size - sizeof(file_header))/sizeof(node_type) &&
+         size == header._nodes_offset + header._nodes_count*sizeof(node_type) &&
+         header._depth <= (addr_bits+5)/6 &&
+         // A trie with a single node at most has no nodes in the file, see the
+         // constructor from subnets.
+         (header._nodes_count || header._depth <= 1) &&
+         (header._nodes_count != 1 || header._depth == 1),
+         invalid_file) ;
+
+    _mapping = std::move(mapping) ;
+    _depth = header._depth ;
+    _root = header._nodes_count
+        ? reinterpret_cast<const node_type *>(_mapping.cdata() + header._nodes_offset)
+        : _depth ? &_anymatch_root : &_nomatch_root ;
+}
+
+void shortest_netprefix_set::save(const char *filename, unsigned addr_bits) const
+{
+    PCOMN_ENSURE_ARG(filename) ;
+
+    const node_type * const nodes = _root == &_nomatch_root || _root == &_anymatch_root ? nullptr : _root ;
+    const size_t count = nodes ? nodes_count() : 0 ;
+
+    file_header header {} ;
+    header._magic = file_magic ;
+    header._byte_order = byte_order_mark ;
+    header._version = file_version ;
+    header._addr_bits = addr_bits ;
+    header._depth = _depth ;
+    header._nodes_count = count ;
+    header._nodes_offset = sizeof header ;
+
+    std::string tmpname (filename) ;
+    tmpname.append(".XXXXXX") ;
+
+    const fd_safehandle fd (PCOMN_ENSURE_POSIX(mkstemp(&tmpname[0]), "mkstemp")) ;
+    auto_unlink tmpfile (tmpname) ;
+
+    const auto write_data = [&](const void *data, size_t size)
+    {
+        for (const char *p = static_cast<const char *>(data) ; size ;)
+        {
+            const ssize_t written = PCOMN_ENSURE_POSIX(write(fd.handle(), p, size), "write") ;
+            p += written ;
+            size -= written ;
+        }
+    } ;
+
+    write_data(&header, sizeof header) ;
+    write_data(nodes, count*sizeof(node_type)) ;
+
+    PCOMN_ENSURE_POSIX(fchmod(fd.handle(), 0644), "fchmod") ;
+    // The data must reach the disk before the file replaces the previous version,
+    // and the rename itself must reach the disk before we return
+    PCOMN_ENSURE_POSIX(fsync(fd.handle()), "fsync") ;
+    PCOMN_ENSURE_POSIX(rename(tmpname.c_str(), filename), "rename") ;
+    tmpfile.release() ;
+
+    const std::string dirname (path::dirname(filename).stdstring()) ;
+    const fd_safehandle dirfd (PCOMN_ENSURE_POSIX(open(dirname.empty() ? "." : dirname.c_str(),
+                                                       O_RDONLY|O_DIRECTORY), "open")) ;
+    PCOMN_ENSURE_POSIX(fsync(dirfd.handle()), "fsync") ;
+}
+
 template<typename Subnet>
 std::vector<Subnet> &shortest_netprefix_set::prepare_source_data(std::vector<Subnet> &v)
 {
@@ -145,11 +248,21 @@ unsigned *shortest_netprefix_set::compile_nodes(const simple_slice<Subnet> &sour
 
         do
         {
-            node = append_node(node, bittuple<6>(addr, level), prefix_tail) ;
-            prefix_tail -= 6 ;
+            const uint8_t hexad = bittuple<6>(addr, level) ;
 
-            const bool not_leaf = prefix_tail > 0 ;
-            *++current_level_count += not_leaf ;
+            if (prefix_tail > 6 && (node->children_bits() & (1ULL << hexad)))
+            {
+                // The path is already there; since the source is sorted, it is always
+                // the path through the last child.
+                node = node->child_at_compilation_stage(node->children_count() - 1) ;
+                ++current_level_count ;
+            }
+            else
+            {
+                node = append_node(node, hexad, prefix_tail) ;
+                *++current_level_count += prefix_tail > 6 ;
+            }
+            prefix_tail -= 6 ;
             ++level ;
         }
         while(prefix_tail > 0) ;
@@ -235,6 +348,192 @@ bool shortest_netprefix_set::is_member(const Addr &addr) const
     return false ;
 }
 
+template<typename Addr>
+size_t shortest_netprefix_set::is_member_many(const Addr *addrs, size_t count, bitarray &result) const
+{
+    if (result.size() != count)
+        bitarray(count).swap(result) ;
+    else
+        result.reset() ;
+
+    size_t found = 0 ;
+
+    for (size_t base = 0 ; base < count ; base += lookup_batch)
+    {
+        const Addr * const batch_addrs = addrs + base ;
+        const unsigned batch_size = std::min<size_t>(lookup_batch, count - base) ;
+
+        // Current node for every walk of the batch and the bitmask of unfinished walks.
+        const node_type *nodes[lookup_batch] ;
+        std::fill_n(nodes, batch_size, _root) ;
+        unsigned walking = ~(~0U << batch_size) ;
+
+        for (unsigned level = 0 ; walking ; ++level)
+        {
+            NOXCHECK(level < (8*sizeof(*addrs)+5)/6) ;
+
+            for (unsigned i = 0 ; i < batch_size ; ++i)
+            {
+                if (!(walking & (1U << i)))
+                    continue ;
+
+                const node_type *node = nodes[i] ;
+                const uint64_t level_bit = 1ULL << bittuple<6>(batch_addrs[i], level) ;
+
+                if (node->children_bits() & level_bit)
+                {
+                    node = nodes[i] = node->child(bitop::popcount(node->children_bits() & (level_bit-1))) ;
+                    PCOMN_PREFETCH(node) ;
+                    continue ;
+                }
+
+                walking &= ~(1U << i) ;
+                if (node->leaves_bits() & level_bit)
+                {
+                    result.set(base + i) ;
+                    ++found ;
+                }
+            }
+        }
+    }
+    return found ;
+}
+
+/*******************************************************************************
+ longest_netprefix_map
+*******************************************************************************/
+constexpr uint32_t longest_netprefix_map::npos ;
+
+longest_netprefix_map::longest_netprefix_map(const simple_cslice<ipv4_subnet> &subnets)
+{
+    compile_nodes(subnets) ;
+}
+
+longest_netprefix_map::longest_netprefix_map(const simple_cslice<ipv6_subnet> &subnets)
+{
+    compile_nodes(subnets) ;
+}
+
+template<typename Subnet>
+void longest_netprefix_map::compile_nodes(const simple_cslice<Subnet> &subnets)
+{
+    // Build the trie breadth-first: all the children of a node are appended at once,
+    // so they are contiguous and the nodes are ordered by level.
+    struct pending_node {
+        uint32_t _node_ndx ;
+        uint32_t _inherited ;  /* Item matching the whole node address range */
+        uint32_t _begin ;      /* The range of _subnet_ndx with longer prefixes */
+        uint32_t _end ;
+        unsigned _level ;
+    } ;
+
+    std::vector<uint32_t> subnet_ndx (subnets.size()) ;
+    std::iota(subnet_ndx.begin(), subnet_ndx.end(), 0) ;
+
+    std::vector<pending_node> queue {{0, npos, 0, (uint32_t)subnets.size(), 0}} ;
+    _nodes.resize(1) ;
+    _leaves.clear() ;
+    _depth = 0 ;
+
+    for (size_t current = 0 ; current < queue.size() ; ++current)
+    {
+        const pending_node pending = queue[current] ;
+        const unsigned level_end_bit = 6*(pending._level + 1) ;
+        const auto hexad = [&](uint32_t ndx)
+        {
+            return bittuple<6>(subnets[ndx].subnet_addr(), pending._level) ;
+        } ;
+
+        uint32_t * const begin = subnet_ndx.data() + pending._begin ;
+        uint32_t * const end = subnet_ndx.data() + pending._end ;
+
+        // Prefixes ending at this level cover runs of slots; apply them from the
+        // shortest to the longest, so longer prefixes override shorter.
+        uint32_t * const longer = std::stable_partition(begin, end, [&](uint32_t ndx)
+        {
+            return subnets[ndx].pfxlen() <= level_end_bit ;
+        }) ;
+        std::stable_sort(begin, longer, [&](uint32_t x, uint32_t y)
+        {
+            return subnets[x].pfxlen() < subnets[y].pfxlen() ;
+        }) ;
+
+        uint32_t slots[64] ;
+        std::fill_n(slots, 64, pending._inherited) ;
+        for (const uint32_t *ndx = begin ; ndx != longer ; ++ndx)
+        {
+            const unsigned first = hexad(*ndx) ;
+            const unsigned run = 1U << (level_end_bit - subnets[*ndx].pfxlen()) ;
+            NOXCHECK(first + run <= 64) ;
+            std::fill_n(slots + first, run, *ndx) ;
+        }
+
+        // Longer prefixes go to the child nodes, one child per distinct hexad.
+        std::stable_sort(longer, end, [&](uint32_t x, uint32_t y) { return hexad(x) < hexad(y) ; }) ;
+
+        uint64_t children = 0 ;
+        for (const uint32_t *ndx = longer ; ndx != end ; )
+        {
+            const unsigned h = hexad(*ndx) ;
+            const uint32_t * const child_begin = ndx ;
+            while (++ndx != end && hexad(*ndx) == h) ;
+
+            children |= 1ULL << h ;
+            queue.push_back({(uint32_t)(_nodes.size() + bitop::popcount(children) - 1), slots[h],
+                             (uint32_t)(child_begin - subnet_ndx.data()),
+                             (uint32_t)(ndx - subnet_ndx.data()),
+                             pending._level + 1}) ;
+        }
+
+        node_type &node = _nodes[pending._node_ndx] ;
+        node._children = children ;
+        node._first_child_offs = children ? _nodes.size() - pending._node_ndx : 0 ;
+        node._first_leaf = _leaves.size() ;
+
+        // A leaf starts at every slot not occupied by a child with an item different
+        // from the previous such slot.
+        uint32_t previous = 0 ;
+        bool first_leaf = true ;
+        for (unsigned slot = 0 ; slot < 64 ; ++slot)
+        {
+            if (children & (1ULL << slot) || (!first_leaf && slots[slot] == previous))
+                continue ;
+            node._leaves |= 1ULL << slot ;
+            _leaves.push_back(previous = slots[slot]) ;
+            first_leaf = false ;
+        }
+
+        _nodes.resize(_nodes.size() + bitop::popcount(children)) ;
+        _depth = std::max<size_t>(_depth, pending._level + 1) ;
+    }
+}
+
+template<typename Addr>
+uint32_t longest_netprefix_map::find_item(const Addr &addr) const
+{
+    constexpr unsigned maxlevels = (8*sizeof(addr)+5)/6 ;
+
+    // Start from the root.
+    const node_type *node = _nodes.data() ;
+    unsigned level = 0 ;
+
+    do {
+        const uint64_t level_bit = 1ULL << bittuple<6>(addr, level) ;
+
+        if (!(node->children_bits() & level_bit))
+            return _leaves[node->_first_leaf + bitop::popcount(node->leaves_bits() & (level_bit|(level_bit-1))) - 1] ;
+
+        node = node->child(bitop::popcount(node->children_bits() & (level_bit-1))) ;
+    }
+    while(++level < maxlevels) ;
+
+    PCOMN_DEBUG_FAIL("must never be here") ;
+    return npos ;
+}
+
+template uint32_t longest_netprefix_map::find_item(const ipv4_addr &) const ;
+template uint32_t longest_netprefix_map::find_item(const ipv6_addr &) const ;
+
 /*******************************************************************************
  ipaddr_prefix_set<Addr>
 *******************************************************************************/
@@ -244,6 +543,204 @@ bool ipaddr_prefix_set<Addr>::is_member(const addr_type &addr) const
     return ancestor::is_member(addr) ;
 }
 
+template<typename Addr>
+size_t ipaddr_prefix_set<Addr>::is_member_many(const addr_type *addrs, size_t count, bitarray &result) const
+{
+    return ancestor::is_member_many(addrs, count, result) ;
+}
+
+/*******************************************************************************
+ ipaddr_prefix_set_builder<Addr>
+*******************************************************************************/
+template<typename Addr>
+constexpr unsigned ipaddr_prefix_set_builder<Addr>::default_partition_levels ;
+
+template<typename Addr>
+ipaddr_prefix_set_builder<Addr>::ipaddr_prefix_set_builder(unsigned partition_levels) :
+    _levels(partition_levels)
+{
+    // The partition key is at most 60 bits and a partition path must be shorter than
+    // the address.
+    PCOMN_ASSERT_ARG(inrange(partition_levels, 1U, std::min(10U, unsigned(8*sizeof(addr_type) - 1)/6))) ;
+}
+
+template<typename Addr>
+ipaddr_prefix_set_builder<Addr>::ipaddr_prefix_set_builder(const simple_cslice<subnet_type> &subnets,
+                                                           unsigned partition_levels) :
+    ipaddr_prefix_set_builder(partition_levels)
+{
+    add(subnets) ;
+}
+
+template<typename Addr>
+uint64_t ipaddr_prefix_set_builder<Addr>::partition_key(const addr_type &addr) const
+{
+    uint64_t key = 0 ;
+    for (unsigned level = 0 ; level < _levels ; ++level)
+        key = key << 6 | bittuple<6>(addr, level) ;
+    return key ;
+}
+
+template<typename Addr>
+template<typename F>
+void ipaddr_prefix_set_builder<Addr>::update(const simple_cslice<subnet_type> &subnets, bool create,
+                                             F &&update_source)
+{
+    std::vector<subnet_type> delta (subnets.begin(), subnets.end()) ;
+    std::transform(delta.begin(), delta.end(), delta.begin(), std::mem_fn(&subnet_type::subnet)) ;
+    pcomn::unique_sort(delta) ;
+
+    const unsigned partition_bits = 6*_levels ;
+
+    // Both parts remain sorted; the subnets ordering is by address first, so the
+    // subnets of every partition are contiguous in the long part.
+    const auto long_begin = std::stable_partition(delta.begin(), delta.end(), [=](const subnet_type &subnet)
+    {
+        return subnet.pfxlen() <= partition_bits ;
+    }) ;
+
+    const auto apply = [&](std::vector<subnet_type> &source, const subnet_type *b, const subnet_type *e)
+    {
+        const size_t old_size = source.size() ;
+        update_source(source, b, e) ;
+        _size += source.size() - old_size ;
+        return source.size() != old_size ;
+    } ;
+
+    apply(_short, delta.data(), delta.data() + (long_begin - delta.begin())) ;
+
+    for (const subnet_type *begin = delta.data() + (long_begin - delta.begin()), *end = begin,
+             *delta_end = delta.data() + delta.size() ; begin != delta_end ; begin = end)
+    {
+        const uint64_t key = partition_key(begin->addr()) ;
+        end = std::find_if(begin + 1, delta_end, [&](const subnet_type &subnet)
+        {
+            return partition_key(subnet.addr()) != key ;
+        }) ;
+
+        const auto found = create ? _partitions.emplace(key, partition()).first : _partitions.find(key) ;
+        if (found != _partitions.end() && apply(found->second._source, begin, end))
+            found->second._dirty = true ;
+    }
+}
+
+template<typename Addr>
+ipaddr_prefix_set_builder<Addr> &ipaddr_prefix_set_builder<Addr>::add(const simple_cslice<subnet_type> &subnets)
+{
+    update(subnets, true, [](std::vector<subnet_type> &source, const subnet_type *begin, const subnet_type *end)
+    {
+        const size_t old_size = source.size() ;
+        source.insert(source.end(), begin, end) ;
+        std::inplace_merge(source.begin(), source.begin() + old_size, source.end()) ;
+        pcomn::unique(source) ;
+    }) ;
+    return *this ;
+}
+
+template<typename Addr>
+ipaddr_prefix_set_builder<Addr> &ipaddr_prefix_set_builder<Addr>::remove(const simple_cslice<subnet_type> &subnets)
+{
+    update(subnets, false, [](std::vector<subnet_type> &source, const subnet_type *begin, const subnet_type *end)
+    {
+        source.erase(std::remove_if(source.begin(), source.end(), [=](const subnet_type &subnet)
+        {
+            return std::binary_search(begin, end, subnet) ;
+        }),
+            source.end()) ;
+    }) ;
+    return *this ;
+}
+
+template<typename Addr>
+void ipaddr_prefix_set_builder<Addr>::compile_partition(partition &p) const
+{
+    shortest_netprefix_set trie (std::false_type(), make_simple_cslice(p._source)) ;
+
+    // All the partition subnets share the path down to the _levels level and are
+    // longer than it, so the path is a single node per level at the start of the
+    // packed trie and the rest of the nodes is the subtrie.
+    NOXCHECK(trie._nodes.size() > _levels) ;
+    NOXCHECK(trie._depth > _levels) ;
+
+    p._nodes.assign(trie._nodes.begin() + _levels, trie._nodes.end()) ;
+    p._depth = trie._depth ;
+    p._dirty = false ;
+}
+
+template<typename Addr>
+auto ipaddr_prefix_set_builder<Addr>::snapshot() -> set_type
+{
+    _recompiled = 0 ;
+
+    // Compile the top trie: short prefixes plus a representative subnet one bit
+    // longer than the partition path for every partition. Representatives of
+    // partitions covered by short prefixes are dropped by the trie compilation.
+    std::vector<subnet_type> top_source (_short) ;
+    top_source.reserve(_short.size() + _partitions.size()) ;
+
+    for (auto p = _partitions.begin() ; p != _partitions.end() ;)
+    {
+        partition &part = p->second ;
+        if (part._source.empty())
+        {
+            p = _partitions.erase(p) ;
+            continue ;
+        }
+        if (part._dirty)
+        {
+            compile_partition(part) ;
+            ++_recompiled ;
+        }
+        top_source.emplace_back(part._source.front().addr(), 6*_levels + 1) ;
+        ++p ;
+    }
+
+    shortest_netprefix_set top (std::true_type(), std::move(top_source)) ;
+
+    if (_partitions.empty() || top._root == &top._anymatch_root)
+        return set_type(std::move(top)) ;
+
+    // Replace the leaf-only nodes at the ends of representatives' paths with the
+    // partition subtries, appending the rest of subtrie nodes to the top trie.
+    std::vector<node_type> &nodes = top._nodes ;
+    size_t depth = top._depth ;
+
+    for (const auto &p: _partitions)
+    {
+        const partition &part = p.second ;
+        const addr_type addr = part._source.front().addr() ;
+
+        size_t ndx = 0 ;
+        unsigned level = 0 ;
+        for (; level < _levels ; ++level)
+        {
+            const node_type &node = nodes[ndx] ;
+            const uint64_t level_bit = 1ULL << bittuple<6>(addr, level) ;
+            if (!(node.children_bits() & level_bit))
+                break ;
+            ndx += node._first_child_offs + bitop::popcount(node.children_bits() & (level_bit-1)) ;
+        }
+        if (level < _levels)
+            // Covered by a short prefix
+            continue ;
+
+        const size_t block_ndx = nodes.size() ;
+        nodes.insert(nodes.end(), part._nodes.begin() + 1, part._nodes.end()) ;
+
+        node_type root = part._nodes.front() ;
+        if (root._first_child_offs)
+            root._first_child_offs += block_ndx - 1 - ndx ;
+        nodes[ndx] = root ;
+
+        depth = std::max(depth, part._depth) ;
+    }
+
+    top._root = nodes.data() ;
+    top._depth = depth ;
+
+    return set_type(std::move(top)) ;
+}
+
 /*******************************************************************************
  Explicitly instantiate ipaddr_prefix_set IPv4 and IPv6 variants to ensure
  instantiation of the respective shortest_netprefix_set template members.
@@ -251,4 +748,7 @@ bool ipaddr_prefix_set<Addr>::is_member(const addr_type &addr) const
 template class ipaddr_prefix_set<ipv4_addr> ;
 template class ipaddr_prefix_set<ipv6_addr> ;
 
+template class ipaddr_prefix_set_builder<ipv4_addr> ;
+template class ipaddr_prefix_set_builder<ipv6_addr> ;
+
 } // end of namespace pcomn
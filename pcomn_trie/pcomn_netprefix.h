@@ -17,9 +17,18 @@
 #include <pcomn_tuple.h>
 #include <pcomn_integer.h>
 #include <pcomn_vector.h>
+#include <pcomn_bitarray.h>
+#include <pcomn_mmap.h>
+#include <pcomn_magiclbl.h>
+
+#include <vector>
+#include <map>
+#include <algorithm>
 
 namespace pcomn {
 
+template<typename> class ipaddr_prefix_set_builder ;
+
 /***************************************************************************//**
  A data structure for fast membership check of a network address against
  a set of prefixes.
@@ -32,12 +41,18 @@ public:
     /// Get nodes count
     size_t nodes_count() const
     {
-        return _nodes.size() + (_root == &_anymatch_root) ;
+        return (is_mapped() ? mapped_header()._nodes_count : _nodes.size()) + (_root == &_anymatch_root) ;
     }
 
     /// Get trie depth.
     size_t depth() const { return _depth ; }
 
+    /// Indicate if the trie is queried directly from a file mapping.
+    bool is_mapped() const { return _mapping != nullptr ; }
+
+    /// The current version of the on-disk trie format.
+    static constexpr uint16_t file_version = 1 ;
+
 protected:
     explicit shortest_netprefix_set(const simple_cslice<ipv4_subnet> &subnets) :
         shortest_netprefix_set(std::false_type(), subnets)
@@ -46,17 +61,37 @@ protected:
         shortest_netprefix_set(std::false_type(), subnets)
     {}
 
+    /// Use the trie saved by save() directly from the read-only mapping of its file.
+    /// @throw std::invalid_argument The mapping is not a valid trie file of version
+    /// file_version for @a addr_bits-bit addresses.
+    shortest_netprefix_set(PMemMapping &&mapping, unsigned addr_bits) ;
+
     shortest_netprefix_set() = default ;
 
     shortest_netprefix_set(shortest_netprefix_set &&) ;
 
+    /// Save the trie to a file loadable by shortest_netprefix_set(PMemMapping&&,unsigned).
+    ///
+    /// The file is written to a temporary file in the same directory and then renamed
+    /// to @a filename, so processes that have the previous version of @a filename
+    /// mapped are not affected.
+    void save(const char *filename, unsigned addr_bits) const ;
+
     ~shortest_netprefix_set() = default ;
 
     /// Check is an addr starts with any of the prefixes in the set.
     template<typename Addr>
     bool is_member(const Addr &addr) const ;
 
+    template<typename Addr>
+    size_t is_member_many(const Addr *addrs, size_t count, bitarray &result) const ;
+
+    /// The count of addresses walked down the trie simultaneously by is_member_many().
+    static constexpr unsigned lookup_batch = 16 ;
+
 private:
+    template<typename> friend class ipaddr_prefix_set_builder ;
+
     // {{descendant_array,leaves_array}, {subnodes_begin,}}
     struct node_type {
 
@@ -102,11 +137,36 @@ private:
     static const node_type _nomatch_root ;
     static const node_type _anymatch_root ;
 
+    // The on-disk format: the header immediately followed by packed nodes, all the
+    // integers in the native byte order.
+    struct file_header {
+        magic64  _magic ;
+        uint32_t _byte_order ;   /* byte_order_mark, to detect foreign byte order */
+        uint16_t _version ;
+        uint16_t _addr_bits ;    /* 32 for IPv4, 128 for IPv6 */
+        uint64_t _depth ;
+        uint64_t _nodes_count ;
+        uint64_t _nodes_offset ; /* From the start of the file */
+        uint64_t _reserved[3] ;
+    } ;
+
+    PCOMN_STATIC_CHECK(sizeof(file_header) == 64) ;
+    PCOMN_STATIC_CHECK(sizeof(node_type) == 24) ;
+
+    static constexpr magic64  file_magic {'P', 'C', 'N', 'E', 'T', 'P', 'F', 'X'} ;
+    static constexpr uint32_t byte_order_mark = 0x01020304 ;
+
 private:
     std::vector<node_type> _nodes ;
+    PMemMapping            _mapping ;
     size_t                 _depth = 0 ;
     const node_type *      _root = &_nomatch_root ;
 
+    const file_header &mapped_header() const
+    {
+        return *static_cast<const file_header *>(_mapping.data()) ;
+    }
+
 private:
     template<typename Subnet>
     shortest_netprefix_set(std::false_type, const simple_cslice<Subnet> &subnets) ;
@@ -141,6 +201,20 @@ public:
         ancestor(subnets)
     {}
 
+    /// Use the trie saved by save() directly from its read-only file mapping, without
+    /// copying or rebuilding.
+    ///
+    /// The mapped nodes are not validated, so the file must come from a trusted
+    /// source.
+    /// @throw std::invalid_argument The mapping is not a trie file of the current
+    /// version for addr_type.
+    /// @note A template only to exclude this constructor from overload resolution for
+    /// braced initializer lists of subnets.
+    template<typename Mapping, typename = std::enable_if_t<std::is_same<Mapping, PMemMapping>::value>>
+    explicit ipaddr_prefix_set(Mapping &&mapping) :
+        ancestor(std::move(mapping), 8*sizeof(addr_type))
+    {}
+
     ipaddr_prefix_set() = default ;
     ipaddr_prefix_set(ipaddr_prefix_set &&) = default ;
 
@@ -153,8 +227,297 @@ public:
     /// Check is an addr starts with any of the prefixes in the set.
     bool is_member(const addr_type &addr) const ;
 
+    /// Check membership of every address from an array, setting the corresponding
+    /// bit of @a result for every member.
+    ///
+    /// Walks of lookup_batch addresses are interleaved level by level and every next
+    /// node of a walk is prefetched, so node load latencies of a batch overlap
+    /// instead of being taken one after another.
+    ///
+    /// @param addrs  Addresses to check.
+    /// @param count  The count of addresses at @a addrs.
+    /// @param result Membership bits; replaced with a bitarray of @a count bits if its
+    ///               size is different from @a count.
+    /// @return The count of members.
+    size_t is_member_many(const addr_type *addrs, size_t count, bitarray &result) const ;
+
     /// STL set<> interface.
     unsigned count(const addr_type &addr) const { return is_member(addr) ; }
+
+    /// Save the compiled trie to @a filename.
+    /// The file can be loaded with ipaddr_prefix_set(PMemMapping(filename)).
+    void save(const char *filename) const { ancestor::save(filename, 8*sizeof(addr_type)) ; }
+
+private:
+    friend ipaddr_prefix_set_builder<addr_type> ;
+
+    explicit ipaddr_prefix_set(ancestor &&trie) : ancestor(std::move(trie)) {}
+} ;
+
+/***************************************************************************//**
+ Incremental builder of ipaddr_prefix_set.
+
+ Keeps the source subnets partitioned by their first partition_levels() hexads,
+ i.e. by the trie path down to the partition_levels() level, together with the
+ compiled subtrie of every partition. add() and remove() only change the source and
+ mark the affected partitions; snapshot() recompiles the marked partitions and then
+ assembles the set from the compiled subtries and the (small) top trie built from
+ the prefixes not longer than the partition path.
+
+ So the cost of a snapshot after a small delta is the cost of compiling the affected
+ partitions plus copying of the nodes, instead of sorting and compiling the whole
+ source.
+
+ Use together with snapshot_holder (pcomn_hazardptr.h) to update a prefix set
+ without blocking is_member() callers:
+ @code
+ typedef ipaddr_prefix_set_builder<ipv4_addr> builder_type ;
+
+ builder_type builder (initial_subnets) ;
+ snapshot_holder<builder_type::set_type> prefixes
+     (std::make_unique<builder_type::set_type>(builder.snapshot())) ;
+
+ // Lookup threads
+ prefixes.read([&](const builder_type::set_type &set) { return set.is_member(addr) ; }) ;
+
+ // Update thread
+ builder.add(added).remove(removed) ;
+ prefixes.reset(std::make_unique<builder_type::set_type>(builder.snapshot())) ;
+ @endcode
+*******************************************************************************/
+template<typename Addr>
+class ipaddr_prefix_set_builder {
+    PCOMN_STATIC_CHECK((is_one_of<Addr, ipv4_addr, ipv6_addr>::value)) ;
+public:
+    typedef Addr                            addr_type ;
+    typedef ip_subnet_t<addr_type>          subnet_type ;
+    typedef ipaddr_prefix_set<addr_type>    set_type ;
+
+    /// The default partition_levels(): partition by 12 bits for IPv4, by 24 bits for
+    /// IPv6.
+    static constexpr unsigned default_partition_levels = sizeof(addr_type) == 4 ? 2 : 4 ;
+
+    /// @throw std::invalid_argument @a partition_levels is 0 or too big for the
+    /// address family (more than 5 for IPv4, more than 10 for IPv6).
+    explicit ipaddr_prefix_set_builder(unsigned partition_levels = default_partition_levels) ;
+
+    explicit ipaddr_prefix_set_builder(const simple_cslice<subnet_type> &subnets,
+                                       unsigned partition_levels = default_partition_levels) ;
+
+    /// Add subnets to the source.
+    /// Takes effect at the next snapshot().
+    ipaddr_prefix_set_builder &add(const simple_cslice<subnet_type> &subnets) ;
+
+    /// Remove subnets from the source; subnets not in the source are ignored.
+    /// Takes effect at the next snapshot().
+    ipaddr_prefix_set_builder &remove(const simple_cslice<subnet_type> &subnets) ;
+
+    /// Make the prefix set from the current source, recompiling only the partitions
+    /// changed since the previous snapshot.
+    ///
+    /// The result is equivalent to set_type constructed from the current source.
+    set_type snapshot() ;
+
+    /// Get the count of the source subnets (normalized and unique, but not reduced to
+    /// the shortest prefixes).
+    size_t size() const { return _size ; }
+
+    unsigned partition_levels() const { return _levels ; }
+
+    /// Get the count of nonempty partitions.
+    size_t partitions_count() const { return _partitions.size() ; }
+
+    /// Get the count of partitions recompiled by the last snapshot().
+    size_t recompiled_count() const { return _recompiled ; }
+
+private:
+    typedef shortest_netprefix_set::node_type node_type ;
+
+    struct partition {
+        std::vector<subnet_type>   _source ; /* Sorted and unique */
+        std::vector<node_type>     _nodes ;  /* Packed subtrie, the root first */
+        size_t                     _depth = 0 ;
+        bool                       _dirty = true ;
+    } ;
+
+    const unsigned              _levels ;
+    size_t                      _size = 0 ;
+    size_t                      _recompiled = 0 ;
+    std::vector<subnet_type>    _short ;     /* Not longer than 6*_levels, sorted, unique */
+    std::map<uint64_t, partition> _partitions ;
+
+    uint64_t partition_key(const addr_type &addr) const ;
+
+    template<typename F>
+    void update(const simple_cslice<subnet_type> &subnets, bool create, F &&update_source) ;
+
+    void compile_partition(partition &p) const ;
+} ;
+
+
+/***************************************************************************//**
+ A data structure for longest-prefix-match search of a network address in a set
+ of prefixes, every prefix having an associated value (item index).
+
+ Uses the same popcount-indexed 6-bit-stride node layout as shortest_netprefix_set,
+ but keeps all the prefixes, not only the shortest ones. Matches of shorter
+ prefixes are pushed down to every node slot not covered by a longer prefix, so a
+ lookup is a single root-to-leaf walk with no backtracking.
+
+ A node leaf bitmap marks only the slots where the item index changes, so a run of
+ slots matching the same prefix takes a single leaf.
+*******************************************************************************/
+class longest_netprefix_map {
+public:
+    /// Get nodes count
+    size_t nodes_count() const { return _nodes.size() ; }
+
+    /// Get trie depth.
+    size_t depth() const { return _depth ; }
+
+protected:
+    /// The item index of unmatched addresses.
+    static constexpr uint32_t npos = ~uint32_t() ;
+
+    /// Build a trie from unique normalized subnets; the item index of a prefix is its
+    /// position in @a subnets.
+    explicit longest_netprefix_map(const simple_cslice<ipv4_subnet> &subnets) ;
+    explicit longest_netprefix_map(const simple_cslice<ipv6_subnet> &subnets) ;
+
+    longest_netprefix_map() : longest_netprefix_map(simple_cslice<ipv4_subnet>()) {}
+
+    longest_netprefix_map(longest_netprefix_map &&) = default ;
+    longest_netprefix_map &operator=(longest_netprefix_map &&) = default ;
+
+    ~longest_netprefix_map() = default ;
+
+    /// Get the item index of the longest prefix matching @a addr, or npos.
+    template<typename Addr>
+    uint32_t find_item(const Addr &addr) const ;
+
+private:
+    struct node_type {
+        constexpr uint64_t children_bits() const { return _children ; }
+        constexpr uint64_t leaves_bits() const { return _leaves ; }
+
+        const node_type *child(size_t n) const
+        {
+            NOXCHECK(n < bitop::popcount(children_bits())) ;
+            return this + _first_child_offs + n ;
+        }
+
+        uint64_t _children = 0 ;        /* Bitarray of child nodes */
+        uint64_t _leaves = 0 ;          /* Bitarray of leaf runs starts */
+        uint32_t _first_child_offs = 0 ;
+        uint32_t _first_leaf = 0 ;      /* Index of the first leaf in _leaves */
+    } ;
+
+private:
+    std::vector<node_type> _nodes ;
+    std::vector<uint32_t>  _leaves ;  /* Item indices */
+    size_t                 _depth = 0 ;
+
+private:
+    template<typename Subnet>
+    void compile_nodes(const simple_cslice<Subnet> &subnets) ;
+} ;
+
+/***************************************************************************//**
+ Routing table: a map from IPv4 or IPv6 subnets to values, looked up by the longest
+ prefix match of an address.
+*******************************************************************************/
+template<typename Addr, typename T>
+class ipaddr_prefix_map : public longest_netprefix_map {
+    PCOMN_STATIC_CHECK((is_one_of<Addr, ipv4_addr, ipv6_addr>::value)) ;
+    typedef longest_netprefix_map ancestor ;
+public:
+    typedef Addr                             addr_type ;
+    typedef ip_subnet_t<addr_type>           subnet_type ;
+    typedef subnet_type                      key_type ;
+    typedef T                                mapped_type ;
+    typedef std::pair<subnet_type, T>        value_type ;
+    typedef const value_type *               const_iterator ;
+    typedef const_iterator                   iterator ;
+
+    /// Create the map from (subnet, value) pairs.
+    ///
+    /// Subnets are normalized (see ip_subnet_t::subnet()); if there are several equal
+    /// subnets, only the first one is retained.
+    explicit ipaddr_prefix_map(const simple_cslice<value_type> &items) :
+        ipaddr_prefix_map(std::true_type(), prepare_items(items))
+    {}
+
+    ipaddr_prefix_map() = default ;
+    ipaddr_prefix_map(ipaddr_prefix_map &&) = default ;
+    ipaddr_prefix_map &operator=(ipaddr_prefix_map &&) = default ;
+
+    /// Get the item with the longest subnet matching @a addr.
+    /// @return Pointer to the item, or nullptr if no subnet matches @a addr.
+    const value_type *find(const addr_type &addr) const
+    {
+        const uint32_t ndx = find_item(addr) ;
+        return ndx == npos ? nullptr : _items.data() + ndx ;
+    }
+
+    /// Get the value of the longest subnet matching @a addr.
+    /// @return true if found, false otherwise (@a value is unchanged then).
+    bool get(const addr_type &addr, mapped_type &value) const
+    {
+        if (const value_type * const item = find(addr))
+        {
+            value = item->second ;
+            return true ;
+        }
+        return false ;
+    }
+
+    bool is_member(const addr_type &addr) const { return find_item(addr) != npos ; }
+
+    unsigned count(const addr_type &addr) const { return is_member(addr) ; }
+
+    /// Get the count of (unique) subnets in the map.
+    size_t size() const { return _items.size() ; }
+    bool empty() const { return _items.empty() ; }
+
+    /// Items are ordered by subnet.
+    const_iterator begin() const { return _items.data() ; }
+    const_iterator end() const { return _items.data() + _items.size() ; }
+
+private:
+    std::vector<value_type> _items ;
+
+    ipaddr_prefix_map(std::true_type, std::vector<value_type> &&items) :
+        ancestor(make_simple_cslice(subnets(items))),
+        _items(std::move(items))
+    {}
+
+    static std::vector<value_type> prepare_items(const simple_cslice<value_type> &source)
+    {
+        std::vector<value_type> items (source.begin(), source.end()) ;
+        for (value_type &item: items)
+            item.first = item.first.subnet() ;
+
+        std::stable_sort(items.begin(), items.end(), [](const value_type &x, const value_type &y)
+        {
+            return x.first < y.first ;
+        }) ;
+        items.erase(std::unique(items.begin(), items.end(), [](const value_type &x, const value_type &y)
+        {
+            return x.first == y.first ;
+        }),
+            items.end()) ;
+
+        return items ;
+    }
+
+    static std::vector<subnet_type> subnets(const std::vector<value_type> &items)
+    {
+        std::vector<subnet_type> result ;
+        result.reserve(items.size()) ;
+        for (const value_type &item: items)
+            result.push_back(item.first) ;
+        return result ;
+    }
 } ;
 
 /*******************************************************************************
@@ -0,0 +1,129 @@
+/*-*- tab-width:4;indent-tabs-mode:nil;c-file-style:"ellemtel";c-basic-offset:4;c-file-offsets:((innamespace . 0)(inlambda . 0)) -*-*/
+/*******************************************************************************
+ FILE         :   benchmark_netprefix.cpp
+ COPYRIGHT    :   Yakov Markovitch, 2026. All rights reserved.
+                  See LICENSE for information on usage/redistribution.
+
+ DESCRIPTION  :   Benchmark of the batch membership check vs. the scalar is_member()
+                  loop for ipaddr_prefix_set.
+
+ PROGRAMMED BY:   Yakov Markovitch
+ CREATION DATE:   16 Oct 2026
+*******************************************************************************/
+#include <pcomn_netprefix.h>
+#include <pcomn_stopwatch.h>
+#include <pcomn_except.h>
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <random>
+
+#include <stdlib.h>
+
+using namespace pcomn ;
+
+static void usage(const char *progname)
+{
+    std::cerr << "Usage: " << progname << " address_count [subnet_count [passes]]\n"
+        "Measure ipaddr_prefix_set::is_member() loop vs. is_member_many() throughput\n"
+        "for random IPv4 and IPv6 subnets.\n" ;
+    exit(1) ;
+}
+
+static ipv4_subnet random_subnet(std::mt19937_64 &rng, ipv4_addr*)
+{
+    return {ipv4_addr((uint32_t)rng()), unsigned(20 + rng()%13)} ;
+}
+
+static ipv6_subnet random_subnet(std::mt19937_64 &rng, ipv6_addr*)
+{
+    // Global unicast addresses, most of the prefixes are within the first 64 bits,
+    // like in real routing tables.
+    const uint64_t hi = rng() ;
+    const uint64_t lo = rng() ;
+    return {ipv6_addr(0x2000 | (hi >> 51), hi >> 32, hi >> 16, hi,
+                      lo >> 48, lo >> 32, lo >> 16, lo),
+            unsigned(24 + rng()%41)} ;
+}
+
+template<typename Addr>
+__noinline void run_bench(size_t count, size_t subnet_count, unsigned passes)
+{
+    typedef ip_subnet_t<Addr> subnet_type ;
+
+    std::mt19937_64 rng (1) ;
+    std::vector<subnet_type> subnets ;
+    for (size_t i = 0 ; i < subnet_count ; ++i)
+        subnets.push_back(random_subnet(rng, (Addr *)nullptr)) ;
+
+    // Every other address matches some subnet.
+    std::vector<Addr> addrs ;
+    for (size_t i = 0 ; i < count ; ++i)
+        addrs.push_back(i % 2
+                        ? random_subnet(rng, (Addr *)nullptr).addr()
+                        : subnets[rng() % subnets.size()].addr()) ;
+
+    const ipaddr_prefix_set<Addr> prefixes (subnets) ;
+    bitarray found (count) ;
+    size_t scalar_count = 0 ;
+    size_t batch_count = 0 ;
+
+    PRealStopwatch scalar_stopwatch ;
+    scalar_stopwatch.start() ;
+    for (unsigned pass = 0 ; pass < passes ; ++pass)
+        for (size_t i = 0 ; i < count ; ++i)
+            if (prefixes.is_member(addrs[i]))
+            {
+                found.set(i) ;
+                ++scalar_count ;
+            }
+    scalar_stopwatch.stop() ;
+
+    PRealStopwatch batch_stopwatch ;
+    batch_stopwatch.start() ;
+    for (unsigned pass = 0 ; pass < passes ; ++pass)
+        batch_count += prefixes.is_member_many(addrs.data(), count, found) ;
+    batch_stopwatch.stop() ;
+
+    std::cout << std::setw(8) << (sizeof(Addr) == 4 ? "IPv4" : "IPv6")
+              << std::setw(8) << prefixes.depth()
+              << std::setw(10) << prefixes.nodes_count()
+              << std::setw(12) << (100.0*scalar_count/passes/count)
+              << std::setw(16) << count*passes/scalar_stopwatch.elapsed()/1e6
+              << std::setw(16) << count*passes/batch_stopwatch.elapsed()/1e6
+              << (scalar_count == batch_count ? "" : "  MISMATCH") << std::endl ;
+}
+
+int main(int argc, char *argv[])
+{
+    if (!inrange(argc, 2, 4))
+        usage(*argv) ;
+
+    const long count        = atol(argv[1]) ;
+    const long subnet_count = argc > 2 ? atol(argv[2]) : 100000 ;
+    const int  passes       = argc > 3 ? atoi(argv[3]) : 10 ;
+
+    if (count <= 0 || subnet_count <= 0 || passes <= 0)
+        usage(*argv) ;
+
+    try {
+        std::cout << count << " addresses, " << subnet_count << " subnets, " << passes << " passes\n\n"
+                  << std::setw(8) << "family"
+                  << std::setw(8) << "depth"
+                  << std::setw(10) << "nodes"
+                  << std::setw(12) << "members%"
+                  << std::setw(16) << "scalar, Mops/s"
+                  << std::setw(16) << "batch, Mops/s" << std::endl
+                  << std::fixed << std::setprecision(2) ;
+
+        run_bench<ipv4_addr>(count, subnet_count, passes) ;
+        run_bench<ipv6_addr>(count, subnet_count, passes) ;
+    }
+    catch (const std::exception &x)
+    {
+        std::cerr << STDEXCEPTOUT(x) << std::endl ;
+        return 1 ;
+    }
+    return 0 ;
+}
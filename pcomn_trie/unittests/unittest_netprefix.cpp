@@ -10,6 +10,13 @@
 *******************************************************************************/
 #include <pcomn_netprefix.h>
 #include <pcomn_unittest.h>
+#include <pcomn_fileutils.h>
+#include <pcomn_hazardptr.h>
+
+#include <random>
+#include <string>
+#include <fstream>
+#include <thread>
 
 using namespace pcomn ;
 
@@ -23,6 +30,7 @@ class ShortestNetPrefixSetTests : public CppUnit::TestFixture {
     void Test_ShortestNetPrefixSet_IPv6_Build() ;
     void Test_ShortestNetPrefixSet_IPv4_MemberTest() ;
     void Test_ShortestNetPrefixSet_IPv6_MemberTest() ;
+    void Test_ShortestNetPrefixSet_MemberTestMany() ;
 
     CPPUNIT_TEST_SUITE(ShortestNetPrefixSetTests) ;
 
@@ -31,6 +39,59 @@ class ShortestNetPrefixSetTests : public CppUnit::TestFixture {
     CPPUNIT_TEST(Test_ShortestNetPrefixSet_IPv6_Build) ;
     CPPUNIT_TEST(Test_ShortestNetPrefixSet_IPv4_MemberTest) ;
     CPPUNIT_TEST(Test_ShortestNetPrefixSet_IPv6_MemberTest) ;
+    CPPUNIT_TEST(Test_ShortestNetPrefixSet_MemberTestMany) ;
+
+    CPPUNIT_TEST_SUITE_END() ;
+} ;
+
+/*******************************************************************************
+                            class IPAddrPrefixMapTests
+*******************************************************************************/
+class IPAddrPrefixMapTests : public CppUnit::TestFixture {
+
+    void Test_IPAddrPrefixMap_IPv4() ;
+    void Test_IPAddrPrefixMap_IPv6() ;
+
+    CPPUNIT_TEST_SUITE(IPAddrPrefixMapTests) ;
+
+    CPPUNIT_TEST(Test_IPAddrPrefixMap_IPv4) ;
+    CPPUNIT_TEST(Test_IPAddrPrefixMap_IPv6) ;
+
+    CPPUNIT_TEST_SUITE_END() ;
+} ;
+
+/*******************************************************************************
+                            class NetPrefixBuilderTests
+*******************************************************************************/
+class NetPrefixBuilderTests : public CppUnit::TestFixture {
+
+    void Test_PrefixSetBuilder_Basic() ;
+    void Test_PrefixSetBuilder_Delta() ;
+    void Test_PrefixSetBuilder_SnapshotHolder() ;
+
+    CPPUNIT_TEST_SUITE(NetPrefixBuilderTests) ;
+
+    CPPUNIT_TEST(Test_PrefixSetBuilder_Basic) ;
+    CPPUNIT_TEST(Test_PrefixSetBuilder_Delta) ;
+    CPPUNIT_TEST(Test_PrefixSetBuilder_SnapshotHolder) ;
+
+    CPPUNIT_TEST_SUITE_END() ;
+} ;
+
+/*******************************************************************************
+                            class NetPrefixFileTests
+*******************************************************************************/
+extern const char NETPREFIX_FILE_FIXTURE[] = "netprefix_file" ;
+
+class NetPrefixFileTests : public unit::TestFixture<NETPREFIX_FILE_FIXTURE> {
+
+    void Test_NetPrefixSet_SaveLoad() ;
+    void Test_NetPrefixSet_LoadInvalid() ;
+
+    CPPUNIT_TEST_SUITE(NetPrefixFileTests) ;
+
+    CPPUNIT_TEST(Test_NetPrefixSet_SaveLoad) ;
+    CPPUNIT_TEST(Test_NetPrefixSet_LoadInvalid) ;
 
     CPPUNIT_TEST_SUITE_END() ;
 } ;
@@ -215,6 +276,20 @@ void ShortestNetPrefixSetTests::Test_ShortestNetPrefixSet_IPv4_MemberTest()
     CPPUNIT_LOG_IS_FALSE(private_set.is_member({172, 15, 0, 1})) ;
 
     CPPUNIT_LOG_IS_FALSE(private_set.is_member({8, 8, 8, 8})) ;
+
+    CPPUNIT_LOG(std::endl) ;
+
+    // Subnets that share the leading part of the trie path
+    netprefix_set shared_path_set({{"10.1.0.0/16"},
+                                   {"10.2.0.0/16"},
+                                   {"10.3.128.0/17"}}) ;
+
+    CPPUNIT_LOG_ASSERT(shared_path_set.is_member({10, 1, 2, 3})) ;
+    CPPUNIT_LOG_ASSERT(shared_path_set.is_member({10, 2, 2, 3})) ;
+    CPPUNIT_LOG_ASSERT(shared_path_set.is_member({10, 3, 200, 3})) ;
+    CPPUNIT_LOG_IS_FALSE(shared_path_set.is_member({10, 3, 2, 3})) ;
+    CPPUNIT_LOG_IS_FALSE(shared_path_set.is_member({10, 0, 2, 3})) ;
+    CPPUNIT_LOG_IS_FALSE(shared_path_set.is_member({10, 4, 2, 3})) ;
 }
 
 void ShortestNetPrefixSetTests::Test_ShortestNetPrefixSet_IPv6_MemberTest()
@@ -251,11 +326,518 @@ void ShortestNetPrefixSetTests::Test_ShortestNetPrefixSet_IPv6_MemberTest()
     */
 }
 
+template<typename Addr>
+static bitarray member_bits(const ipaddr_prefix_set<Addr> &set, const std::vector<Addr> &addrs)
+{
+    bitarray result (addrs.size()) ;
+    for (size_t i = 0 ; i < addrs.size() ; ++i)
+        result.set(i, set.is_member(addrs[i])) ;
+    return result ;
+}
+
+void ShortestNetPrefixSetTests::Test_ShortestNetPrefixSet_MemberTestMany()
+{
+    typedef ipaddr_prefix_set<ipv4_addr> netprefix_set ;
+
+    const netprefix_set empty_set ;
+    const netprefix_set any_set ({{ipv4_addr(1, 0, 0, 0), 0}}) ;
+    const netprefix_set private_set({{"127.0.0.1/24"},
+                                     {"10.0.0.1/8"},
+                                     {"172.16.0.1/12"},
+                                     {"192.168.0.0/16"}}) ;
+
+    const std::vector<ipv4_addr> addrs {{127, 0, 0, 255}, {127, 1, 0, 255}, {172, 20, 0, 255},
+                                        {172, 15, 0, 1}, {8, 8, 8, 8}, {10, 1, 2, 3}} ;
+    bitarray found ;
+
+    CPPUNIT_LOG_EQ(private_set.is_member_many(addrs.data(), addrs.size(), found), 3) ;
+    CPPUNIT_LOG_EQ(found, 101001_bit) ;
+    CPPUNIT_LOG_EQ(any_set.is_member_many(addrs.data(), addrs.size(), found), 6) ;
+    CPPUNIT_LOG_EQ(found, 111111_bit) ;
+    CPPUNIT_LOG_EQ(empty_set.is_member_many(addrs.data(), addrs.size(), found), 0) ;
+    CPPUNIT_LOG_EQ(found, 000000_bit) ;
+
+    CPPUNIT_LOG_EQ(private_set.is_member_many(addrs.data(), 0, found), 0) ;
+    CPPUNIT_LOG_EQ(found.size(), 0) ;
+
+    CPPUNIT_LOG(std::endl) ;
+
+    // Random subnets: the batch lookup must match is_member() exactly, including a
+    // tail shorter than the lookup batch.
+    std::mt19937_64 rng (1) ;
+    const auto random_ipv6 = [&rng]
+    {
+        const uint64_t hi = rng() ;
+        const uint64_t lo = rng() ;
+        return ipv6_addr(hi >> 48, hi >> 32, hi >> 16, hi, lo >> 48, lo >> 32, lo >> 16, lo) ;
+    } ;
+
+    std::vector<ipv4_subnet> subnets4 (5000) ;
+    std::vector<ipv6_subnet> subnets6 (5000) ;
+    for (ipv4_subnet &subnet: subnets4)
+        subnet = ipv4_subnet(ipv4_addr((uint32_t)rng()), 8 + rng()%25) ;
+    for (ipv6_subnet &subnet: subnets6)
+        subnet = ipv6_subnet(random_ipv6(), 8 + rng()%121) ;
+
+    std::vector<ipv4_addr> addrs4 ;
+    std::vector<ipv6_addr> addrs6 ;
+    for (unsigned i = 0 ; i < 10007 ; ++i)
+    {
+        addrs4.push_back(i % 2 ? ipv4_addr((uint32_t)rng()) : subnets4[i % subnets4.size()].addr()) ;
+        addrs6.push_back(i % 2 ? random_ipv6() : subnets6[i % subnets6.size()].addr()) ;
+    }
+
+    const ipaddr_prefix_set<ipv4_addr> set4 (subnets4) ;
+    const ipaddr_prefix_set<ipv6_addr> set6 (subnets6) ;
+    const bitarray expected4 (member_bits(set4, addrs4)) ;
+    const bitarray expected6 (member_bits(set6, addrs6)) ;
+
+    CPPUNIT_LOG_EQ(set4.is_member_many(addrs4.data(), addrs4.size(), found), expected4.count()) ;
+    CPPUNIT_LOG_EQ(found, expected4) ;
+    CPPUNIT_LOG_EQ(set6.is_member_many(addrs6.data(), addrs6.size(), found), expected6.count()) ;
+    CPPUNIT_LOG_EQ(found, expected6) ;
+}
+
+/*******************************************************************************
+ IPAddrPrefixMapTests
+*******************************************************************************/
+void IPAddrPrefixMapTests::Test_IPAddrPrefixMap_IPv4()
+{
+    typedef ipaddr_prefix_map<ipv4_addr, std::string> route_map ;
+
+    const route_map empty_map ;
+    std::string route ("none") ;
+
+    CPPUNIT_LOG_ASSERT(empty_map.empty()) ;
+    CPPUNIT_LOG_EQ(empty_map.nodes_count(), 1) ;
+    CPPUNIT_LOG_EQ(empty_map.depth(), 1) ;
+    CPPUNIT_LOG_IS_NULL(empty_map.find({127, 0, 0, 1})) ;
+    CPPUNIT_LOG_IS_FALSE(empty_map.get({127, 0, 0, 1}, route)) ;
+    CPPUNIT_LOG_EQ(route, "none") ;
+
+    CPPUNIT_LOG(std::endl) ;
+
+    const route_map routes ({{{"0.0.0.0/0"},       "default"},
+                             {{"10.0.0.1/8"},      "ten"},
+                             {{"10.1.0.0/16"},     "ten-one"},
+                             {{"10.1.2.0/24"},     "ten-one-two"},
+                             {{"10.1.2.3/32"},     "host"},
+                             {{"10.1.0.0/16"},     "duplicate"},
+                             {{"192.168.0.0/17"},  "private-low"},
+                             {{"192.168.128.0/17"},"private-high"}}) ;
+
+    CPPUNIT_LOG_EQ(routes.size(), 7) ;
+    CPPUNIT_LOG_EQ(routes.depth(), 6) ;
+    CPPUNIT_LOG_EQ(routes.begin()->first, ipv4_subnet("0.0.0.0/0")) ;
+    CPPUNIT_LOG_EQ(routes.begin()[1].first, ipv4_subnet("10.0.0.0/8")) ;
+
+    CPPUNIT_LOG_ASSERT(routes.get({10, 1, 2, 3}, route)) ;
+    CPPUNIT_LOG_EQ(route, "host") ;
+    CPPUNIT_LOG_ASSERT(routes.get({10, 1, 2, 4}, route)) ;
+    CPPUNIT_LOG_EQ(route, "ten-one-two") ;
+    CPPUNIT_LOG_ASSERT(routes.get({10, 1, 3, 3}, route)) ;
+    CPPUNIT_LOG_EQ(route, "ten-one") ;
+    CPPUNIT_LOG_ASSERT(routes.get({10, 2, 2, 3}, route)) ;
+    CPPUNIT_LOG_EQ(route, "ten") ;
+    CPPUNIT_LOG_ASSERT(routes.get({11, 1, 2, 3}, route)) ;
+    CPPUNIT_LOG_EQ(route, "default") ;
+    CPPUNIT_LOG_ASSERT(routes.get({192, 168, 127, 255}, route)) ;
+    CPPUNIT_LOG_EQ(route, "private-low") ;
+    CPPUNIT_LOG_ASSERT(routes.get({192, 168, 128, 0}, route)) ;
+    CPPUNIT_LOG_EQ(route, "private-high") ;
+
+    CPPUNIT_LOG_ASSERT(routes.find({10, 1, 2, 3})) ;
+    CPPUNIT_LOG_EQ(routes.find({10, 1, 2, 3})->first, ipv4_subnet("10.1.2.3/32")) ;
+    CPPUNIT_LOG_EQ(routes.count({8, 8, 8, 8}), 1) ;
+
+    CPPUNIT_LOG(std::endl) ;
+
+    const route_map no_default ({{{"10.1.0.0/16"}, "ten-one"}, {{"10.1.2.3/32"}, "host"}}) ;
+
+    CPPUNIT_LOG_IS_NULL(no_default.find({10, 0, 0, 1})) ;
+    CPPUNIT_LOG_IS_NULL(no_default.find({11, 1, 2, 3})) ;
+    CPPUNIT_LOG_EQ(no_default.count({11, 1, 2, 3}), 0) ;
+    CPPUNIT_LOG_EQ(no_default.find({10, 1, 2, 2})->second, "ten-one") ;
+    CPPUNIT_LOG_EQ(no_default.find({10, 1, 2, 3})->second, "host") ;
+}
+
+void IPAddrPrefixMapTests::Test_IPAddrPrefixMap_IPv6()
+{
+    typedef ipaddr_prefix_map<ipv6_addr, int> route_map ;
+
+    const route_map routes ({{{"2001:db8::/32"},         1},
+                             {{"2001:db8:5::/48"},       2},
+                             {{"2001:db8:5:1234::/64"},  3},
+                             {{"2001:db8:5:1234::1/128"},4},
+                             {{"::/0"},                  0}}) ;
+
+    int route = -1 ;
+    CPPUNIT_LOG_EQ(routes.size(), 5) ;
+    CPPUNIT_LOG_EQ(routes.depth(), 22) ;
+
+    CPPUNIT_LOG_ASSERT(routes.get(ipv6_addr(0x2001, 0xdb8, 5, 0x1234, 0, 0, 0, 1), route)) ;
+    CPPUNIT_LOG_EQ(route, 4) ;
+    CPPUNIT_LOG_ASSERT(routes.get(ipv6_addr(0x2001, 0xdb8, 5, 0x1234, 0, 0, 0, 2), route)) ;
+    CPPUNIT_LOG_EQ(route, 3) ;
+    CPPUNIT_LOG_ASSERT(routes.get(ipv6_addr(0x2001, 0xdb8, 5, 0x1235, 0, 0, 0, 1), route)) ;
+    CPPUNIT_LOG_EQ(route, 2) ;
+    CPPUNIT_LOG_ASSERT(routes.get(ipv6_addr(0x2001, 0xdb8, 6, 0, 0, 0, 0, 1), route)) ;
+    CPPUNIT_LOG_EQ(route, 1) ;
+    CPPUNIT_LOG_ASSERT(routes.get(ipv6_addr::localhost(), route)) ;
+    CPPUNIT_LOG_EQ(route, 0) ;
+
+    CPPUNIT_LOG(std::endl) ;
+
+    // Compare with the linear search of the longest matching prefix.
+    std::mt19937_64 rng (2) ;
+    const auto random_ipv6 = [&rng]
+    {
+        const uint64_t hi = rng() ;
+        const uint64_t lo = rng() ;
+        // Keep addresses close to each other to get long common prefixes.
+        return ipv6_addr(0x2001, 0xdb8, hi >> 62, hi, lo >> 48, lo >> 32, lo >> 16, lo & 3) ;
+    } ;
+
+    std::vector<route_map::value_type> items ;
+    for (int i = 0 ; i < 2000 ; ++i)
+        items.emplace_back(ipv6_subnet(random_ipv6(), rng() % 129), i) ;
+
+    const route_map random_routes (items) ;
+    unsigned mismatches = 0 ;
+    for (int i = 0 ; i < 4000 ; ++i)
+    {
+        const ipv6_addr addr = i % 2 ? random_ipv6() : items[rng() % items.size()].first.addr() ;
+        int expected = -1 ;
+        unsigned longest = 0 ;
+        for (const route_map::value_type &item: items)
+            if (item.first.match(addr) && (expected < 0 || item.first.pfxlen() > longest))
+            {
+                expected = item.second ;
+                longest = item.first.pfxlen() ;
+            }
+        const route_map::value_type * const found = random_routes.find(addr) ;
+        mismatches += (found ? found->second : -1) != expected ;
+    }
+    CPPUNIT_LOG_EQ(mismatches, 0) ;
+}
+
+/*******************************************************************************
+ NetPrefixBuilderTests
+*******************************************************************************/
+void NetPrefixBuilderTests::Test_PrefixSetBuilder_Basic()
+{
+    typedef ipaddr_prefix_set_builder<ipv4_addr> builder_type ;
+
+    CPPUNIT_LOG_EXCEPTION(builder_type(0), std::invalid_argument) ;
+    CPPUNIT_LOG_EXCEPTION(builder_type(6), std::invalid_argument) ;
+    CPPUNIT_LOG_EXCEPTION(ipaddr_prefix_set_builder<ipv6_addr>(11), std::invalid_argument) ;
+
+    builder_type builder ;
+    CPPUNIT_LOG_EQ(builder.partition_levels(), 2) ;
+    CPPUNIT_LOG_EQ(builder.size(), 0) ;
+    CPPUNIT_LOG_IS_FALSE(builder.snapshot().is_member({127, 0, 0, 1})) ;
+
+    CPPUNIT_LOG(std::endl) ;
+    builder.add({{"127.0.0.1/24"}, {"10.0.0.1/8"}, {"172.16.0.1/12"}, {"192.168.0.0/16"}, {"10.1.0.0/16"}}) ;
+    CPPUNIT_LOG_EQ(builder.size(), 5) ;
+    CPPUNIT_LOG_EQ(builder.partitions_count(), 3) ;
+
+    const auto private_set = builder.snapshot() ;
+    CPPUNIT_LOG_EQ(builder.recompiled_count(), 3) ;
+    CPPUNIT_LOG_ASSERT(private_set.is_member({127, 0, 0, 255})) ;
+    CPPUNIT_LOG_IS_FALSE(private_set.is_member({127, 1, 0, 255})) ;
+    CPPUNIT_LOG_ASSERT(private_set.is_member({172, 20, 0, 255})) ;
+    CPPUNIT_LOG_IS_FALSE(private_set.is_member({172, 15, 0, 1})) ;
+    CPPUNIT_LOG_ASSERT(private_set.is_member({10, 20, 0, 255})) ;
+    CPPUNIT_LOG_EQ(private_set.depth(), 4) ;
+
+    CPPUNIT_LOG(std::endl) ;
+    // Removing the covering prefix reveals the covered one
+    builder.remove({{"10.0.0.0/8"}, {"11.0.0.0/8"}}) ;
+    CPPUNIT_LOG_EQ(builder.size(), 4) ;
+
+    const auto no_ten = builder.snapshot() ;
+    CPPUNIT_LOG_EQ(builder.recompiled_count(), 0) ;
+    CPPUNIT_LOG_IS_FALSE(no_ten.is_member({10, 20, 0, 255})) ;
+    CPPUNIT_LOG_ASSERT(no_ten.is_member({10, 1, 0, 255})) ;
+    CPPUNIT_LOG_ASSERT(private_set.is_member({10, 20, 0, 255})) ;
+
+    CPPUNIT_LOG(std::endl) ;
+    // An emptied partition is dropped, not recompiled
+    builder.add({{"0.0.0.0/0"}}).remove({{"127.0.0.0/24"}}) ;
+    const auto any_set = builder.snapshot() ;
+    CPPUNIT_LOG_EQ(builder.recompiled_count(), 0) ;
+    CPPUNIT_LOG_EQ(builder.partitions_count(), 2) ;
+    CPPUNIT_LOG_EQ(any_set.depth(), 1) ;
+    CPPUNIT_LOG_ASSERT(any_set.is_member({8, 8, 8, 8})) ;
+}
+
+template<typename Subnet>
+static std::vector<Subnet> normalized(std::vector<Subnet> v)
+{
+    for (Subnet &subnet: v)
+        subnet = subnet.subnet() ;
+    std::sort(v.begin(), v.end()) ;
+    v.erase(std::unique(v.begin(), v.end()), v.end()) ;
+    return v ;
+}
+
+void NetPrefixBuilderTests::Test_PrefixSetBuilder_Delta()
+{
+    std::mt19937_64 rng (1) ;
+
+    // Mostly long prefixes, like in real routing tables, with few short ones.
+    const auto random_subnet4 = [&rng]
+    {
+        return ipv4_subnet(ipv4_addr((uint32_t)rng()), rng()%512 ? 13 + rng()%20 : 8 + rng()%5) ;
+    } ;
+    const auto random_subnet6 = [&rng]
+    {
+        const uint64_t hi = rng() ;
+        return ipv6_subnet(ipv6_addr(0x2000 | (hi >> 60), hi >> 32 & 0xff, hi >> 16, hi, rng() >> 48, 0, 0, 0),
+                           rng()%512 ? 28 + rng()%40 : 20 + rng()%8) ;
+    } ;
+
+    const auto check_deltas = [&rng](auto &builder, auto random_subnet)
+    {
+        typedef std::remove_reference_t<decltype(builder)> builder_type ;
+        typedef typename builder_type::subnet_type subnet_type ;
+        typedef typename builder_type::addr_type   addr_type ;
+
+        std::vector<subnet_type> source ;
+        for (unsigned i = 0 ; i < 3000 ; ++i)
+            source.push_back(random_subnet()) ;
+        builder.add(source) ;
+        source = normalized(source) ;
+
+        CPPUNIT_EQUAL(builder.snapshot().nodes_count(), ipaddr_prefix_set<addr_type>(source).nodes_count()) ;
+        CPPUNIT_EQUAL(builder.recompiled_count(), builder.partitions_count()) ;
+
+        for (unsigned round = 0 ; round < 20 ; ++round)
+        {
+            std::vector<subnet_type> added ;
+            std::vector<subnet_type> removed ;
+            for (unsigned i = 0 ; i < 5 ; ++i)
+            {
+                added.push_back(random_subnet()) ;
+                removed.push_back(source[rng() % source.size()]) ;
+            }
+            builder.remove(removed).add(added) ;
+
+            std::vector<subnet_type> expected (normalized(added)) ;
+            std::copy_if(source.begin(), source.end(), std::back_inserter(expected), [&](const subnet_type &s)
+            {
+                return std::find(removed.begin(), removed.end(), s) == removed.end() ;
+            }) ;
+            source = normalized(expected) ;
+
+            const auto snapshot = builder.snapshot() ;
+            const ipaddr_prefix_set<addr_type> rebuilt (source) ;
+
+            CPPUNIT_EQUAL(builder.size(), source.size()) ;
+            CPPUNIT_ASSERT(builder.recompiled_count() <= added.size() + removed.size()) ;
+            CPPUNIT_EQUAL(snapshot.depth(), rebuilt.depth()) ;
+            CPPUNIT_EQUAL(snapshot.nodes_count(), rebuilt.nodes_count()) ;
+
+            std::vector<addr_type> addrs ;
+            for (unsigned i = 0 ; i < 4000 ; ++i)
+                addrs.push_back(i % 2 ? random_subnet().addr() : source[rng() % source.size()].addr()) ;
+
+            bitarray found ;
+            snapshot.is_member_many(addrs.data(), addrs.size(), found) ;
+            CPPUNIT_EQUAL(found, member_bits(rebuilt, addrs)) ;
+        }
+        CPPUNIT_LOG("Partitions: " << builder.partitions_count() << ", nodes: "
+                    << builder.snapshot().nodes_count() << std::endl) ;
+    } ;
+
+    for (unsigned levels: {1, 2, 5})
+    {
+        ipaddr_prefix_set_builder<ipv4_addr> builder (levels) ;
+        CPPUNIT_LOG_RUN(check_deltas(builder, random_subnet4)) ;
+    }
+    for (unsigned levels: {1, 4, 10})
+    {
+        ipaddr_prefix_set_builder<ipv6_addr> builder (levels) ;
+        CPPUNIT_LOG_RUN(check_deltas(builder, random_subnet6)) ;
+    }
+}
+
+void NetPrefixBuilderTests::Test_PrefixSetBuilder_SnapshotHolder()
+{
+    typedef ipaddr_prefix_set_builder<ipv4_addr> builder_type ;
+    typedef builder_type::set_type               set_type ;
+
+    builder_type builder ({{"10.0.0.0/8"}}) ;
+    snapshot_holder<set_type> prefixes (std::make_unique<set_type>(builder.snapshot())) ;
+
+    std::atomic<bool> stop {false} ;
+    std::atomic<size_t> mismatches {0} ;
+    std::atomic<size_t> lookups {0} ;
+
+    // Readers check the prefix that is in every snapshot while the writer replaces
+    // snapshots as fast as it can.
+    std::vector<std::thread> readers ;
+    for (unsigned t = 0 ; t < 4 ; ++t)
+        readers.emplace_back([&]
+        {
+            size_t count = 0 ;
+            while (!stop.load(std::memory_order_relaxed))
+            {
+                mismatches += !prefixes.read([](const set_type &set) { return set.is_member({10, 1, 2, 3}) ; }) ;
+                ++count ;
+            }
+            lookups += count ;
+        }) ;
+
+    for (unsigned i = 0 ; i < 1000 ; ++i)
+    {
+        const ipv4_subnet subnet (ipv4_addr(11, 0, i >> 8, i & 0xff), 32) ;
+        builder.add({subnet}) ;
+        if (i >= 8)
+            builder.remove({ipv4_subnet(ipv4_addr(11, 0, (i - 8) >> 8, (i - 8) & 0xff), 32)}) ;
+        prefixes.reset(std::make_unique<set_type>(builder.snapshot())) ;
+
+        CPPUNIT_EQUAL(builder.recompiled_count(), 1) ;
+        CPPUNIT_ASSERT(prefixes.read([&](const set_type &set) { return set.is_member(subnet.addr()) ; })) ;
+    }
+
+    stop = true ;
+    for (std::thread &reader: readers)
+        reader.join() ;
+
+    CPPUNIT_LOG_EQ(mismatches.load(), 0) ;
+    CPPUNIT_LOG_ASSERT(lookups.load()) ;
+    CPPUNIT_LOG_EQ(prefixes.reclaim(), 0) ;
+    CPPUNIT_LOG_ASSERT(prefixes.read([](const set_type &set) { return set.is_member({11, 0, 3, 231}) ; })) ;
+    CPPUNIT_LOG_IS_FALSE(prefixes.read([](const set_type &set) { return set.is_member({11, 0, 3, 222}) ; })) ;
+}
+
+/*******************************************************************************
+ NetPrefixFileTests
+*******************************************************************************/
+void NetPrefixFileTests::Test_NetPrefixSet_SaveLoad()
+{
+    typedef ipaddr_prefix_set<ipv4_addr> netprefix_set ;
+
+    const std::string empty_file (at_data_dir("empty.trie")) ;
+    const std::string any_file (at_data_dir("any.trie")) ;
+    const std::string private_file (at_data_dir("private.trie")) ;
+
+    CPPUNIT_LOG_RUN(netprefix_set().save(empty_file.c_str())) ;
+    CPPUNIT_LOG_RUN(netprefix_set({{ipv4_addr(1, 0, 0, 0), 0}}).save(any_file.c_str())) ;
+    CPPUNIT_LOG_RUN(netprefix_set({{"127.0.0.1/24"},
+                                   {"10.0.0.1/8"},
+                                   {"172.16.0.1/12"},
+                                   {"192.168.0.0/16"}}).save(private_file.c_str())) ;
+
+    const netprefix_set empty_set (PMemMapping(empty_file.c_str())) ;
+    const netprefix_set any_set (PMemMapping(any_file.c_str())) ;
+    netprefix_set private_set (PMemMapping(private_file.c_str())) ;
+
+    CPPUNIT_LOG_ASSERT(private_set.is_mapped()) ;
+    CPPUNIT_LOG_EQ(empty_set.depth(), 0) ;
+    CPPUNIT_LOG_EQ(empty_set.nodes_count(), 0) ;
+    CPPUNIT_LOG_EQ(any_set.depth(), 1) ;
+    CPPUNIT_LOG_EQ(any_set.nodes_count(), 1) ;
+    CPPUNIT_LOG_EQ(private_set.depth(), 4) ;
+    CPPUNIT_LOG_EQ(private_set.nodes_count(), 8) ;
+
+    CPPUNIT_LOG_IS_FALSE(empty_set.is_member({127, 0, 0, 1})) ;
+    CPPUNIT_LOG_ASSERT(any_set.is_member({127, 0, 0, 1})) ;
+    CPPUNIT_LOG_ASSERT(private_set.is_member({127, 0, 0, 255})) ;
+    CPPUNIT_LOG_IS_FALSE(private_set.is_member({127, 1, 0, 255})) ;
+    CPPUNIT_LOG_ASSERT(private_set.is_member({172, 20, 0, 255})) ;
+    CPPUNIT_LOG_IS_FALSE(private_set.is_member({172, 15, 0, 1})) ;
+    CPPUNIT_LOG_IS_FALSE(private_set.is_member({8, 8, 8, 8})) ;
+
+    CPPUNIT_LOG(std::endl) ;
+
+    // Overwriting the file doesn't affect the set mapped from the previous version.
+    CPPUNIT_LOG_RUN(netprefix_set({{"8.8.8.8/32"}}).save(private_file.c_str())) ;
+    CPPUNIT_LOG_ASSERT(private_set.is_member({172, 20, 0, 255})) ;
+    CPPUNIT_LOG_IS_FALSE(private_set.is_member({8, 8, 8, 8})) ;
+    CPPUNIT_LOG_ASSERT(netprefix_set(PMemMapping(private_file.c_str())).is_member({8, 8, 8, 8})) ;
+
+    // A mapped set can be moved and saved again.
+    netprefix_set moved_set (std::move(private_set)) ;
+    CPPUNIT_LOG_ASSERT(moved_set.is_mapped()) ;
+    CPPUNIT_LOG_IS_FALSE(private_set.is_mapped()) ;
+    CPPUNIT_LOG_RUN(moved_set.save(private_file.c_str())) ;
+    CPPUNIT_LOG_ASSERT(netprefix_set(PMemMapping(private_file.c_str())).is_member({10, 1, 2, 3})) ;
+
+    CPPUNIT_LOG(std::endl) ;
+
+    // Compare with the source on random IPv6 subnets.
+    std::mt19937_64 rng (3) ;
+    const auto random_ipv6 = [&rng]
+    {
+        const uint64_t hi = rng() ;
+        const uint64_t lo = rng() ;
+        return ipv6_addr(0x2001, hi >> 48, hi >> 32, hi, lo >> 48, lo >> 32, lo >> 16, lo) ;
+    } ;
+    std::vector<ipv6_subnet> subnets (5000) ;
+    for (ipv6_subnet &subnet: subnets)
+        subnet = ipv6_subnet(random_ipv6(), 20 + rng()%109) ;
+
+    const std::string ipv6_file (at_data_dir("ipv6.trie")) ;
+    const ipaddr_prefix_set<ipv6_addr> built_set (subnets) ;
+    CPPUNIT_LOG_RUN(built_set.save(ipv6_file.c_str())) ;
+    const ipaddr_prefix_set<ipv6_addr> mapped_set (PMemMapping(ipv6_file.c_str())) ;
+
+    CPPUNIT_LOG_EQ(mapped_set.nodes_count(), built_set.nodes_count()) ;
+    CPPUNIT_LOG_EQ(mapped_set.depth(), built_set.depth()) ;
+
+    unsigned mismatches = 0 ;
+    for (unsigned i = 0 ; i < 10000 ; ++i)
+    {
+        const ipv6_addr addr = i % 2 ? random_ipv6() : subnets[i % subnets.size()].addr() ;
+        mismatches += mapped_set.is_member(addr) != built_set.is_member(addr) ;
+    }
+    CPPUNIT_LOG_EQ(mismatches, 0) ;
+}
+
+void NetPrefixFileTests::Test_NetPrefixSet_LoadInvalid()
+{
+    const std::string ipv4_file (at_data_dir("ipv4.trie")) ;
+    const std::string garbage_file (at_data_dir("garbage.trie")) ;
+
+    const ipaddr_prefix_set<ipv4_addr> ipv4_set ({{"10.0.0.1/8"}, {"192.168.0.0/16"}}) ;
+    CPPUNIT_LOG_RUN(ipv4_set.save(ipv4_file.c_str())) ;
+
+    CPPUNIT_LOG_EXCEPTION(ipaddr_prefix_set<ipv6_addr>(PMemMapping(ipv4_file.c_str())), std::invalid_argument) ;
+
+    const std::string data (readfile(ipv4_file)) ;
+    CPPUNIT_LOG_EQ(data.size(), 64 + 24*ipv4_set.nodes_count()) ;
+
+    const auto write_garbage = [&](const std::string &content)
+    {
+        std::ofstream(garbage_file, std::ios::trunc).write(content.data(), content.size()) ;
+        return PMemMapping(garbage_file.c_str()) ;
+    } ;
+
+    // Truncated
+    CPPUNIT_LOG_EXCEPTION(ipaddr_prefix_set<ipv4_addr>(write_garbage(data.substr(0, 32))), std::invalid_argument) ;
+    CPPUNIT_LOG_EXCEPTION(ipaddr_prefix_set<ipv4_addr>(write_garbage(data.substr(0, data.size() - 1))),
+                          std::invalid_argument) ;
+    // Bad magic
+    CPPUNIT_LOG_EXCEPTION(ipaddr_prefix_set<ipv4_addr>(write_garbage("X" + data.substr(1))), std::invalid_argument) ;
+    // Unknown version
+    std::string bad_version (data) ;
+    ++bad_version[12] ;
+    CPPUNIT_LOG_EXCEPTION(ipaddr_prefix_set<ipv4_addr>(write_garbage(bad_version)), std::invalid_argument) ;
+
+    CPPUNIT_LOG_ASSERT(ipaddr_prefix_set<ipv4_addr>(write_garbage(data)).is_member({192, 168, 1, 1})) ;
+}
+
 int main(int argc, char *argv[])
 {
    return pcomn::unit::run_tests
       <
-         ShortestNetPrefixSetTests
+         ShortestNetPrefixSetTests,
+         IPAddrPrefixMapTests,
+         NetPrefixBuilderTests,
+         NetPrefixFileTests
       >
       (argc, argv) ;
 }